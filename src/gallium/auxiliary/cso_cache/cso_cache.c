@@ -29,64 +29,80 @@
  */
 
 #include "util/u_debug.h"
-
+#include "util/u_math.h"
 #include "util/u_memory.h"
 
 #include "cso_cache.h"
 #include "cso_hash.h"
 
 
+/**
+ * One slot of the open-addressing table holding the states of one type.
+ */
+struct cso_cache_slot {
+   unsigned hash_key;
+   void *state;                 /**< NULL if the slot is free */
+   uint64_t last_used;          /**< cso_cache::clock of the last lookup */
+};
+
+/**
+ * Linearly probed table, at most half full so probe sequences stay short.
+ */
+struct cso_cache_table {
+   struct cso_cache_slot *slots;
+   unsigned size;               /**< 0 or a power of two */
+   unsigned count;
+};
+
 struct cso_cache {
-   struct cso_hash *hashes[CSO_CACHE_MAX];
+   struct cso_cache_table tables[CSO_CACHE_MAX];
+   uint64_t clock;
    int    max_size;
 
-   cso_sanitize_callback sanitize_cb;
-   void                 *sanitize_data;
+   cso_evict_callback evict_cb;
+   void              *evict_data;
 };
 
-#if 1
+#define CSO_CACHE_MIN_TABLE_SIZE 32
+
+
+static inline uint32_t rotl32(uint32_t x, unsigned r)
+{
+   return (x << r) | (x >> (32 - r));
+}
+
+/**
+ * MurmurHash3 (x86_32) over whole words.  Unlike XOR-ing the words
+ * together, every bit of the template affects every bit of the hash,
+ * which the open-addressing table relies on to keep probe sequences short.
+ */
 static unsigned hash_key(const void *key, unsigned key_size)
 {
-   unsigned *ikey = (unsigned *)key;
-   unsigned hash = 0, i;
+   const uint32_t *ikey = (const uint32_t *)key;
+   uint32_t hash = key_size;
+   unsigned i;
 
    assert(key_size % 4 == 0);
 
-   /* I'm sure this can be improved on:
-    */
-   for (i = 0; i < key_size/4; i++)
-      hash ^= ikey[i];
+   for (i = 0; i < key_size/4; i++) {
+      uint32_t k = ikey[i] * 0xcc9e2d51;
+      k = rotl32(k, 15) * 0x1b873593;
+      hash = rotl32(hash ^ k, 13) * 5 + 0xe6546b64;
+   }
 
+   hash ^= hash >> 16;
+   hash *= 0x85ebca6b;
+   hash ^= hash >> 13;
+   hash *= 0xc2b2ae35;
+   hash ^= hash >> 16;
    return hash;
 }
-#else
-static unsigned hash_key(const unsigned char *p, int n)
-{
-   unsigned h = 0;
-   unsigned g;
-
-   while (n--) {
-      h = (h << 4) + *p++;
-      if ((g = (h & 0xf0000000)) != 0)
-         h ^= g >> 23;
-      h &= ~g;
-   }
-   return h;
-}
-#endif
 
 unsigned cso_construct_key(void *item, int item_size)
 {
    return hash_key((item), item_size);
 }
 
-static inline struct cso_hash *_cso_hash_for_type(struct cso_cache *sc, enum cso_cache_type type)
-{
-   struct cso_hash *hash;
-   hash = sc->hashes[type];
-   return hash;
-}
-
 static void delete_blend_state(void *state, void *data)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
@@ -152,54 +168,185 @@ static inline void delete_cso(void *state, enum cso_cache_type type)
 }
 
 
-static inline void sanitize_hash(struct cso_cache *sc,
-                                 struct cso_hash *hash,
-                                 enum cso_cache_type type,
-                                 int max_size)
+/**
+ * Insert without growing; the table must have a free slot.
+ */
+static void table_insert(struct cso_cache_table *table,
+                         const struct cso_cache_slot *entry)
+{
+   unsigned mask = table->size - 1;
+   unsigned i = entry->hash_key & mask;
+
+   while (table->slots[i].state)
+      i = (i + 1) & mask;
+
+   table->slots[i] = *entry;
+   table->count++;
+}
+
+static boolean table_grow(struct cso_cache_table *table)
 {
-   if (sc->sanitize_cb)
-      sc->sanitize_cb(hash, type, max_size, sc->sanitize_data);
+   struct cso_cache_table old = *table;
+   unsigned size = old.size ? old.size * 2 : CSO_CACHE_MIN_TABLE_SIZE;
+   unsigned i;
+
+   table->slots = CALLOC(size, sizeof(struct cso_cache_slot));
+   if (!table->slots) {
+      *table = old;
+      return FALSE;
+   }
+   table->size = size;
+   table->count = 0;
+
+   for (i = 0; i < old.size; i++) {
+      if (old.slots[i].state)
+         table_insert(table, &old.slots[i]);
+   }
+   FREE(old.slots);
+   return TRUE;
 }
 
+/**
+ * Free slot i, moving later entries of the probe sequence back so lookups
+ * never need tombstones.
+ */
+static void table_remove(struct cso_cache_table *table, unsigned i)
+{
+   unsigned mask = table->size - 1;
+   unsigned j = i;
+
+   for (;;) {
+      unsigned home;
+
+      j = (j + 1) & mask;
+      if (!table->slots[j].state)
+         break;
+
+      /* The entry at j can fill the hole at i unless its home slot lies
+       * cyclically in (i, j].
+       */
+      home = table->slots[j].hash_key & mask;
+      if (i <= j ? (home <= i || home > j) : (home <= i && home > j)) {
+         table->slots[i] = table->slots[j];
+         i = j;
+      }
+   }
+
+   table->slots[i].state = NULL;
+   table->count--;
+}
 
-static inline void sanitize_cb(struct cso_hash *hash, enum cso_cache_type type,
-                               int max_size, void *user_data)
+/**
+ * Partially order stamps[0..n-1] so that stamps[k] holds the value it
+ * would have if sorted (quickselect).
+ */
+static uint64_t select_stamp(uint64_t *stamps, unsigned n, unsigned k)
 {
-   /* if we're approach the maximum size, remove fourth of the entries
-    * otherwise every subsequent call will go through the same */
-   int hash_size = cso_hash_size(hash);
-   int max_entries = (max_size > hash_size) ? max_size : hash_size;
-   int to_remove =  (max_size < max_entries) * max_entries/4;
-   if (hash_size > max_size)
-      to_remove += hash_size - max_size;
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      struct cso_hash_iter iter = cso_hash_first_node(hash);
-      void  *cso = cso_hash_take(hash, cso_hash_iter_key(iter));
-      delete_cso(cso, type);
-      --to_remove;
+   unsigned lo = 0, hi = n - 1;
+
+   while (lo < hi) {
+      uint64_t pivot = stamps[lo + (hi - lo) / 2];
+      unsigned i = lo, j = hi;
+
+      while (i <= j) {
+         while (stamps[i] < pivot)
+            i++;
+         while (stamps[j] > pivot)
+            j--;
+         if (i <= j) {
+            uint64_t tmp = stamps[i];
+            stamps[i] = stamps[j];
+            stamps[j] = tmp;
+            i++;
+            if (j == 0)
+               break;
+            j--;
+         }
+      }
+
+      if (k <= j)
+         hi = j;
+      else if (k >= i)
+         lo = i;
+      else
+         break;
    }
+   return stamps[k];
 }
 
-struct cso_hash_iter
+/**
+ * Once a table reaches the maximum size, delete the least recently looked
+ * up quarter of it so that the following insertions don't each have to
+ * evict.  States the evict callback wants to keep stay in the table.
+ */
+static void evict_lru(struct cso_cache *sc, enum cso_cache_type type)
+{
+   struct cso_cache_table *table = &sc->tables[type];
+   unsigned max_size = MAX2(sc->max_size, 1);
+   unsigned to_remove, n, i;
+   uint64_t *stamps, threshold;
+
+   if (table->count < max_size)
+      return;
+
+   to_remove = table->count - max_size + MAX2(max_size / 4, 1);
+   to_remove = MIN2(to_remove, table->count);
+
+   stamps = MALLOC(table->count * sizeof(uint64_t));
+   if (!stamps)
+      return;
+
+   for (i = 0, n = 0; i < table->size; i++) {
+      if (table->slots[i].state)
+         stamps[n++] = table->slots[i].last_used;
+   }
+   threshold = select_stamp(stamps, n, to_remove - 1);
+   FREE(stamps);
+
+   for (i = 0; i < table->size && to_remove; ) {
+      struct cso_cache_slot *slot = &table->slots[i];
+
+      if (slot->state && slot->last_used <= threshold &&
+          sc->evict_cb(slot->state, type, sc->evict_data)) {
+         /* Another entry may have moved into slot i. */
+         table_remove(table, i);
+         to_remove--;
+      }
+      else {
+         i++;
+      }
+   }
+}
+
+static boolean default_evict_cb(void *state, enum cso_cache_type type,
+                                void *user_data)
+{
+   delete_cso(state, type);
+   return TRUE;
+}
+
+/**
+ * Add a state to the cache.  state must point to one of the cso_* structs,
+ * whose template comes first.  Returns FALSE if out of memory.
+ */
+boolean
 cso_insert_state(struct cso_cache *sc,
                  unsigned hash_key, enum cso_cache_type type,
                  void *state)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   sanitize_hash(sc, hash, type, sc->max_size);
+   struct cso_cache_table *table = &sc->tables[type];
+   struct cso_cache_slot entry;
 
-   return cso_hash_insert(hash, hash_key, state);
-}
+   evict_lru(sc, type);
 
-struct cso_hash_iter
-cso_find_state(struct cso_cache *sc,
-               unsigned hash_key, enum cso_cache_type type)
-{
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
+   if ((table->count + 1) * 2 > table->size && !table_grow(table))
+      return FALSE;
 
-   return cso_hash_find(hash, hash_key);
+   entry.hash_key = hash_key;
+   entry.state = state;
+   entry.last_used = ++sc->clock;
+   table_insert(table, &entry);
+   return TRUE;
 }
 
 
@@ -222,40 +369,41 @@ void *cso_hash_find_data_from_template( struct cso_hash *hash,
 }
 
 
-struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
-                                             unsigned hash_key, enum cso_cache_type type,
-                                             void *templ, unsigned size)
+/**
+ * Return the cached state whose first size bytes match templ, or NULL.
+ */
+void *
+cso_find_state_template(struct cso_cache *sc,
+                        unsigned hash_key, enum cso_cache_type type,
+                        const void *templ, unsigned size)
 {
-   struct cso_hash_iter iter = cso_find_state(sc, hash_key, type);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *iter_data = cso_hash_iter_data(iter);
-      if (!memcmp(iter_data, templ, size))
-         return iter;
-      iter = cso_hash_iter_next(iter);
-   }
-   return iter;
-}
+   struct cso_cache_table *table = &sc->tables[type];
+   unsigned mask = table->size - 1;
+   unsigned i;
 
-void * cso_take_state(struct cso_cache *sc,
-                      unsigned hash_key, enum cso_cache_type type)
-{
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   return cso_hash_take(hash, hash_key);
+   if (!table->size)
+      return NULL;
+
+   for (i = hash_key & mask; table->slots[i].state; i = (i + 1) & mask) {
+      struct cso_cache_slot *slot = &table->slots[i];
+
+      if (slot->hash_key == hash_key && !memcmp(slot->state, templ, size)) {
+         slot->last_used = ++sc->clock;
+         return slot->state;
+      }
+   }
+   return NULL;
 }
 
 struct cso_cache *cso_cache_create(void)
 {
-   struct cso_cache *sc = MALLOC_STRUCT(cso_cache);
-   int i;
+   struct cso_cache *sc = CALLOC_STRUCT(cso_cache);
    if (sc == NULL)
       return NULL;
 
    sc->max_size           = 4096;
-   for (i = 0; i < CSO_CACHE_MAX; i++)
-      sc->hashes[i] = cso_hash_create();
-
-   sc->sanitize_cb        = sanitize_cb;
-   sc->sanitize_data      = 0;
+   sc->evict_cb           = default_evict_cb;
+   sc->evict_data         = NULL;
 
    return sc;
 }
@@ -263,16 +411,12 @@ struct cso_cache *cso_cache_create(void)
 void cso_for_each_state(struct cso_cache *sc, enum cso_cache_type type,
                         cso_state_callback func, void *user_data)
 {
-   struct cso_hash *hash = _cso_hash_for_type(sc, type);
-   struct cso_hash_iter iter;
+   struct cso_cache_table *table = &sc->tables[type];
+   unsigned i;
 
-   iter = cso_hash_first_node(hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      void *state = cso_hash_iter_data(iter);
-      iter = cso_hash_iter_next(iter);
-      if (state) {
-         func(state, user_data);
-      }
+   for (i = 0; i < table->size; i++) {
+      if (table->slots[i].state)
+         func(table->slots[i].state, user_data);
    }
 }
 
@@ -292,7 +436,7 @@ void cso_cache_delete(struct cso_cache *sc)
    cso_for_each_state(sc, CSO_VELEMENTS, delete_velements, 0);
 
    for (i = 0; i < CSO_CACHE_MAX; i++)
-      cso_hash_delete(sc->hashes[i]);
+      FREE(sc->tables[i].slots);
 
    FREE(sc);
 }
@@ -304,7 +448,7 @@ void cso_set_maximum_cache_size(struct cso_cache *sc, int number)
    sc->max_size = number;
 
    for (i = 0; i < CSO_CACHE_MAX; i++)
-      sanitize_hash(sc, sc->hashes[i], i, sc->max_size);
+      evict_lru(sc, i);
 }
 
 int cso_maximum_cache_size(const struct cso_cache *sc)
@@ -312,11 +456,10 @@ int cso_maximum_cache_size(const struct cso_cache *sc)
    return sc->max_size;
 }
 
-void cso_cache_set_sanitize_callback(struct cso_cache *sc,
-                                     cso_sanitize_callback cb,
-                                     void *user_data)
+void cso_cache_set_evict_callback(struct cso_cache *sc,
+                                  cso_evict_callback cb,
+                                  void *user_data)
 {
-   sc->sanitize_cb   = cb;
-   sc->sanitize_data = user_data;
+   sc->evict_cb   = cb ? cb : default_evict_cb;
+   sc->evict_data = user_data;
 }
-
@@ -76,10 +76,6 @@
 #include "pipe/p_context.h"
 #include "pipe/p_state.h"
 
-/* cso_hash.h is necessary for cso_hash_iter, as MSVC requires structures
- * returned by value to be fully defined */
-#include "cso_hash.h"
-
 
 #ifdef	__cplusplus
 extern "C" {
@@ -96,9 +92,12 @@ enum cso_cache_type {
 
 typedef void (*cso_state_callback)(void *ctx, void *obj);
 
-typedef void (*cso_sanitize_callback)(struct cso_hash *hash,
+/**
+ * Called on the least recently used states of a full cache.  Deletes the
+ * state and returns TRUE, or returns FALSE to keep a state still in use.
+ */
+typedef boolean (*cso_evict_callback)(void *state,
                                       enum cso_cache_type type,
-                                      int max_size,
                                       void *user_data);
 
 struct cso_cache;
@@ -148,22 +147,18 @@ unsigned cso_construct_key(void *item, int item_size);
 struct cso_cache *cso_cache_create(void);
 void cso_cache_delete(struct cso_cache *sc);
 
-void cso_cache_set_sanitize_callback(struct cso_cache *sc,
-                                     cso_sanitize_callback cb,
-                                     void *user_data);
-
-struct cso_hash_iter cso_insert_state(struct cso_cache *sc,
-                                      unsigned hash_key, enum cso_cache_type type,
-                                      void *state);
-struct cso_hash_iter cso_find_state(struct cso_cache *sc,
-                                    unsigned hash_key, enum cso_cache_type type);
-struct cso_hash_iter cso_find_state_template(struct cso_cache *sc,
-                                             unsigned hash_key, enum cso_cache_type type,
-                                             void *templ, unsigned size);
+void cso_cache_set_evict_callback(struct cso_cache *sc,
+                                  cso_evict_callback cb,
+                                  void *user_data);
+
+boolean cso_insert_state(struct cso_cache *sc,
+                         unsigned hash_key, enum cso_cache_type type,
+                         void *state);
+void *cso_find_state_template(struct cso_cache *sc,
+                              unsigned hash_key, enum cso_cache_type type,
+                              const void *templ, unsigned size);
 void cso_for_each_state(struct cso_cache *sc, enum cso_cache_type type,
                         cso_state_callback func, void *user_data);
-void * cso_take_state(struct cso_cache *sc, unsigned hash_key,
-                      enum cso_cache_type type);
 
 void cso_set_maximum_cache_size(struct cso_cache *sc, int number);
 int cso_maximum_cache_size(const struct cso_cache *sc);
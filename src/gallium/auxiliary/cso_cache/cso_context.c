@@ -46,7 +46,6 @@
 
 #include "cso_cache/cso_context.h"
 #include "cso_cache/cso_cache.h"
-#include "cso_cache/cso_hash.h"
 #include "cso_context.h"
 
 
@@ -57,6 +56,7 @@
 struct sampler_info
 {
    void *samplers[PIPE_MAX_SAMPLERS];
+   struct cso_sampler *csos[PIPE_MAX_SAMPLERS];
    unsigned nr_samplers;
 };
 
@@ -78,6 +78,7 @@ struct cso_context {
    unsigned nr_fragment_views_saved;
 
    void *fragment_samplers_saved[PIPE_MAX_SAMPLERS];
+   struct cso_sampler *fragment_sampler_csos_saved[PIPE_MAX_SAMPLERS];
    unsigned nr_fragment_samplers_saved;
 
    struct sampler_info samplers[PIPE_SHADER_TYPES];
@@ -108,6 +109,16 @@ struct cso_context {
    void *tesseval_shader, *tesseval_shader_saved;
    void *velements, *velements_saved;
    struct pipe_query *render_condition, *render_condition_saved;
+
+   /** Cache entries of the current and saved state, which let setting
+    * the state that is already bound skip the cache lookup.  The cache
+    * doesn't evict them.
+    */
+   struct cso_blend *blend_cso, *blend_cso_saved;
+   struct cso_depth_stencil_alpha *depth_stencil_cso, *depth_stencil_cso_saved;
+   struct cso_rasterizer *rasterizer_cso, *rasterizer_cso_saved;
+   struct cso_velements *velements_cso, *velements_cso_saved;
+
    uint render_condition_mode, render_condition_mode_saved;
    boolean render_condition_cond, render_condition_cond_saved;
 
@@ -124,7 +135,7 @@ static boolean delete_blend_state(struct cso_context *ctx, void *state)
 {
    struct cso_blend *cso = (struct cso_blend *)state;
 
-   if (ctx->blend == cso->data)
+   if (ctx->blend == cso->data || ctx->blend_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
@@ -138,7 +149,8 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
    struct cso_depth_stencil_alpha *cso =
       (struct cso_depth_stencil_alpha *)state;
 
-   if (ctx->depth_stencil == cso->data)
+   if (ctx->depth_stencil == cso->data ||
+       ctx->depth_stencil_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
@@ -151,6 +163,19 @@ static boolean delete_depth_stencil_state(struct cso_context *ctx, void *state)
 static boolean delete_sampler_state(struct cso_context *ctx, void *state)
 {
    struct cso_sampler *cso = (struct cso_sampler *)state;
+   unsigned sh, i;
+
+   for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
+      for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+         if (ctx->samplers[sh].csos[i] == cso)
+            return FALSE;
+      }
+   }
+   for (i = 0; i < PIPE_MAX_SAMPLERS; i++) {
+      if (ctx->fragment_sampler_csos_saved[i] == cso)
+         return FALSE;
+   }
+
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
    FREE(state);
@@ -161,7 +186,7 @@ static boolean delete_rasterizer_state(struct cso_context *ctx, void *state)
 {
    struct cso_rasterizer *cso = (struct cso_rasterizer *)state;
 
-   if (ctx->rasterizer == cso->data)
+   if (ctx->rasterizer == cso->data || ctx->rasterizer_saved == cso->data)
       return FALSE;
    if (cso->delete_state)
       cso->delete_state(cso->context, cso->data);
@@ -174,7 +199,7 @@ static boolean delete_vertex_elements(struct cso_context *ctx,
 {
    struct cso_velements *cso = (struct cso_velements *)state;
 
-   if (ctx->velements == cso->data)
+   if (ctx->velements == cso->data || ctx->velements_saved == cso->data)
       return FALSE;
 
    if (cso->delete_state)
@@ -205,29 +230,10 @@ static inline boolean delete_cso(struct cso_context *ctx,
    return FALSE;
 }
 
-static inline void
-sanitize_hash(struct cso_hash *hash, enum cso_cache_type type,
-              int max_size, void *user_data)
+static boolean
+evict_cso(void *state, enum cso_cache_type type, void *user_data)
 {
-   struct cso_context *ctx = (struct cso_context *)user_data;
-   /* if we're approach the maximum size, remove fourth of the entries
-    * otherwise every subsequent call will go through the same */
-   int hash_size = cso_hash_size(hash);
-   int max_entries = (max_size > hash_size) ? max_size : hash_size;
-   int to_remove =  (max_size < max_entries) * max_entries/4;
-   struct cso_hash_iter iter = cso_hash_first_node(hash);
-   if (hash_size > max_size)
-      to_remove += hash_size - max_size;
-   while (to_remove) {
-      /*remove elements until we're good */
-      /*fixme: currently we pick the nodes to remove at random*/
-      void *cso = cso_hash_iter_data(iter);
-      if (delete_cso(ctx, cso, type)) {
-         iter = cso_hash_erase(hash, iter);
-         --to_remove;
-      } else
-         iter = cso_hash_iter_next(iter);
-   }
+   return delete_cso((struct cso_context *)user_data, state, type);
 }
 
 static void cso_init_vbuf(struct cso_context *cso)
@@ -250,9 +256,7 @@ struct cso_context *cso_create_context( struct pipe_context *pipe )
    ctx->cache = cso_cache_create();
    if (ctx->cache == NULL)
       goto out;
-   cso_cache_set_sanitize_callback(ctx->cache,
-                                   sanitize_hash,
-                                   ctx);
+   cso_cache_set_evict_callback(ctx->cache, evict_cso, ctx);
 
    ctx->pipe = pipe;
    ctx->sample_mask = ~0;
@@ -385,18 +389,21 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
                               const struct pipe_blend_state *templ)
 {
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
-   void *handle;
+   struct cso_blend *cso;
 
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
+
+   if (ctx->blend_cso && !memcmp(&ctx->blend_cso->state, templ, key_size))
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)templ, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
-                                  (void*)templ, key_size);
+   cso = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
+                                 templ, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
+   if (!cso) {
+      cso = MALLOC(sizeof(struct cso_blend));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -406,21 +413,17 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
       cso->delete_state = (cso_state_callback)ctx->pipe->delete_blend_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_BLEND, cso)) {
+         cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
    }
 
-   if (ctx->blend != handle) {
-      ctx->blend = handle;
-      ctx->pipe->bind_blend_state(ctx->pipe, handle);
+   ctx->blend_cso = cso;
+   if (ctx->blend != cso->data) {
+      ctx->blend = cso->data;
+      ctx->pipe->bind_blend_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -429,6 +432,7 @@ void cso_save_blend(struct cso_context *ctx)
 {
    assert(!ctx->blend_saved);
    ctx->blend_saved = ctx->blend;
+   ctx->blend_cso_saved = ctx->blend_cso;
 }
 
 void cso_restore_blend(struct cso_context *ctx)
@@ -437,7 +441,9 @@ void cso_restore_blend(struct cso_context *ctx)
       ctx->blend = ctx->blend_saved;
       ctx->pipe->bind_blend_state(ctx->pipe, ctx->blend_saved);
    }
+   ctx->blend_cso = ctx->blend_cso_saved;
    ctx->blend_saved = NULL;
+   ctx->blend_cso_saved = NULL;
 }
 
 
@@ -447,16 +453,19 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
-   void *handle;
-
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_depth_stencil_alpha *cso =
-         MALLOC(sizeof(struct cso_depth_stencil_alpha));
+   unsigned hash_key;
+   struct cso_depth_stencil_alpha *cso;
+
+   if (ctx->depth_stencil_cso &&
+       !memcmp(&ctx->depth_stencil_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   cso = cso_find_state_template(ctx->cache, hash_key,
+                                 CSO_DEPTH_STENCIL_ALPHA, templ, key_size);
+
+   if (!cso) {
+      cso = MALLOC(sizeof(struct cso_depth_stencil_alpha));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -467,23 +476,18 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          (cso_state_callback)ctx->pipe->delete_depth_stencil_alpha_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key,
-                              CSO_DEPTH_STENCIL_ALPHA, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key,
+                            CSO_DEPTH_STENCIL_ALPHA, cso)) {
+         cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_depth_stencil_alpha *)
-                cso_hash_iter_data(iter))->data;
    }
 
-   if (ctx->depth_stencil != handle) {
-      ctx->depth_stencil = handle;
-      ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
+   ctx->depth_stencil_cso = cso;
+   if (ctx->depth_stencil != cso->data) {
+      ctx->depth_stencil = cso->data;
+      ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -492,6 +496,7 @@ void cso_save_depth_stencil_alpha(struct cso_context *ctx)
 {
    assert(!ctx->depth_stencil_saved);
    ctx->depth_stencil_saved = ctx->depth_stencil;
+   ctx->depth_stencil_cso_saved = ctx->depth_stencil_cso;
 }
 
 void cso_restore_depth_stencil_alpha(struct cso_context *ctx)
@@ -501,7 +506,9 @@ void cso_restore_depth_stencil_alpha(struct cso_context *ctx)
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe,
                                                 ctx->depth_stencil_saved);
    }
+   ctx->depth_stencil_cso = ctx->depth_stencil_cso_saved;
    ctx->depth_stencil_saved = NULL;
+   ctx->depth_stencil_cso_saved = NULL;
 }
 
 
@@ -510,15 +517,19 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
-   void *handle = NULL;
-
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
+   unsigned hash_key;
+   struct cso_rasterizer *cso;
+
+   if (ctx->rasterizer_cso &&
+       !memcmp(&ctx->rasterizer_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   cso = cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                 templ, key_size);
+
+   if (!cso) {
+      cso = MALLOC(sizeof(struct cso_rasterizer));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -528,21 +539,17 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          (cso_state_callback)ctx->pipe->delete_rasterizer_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_RASTERIZER, cso)) {
+         cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
    }
 
-   if (ctx->rasterizer != handle) {
-      ctx->rasterizer = handle;
-      ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
+   ctx->rasterizer_cso = cso;
+   if (ctx->rasterizer != cso->data) {
+      ctx->rasterizer = cso->data;
+      ctx->pipe->bind_rasterizer_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -551,6 +558,7 @@ void cso_save_rasterizer(struct cso_context *ctx)
 {
    assert(!ctx->rasterizer_saved);
    ctx->rasterizer_saved = ctx->rasterizer;
+   ctx->rasterizer_cso_saved = ctx->rasterizer_cso;
 }
 
 void cso_restore_rasterizer(struct cso_context *ctx)
@@ -559,7 +567,9 @@ void cso_restore_rasterizer(struct cso_context *ctx)
       ctx->rasterizer = ctx->rasterizer_saved;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, ctx->rasterizer_saved);
    }
+   ctx->rasterizer_cso = ctx->rasterizer_cso_saved;
    ctx->rasterizer_saved = NULL;
+   ctx->rasterizer_cso_saved = NULL;
 }
 
 
@@ -914,8 +924,7 @@ cso_set_vertex_elements(struct cso_context *ctx,
 {
    struct u_vbuf *vbuf = ctx->vbuf;
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
-   void *handle;
+   struct cso_velements *cso;
    struct cso_velems_state velems_state;
 
    if (vbuf) {
@@ -932,12 +941,16 @@ cso_set_vertex_elements(struct cso_context *ctx,
    velems_state.count = count;
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
+   if (ctx->velements_cso &&
+       !memcmp(&ctx->velements_cso->state, &velems_state, key_size))
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)&velems_state, key_size);
-   iter = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
+   cso = cso_find_state_template(ctx->cache, hash_key, CSO_VELEMENTS,
+                                 &velems_state, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_velements *cso = MALLOC(sizeof(struct cso_velements));
+   if (!cso) {
+      cso = MALLOC(sizeof(struct cso_velements));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -948,21 +961,17 @@ cso_set_vertex_elements(struct cso_context *ctx,
          (cso_state_callback) ctx->pipe->delete_vertex_elements_state;
       cso->context = ctx->pipe;
 
-      iter = cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso);
-      if (cso_hash_iter_is_null(iter)) {
+      if (!cso_insert_state(ctx->cache, hash_key, CSO_VELEMENTS, cso)) {
+         cso->delete_state(cso->context, cso->data);
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
    }
 
-   if (ctx->velements != handle) {
-      ctx->velements = handle;
-      ctx->pipe->bind_vertex_elements_state(ctx->pipe, handle);
+   ctx->velements_cso = cso;
+   if (ctx->velements != cso->data) {
+      ctx->velements = cso->data;
+      ctx->pipe->bind_vertex_elements_state(ctx->pipe, cso->data);
    }
    return PIPE_OK;
 }
@@ -978,6 +987,7 @@ void cso_save_vertex_elements(struct cso_context *ctx)
 
    assert(!ctx->velements_saved);
    ctx->velements_saved = ctx->velements;
+   ctx->velements_cso_saved = ctx->velements_cso;
 }
 
 void cso_restore_vertex_elements(struct cso_context *ctx)
@@ -993,7 +1003,9 @@ void cso_restore_vertex_elements(struct cso_context *ctx)
       ctx->velements = ctx->velements_saved;
       ctx->pipe->bind_vertex_elements_state(ctx->pipe, ctx->velements_saved);
    }
+   ctx->velements_cso = ctx->velements_cso_saved;
    ctx->velements_saved = NULL;
+   ctx->velements_cso_saved = NULL;
 }
 
 /* vertex buffers */
@@ -1066,6 +1078,20 @@ unsigned cso_get_aux_vertex_buffer_slot(struct cso_context *ctx)
    return ctx->aux_vertex_buffer_index;
 }
 
+void cso_enable_static_vertex_translations(struct cso_context *ctx,
+                                           boolean enable)
+{
+   if (ctx->vbuf)
+      u_vbuf_enable_static_translations(ctx->vbuf, enable);
+}
+
+void cso_invalidate_buffer(struct cso_context *ctx,
+                           struct pipe_resource *buffer)
+{
+   if (ctx->vbuf)
+      u_vbuf_invalidate_buffer(ctx->vbuf, buffer);
+}
+
 
 /**************** fragment/vertex sampler view state *************************/
 
@@ -1073,18 +1099,23 @@ enum pipe_error
 cso_single_sampler(struct cso_context *ctx, unsigned shader_stage,
                    unsigned idx, const struct pipe_sampler_state *templ)
 {
-   void *handle = NULL;
+   struct sampler_info *info = &ctx->samplers[shader_stage];
+   struct cso_sampler *cso = NULL;
 
    if (templ != NULL) {
       unsigned key_size = sizeof(struct pipe_sampler_state);
-      unsigned hash_key = cso_construct_key((void*)templ, key_size);
-      struct cso_hash_iter iter =
-         cso_find_state_template(ctx->cache,
-                                 hash_key, CSO_SAMPLER,
-                                 (void *) templ, key_size);
-
-      if (cso_hash_iter_is_null(iter)) {
-         struct cso_sampler *cso = MALLOC(sizeof(struct cso_sampler));
+      unsigned hash_key;
+
+      if (info->csos[idx] &&
+          !memcmp(&info->csos[idx]->state, templ, key_size))
+         return PIPE_OK;
+
+      hash_key = cso_construct_key((void*)templ, key_size);
+      cso = cso_find_state_template(ctx->cache, hash_key, CSO_SAMPLER,
+                                    templ, key_size);
+
+      if (!cso) {
+         cso = MALLOC(sizeof(struct cso_sampler));
          if (!cso)
             return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -1094,20 +1125,16 @@ cso_single_sampler(struct cso_context *ctx, unsigned shader_stage,
             (cso_state_callback) ctx->pipe->delete_sampler_state;
          cso->context = ctx->pipe;
 
-         iter = cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso);
-         if (cso_hash_iter_is_null(iter)) {
+         if (!cso_insert_state(ctx->cache, hash_key, CSO_SAMPLER, cso)) {
+            cso->delete_state(cso->context, cso->data);
             FREE(cso);
             return PIPE_ERROR_OUT_OF_MEMORY;
          }
-
-         handle = cso->data;
-      }
-      else {
-         handle = ((struct cso_sampler *)cso_hash_iter_data(iter))->data;
       }
    }
 
-   ctx->samplers[shader_stage].samplers[idx] = handle;
+   info->csos[idx] = cso;
+   info->samplers[idx] = cso ? cso->data : NULL;
    return PIPE_OK;
 }
 
@@ -1173,6 +1200,8 @@ cso_save_fragment_samplers(struct cso_context *ctx)
    ctx->nr_fragment_samplers_saved = info->nr_samplers;
    memcpy(ctx->fragment_samplers_saved, info->samplers,
           sizeof(info->samplers));
+   memcpy(ctx->fragment_sampler_csos_saved, info->csos,
+          sizeof(info->csos));
 }
 
 
@@ -1184,6 +1213,8 @@ cso_restore_fragment_samplers(struct cso_context *ctx)
    info->nr_samplers = ctx->nr_fragment_samplers_saved;
    memcpy(info->samplers, ctx->fragment_samplers_saved,
           sizeof(info->samplers));
+   memcpy(info->csos, ctx->fragment_sampler_csos_saved,
+          sizeof(info->csos));
    cso_single_sampler_done(ctx, PIPE_SHADER_FRAGMENT);
 }
 
@@ -1265,6 +1296,18 @@ cso_restore_fragment_sampler_views(struct cso_context *ctx)
 }
 
 
+/* The bound targets may have been written by stream output. */
+static void
+invalidate_so_targets(struct cso_context *ctx)
+{
+   unsigned i;
+
+   for (i = 0; i < ctx->nr_so_targets; i++) {
+      if (ctx->so_targets[i])
+         cso_invalidate_buffer(ctx, ctx->so_targets[i]->buffer);
+   }
+}
+
 void
 cso_set_stream_outputs(struct cso_context *ctx,
                        unsigned num_targets,
@@ -1284,6 +1327,8 @@ cso_set_stream_outputs(struct cso_context *ctx,
       return;
    }
 
+   invalidate_so_targets(ctx);
+
    /* reference new targets */
    for (i = 0; i < num_targets; i++) {
       pipe_so_target_reference(&ctx->so_targets[i], targets[i]);
@@ -1331,6 +1376,8 @@ cso_restore_stream_outputs(struct cso_context *ctx)
       return;
    }
 
+   invalidate_so_targets(ctx);
+
    assert(ctx->nr_so_targets_saved <= PIPE_MAX_SO_BUFFERS);
    for (i = 0; i < ctx->nr_so_targets_saved; i++) {
       pipe_so_target_reference(&ctx->so_targets[i], NULL);
@@ -1432,6 +1479,27 @@ cso_draw_vbo(struct cso_context *cso,
    }
 }
 
+/**
+ * Do several draws sharing their state, see pipe_context::multi_draw.
+ * Vertex buffers which u_vbuf has to translate may differ from one draw to
+ * the next, so it gets the draws one at a time.
+ */
+void
+cso_multi_draw(struct cso_context *cso,
+               const struct pipe_draw_info *info,
+               unsigned num_draws)
+{
+   struct u_vbuf *vbuf = cso->vbuf;
+   unsigned i;
+
+   if (vbuf) {
+      for (i = 0; i < num_draws; i++)
+         u_vbuf_draw_vbo(vbuf, &info[i]);
+   } else {
+      util_draw_multi(cso->pipe, info, num_draws);
+   }
+}
+
 void
 cso_draw_arrays(struct cso_context *cso, uint mode, uint start, uint count)
 {
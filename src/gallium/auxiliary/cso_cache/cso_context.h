@@ -105,6 +105,14 @@ void cso_save_aux_vertex_buffer_slot(struct cso_context *ctx);
 void cso_restore_aux_vertex_buffer_slot(struct cso_context *ctx);
 unsigned cso_get_aux_vertex_buffer_slot(struct cso_context *ctx);
 
+/* For state trackers that report every buffer write with
+ * cso_invalidate_buffer: keep translated copies of static vertex buffers
+ * the driver can't fetch from directly. */
+void cso_enable_static_vertex_translations(struct cso_context *ctx,
+                                           boolean enable);
+void cso_invalidate_buffer(struct cso_context *ctx,
+                           struct pipe_resource *buffer);
+
 
 void cso_set_stream_outputs(struct cso_context *ctx,
                             unsigned num_targets,
@@ -225,6 +233,11 @@ void
 cso_draw_vbo(struct cso_context *cso,
              const struct pipe_draw_info *info);
 
+void
+cso_multi_draw(struct cso_context *cso,
+               const struct pipe_draw_info *info,
+               unsigned num_draws);
+
 void
 cso_draw_arrays_instanced(struct cso_context *cso, uint mode,
                           uint start, uint count,
@@ -98,10 +98,21 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
          /* Do the hardwired planes first:
           */
          if (flags & DO_CLIP_XY_GUARD_BAND) {
-            if (-0.50 * position[0] + position[3] < 0) mask |= (1<<0);
-            if ( 0.50 * position[0] + position[3] < 0) mask |= (1<<1);
-            if (-0.50 * position[1] + position[3] < 0) mask |= (1<<2);
-            if ( 0.50 * position[1] + position[3] < 0) mask |= (1<<3);
+            if (-0.50f * position[0] + position[3] < 0) mask |= (1<<0);
+            if ( 0.50f * position[0] + position[3] < 0) mask |= (1<<1);
+            if (-0.50f * position[1] + position[3] < 0) mask |= (1<<2);
+            if ( 0.50f * position[1] + position[3] < 0) mask |= (1<<3);
+
+            /* Vertices between the viewport and the guard band aren't
+             * clipped, but the clip stage needs to see their triangles to
+             * count them.
+             */
+            if ((flags & DO_GUARD_BAND_STATS) &&
+                (-position[0] + position[3] < 0 ||
+                  position[0] + position[3] < 0 ||
+                 -position[1] + position[3] < 0 ||
+                  position[1] + position[3] < 0))
+               need_pipeline |= GUARD_BAND_VERTEX;
          }
          else if (flags & DO_CLIP_XY) {
             if (-position[0] + position[3] < 0) mask |= (1<<0);
@@ -1065,6 +1065,53 @@ draw_collect_pipeline_statistics(struct draw_context *draw,
    draw->collect_statistics = enable;
 }
 
+/**
+ * Returns the post-transform vertex cache hit counts of the last
+ * draw_vbo() call, e.g. to judge how cache friendly an index order is.
+ */
+void
+draw_get_vertex_cache_stats(const struct draw_context *draw,
+                            struct draw_vertex_cache_stats *stats)
+{
+   *stats = draw->vertex_cache_stats;
+}
+
+/**
+ * Counting the triangles the guard band saves from clipping makes them go
+ * through the pipeline, even if nothing else needs it, so it's disabled by
+ * default.
+ */
+void
+draw_collect_clip_stats(struct draw_context *draw, boolean enable)
+{
+   draw_do_flush( draw, DRAW_FLUSH_STATE_CHANGE );
+
+   draw->collect_clip_stats = enable;
+}
+
+/**
+ * Returns how many triangles of the last draw_vbo() call were clipped, and
+ * how many the guard band (see draw_set_driver_clipping()) saved from it.
+ */
+void
+draw_get_clip_stats(const struct draw_context *draw,
+                    struct draw_clip_stats *stats)
+{
+   *stats = draw->clip_stats;
+}
+
+/**
+ * Returns how many adjacency primitives (or primitives needing their ids
+ * injected) the last draw_vbo() call decomposed without a geometry shader,
+ * and how many vertices were copied doing so.
+ */
+void
+draw_get_assembler_stats(const struct draw_context *draw,
+                         struct draw_assembler_stats *stats)
+{
+   *stats = draw->ia_stats;
+}
+
 /**
  * Computes clipper invocation statistics.
  *
@@ -62,6 +62,38 @@ struct draw_so_target {
    int internal_offset;
 };
 
+/*
+ * How well the front end's post-transform vertex cache did in the last
+ * draw_vbo() call: of the 'indices' it looked up, 'hits' reused a vertex
+ * which had already been shaded.
+ */
+struct draw_vertex_cache_stats {
+   unsigned indices;
+   unsigned hits;
+};
+
+/*
+ * Triangles of the last draw_vbo() call which went through the clipper,
+ * and ones which crossed the viewport edges but were passed on unclipped
+ * as they lay within the guard band.  The latter are only counted while
+ * draw_collect_clip_stats() is enabled.
+ */
+struct draw_clip_stats {
+   unsigned clipped;
+   unsigned guard_band;
+};
+
+/*
+ * Primitives of the last draw_vbo() call which the primitive assembler
+ * decomposed, and the vertices it copied for them.  It only copies them
+ * when primitive ids need injecting, otherwise the primitives index the
+ * shaded vertices.
+ */
+struct draw_assembler_stats {
+   unsigned primitives;
+   unsigned copied_vertices;
+};
+
 struct draw_context *draw_create( struct pipe_context *pipe );
 
 #if HAVE_LLVM
@@ -280,6 +312,17 @@ void draw_set_force_passthrough( struct draw_context *draw,
 void draw_collect_pipeline_statistics(struct draw_context *draw,
                                       boolean enable);
 
+void draw_get_vertex_cache_stats(const struct draw_context *draw,
+                                 struct draw_vertex_cache_stats *stats);
+
+void draw_collect_clip_stats(struct draw_context *draw, boolean enable);
+
+void draw_get_clip_stats(const struct draw_context *draw,
+                         struct draw_clip_stats *stats);
+
+void draw_get_assembler_stats(const struct draw_context *draw,
+                              struct draw_assembler_stats *stats);
+
 /*******************************************************************************
  * Draw pipeline 
  */
@@ -406,7 +406,7 @@ static void gs_flush(struct draw_geometry_shader *shader)
    unsigned input_primitives = shader->fetched_prim_count;
 
    if (shader->draw->collect_statistics) {
-      shader->draw->statistics.gs_invocations += input_primitives;
+      shader->statistics->gs_invocations += input_primitives;
    }
 
    debug_assert(input_primitives > 0 &&
@@ -528,6 +528,33 @@ static void gs_tri_adj(struct draw_geometry_shader *shader,
 #include "draw_gs_tmp.h"
 
 
+/* Count the primitives gs_run() would fetch, without fetching them. */
+#define FUNC         gs_count_prims
+#define FUNC_VARS    const struct draw_prim_info *input_prims,    \
+                     unsigned *num_prims
+#define FUNC_ENTER                                                \
+   const unsigned prim = input_prims->prim;                       \
+   const unsigned prim_flags = input_prims->flags;                \
+   const unsigned count = input_prims->count;                     \
+   const boolean quads_flatshade_last = FALSE;                    \
+   const boolean last_vertex_last = TRUE;                         \
+   switch (prim) {                                                \
+   case PIPE_PRIM_QUADS:                                          \
+   case PIPE_PRIM_QUAD_STRIP:                                     \
+   case PIPE_PRIM_POLYGON:                                        \
+      return;                                                     \
+   default:                                                       \
+      break;                                                      \
+   }
+#define GET_ELT(idx)                          (idx)
+#define POINT(i0)                             ++*num_prims
+#define LINE(flags,i0,i1)                     ++*num_prims
+#define TRIANGLE(flags,i0,i1,i2)              ++*num_prims
+#define LINE_ADJ(flags,i0,i1,i2,i3)           ++*num_prims
+#define TRIANGLE_ADJ(flags,i0,i1,i2,i3,i4,i5) ++*num_prims
+#include "draw_decompose_tmp.h"
+
+
 /**
  * Execute geometry shader.
  */
@@ -665,7 +692,7 @@ int draw_geometry_shader_run(struct draw_geometry_shader *shader,
    if (shader->draw->collect_statistics) {
       unsigned i;
       for (i = 0; i < shader->emitted_primitives; ++i) {
-         shader->draw->statistics.gs_primitives +=
+         shader->statistics->gs_primitives +=
             u_decomposed_prims_for_vertices(shader->output_primitive,
                                             shader->primitive_lengths[i]);
       }
@@ -680,15 +707,115 @@ int draw_geometry_shader_run(struct draw_geometry_shader *shader,
    return shader->emitted_vertices;
 }
 
+
+/**
+ * Like draw_geometry_shader_run(), but may be called from vertex processing
+ * thread 'thread' concurrently with the other threads, as long as the
+ * shader has thread copies.  The input primitives are numbered from
+ * 'in_prim_idx' on, the statistics are counted in 'statistics', and the
+ * caller owns the returned primitive lengths.
+ */
+int draw_geometry_shader_run_thread(struct draw_geometry_shader *shader,
+                                    unsigned thread,
+                                    unsigned in_prim_idx,
+                                    struct pipe_query_data_pipeline_statistics *statistics,
+                                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                                    const unsigned constants_size[PIPE_MAX_CONSTANT_BUFFERS],
+                                    const struct draw_vertex_info *input_verts,
+                                    const struct draw_prim_info *input_prim,
+                                    const struct tgsi_shader_info *input_info,
+                                    struct draw_vertex_info *output_verts,
+                                    struct draw_prim_info *output_prims)
+{
+   struct draw_geometry_shader *gs = shader->thread_gs[thread];
+   int emitted_vertices;
+
+   assert(gs);
+
+   gs->in_prim_idx = in_prim_idx;
+   gs->statistics = statistics;
+
+   emitted_vertices = draw_geometry_shader_run(gs, constants, constants_size,
+                                               input_verts, input_prim,
+                                               input_info,
+                                               output_verts, output_prims);
+
+   gs->primitive_lengths = NULL;
+
+   return emitted_vertices;
+}
+
+
+/**
+ * Number the input primitives of a draw_geometry_shader_run_thread() call
+ * made later, or on another thread: return the id of the first one, and
+ * skip all of them, as draw_geometry_shader_run() would.
+ */
+unsigned draw_geometry_shader_skip_prims(struct draw_geometry_shader *shader,
+                                         const struct draw_prim_info *input_prim)
+{
+   unsigned in_prim_idx = shader->in_prim_idx;
+   unsigned num_prims = 0;
+
+   gs_count_prims(input_prim, &num_prims);
+   shader->in_prim_idx += num_prims * shader->num_invocations;
+
+   return in_prim_idx;
+}
+
+
 void draw_geometry_shader_prepare(struct draw_geometry_shader *shader,
                                   struct draw_context *draw)
 {
    boolean use_llvm = draw->llvm != NULL;
+   unsigned i;
+
    if (!use_llvm && shader && shader->machine->Tokens != shader->state.tokens) {
       tgsi_exec_machine_bind_shader(shader->machine,
                                     shader->state.tokens,
                                     draw->gs.tgsi.sampler);
    }
+
+   if (!use_llvm && shader && shader->thread_gs[0]) {
+      for (i = 1; i <= draw->pt.nr_threads; i++) {
+         struct tgsi_exec_machine *machine = shader->thread_gs[i]->machine;
+
+         if (machine->Tokens != shader->state.tokens) {
+            tgsi_exec_machine_bind_shader(machine,
+                                          shader->state.tokens,
+                                          draw->gs.tgsi.sampler);
+         }
+      }
+   }
+}
+
+
+static struct tgsi_exec_machine *
+create_gs_machine(void)
+{
+   struct tgsi_exec_machine *machine = tgsi_exec_machine_create();
+
+   if (!machine)
+      return NULL;
+
+   machine->Primitives = align_malloc(
+      MAX_PRIMITIVES * sizeof(struct tgsi_exec_vector), 16);
+   if (!machine->Primitives) {
+      tgsi_exec_machine_destroy(machine);
+      return NULL;
+   }
+   memset(machine->Primitives, 0,
+          MAX_PRIMITIVES * sizeof(struct tgsi_exec_vector));
+
+   return machine;
+}
+
+
+static void
+destroy_gs_machine(struct tgsi_exec_machine *machine)
+{
+   align_free(machine->Primitives);
+   tgsi_exec_machine_destroy(machine);
 }
 
 
@@ -696,16 +823,18 @@ boolean
 draw_gs_init( struct draw_context *draw )
 {
    if (!draw->llvm) {
-      draw->gs.tgsi.machine = tgsi_exec_machine_create();
+      unsigned i;
+
+      draw->gs.tgsi.machine = create_gs_machine();
       if (!draw->gs.tgsi.machine)
          return FALSE;
 
-      draw->gs.tgsi.machine->Primitives = align_malloc(
-         MAX_PRIMITIVES * sizeof(struct tgsi_exec_vector), 16);
-      if (!draw->gs.tgsi.machine->Primitives)
-         return FALSE;
-      memset(draw->gs.tgsi.machine->Primitives, 0,
-             MAX_PRIMITIVES * sizeof(struct tgsi_exec_vector));
+      draw->gs.tgsi.thread_machine[0] = draw->gs.tgsi.machine;
+      for (i = 1; i <= draw->pt.nr_threads; i++) {
+         draw->gs.tgsi.thread_machine[i] = create_gs_machine();
+         if (!draw->gs.tgsi.thread_machine[i])
+            return FALSE;
+      }
    }
 
    return TRUE;
@@ -713,12 +842,70 @@ draw_gs_init( struct draw_context *draw )
 
 void draw_gs_destroy( struct draw_context *draw )
 {
-   if (draw->gs.tgsi.machine) {
-      align_free(draw->gs.tgsi.machine->Primitives);
-      tgsi_exec_machine_destroy(draw->gs.tgsi.machine);
+   unsigned i;
+
+   for (i = 1; i <= draw->pt.nr_threads; i++) {
+      if (draw->gs.tgsi.thread_machine[i])
+         destroy_gs_machine(draw->gs.tgsi.thread_machine[i]);
    }
+
+   if (draw->gs.tgsi.machine)
+      destroy_gs_machine(draw->gs.tgsi.machine);
 }
 
+
+static void
+free_thread_copy(struct draw_geometry_shader *gs)
+{
+   FREE(gs->primitive_lengths);
+   FREE(gs);
+}
+
+
+/**
+ * Make a copy of the shader for each vertex processing thread, sharing the
+ * tokens but with its own exec machine.  Only TGSI shaders are threaded,
+ * and not those that sample textures, as the samplers aren't thread safe.
+ */
+static boolean
+create_thread_copies(struct draw_context *draw,
+                     struct draw_geometry_shader *gs)
+{
+   unsigned i;
+
+   if (!draw->pt.threads)
+      return TRUE;
+
+   if (draw->llvm ||
+       gs->info.file_count[TGSI_FILE_SAMPLER] ||
+       gs->info.file_count[TGSI_FILE_SAMPLER_VIEW])
+      return TRUE;
+
+   for (i = 0; i <= draw->pt.nr_threads; i++) {
+      struct draw_geometry_shader *copy = MALLOC_STRUCT(draw_geometry_shader);
+
+      if (!copy)
+         goto fail;
+
+      *copy = *gs;
+      memset(copy->thread_gs, 0, sizeof copy->thread_gs);
+      copy->primitive_lengths = NULL;
+      copy->machine = draw->gs.tgsi.thread_machine[i];
+      gs->thread_gs[i] = copy;
+   }
+
+   return TRUE;
+
+fail:
+   for (i = 0; i <= draw->pt.nr_threads; i++) {
+      if (gs->thread_gs[i])
+         free_thread_copy(gs->thread_gs[i]);
+      gs->thread_gs[i] = NULL;
+   }
+   return FALSE;
+}
+
+
 struct draw_geometry_shader *
 draw_create_geometry_shader(struct draw_context *draw,
                             const struct pipe_shader_state *state)
@@ -817,6 +1004,7 @@ draw_create_geometry_shader(struct draw_context *draw,
    }
 
    gs->machine = draw->gs.tgsi.machine;
+   gs->statistics = &draw->statistics;
 
 #ifdef HAVE_LLVM
    if (use_llvm) {
@@ -850,6 +1038,11 @@ draw_create_geometry_shader(struct draw_context *draw,
       gs->run = tgsi_gs_run;
    }
 
+   if (!create_thread_copies(draw, gs)) {
+      draw_delete_geometry_shader(draw, gs);
+      return NULL;
+   }
+
    return gs;
 }
 
@@ -873,9 +1066,16 @@ void draw_bind_geometry_shader(struct draw_context *draw,
 void draw_delete_geometry_shader(struct draw_context *draw,
                                  struct draw_geometry_shader *dgs)
 {
+   unsigned i;
+
    if (!dgs) {
       return;
    }
+
+   for (i = 0; i < Elements(dgs->thread_gs); i++) {
+      if (dgs->thread_gs[i])
+         free_thread_copy(dgs->thread_gs[i]);
+   }
 #ifdef HAVE_LLVM
    if (draw->llvm) {
       struct llvm_geometry_shader *shader = llvm_geometry_shader(dgs);
@@ -92,6 +92,16 @@ struct draw_geometry_shader {
 
    unsigned num_invocations;
    unsigned invocation_id;
+
+   /* Where to count invocations and primitives, the draw context's
+    * statistics except for the thread copies' runs.
+    */
+   struct pipe_query_data_pipeline_statistics *statistics;
+
+   /* Copies of the shader, with their own machines and buffers, to run it
+    * on each vertex processing thread at once.  NULL if it can't be.
+    */
+   struct draw_geometry_shader *thread_gs[DRAW_MAX_THREADS];
 #ifdef HAVE_LLVM
    struct draw_gs_inputs *gs_input;
    struct draw_gs_jit_context *jit_context;
@@ -135,6 +145,21 @@ int draw_geometry_shader_run(struct draw_geometry_shader *shader,
                              struct draw_vertex_info *output_verts,
                              struct draw_prim_info *output_prims );
 
+int draw_geometry_shader_run_thread(struct draw_geometry_shader *shader,
+                                    unsigned thread,
+                                    unsigned in_prim_idx,
+                                    struct pipe_query_data_pipeline_statistics *statistics,
+                                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                                    const unsigned constants_size[PIPE_MAX_CONSTANT_BUFFERS],
+                                    const struct draw_vertex_info *input_verts,
+                                    const struct draw_prim_info *input_prim,
+                                    const struct tgsi_shader_info *input_info,
+                                    struct draw_vertex_info *output_verts,
+                                    struct draw_prim_info *output_prims);
+
+unsigned draw_geometry_shader_skip_prims(struct draw_geometry_shader *shader,
+                                         const struct draw_prim_info *input_prim);
+
 void draw_geometry_shader_prepare(struct draw_geometry_shader *shader,
                                   struct draw_context *draw);
 
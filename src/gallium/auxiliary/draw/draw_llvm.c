@@ -1139,12 +1139,15 @@ generate_clipmask(struct draw_llvm *llvm,
                   struct lp_type vs_type,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
                   boolean clip_xy,
+                  boolean guard_band_xy,
+                  boolean guard_band_stats,
                   boolean clip_z,
                   boolean clip_user,
                   boolean clip_halfz,
                   unsigned ucp_enable,
                   LLVMValueRef context_ptr,
-                  boolean *have_clipdist)
+                  boolean *have_clipdist,
+                  LLVMValueRef *guard_band_verts)
 {
    LLVMBuilderRef builder = gallivm->builder;
    LLVMValueRef mask; /* stores the <nxi32> clipmasks */
@@ -1198,29 +1201,58 @@ generate_clipmask(struct draw_llvm *llvm,
       cv_w = pos_w;
    }
 
+   *guard_band_verts = lp_build_const_int_vec(gallivm, i32_type, 0);
+
    /* Cliptest, for hardwired planes */
    if (clip_xy) {
+      LLVMValueRef band_x = pos_x, band_y = pos_y;
+
+      if (guard_band_xy) {
+         /* The guard band is twice the size of the viewport. */
+         LLVMValueRef half = lp_build_const_vec(gallivm, f32_type, 0.5);
+
+         band_x = LLVMBuildFMul(builder, pos_x, half, "");
+         band_y = LLVMBuildFMul(builder, pos_y, half, "");
+      }
+
+      if (guard_band_stats) {
+         /* Vertices between the viewport and the guard band are flagged
+          * separately, see draw_cliptest_tmp.h.
+          */
+         LLVMValueRef outside;
+
+         outside = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, pos_x, pos_w);
+         test = LLVMBuildFAdd(builder, pos_x, pos_w, "");
+         test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, zero, test);
+         outside = LLVMBuildOr(builder, outside, test, "");
+         test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, pos_y, pos_w);
+         outside = LLVMBuildOr(builder, outside, test, "");
+         test = LLVMBuildFAdd(builder, pos_y, pos_w, "");
+         test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, zero, test);
+         *guard_band_verts = LLVMBuildOr(builder, outside, test, "");
+      }
+
       /* plane 1 */
-      test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, pos_x , pos_w);
+      test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, band_x , pos_w);
       temp = shift;
       test = LLVMBuildAnd(builder, test, temp, "");
       mask = test;
 
       /* plane 2 */
-      test = LLVMBuildFAdd(builder, pos_x, pos_w, "");
+      test = LLVMBuildFAdd(builder, band_x, pos_w, "");
       test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, zero, test);
       temp = LLVMBuildShl(builder, temp, shift, "");
       test = LLVMBuildAnd(builder, test, temp, "");
       mask = LLVMBuildOr(builder, mask, test, "");
 
       /* plane 3 */
-      test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, pos_y, pos_w);
+      test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, band_y, pos_w);
       temp = LLVMBuildShl(builder, temp, shift, "");
       test = LLVMBuildAnd(builder, test, temp, "");
       mask = LLVMBuildOr(builder, mask, test, "");
 
       /* plane 4 */
-      test = LLVMBuildFAdd(builder, pos_y, pos_w, "");
+      test = LLVMBuildFAdd(builder, band_y, pos_w, "");
       test = lp_build_compare(gallivm, f32_type, PIPE_FUNC_GREATER, zero, test);
       temp = LLVMBuildShl(builder, temp, shift, "");
       test = LLVMBuildAnd(builder, test, temp, "");
@@ -1770,18 +1802,24 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant,
          /* do cliptest */
          if (enable_cliptest) {
             LLVMValueRef temp = LLVMBuildLoad(builder, clipmask_bool_ptr, "");
+            LLVMValueRef guard_band_verts;
             /* allocate clipmask, assign it integer type */
             clipmask = generate_clipmask(llvm,
                                          gallivm,
                                          vs_type,
                                          outputs,
                                          key->clip_xy,
+                                         key->guard_band_xy,
+                                         key->guard_band_stats,
                                          key->clip_z,
                                          key->clip_user,
                                          key->clip_halfz,
                                          key->ucp_enable,
-                                         context_ptr, &have_clipdist);
+                                         context_ptr, &have_clipdist,
+                                         &guard_band_verts);
             temp = LLVMBuildOr(builder, clipmask, temp, "");
+            /* run the pipeline for guard band vertices when counting them */
+            temp = LLVMBuildOr(builder, guard_band_verts, temp, "");
             /* store temporary clipping boolean value */
             LLVMBuildStore(builder, temp, clipmask_bool_ptr);
          }
@@ -1841,6 +1879,9 @@ draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
 
    /* will have to rig this up properly later */
    key->clip_xy = llvm->draw->clip_xy;
+   key->guard_band_xy = llvm->draw->guard_band_xy;
+   key->guard_band_stats = (llvm->draw->guard_band_xy &&
+                            llvm->draw->collect_clip_stats);
    key->clip_z = llvm->draw->clip_z;
    key->clip_user = llvm->draw->clip_user;
    key->bypass_viewport = llvm->draw->bypass_viewport;
@@ -1893,6 +1934,8 @@ draw_llvm_dump_variant_key(struct draw_llvm_variant_key *key)
 
    debug_printf("clamp_vertex_color = %u\n", key->clamp_vertex_color);
    debug_printf("clip_xy = %u\n", key->clip_xy);
+   debug_printf("guard_band_xy = %u\n", key->guard_band_xy);
+   debug_printf("guard_band_stats = %u\n", key->guard_band_stats);
    debug_printf("clip_z = %u\n", key->clip_z);
    debug_printf("clip_user = %u\n", key->clip_user);
    debug_printf("bypass_viewport = %u\n", key->bypass_viewport);
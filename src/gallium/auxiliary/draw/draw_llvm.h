@@ -315,12 +315,14 @@ struct draw_llvm_variant_key
    unsigned need_edgeflags:1;
    unsigned has_gs:1;
    unsigned num_outputs:8;
+   unsigned guard_band_xy:1;
+   unsigned guard_band_stats:1;
    /*
     * it is important there are no holes in this struct
     * (and all padding gets zeroed).
     */
    unsigned ucp_enable:PIPE_MAX_CLIP_PLANES;
-   unsigned pad1:24-PIPE_MAX_CLIP_PLANES;
+   unsigned pad1:22-PIPE_MAX_CLIP_PLANES;
 
    /* Variable number of vertex elements:
     */
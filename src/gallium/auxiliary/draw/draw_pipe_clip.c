@@ -685,6 +685,22 @@ clip_line( struct draw_stage *stage,
 }
 
 
+/**
+ * Is the vertex outside the viewport in x or y?  Only of interest when the
+ * clipmask tests against the guard band instead.
+ */
+static inline boolean
+outside_viewport_xy(const struct vertex_header *v)
+{
+   const float *pos = v->pre_clip_pos;
+
+   return (-pos[0] + pos[3] < 0 ||
+            pos[0] + pos[3] < 0 ||
+           -pos[1] + pos[3] < 0 ||
+            pos[1] + pos[3] < 0);
+}
+
+
 static void
 clip_tri( struct draw_stage *stage,
           struct prim_header *header )
@@ -695,11 +711,18 @@ clip_tri( struct draw_stage *stage,
 
    if (clipmask == 0) {
       /* no clipping needed */
+      if (stage->draw->guard_band_xy &&
+          (outside_viewport_xy(header->v[0]) ||
+           outside_viewport_xy(header->v[1]) ||
+           outside_viewport_xy(header->v[2])))
+         stage->draw->clip_stats.guard_band++;
+
       stage->next->tri( stage->next, header );
    }
    else if ((header->v[0]->clipmask & 
              header->v[1]->clipmask & 
              header->v[2]->clipmask) == 0) {
+      stage->draw->clip_stats.clipped++;
       do_clip_tri(stage, header, clipmask);
    }
 }
@@ -50,6 +50,15 @@ struct draw_assembler
    int primid_slot;
    unsigned primid;
 
+   /* Whether the assembled primitives index the input vertices, rather
+    * than having their vertices copied.
+    */
+   boolean indexed;
+   boolean always_copy;  /**< DRAW_IA_COPY_VERTS */
+   ushort *elts;
+   unsigned elts_size;
+
+   unsigned num_verts;
    unsigned num_prims;
 };
 
@@ -82,29 +91,36 @@ draw_prim_assembler_is_required(const struct draw_context *draw,
 }
 
 /*
- * Copy the vertex header along with its data from the current
- * vertex buffer into a buffer holding vertices arranged
- * into decomposed primitives (i.e. buffer without the
- * adjacency vertices)
+ * Add the vertices of a decomposed primitive (i.e. without the adjacency
+ * vertices) to the output.  Vertices shared with the previous primitives
+ * are only referenced again by index, unless the assembler has to copy
+ * each primitive's vertices, header and data, into a new vertex buffer.
  */
 static void
-copy_verts(struct draw_assembler *asmblr,
-           unsigned *indices, unsigned num_indices)
+add_prim(struct draw_assembler *asmblr,
+         unsigned *indices, unsigned num_indices)
 {
    unsigned i;
 
-   char *output = (char*)asmblr->output_verts->verts;
-   const char *input = (const char*)asmblr->input_verts->verts;
-
-   for (i = 0; i < num_indices; ++i) {
-      unsigned idx = indices[i];
-      unsigned output_offset =
-         asmblr->output_verts->count * asmblr->output_verts->stride;
-      unsigned input_offset = asmblr->input_verts->stride * idx;
-      memcpy(output + output_offset, input + input_offset,
-             asmblr->input_verts->vertex_size);
-      asmblr->output_verts->count += 1;
+   if (asmblr->indexed) {
+      for (i = 0; i < num_indices; ++i)
+         asmblr->elts[asmblr->num_verts + i] = (ushort)indices[i];
    }
+   else {
+      char *output = (char*)asmblr->output_verts->verts;
+      const char *input = (const char*)asmblr->input_verts->verts;
+
+      for (i = 0; i < num_indices; ++i) {
+         unsigned idx = indices[i];
+         unsigned output_offset =
+            (asmblr->num_verts + i) * asmblr->output_verts->stride;
+         unsigned input_offset = asmblr->input_verts->stride * idx;
+         memcpy(output + output_offset, input + input_offset,
+                asmblr->input_verts->vertex_size);
+      }
+      asmblr->draw->ia_stats.copied_vertices += num_indices;
+   }
+   asmblr->num_verts += num_indices;
    ++asmblr->num_prims;
 }
 
@@ -142,7 +158,7 @@ prim_point(struct draw_assembler *asmblr,
    }
    indices[0] = idx;
    
-   copy_verts(asmblr, indices, 1);
+   add_prim(asmblr, indices, 1);
 }
 
 static void
@@ -158,7 +174,7 @@ prim_line(struct draw_assembler *asmblr,
    indices[0] = i0;
    indices[1] = i1;
 
-   copy_verts(asmblr, indices, 2);
+   add_prim(asmblr, indices, 2);
 }
 
 static void
@@ -176,7 +192,7 @@ prim_tri(struct draw_assembler *asmblr,
    indices[1] = i1;
    indices[2] = i2;
 
-   copy_verts(asmblr, indices, 3);
+   add_prim(asmblr, indices, 3);
 }
 
 void
@@ -232,10 +248,21 @@ draw_prim_assembler_run(struct draw_context *draw,
    asmblr->input_prims = input_prims;
    asmblr->input_verts = input_verts;
    asmblr->needs_primid = needs_primid(asmblr->draw);
+   asmblr->num_verts = 0;
    asmblr->num_prims = 0;
 
-   output_prims->linear = TRUE;
-   output_prims->elts = NULL;
+   /* Injecting the primitive id into a vertex shared by several primitives
+    * would overwrite theirs, so only then do the vertices get copied.
+    */
+   asmblr->indexed = !asmblr->needs_primid && !asmblr->always_copy &&
+                     input_verts->count <= 0xffff;
+   if (asmblr->indexed && asmblr->elts_size < max_verts) {
+      FREE(asmblr->elts);
+      asmblr->elts = MALLOC(max_verts * sizeof(ushort));
+      asmblr->elts_size = asmblr->elts ? max_verts : 0;
+      asmblr->indexed = asmblr->elts != NULL;
+   }
+
    output_prims->start = 0;
    output_prims->prim = assembled_prim;
    output_prims->flags = 0x0;
@@ -243,12 +270,20 @@ draw_prim_assembler_run(struct draw_context *draw,
    output_prims->primitive_lengths[0] = 0;
    output_prims->primitive_count = 1;
 
-   output_verts->vertex_size = input_verts->vertex_size;
-   output_verts->stride = input_verts->stride;
-   output_verts->verts = (struct vertex_header*)MALLOC(
-      input_verts->vertex_size * max_verts);
-   output_verts->count = 0;
-
+   if (asmblr->indexed) {
+      output_prims->linear = FALSE;
+      output_prims->elts = asmblr->elts;
+      *output_verts = *input_verts;
+   }
+   else {
+      output_prims->linear = TRUE;
+      output_prims->elts = NULL;
+      output_verts->vertex_size = input_verts->vertex_size;
+      output_verts->stride = input_verts->stride;
+      output_verts->verts = (struct vertex_header*)MALLOC(
+         input_verts->vertex_size * max_verts);
+      output_verts->count = 0;
+   }
 
    for (start = i = 0; i < input_prims->primitive_count;
         start += input_prims->primitive_lengths[i], i++)
@@ -263,8 +298,12 @@ draw_prim_assembler_run(struct draw_context *draw,
       }
    }
 
-   output_prims->primitive_lengths[0] = output_verts->count;
-   output_prims->count = output_verts->count;
+   output_prims->primitive_lengths[0] = asmblr->num_verts;
+   output_prims->count = asmblr->num_verts;
+   if (!asmblr->indexed)
+      output_verts->count = asmblr->num_verts;
+
+   asmblr->draw->ia_stats.primitives += asmblr->num_prims;
 }
 
 struct draw_assembler *
@@ -273,6 +312,7 @@ draw_prim_assembler_create(struct draw_context *draw)
    struct draw_assembler *ia = CALLOC_STRUCT( draw_assembler );
 
    ia->draw = draw;
+   ia->always_copy = debug_get_bool_option("DRAW_IA_COPY_VERTS", FALSE);
 
    return ia;
 }
@@ -280,6 +320,7 @@ draw_prim_assembler_create(struct draw_context *draw)
 void
 draw_prim_assembler_destroy(struct draw_assembler *ia)
 {
+   FREE(ia->elts);
    FREE(ia);
 }
 
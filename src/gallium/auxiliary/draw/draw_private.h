@@ -46,6 +46,8 @@
 
 #include "tgsi/tgsi_scan.h"
 
+#include "draw/draw_context.h"
+
 #ifdef HAVE_LLVM
 struct gallivm_state;
 #endif
@@ -67,6 +69,8 @@ struct vbuf_render;
 struct tgsi_exec_machine;
 struct tgsi_sampler;
 struct draw_pt_front_end;
+struct draw_pt_middle_end;
+struct pt_threads;
 struct draw_assembler;
 struct draw_llvm;
 
@@ -104,6 +108,11 @@ struct vertex_header {
 /* maximum number of shader variants we can cache */
 #define DRAW_MAX_SHADER_VARIANTS 128
 
+/* maximum number of threads processing vertices, including the
+ * application thread
+ */
+#define DRAW_MAX_THREADS 8
+
 /**
  * Private context for the drawing module.
  */
@@ -170,6 +179,10 @@ struct draw_context
          struct draw_pt_front_end *vsplit;
       } front;
 
+      /* Worker threads shading segments, NULL if there are none */
+      struct pt_threads *threads;
+      unsigned nr_threads;
+
       struct pipe_vertex_buffer vertex_buffer[PIPE_MAX_ATTRIBS];
       unsigned nr_vertex_buffers;
 
@@ -267,6 +280,11 @@ struct draw_context
       struct {
          struct tgsi_exec_machine *machine;
 
+         /* One machine per vertex processing thread, the first one being
+          * the machine above.
+          */
+         struct tgsi_exec_machine *thread_machine[DRAW_MAX_THREADS];
+
          struct tgsi_sampler *sampler;
       } tgsi;
 
@@ -286,6 +304,11 @@ struct draw_context
       struct {
          struct tgsi_exec_machine *machine;
 
+         /* One machine per vertex processing thread, the first one being
+          * the machine above.
+          */
+         struct tgsi_exec_machine *thread_machine[DRAW_MAX_THREADS];
+
          struct tgsi_sampler *sampler;
       } tgsi;
 
@@ -334,6 +357,16 @@ struct draw_context
    struct pipe_query_data_pipeline_statistics statistics;
    boolean collect_statistics;
 
+   /** post-transform vertex cache use of the last draw_vbo() */
+   struct draw_vertex_cache_stats vertex_cache_stats;
+
+   /** triangle clipping of the last draw_vbo() */
+   struct draw_clip_stats clip_stats;
+   boolean collect_clip_stats;
+
+   /** primitive assembly of the last draw_vbo() */
+   struct draw_assembler_stats ia_stats;
+
    struct draw_assembler *ia;
 
    void *driver_private;
@@ -371,6 +404,39 @@ struct draw_prim_info {
    unsigned primitive_count;
 };
 
+/* A segment of a draw as seen by the middle end, with its own copy of the
+ * element lists.
+ */
+struct draw_pt_segment {
+   struct draw_pt_middle_end *middle;
+
+   struct draw_fetch_info fetch_info;
+   struct draw_prim_info prim_info;
+
+   /* Filled in by shade_segment(): the shaded vertices and, if it ran the
+    * post-vs stage on them too, whether any of them need clipping.
+    */
+   struct draw_vertex_info vert_info;
+   boolean clip_tested;
+   boolean clipped;
+
+   /* Also filled in by shade_segment() if it ran the geometry shader, on
+    * the input primitives numbered from gs_prim_idx: vert_info is then its
+    * output, and gs_prim_info, whose primitive lengths the segment owns,
+    * the primitives it emitted.
+    */
+   boolean gs_run;
+   unsigned gs_prim_idx;
+   struct draw_prim_info gs_prim_info;
+   struct pipe_query_data_pipeline_statistics gs_statistics;
+
+   unsigned *fetch_elts;
+   unsigned fetch_elts_size;
+   ushort *draw_elts;
+   unsigned draw_elts_size;
+   unsigned draw_count;
+};
+
 
 /*******************************************************************************
  * Draw common initialization code
@@ -148,6 +148,10 @@ draw_pt_arrays(struct draw_context *draw,
 
    frontend->run( frontend, start, count );
 
+   /* The vertex buffers may be unmapped as soon as we return. */
+   if (draw->pt.threads)
+      draw_pt_threads_flush( draw->pt.threads );
+
    return TRUE;
 }
 
@@ -175,6 +179,18 @@ boolean draw_pt_init( struct draw_context *draw )
    draw->pt.test_fse = debug_get_option_draw_fse();
    draw->pt.no_fse = debug_get_option_draw_no_fse();
 
+   /* Shading segments on worker threads is an opt-in experiment, only
+    * validated with softpipe so far.  If no worker thread can be started,
+    * everything is shaded on the application thread as usual.
+    */
+   draw->pt.nr_threads = debug_get_num_option("DRAW_NUM_THREADS", 0);
+   draw->pt.nr_threads = MIN2(draw->pt.nr_threads, DRAW_MAX_THREADS - 1);
+   if (draw->pt.nr_threads) {
+      draw->pt.threads = draw_pt_threads_create( draw, draw->pt.nr_threads );
+      if (!draw->pt.threads)
+         draw->pt.nr_threads = 0;
+   }
+
    draw->pt.front.vsplit = draw_pt_vsplit(draw);
    if (!draw->pt.front.vsplit)
       return FALSE;
@@ -202,6 +218,11 @@ boolean draw_pt_init( struct draw_context *draw )
 
 void draw_pt_destroy( struct draw_context *draw )
 {
+   if (draw->pt.threads) {
+      draw_pt_threads_destroy( draw->pt.threads );
+      draw->pt.threads = NULL;
+   }
+
    if (draw->pt.middle.llvm) {
       draw->pt.middle.llvm->destroy( draw->pt.middle.llvm );
       draw->pt.middle.llvm = NULL;
@@ -478,6 +499,10 @@ draw_vbo(struct draw_context *draw,
 
    count = info->count;
 
+   memset(&draw->vertex_cache_stats, 0, sizeof(draw->vertex_cache_stats));
+   memset(&draw->clip_stats, 0, sizeof(draw->clip_stats));
+   memset(&draw->ia_stats, 0, sizeof(draw->ia_stats));
+
    draw->pt.user.eltBias = info->index_bias;
    draw->pt.user.min_index = info->min_index;
    draw->pt.user.max_index = info->max_index;
@@ -39,6 +39,8 @@ struct draw_pt_middle_end;
 struct draw_context;
 struct draw_prim_info;
 struct draw_vertex_info;
+struct draw_fetch_info;
+struct draw_pt_segment;
 
 
 #define PT_SHADE      0x1
@@ -124,6 +126,17 @@ struct draw_pt_middle_end {
 
    int (*get_max_vertex_count)( struct draw_pt_middle_end * );
 
+   /* Optional: shade a segment queued with draw_pt_threads_queue(), on
+    * any thread, and finish it on the application thread in queue order.
+    * Thread 0 is the application thread.
+    */
+   void (*shade_segment)( struct draw_pt_middle_end *,
+                          struct draw_pt_segment *,
+                          unsigned thread );
+
+   void (*finish_segment)( struct draw_pt_middle_end *,
+                           struct draw_pt_segment * );
+
    void (*finish)( struct draw_pt_middle_end * );
    void (*destroy)( struct draw_pt_middle_end * );
 };
@@ -242,6 +255,28 @@ struct pt_post_vs *draw_pt_post_vs_create( struct draw_context *draw );
 void draw_pt_post_vs_destroy( struct pt_post_vs *pvs );
 
 
+/*******************************************************************************
+ * Worker threads shading segments:
+ */
+struct pt_threads;
+
+struct draw_pt_segment *
+draw_pt_threads_alloc( struct pt_threads *threads,
+                       struct draw_pt_middle_end *middle,
+                       const struct draw_fetch_info *fetch_info,
+                       const struct draw_prim_info *prim_info );
+
+void draw_pt_threads_queue( struct pt_threads *threads,
+                            struct draw_pt_segment *segment );
+
+void draw_pt_threads_flush( struct pt_threads *threads );
+
+struct pt_threads *draw_pt_threads_create( struct draw_context *draw,
+                                           unsigned num_threads );
+
+void draw_pt_threads_destroy( struct pt_threads *threads );
+
+
 /*******************************************************************************
  * Utils: 
  */
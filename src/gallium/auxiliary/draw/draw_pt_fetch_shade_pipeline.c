@@ -50,6 +50,14 @@ struct fetch_pipeline_middle_end {
    unsigned vertex_size;
    unsigned input_prim;
    unsigned opt;
+
+   /* Queue segments on the worker threads?  And when nothing comes
+    * between the vertex shader and clipping, clip test on them too?
+    * Run the geometry shader on them too?
+    */
+   boolean threaded;
+   boolean threaded_clip;
+   boolean threaded_gs;
 };
 
 
@@ -135,6 +143,15 @@ fetch_pipeline_prepare(struct draw_pt_middle_end *middle,
       *max_vertices = 4096;
    }
 
+   fpme->threaded = (draw->pt.threads &&
+                     (opt & PT_SHADE) &&
+                     vs->run_linear_thread);
+   fpme->threaded_clip = (!gs &&
+                          !vs->state.stream_output.num_outputs &&
+                          draw_current_shader_position_output(draw) != -1);
+   fpme->threaded_gs = (fpme->threaded &&
+                        gs && gs->thread_gs[0]);
+
    /* No need to prepare the shader.
     */
    vs->prepare(vs, draw);
@@ -203,6 +220,7 @@ emit(struct pt_emit *emit,
 
 static void
 draw_vertex_shader_run(struct draw_vertex_shader *vshader,
+                       unsigned thread,
                        const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
                        unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
                        const struct draw_vertex_info *input_verts,
@@ -215,6 +233,19 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
       (struct vertex_header *)MALLOC(output_verts->vertex_size *
                                      align(output_verts->count, 4));
 
+   if (thread) {
+      vshader->run_linear_thread(vshader,
+                                 thread,
+                                 (const float (*)[4])input_verts->verts->data,
+                                 (      float (*)[4])output_verts->verts->data,
+                                 constants,
+                                 const_size,
+                                 input_verts->count,
+                                 input_verts->vertex_size,
+                                 input_verts->vertex_size);
+      return;
+   }
+
    vshader->run_linear(vshader,
                        (const float (*)[4])input_verts->verts->data,
                        (      float (*)[4])output_verts->verts->data,
@@ -226,67 +257,35 @@ draw_vertex_shader_run(struct draw_vertex_shader *vshader,
 }
 
 
+/**
+ * Run everything after the vertex shader on its output, and free it.
+ * If the vertices have already been through post_vs, 'clipped' is its
+ * result.  If they are the geometry shader's output already, 'gs_run' is
+ * set and the primitive lengths are freed too.
+ */
 static void
-fetch_pipeline_generic(struct draw_pt_middle_end *middle,
-                       const struct draw_fetch_info *fetch_info,
-                       const struct draw_prim_info *in_prim_info)
+fetch_pipeline_shaded(struct fetch_pipeline_middle_end *fpme,
+                      struct draw_vertex_info *vs_vert_info,
+                      const struct draw_prim_info *in_prim_info,
+                      boolean gs_run,
+                      boolean clip_tested,
+                      boolean clipped)
 {
-   struct fetch_pipeline_middle_end *fpme = fetch_pipeline_middle_end(middle);
    struct draw_context *draw = fpme->draw;
    struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
    struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
    struct draw_prim_info gs_prim_info;
-   struct draw_vertex_info fetched_vert_info;
-   struct draw_vertex_info vs_vert_info;
    struct draw_vertex_info gs_vert_info;
-   struct draw_vertex_info *vert_info;
+   struct draw_vertex_info *vert_info = vs_vert_info;
    struct draw_prim_info ia_prim_info;
    struct draw_vertex_info ia_vert_info;
    const struct draw_prim_info *prim_info = in_prim_info;
    boolean free_prim_info = FALSE;
    unsigned opt = fpme->opt;
 
-   fetched_vert_info.count = fetch_info->count;
-   fetched_vert_info.vertex_size = fpme->vertex_size;
-   fetched_vert_info.stride = fpme->vertex_size;
-   fetched_vert_info.verts =
-      (struct vertex_header *)MALLOC(fpme->vertex_size *
-                                     align(fetch_info->count,  4));
-   if (!fetched_vert_info.verts) {
-      assert(0);
-      return;
-   }
-   if (draw->collect_statistics) {
-      draw->statistics.ia_vertices += prim_info->count;
-      draw->statistics.ia_primitives +=
-         u_decomposed_prims_for_vertices(prim_info->prim, fetch_info->count);
-      draw->statistics.vs_invocations += fetch_info->count;
-   }
-
-   /* Fetch into our vertex buffer.
-    */
-   fetch( fpme->fetch, fetch_info, (char *)fetched_vert_info.verts );
-
-   /* Finished with fetch:
-    */
-   fetch_info = NULL;
-   vert_info = &fetched_vert_info;
-
-   /* Run the shader, note that this overwrites the data[] parts of
-    * the pipeline verts.
-    */
-   if (fpme->opt & PT_SHADE) {
-      draw_vertex_shader_run(vshader,
-                             draw->pt.user.vs_constants,
-                             draw->pt.user.vs_constants_size,
-                             vert_info,
-                             &vs_vert_info);
-
-      FREE(vert_info->verts);
-      vert_info = &vs_vert_info;
-   }
-
-   if ((fpme->opt & PT_SHADE) && gshader) {
+   if (gs_run) {
+      free_prim_info = TRUE;
+   } else if ((fpme->opt & PT_SHADE) && gshader) {
       draw_geometry_shader_run(gshader,
                                draw->pt.user.gs_constants,
                                draw->pt.user.gs_constants_size,
@@ -304,8 +303,10 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
          draw_prim_assembler_run(draw, prim_info, vert_info,
                                  &ia_prim_info, &ia_vert_info);
 
-         if (ia_vert_info.count) {
-            FREE(vert_info->verts);
+         if (ia_prim_info.count) {
+            /* unless the primitives just index the shaded vertices */
+            if (ia_vert_info.verts != vert_info->verts)
+               FREE(vert_info->verts);
             vert_info = &ia_vert_info;
             prim_info = &ia_prim_info;
             free_prim_info = TRUE;
@@ -338,7 +339,10 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
     */
    if (draw_current_shader_position_output(draw) != -1) {
 
-      if (draw_pt_post_vs_run( fpme->post_vs, vert_info, prim_info ))
+      if (!clip_tested)
+         clipped = draw_pt_post_vs_run( fpme->post_vs, vert_info, prim_info );
+
+      if (clipped)
       {
          opt |= PT_PIPELINE;
       }
@@ -359,6 +363,161 @@ fetch_pipeline_generic(struct draw_pt_middle_end *middle,
 }
 
 
+static void
+fetch_pipeline_generic(struct draw_pt_middle_end *middle,
+                       const struct draw_fetch_info *fetch_info,
+                       const struct draw_prim_info *prim_info)
+{
+   struct fetch_pipeline_middle_end *fpme = fetch_pipeline_middle_end(middle);
+   struct draw_context *draw = fpme->draw;
+   struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
+   struct draw_vertex_info fetched_vert_info;
+   struct draw_vertex_info vs_vert_info;
+   struct draw_vertex_info *vert_info;
+
+   fetched_vert_info.count = fetch_info->count;
+   fetched_vert_info.vertex_size = fpme->vertex_size;
+   fetched_vert_info.stride = fpme->vertex_size;
+   fetched_vert_info.verts =
+      (struct vertex_header *)MALLOC(fpme->vertex_size *
+                                     align(fetch_info->count,  4));
+   if (!fetched_vert_info.verts) {
+      assert(0);
+      return;
+   }
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += prim_info->count;
+      draw->statistics.ia_primitives +=
+         u_decomposed_prims_for_vertices(prim_info->prim, fetch_info->count);
+      draw->statistics.vs_invocations += fetch_info->count;
+   }
+
+   /* Fetch into our vertex buffer.  The translate objects doing this
+    * aren't thread safe, so this always happens here.
+    */
+   fetch( fpme->fetch, fetch_info, (char *)fetched_vert_info.verts );
+
+   if (fpme->threaded) {
+      struct draw_pt_segment *segment =
+         draw_pt_threads_alloc(draw->pt.threads, middle,
+                               fetch_info, prim_info);
+
+      if (segment) {
+         segment->vert_info = fetched_vert_info;
+         if (fpme->threaded_gs)
+            segment->gs_prim_idx =
+               draw_geometry_shader_skip_prims(draw->gs.geometry_shader,
+                                               prim_info);
+         draw_pt_threads_queue(draw->pt.threads, segment);
+         return;
+      }
+   }
+
+   /* Finished with fetch:
+    */
+   fetch_info = NULL;
+   vert_info = &fetched_vert_info;
+
+   /* Run the shader, note that this overwrites the data[] parts of
+    * the pipeline verts.
+    */
+   if (fpme->opt & PT_SHADE) {
+      draw_vertex_shader_run(vshader,
+                             0,
+                             draw->pt.user.vs_constants,
+                             draw->pt.user.vs_constants_size,
+                             vert_info,
+                             &vs_vert_info);
+
+      FREE(vert_info->verts);
+      vert_info = &vs_vert_info;
+   }
+
+   fetch_pipeline_shaded(fpme, vert_info, prim_info, FALSE, FALSE, FALSE);
+}
+
+
+/**
+ * Shade the fetched vertices of a queued segment, on any thread.
+ */
+static void
+fetch_pipeline_shade_segment(struct draw_pt_middle_end *middle,
+                             struct draw_pt_segment *segment,
+                             unsigned thread)
+{
+   struct fetch_pipeline_middle_end *fpme = fetch_pipeline_middle_end(middle);
+   struct draw_context *draw = fpme->draw;
+   struct draw_vertex_info vs_vert_info;
+
+   draw_vertex_shader_run(draw->vs.vertex_shader,
+                          thread,
+                          draw->pt.user.vs_constants,
+                          draw->pt.user.vs_constants_size,
+                          &segment->vert_info,
+                          &vs_vert_info);
+
+   FREE(segment->vert_info.verts);
+   segment->vert_info = vs_vert_info;
+
+   if (fpme->threaded_gs) {
+      struct draw_vertex_info gs_vert_info;
+
+      memset(&segment->gs_statistics, 0, sizeof segment->gs_statistics);
+      draw_geometry_shader_run_thread(draw->gs.geometry_shader,
+                                      thread,
+                                      segment->gs_prim_idx,
+                                      &segment->gs_statistics,
+                                      draw->pt.user.gs_constants,
+                                      draw->pt.user.gs_constants_size,
+                                      &segment->vert_info,
+                                      &segment->prim_info,
+                                      &draw->vs.vertex_shader->info,
+                                      &gs_vert_info,
+                                      &segment->gs_prim_info);
+
+      FREE(segment->vert_info.verts);
+      segment->vert_info = gs_vert_info;
+      segment->gs_run = TRUE;
+      return;
+   }
+
+   if (fpme->threaded_clip &&
+       !draw_prim_assembler_is_required(draw, &segment->prim_info,
+                                        &segment->vert_info)) {
+      segment->clipped = draw_pt_post_vs_run(fpme->post_vs,
+                                             &segment->vert_info,
+                                             &segment->prim_info);
+      segment->clip_tested = TRUE;
+   }
+}
+
+
+static void
+fetch_pipeline_finish_segment(struct draw_pt_middle_end *middle,
+                              struct draw_pt_segment *segment)
+{
+   struct draw_context *draw = fetch_pipeline_middle_end(middle)->draw;
+
+   if (segment->gs_run) {
+      if (draw->collect_statistics) {
+         draw->statistics.gs_invocations +=
+            segment->gs_statistics.gs_invocations;
+         draw->statistics.gs_primitives +=
+            segment->gs_statistics.gs_primitives;
+      }
+
+      fetch_pipeline_shaded(fetch_pipeline_middle_end(middle),
+                            &segment->vert_info, &segment->gs_prim_info,
+                            TRUE, FALSE, FALSE);
+      return;
+   }
+
+   fetch_pipeline_shaded(fetch_pipeline_middle_end(middle),
+                         &segment->vert_info, &segment->prim_info,
+                         FALSE, segment->clip_tested, segment->clipped);
+}
+
+
 static void
 fetch_pipeline_run(struct draw_pt_middle_end *middle,
                    const unsigned *fetch_elts,
@@ -491,6 +650,8 @@ draw_pt_fetch_pipeline_or_emit(struct draw_context *draw)
    fpme->base.run            = fetch_pipeline_run;
    fpme->base.run_linear     = fetch_pipeline_linear_run;
    fpme->base.run_linear_elts = fetch_pipeline_linear_run_elts;
+   fpme->base.shade_segment  = fetch_pipeline_shade_segment;
+   fpme->base.finish_segment = fetch_pipeline_finish_segment;
    fpme->base.finish         = fetch_pipeline_finish;
    fpme->base.destroy        = fetch_pipeline_destroy;
 
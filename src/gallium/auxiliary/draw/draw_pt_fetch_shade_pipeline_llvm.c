@@ -54,6 +54,9 @@ struct llvm_middle_end {
    unsigned input_prim;
    unsigned opt;
 
+   /* Queue segments on the worker threads? */
+   boolean threaded;
+
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
 };
@@ -155,6 +158,7 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
 
    fpme->input_prim = in_prim;
    fpme->opt = opt;
+   fpme->threaded = draw->pt.threads != NULL;
 
    draw_pt_post_vs_prepare( fpme->post_vs,
                             draw->clip_xy,
@@ -336,46 +340,31 @@ emit(struct pt_emit *emit,
 }
 
 
-static void
-llvm_pipeline_generic(struct draw_pt_middle_end *middle,
-                      const struct draw_fetch_info *fetch_info,
-                      const struct draw_prim_info *in_prim_info)
+/**
+ * Fetch, shade and clip test, which the generated code does all together.
+ * This only reads the draw context, so it may run on any thread.
+ */
+static unsigned
+llvm_pipeline_shade(struct llvm_middle_end *fpme,
+                    const struct draw_fetch_info *fetch_info,
+                    struct draw_vertex_info *llvm_vert_info)
 {
-   struct llvm_middle_end *fpme = llvm_middle_end(middle);
    struct draw_context *draw = fpme->draw;
-   struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
-   struct draw_prim_info gs_prim_info;
-   struct draw_vertex_info llvm_vert_info;
-   struct draw_vertex_info gs_vert_info;
-   struct draw_vertex_info *vert_info;
-   struct draw_prim_info ia_prim_info;
-   struct draw_vertex_info ia_vert_info;
-   const struct draw_prim_info *prim_info = in_prim_info;
-   boolean free_prim_info = FALSE;
-   unsigned opt = fpme->opt;
-   unsigned clipped = 0;
 
-   llvm_vert_info.count = fetch_info->count;
-   llvm_vert_info.vertex_size = fpme->vertex_size;
-   llvm_vert_info.stride = fpme->vertex_size;
-   llvm_vert_info.verts = (struct vertex_header *)
+   llvm_vert_info->count = fetch_info->count;
+   llvm_vert_info->vertex_size = fpme->vertex_size;
+   llvm_vert_info->stride = fpme->vertex_size;
+   llvm_vert_info->verts = (struct vertex_header *)
       MALLOC(fpme->vertex_size *
              align(fetch_info->count, lp_native_vector_width / 32));
-   if (!llvm_vert_info.verts) {
+   if (!llvm_vert_info->verts) {
       assert(0);
-      return;
-   }
-
-   if (draw->collect_statistics) {
-      draw->statistics.ia_vertices += prim_info->count;
-      draw->statistics.ia_primitives +=
-         u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
-      draw->statistics.vs_invocations += fetch_info->count;
+      return 0;
    }
 
    if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       llvm_vert_info->verts,
                                        draw->pt.user.vbuffer,
                                        fetch_info->start,
                                        fetch_info->count,
@@ -385,8 +374,8 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                                        draw->start_index,
                                        draw->start_instance);
    else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            llvm_vert_info->verts,
                                             draw->pt.user.vbuffer,
                                             fetch_info->elts,
                                             draw->pt.user.eltMax,
@@ -396,11 +385,28 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                                             draw->instance_id,
                                             draw->pt.user.eltBias,
                                             draw->start_instance);
+}
 
-   /* Finished with fetch and vs:
-    */
-   fetch_info = NULL;
-   vert_info = &llvm_vert_info;
+
+/**
+ * Run everything after llvm_pipeline_shade() on its output, and free it.
+ */
+static void
+llvm_pipeline_shaded(struct llvm_middle_end *fpme,
+                     struct draw_vertex_info *llvm_vert_info,
+                     const struct draw_prim_info *in_prim_info,
+                     unsigned clipped)
+{
+   struct draw_context *draw = fpme->draw;
+   struct draw_geometry_shader *gshader = draw->gs.geometry_shader;
+   struct draw_prim_info gs_prim_info;
+   struct draw_vertex_info gs_vert_info;
+   struct draw_vertex_info *vert_info = llvm_vert_info;
+   struct draw_prim_info ia_prim_info;
+   struct draw_vertex_info ia_vert_info;
+   const struct draw_prim_info *prim_info = in_prim_info;
+   boolean free_prim_info = FALSE;
+   unsigned opt = fpme->opt;
 
    if ((opt & PT_SHADE) && gshader) {
       struct draw_vertex_shader *vshader = draw->vs.vertex_shader;
@@ -421,8 +427,10 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
          draw_prim_assembler_run(draw, prim_info, vert_info,
                                  &ia_prim_info, &ia_vert_info);
 
-         if (ia_vert_info.count) {
-            FREE(vert_info->verts);
+         if (ia_prim_info.count) {
+            /* unless the primitives just index the shaded vertices */
+            if (ia_vert_info.verts != vert_info->verts)
+               FREE(vert_info->verts);
             vert_info = &ia_vert_info;
             prim_info = &ia_prim_info;
             free_prim_info = TRUE;
@@ -473,6 +481,65 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
 }
 
 
+static void
+llvm_pipeline_generic(struct draw_pt_middle_end *middle,
+                      const struct draw_fetch_info *fetch_info,
+                      const struct draw_prim_info *prim_info)
+{
+   struct llvm_middle_end *fpme = llvm_middle_end(middle);
+   struct draw_context *draw = fpme->draw;
+   struct draw_vertex_info llvm_vert_info;
+   unsigned clipped;
+
+   if (draw->collect_statistics) {
+      draw->statistics.ia_vertices += prim_info->count;
+      draw->statistics.ia_primitives +=
+         u_decomposed_prims_for_vertices(prim_info->prim, prim_info->count);
+      draw->statistics.vs_invocations += fetch_info->count;
+   }
+
+   if (fpme->threaded) {
+      struct draw_pt_segment *segment =
+         draw_pt_threads_alloc(draw->pt.threads, middle,
+                               fetch_info, prim_info);
+
+      if (segment) {
+         draw_pt_threads_queue(draw->pt.threads, segment);
+         return;
+      }
+   }
+
+   clipped = llvm_pipeline_shade(fpme, fetch_info, &llvm_vert_info);
+   if (!llvm_vert_info.verts)
+      return;
+
+   llvm_pipeline_shaded(fpme, &llvm_vert_info, prim_info, clipped);
+}
+
+
+static void
+llvm_middle_end_shade_segment(struct draw_pt_middle_end *middle,
+                              struct draw_pt_segment *segment,
+                              unsigned thread)
+{
+   segment->clipped = llvm_pipeline_shade(llvm_middle_end(middle),
+                                          &segment->fetch_info,
+                                          &segment->vert_info);
+}
+
+
+static void
+llvm_middle_end_finish_segment(struct draw_pt_middle_end *middle,
+                               struct draw_pt_segment *segment)
+{
+   if (!segment->vert_info.verts)
+      return;
+
+   llvm_pipeline_shaded(llvm_middle_end(middle), &segment->vert_info,
+                        &segment->prim_info, segment->clipped);
+}
+
+
 static void
 llvm_middle_end_run(struct draw_pt_middle_end *middle,
                     const unsigned *fetch_elts,
@@ -608,6 +675,8 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
    fpme->base.run             = llvm_middle_end_run;
    fpme->base.run_linear      = llvm_middle_end_linear_run;
    fpme->base.run_linear_elts = llvm_middle_end_linear_run_elts;
+   fpme->base.shade_segment   = llvm_middle_end_shade_segment;
+   fpme->base.finish_segment  = llvm_middle_end_finish_segment;
    fpme->base.finish          = llvm_middle_end_finish;
    fpme->base.destroy         = llvm_middle_end_destroy;
 
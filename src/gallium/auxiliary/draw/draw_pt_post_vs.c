@@ -28,6 +28,8 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_prim.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_sse.h"
 #include "pipe/p_context.h"
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
@@ -41,6 +43,12 @@
 #define DO_VIEWPORT          0x10
 #define DO_EDGEFLAG          0x20
 #define DO_CLIP_XY_GUARD_BAND 0x40
+#define DO_GUARD_BAND_STATS  0x80
+
+/* Returned along with the clipmasks, with DO_GUARD_BAND_STATS, for
+ * vertices outside the viewport but within the guard band.
+ */
+#define GUARD_BAND_VERTEX (1 << DRAW_TOTAL_CLIP_PLANES)
 
 
 struct pt_post_vs {
@@ -87,6 +95,10 @@ dot4(const float *a, const float *b)
 #define TAG(x) x##_xy_gb_halfz_viewport
 #include "draw_cliptest_tmp.h"
 
+#define FLAGS (DO_CLIP_XY_GUARD_BAND | DO_CLIP_FULL_Z | DO_VIEWPORT)
+#define TAG(x) x##_xy_gb_fullz_viewport
+#include "draw_cliptest_tmp.h"
+
 #define FLAGS (DO_CLIP_FULL_Z | DO_VIEWPORT)
 #define TAG(x) x##_fullz_viewport
 #include "draw_cliptest_tmp.h"
@@ -115,6 +127,173 @@ dot4(const float *a, const float *b)
 #include "draw_cliptest_tmp.h"
 
 
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Cliptest and viewport transform of four vertices at a time, for the
+ * common case of only the hardwired planes and a single viewport.  The
+ * positions are transposed so that each SSE register holds one coordinate
+ * of four vertices; the arithmetic is the same as in draw_cliptest_tmp.h.
+ */
+static boolean
+do_cliptest_sse(struct pt_post_vs *pvs,
+                struct draw_vertex_info *info,
+                const struct draw_prim_info *prim_info)
+{
+   struct draw_context *draw = pvs->draw;
+   const unsigned flags = pvs->flags;
+   const unsigned pos = draw_current_shader_position_output(draw);
+   const unsigned stride = info->stride;
+   const unsigned count = info->count & ~3;
+   const float *scale = draw->viewports[0].scale;
+   const float *trans = draw->viewports[0].translate;
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 one = _mm_set1_ps(1.0f);
+   const __m128 band = _mm_set1_ps(flags & DO_CLIP_XY_GUARD_BAND ?
+                                   0.50f : 1.0f);
+   const __m128 scale_x = _mm_set1_ps(scale[0]);
+   const __m128 scale_y = _mm_set1_ps(scale[1]);
+   const __m128 scale_z = _mm_set1_ps(scale[2]);
+   const __m128 trans_x = _mm_set1_ps(trans[0]);
+   const __m128 trans_y = _mm_set1_ps(trans[1]);
+   const __m128 trans_z = _mm_set1_ps(trans[2]);
+   __m128i need_pipeline = _mm_setzero_si128();
+   __m128 guard_band_verts = _mm_setzero_ps();
+   struct draw_vertex_info rest;
+   boolean rest_clipped = FALSE;
+   unsigned i, j;
+
+   /* Leave user clipping and viewport indices to the generic code. */
+   if (draw_current_shader_uses_viewport_index(draw) ||
+       draw_current_shader_num_written_clipdistances(draw))
+      return do_cliptest_generic(pvs, info, prim_info);
+
+   for (j = 0; j < count; j += 4) {
+      struct vertex_header *out[4];
+      __m128 x, y, z, w, outside;
+      __m128 mask = _mm_setzero_ps();
+      union m128i clipmask;
+
+      for (i = 0; i < 4; i++) {
+         out[i] = (struct vertex_header *)
+            ((char *) info->verts + (j + i) * stride);
+      }
+
+      x = _mm_loadu_ps(out[0]->data[pos]);
+      y = _mm_loadu_ps(out[1]->data[pos]);
+      z = _mm_loadu_ps(out[2]->data[pos]);
+      w = _mm_loadu_ps(out[3]->data[pos]);
+
+      _mm_storeu_ps(out[0]->clip, x);
+      _mm_storeu_ps(out[1]->clip, y);
+      _mm_storeu_ps(out[2]->clip, z);
+      _mm_storeu_ps(out[3]->clip, w);
+      _mm_storeu_ps(out[0]->pre_clip_pos, x);
+      _mm_storeu_ps(out[1]->pre_clip_pos, y);
+      _mm_storeu_ps(out[2]->pre_clip_pos, z);
+      _mm_storeu_ps(out[3]->pre_clip_pos, w);
+
+      _MM_TRANSPOSE4_PS(x, y, z, w);
+
+      /* The compares give all ones per failing plane, which the plane's
+       * bit, as a float bit pattern, is then masked with.
+       */
+#define PLANE(test, bit) \
+      mask = _mm_or_ps(mask, _mm_and_ps(test, \
+                       _mm_castsi128_ps(_mm_set1_epi32(1 << (bit)))))
+
+      if (flags & (DO_CLIP_XY | DO_CLIP_XY_GUARD_BAND)) {
+         const __m128 bx = _mm_mul_ps(band, x);
+         const __m128 by = _mm_mul_ps(band, y);
+
+         PLANE(_mm_cmplt_ps(_mm_sub_ps(w, bx), zero), 0);
+         PLANE(_mm_cmplt_ps(_mm_add_ps(bx, w), zero), 1);
+         PLANE(_mm_cmplt_ps(_mm_sub_ps(w, by), zero), 2);
+         PLANE(_mm_cmplt_ps(_mm_add_ps(by, w), zero), 3);
+
+         if (flags & DO_GUARD_BAND_STATS) {
+            outside = _mm_or_ps(
+               _mm_or_ps(_mm_cmplt_ps(_mm_sub_ps(w, x), zero),
+                         _mm_cmplt_ps(_mm_add_ps(x, w), zero)),
+               _mm_or_ps(_mm_cmplt_ps(_mm_sub_ps(w, y), zero),
+                         _mm_cmplt_ps(_mm_add_ps(y, w), zero)));
+            guard_band_verts = _mm_or_ps(guard_band_verts, outside);
+         }
+      }
+
+      if (flags & DO_CLIP_FULL_Z) {
+         PLANE(_mm_cmplt_ps(_mm_add_ps(z, w), zero), 4);
+         PLANE(_mm_cmplt_ps(_mm_sub_ps(w, z), zero), 5);
+      }
+      else if (flags & DO_CLIP_HALF_Z) {
+         PLANE(_mm_cmplt_ps(z, zero), 4);
+         PLANE(_mm_cmplt_ps(_mm_sub_ps(w, z), zero), 5);
+      }
+
+#undef PLANE
+
+      clipmask.m = _mm_castps_si128(mask);
+      need_pipeline = _mm_or_si128(need_pipeline, clipmask.m);
+
+      for (i = 0; i < 4; i++) {
+         initialize_vertex_header(out[i]);
+         out[i]->clipmask = clipmask.ui[i];
+      }
+
+      if (flags & DO_VIEWPORT) {
+         /* only the unclipped vertices are transformed */
+         const __m128 unclipped =
+            _mm_castsi128_ps(_mm_cmpeq_epi32(clipmask.m,
+                                             _mm_setzero_si128()));
+         const __m128 rw = _mm_div_ps(one, w);
+         __m128 wx, wy, wz;
+#ifdef DEBUG
+         /* NaN for the clipped vertices, as in draw_cliptest_tmp.h */
+         const __m128 keep = _mm_div_ps(zero, zero);
+#define SELECT(a, b) \
+         _mm_or_ps(_mm_and_ps(unclipped, a), _mm_andnot_ps(unclipped, keep))
+#else
+#define SELECT(a, b) \
+         _mm_or_ps(_mm_and_ps(unclipped, a), _mm_andnot_ps(unclipped, b))
+#endif
+
+         wx = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(x, rw), scale_x), trans_x);
+         wy = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(y, rw), scale_y), trans_y);
+         wz = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(z, rw), scale_z), trans_z);
+
+         x = SELECT(wx, x);
+         y = SELECT(wy, y);
+         z = SELECT(wz, z);
+         w = SELECT(rw, w);
+#undef SELECT
+
+         _MM_TRANSPOSE4_PS(x, y, z, w);
+
+         _mm_storeu_ps(out[0]->data[pos], x);
+         _mm_storeu_ps(out[1]->data[pos], y);
+         _mm_storeu_ps(out[2]->data[pos], z);
+         _mm_storeu_ps(out[3]->data[pos], w);
+      }
+   }
+
+   /* Up to three vertices left over. */
+   if (count < info->count) {
+      rest = *info;
+      rest.verts = (struct vertex_header *)
+         ((char *) info->verts + count * stride);
+      rest.count = info->count - count;
+      rest_clipped = do_cliptest_generic(pvs, &rest, prim_info);
+   }
+
+   return (rest_clipped ||
+           _mm_movemask_epi8(_mm_cmpeq_epi32(need_pipeline,
+                                             _mm_setzero_si128())) != 0xffff ||
+           _mm_movemask_ps(guard_band_verts) != 0);
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
 
 boolean draw_pt_post_vs_run( struct pt_post_vs *pvs,
                              struct draw_vertex_info *info,
@@ -135,11 +314,6 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
 {
    pvs->flags = 0;
 
-   /* This combination not currently tested/in use:
-    */
-   if (!clip_halfz)
-      guard_band = FALSE;
-
    if (clip_xy && !guard_band) {
       pvs->flags |= DO_CLIP_XY;
       ASSIGN_4V( pvs->draw->plane[0], -1,  0,  0, 1 );
@@ -149,6 +323,8 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
    }
    else if (clip_xy && guard_band) {
       pvs->flags |= DO_CLIP_XY_GUARD_BAND;
+      if (pvs->draw->collect_clip_stats)
+         pvs->flags |= DO_GUARD_BAND_STATS;
       ASSIGN_4V( pvs->draw->plane[0], -0.5,  0,  0, 1 );
       ASSIGN_4V( pvs->draw->plane[1],  0.5,  0,  0, 1 );
       ASSIGN_4V( pvs->draw->plane[2],  0, -0.5,  0, 1 );
@@ -193,6 +369,10 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
       pvs->run = do_cliptest_xy_gb_halfz_viewport;
       break;
 
+   case DO_CLIP_XY_GUARD_BAND | DO_CLIP_FULL_Z | DO_VIEWPORT:
+      pvs->run = do_cliptest_xy_gb_fullz_viewport;
+      break;
+
    case DO_CLIP_FULL_Z | DO_VIEWPORT:
       pvs->run = do_cliptest_fullz_viewport;
       break;
@@ -214,6 +394,16 @@ void draw_pt_post_vs_prepare( struct pt_post_vs *pvs,
       pvs->run = do_cliptest_generic;
       break;
    }
+
+#if defined(PIPE_ARCH_SSE)
+   /* The hardwired planes only, the bulk of the cases */
+   if ((pvs->flags & (DO_CLIP_XY | DO_CLIP_XY_GUARD_BAND)) &&
+       (pvs->flags & ~(DO_CLIP_XY | DO_CLIP_XY_GUARD_BAND |
+                       DO_GUARD_BAND_STATS |
+                       DO_CLIP_FULL_Z | DO_CLIP_HALF_Z)) == DO_VIEWPORT &&
+       util_cpu_caps.has_sse2)
+      pvs->run = do_cliptest_sse;
+#endif
 }
 
 
@@ -0,0 +1,334 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Worker threads for the middle ends.
+ *
+ * The front end hands the middle end one segment of a draw at a time.  A
+ * middle end which can shade segments independently of each other queues
+ * them here instead of processing them immediately: the worker threads
+ * (and the application thread, while it waits) run the middle end's
+ * shade_segment() on the queued segments in any order, and the
+ * application thread then runs finish_segment() on them strictly in the
+ * order they were queued, so that everything from the geometry shader
+ * on, and the emission to the backend, sees the primitives in API order.
+ *
+ * The queue is flushed at the end of every draw_pt_arrays() call, since
+ * the vertex buffers are only guaranteed to be mapped until then.
+ */
+
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "os/os_thread.h"
+#include "draw/draw_context.h"
+#include "draw/draw_private.h"
+#include "draw/draw_pt.h"
+
+
+/* Segments in flight.  Enough for every thread to have one being shaded
+ * and one waiting.
+ */
+#define MAX_SEGMENTS (2 * DRAW_MAX_THREADS)
+
+
+struct pt_threads;
+
+struct pt_thread {
+   struct pt_threads *threads;
+   unsigned index;
+   pipe_thread thread;
+};
+
+struct pt_threads {
+   struct draw_context *draw;
+
+   unsigned num_threads;
+   struct pt_thread thread[DRAW_MAX_THREADS];
+
+   pipe_mutex mutex;
+   pipe_condvar work_ready;   /**< a segment was queued, or exit */
+   pipe_condvar work_done;    /**< a segment was shaded */
+   boolean exit;
+
+   /* Ring of segments.  These only ever increase; a segment's slot is its
+    * number modulo MAX_SEGMENTS.  Segments [head, next) are being shaded
+    * or done, [next, tail) are waiting to be picked up.
+    */
+   struct draw_pt_segment segment[MAX_SEGMENTS];
+   boolean shaded[MAX_SEGMENTS];
+   unsigned head;   /**< next segment to finish */
+   unsigned next;   /**< next segment to shade */
+   unsigned tail;   /**< next segment to queue */
+};
+
+
+static PIPE_THREAD_ROUTINE( thread_function, init_data )
+{
+   struct pt_thread *thread = (struct pt_thread *) init_data;
+   struct pt_threads *threads = thread->threads;
+   char thread_name[16];
+
+   util_snprintf(thread_name, sizeof thread_name, "draw-%u", thread->index);
+   pipe_thread_setname(thread_name);
+
+   pipe_mutex_lock(threads->mutex);
+
+   while (!threads->exit) {
+      if (threads->next != threads->tail) {
+         unsigned slot = threads->next++ % MAX_SEGMENTS;
+         struct draw_pt_segment *segment = &threads->segment[slot];
+
+         pipe_mutex_unlock(threads->mutex);
+         segment->middle->shade_segment(segment->middle, segment,
+                                        thread->index);
+         pipe_mutex_lock(threads->mutex);
+
+         threads->shaded[slot] = TRUE;
+         pipe_condvar_broadcast(threads->work_done);
+      }
+      else {
+         pipe_condvar_wait(threads->work_ready, threads->mutex);
+      }
+   }
+
+   pipe_mutex_unlock(threads->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Wait for the oldest queued segment to be shaded, shading it on this
+ * thread if no worker has picked it up yet, then finish it.
+ */
+static void
+finish_oldest(struct pt_threads *threads)
+{
+   unsigned slot = threads->head % MAX_SEGMENTS;
+   struct draw_pt_segment *segment = &threads->segment[slot];
+
+   assert(threads->head != threads->tail);
+
+   pipe_mutex_lock(threads->mutex);
+   if (threads->next == threads->head) {
+      threads->next++;
+      pipe_mutex_unlock(threads->mutex);
+      segment->middle->shade_segment(segment->middle, segment, 0);
+      pipe_mutex_lock(threads->mutex);
+      threads->shaded[slot] = TRUE;
+   }
+   while (!threads->shaded[slot])
+      pipe_condvar_wait(threads->work_done, threads->mutex);
+   threads->shaded[slot] = FALSE;
+   pipe_mutex_unlock(threads->mutex);
+
+   segment->middle->finish_segment(segment->middle, segment);
+
+   threads->head++;
+}
+
+
+/**
+ * Return a free segment set up to fetch and draw the given elements,
+ * finishing the oldest segment to make room if needed.  The element lists
+ * are copied, as the front end reuses its buffers for the next segment.
+ *
+ * Returns NULL, with all the queued segments finished, if the copies can't
+ * be allocated; the caller then runs the segment itself.
+ */
+struct draw_pt_segment *
+draw_pt_threads_alloc(struct pt_threads *threads,
+                      struct draw_pt_middle_end *middle,
+                      const struct draw_fetch_info *fetch_info,
+                      const struct draw_prim_info *prim_info)
+{
+   struct draw_pt_segment *segment;
+
+   if (threads->tail - threads->head == MAX_SEGMENTS)
+      finish_oldest(threads);
+
+   segment = &threads->segment[threads->tail % MAX_SEGMENTS];
+   segment->middle = middle;
+   segment->fetch_info = *fetch_info;
+   segment->prim_info = *prim_info;
+   segment->clipped = FALSE;
+   segment->clip_tested = FALSE;
+   segment->gs_run = FALSE;
+
+   if (fetch_info->elts) {
+      if (segment->fetch_elts_size < fetch_info->count) {
+         FREE(segment->fetch_elts);
+         segment->fetch_elts = MALLOC(fetch_info->count * sizeof(unsigned));
+         segment->fetch_elts_size = segment->fetch_elts ? fetch_info->count : 0;
+         if (!segment->fetch_elts)
+            goto fail;
+      }
+      memcpy(segment->fetch_elts, fetch_info->elts,
+             fetch_info->count * sizeof(unsigned));
+      segment->fetch_info.elts = segment->fetch_elts;
+   }
+
+   if (prim_info->elts) {
+      if (segment->draw_elts_size < prim_info->count) {
+         FREE(segment->draw_elts);
+         segment->draw_elts = MALLOC(prim_info->count * sizeof(ushort));
+         segment->draw_elts_size = segment->draw_elts ? prim_info->count : 0;
+         if (!segment->draw_elts)
+            goto fail;
+      }
+      memcpy(segment->draw_elts, prim_info->elts,
+             prim_info->count * sizeof(ushort));
+      segment->prim_info.elts = segment->draw_elts;
+   }
+
+   /* Segments from the front end are a single primitive. */
+   assert(prim_info->primitive_count == 1);
+   segment->draw_count = prim_info->primitive_lengths[0];
+   segment->prim_info.primitive_lengths = &segment->draw_count;
+
+   return segment;
+
+fail:
+   /* The caller's segment must be drawn after the queued ones. */
+   draw_pt_threads_flush(threads);
+   return NULL;
+}
+
+
+/**
+ * Queue a segment returned by draw_pt_threads_alloc().
+ */
+void
+draw_pt_threads_queue(struct pt_threads *threads,
+                      struct draw_pt_segment *segment)
+{
+   assert(segment == &threads->segment[threads->tail % MAX_SEGMENTS]);
+
+   pipe_mutex_lock(threads->mutex);
+   threads->tail++;
+   /* A lone segment is cheaper to shade on the application thread when the
+    * queue is flushed than to hand over to a worker.
+    */
+   if (threads->tail - threads->next > 1)
+      pipe_condvar_broadcast(threads->work_ready);
+   pipe_mutex_unlock(threads->mutex);
+
+   /* Keep the backend busy with whatever is ready. */
+   while (threads->head != threads->tail) {
+      boolean ready;
+
+      pipe_mutex_lock(threads->mutex);
+      ready = threads->shaded[threads->head % MAX_SEGMENTS];
+      pipe_mutex_unlock(threads->mutex);
+
+      if (!ready)
+         break;
+
+      finish_oldest(threads);
+   }
+}
+
+
+/**
+ * Finish all queued segments.
+ */
+void
+draw_pt_threads_flush(struct pt_threads *threads)
+{
+   while (threads->head != threads->tail)
+      finish_oldest(threads);
+}
+
+
+/**
+ * Start up to num_threads worker threads, and set draw->pt.nr_threads to the
+ * number actually started.  Returns NULL if none could be.
+ */
+struct pt_threads *
+draw_pt_threads_create(struct draw_context *draw, unsigned num_threads)
+{
+   struct pt_threads *threads = CALLOC_STRUCT(pt_threads);
+   unsigned i;
+
+   if (!threads)
+      return NULL;
+
+   assert(num_threads < DRAW_MAX_THREADS);
+
+   threads->draw = draw;
+   pipe_mutex_init(threads->mutex);
+   pipe_condvar_init(threads->work_ready);
+   pipe_condvar_init(threads->work_done);
+
+   /* Thread 0 is the application thread. */
+   for (i = 1; i <= num_threads; i++) {
+      threads->thread[i].threads = threads;
+      threads->thread[i].index = i;
+      threads->thread[i].thread = pipe_thread_create(thread_function,
+                                                     &threads->thread[i]);
+      if (!threads->thread[i].thread)
+         break;
+      threads->num_threads = i;
+   }
+
+   draw->pt.nr_threads = threads->num_threads;
+
+   if (!threads->num_threads) {
+      draw_pt_threads_destroy(threads);
+      return NULL;
+   }
+
+   return threads;
+}
+
+
+void
+draw_pt_threads_destroy(struct pt_threads *threads)
+{
+   unsigned i;
+
+   draw_pt_threads_flush(threads);
+
+   pipe_mutex_lock(threads->mutex);
+   threads->exit = TRUE;
+   pipe_condvar_broadcast(threads->work_ready);
+   pipe_mutex_unlock(threads->mutex);
+
+   for (i = 1; i <= threads->num_threads; i++)
+      pipe_thread_wait(threads->thread[i].thread);
+
+   for (i = 0; i < MAX_SEGMENTS; i++) {
+      FREE(threads->segment[i].fetch_elts);
+      FREE(threads->segment[i].draw_elts);
+   }
+
+   pipe_condvar_destroy(threads->work_done);
+   pipe_condvar_destroy(threads->work_ready);
+   pipe_mutex_destroy(threads->mutex);
+
+   FREE(threads);
+}
@@ -31,7 +31,14 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/* The post-transform vertex cache is MAP_SETS sets of DRAW_VSPLIT_CACHE_WAYS
+ * entries each, the default being MAP_WAYS.  One way gives a direct-mapped
+ * cache.
+ */
+#define MAP_SETS     256
+#define MAP_WAYS     4
+#define MAP_MAX_WAYS 8
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -53,10 +60,14 @@ struct vsplit_frontend {
    ushort identity_draw_elts[SEGMENT_SIZE];
 
    struct {
-      /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      /* map a fetch element to a draw element, replacing the entries of
+       * a set in FIFO order
+       */
+      unsigned fetches[MAP_SETS][MAP_MAX_WAYS];
+      ushort draws[MAP_SETS][MAP_MAX_WAYS];
+      ubyte valid[MAP_SETS];
+      ubyte next[MAP_SETS];
+      unsigned ways;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +78,8 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   memset(vsplit->cache.valid, 0, sizeof(vsplit->cache.valid));
+   memset(vsplit->cache.next, 0, sizeof(vsplit->cache.next));
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -76,6 +87,11 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   struct draw_vertex_cache_stats *stats = &vsplit->draw->vertex_cache_stats;
+
+   stats->indices += vsplit->cache.num_draw_elts;
+   stats->hits += vsplit->cache.num_draw_elts - vsplit->cache.num_fetch_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -87,23 +103,35 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
+   const unsigned set = fetch % MAP_SETS;
+   unsigned way;
+
+   /* An overflow due to the element bias always gets a new vertex */
+   if (!ofbias) {
+      for (way = 0; way < vsplit->cache.valid[set]; way++) {
+         if (vsplit->cache.fetches[set][way] == fetch) {
+            vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+               vsplit->cache.draws[set][way];
+            return;
+         }
+      }
+   }
 
-   hash = fetch % MAP_SIZE;
+   /* update cache */
+   way = vsplit->cache.next[set];
+   vsplit->cache.next[set] = way + 1 < vsplit->cache.ways ? way + 1 : 0;
+   if (vsplit->cache.valid[set] < vsplit->cache.ways)
+      vsplit->cache.valid[set]++;
 
-   /* If the value isn't in the cache or it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   vsplit->cache.fetches[set][way] = fetch;
+   vsplit->cache.draws[set][way] = vsplit->cache.num_fetch_elts;
 
-      /* add fetch */
-      assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
-      vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
-   }
+   /* add fetch */
+   assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+   vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.draws[set][way];
 }
 
 /**
@@ -198,16 +226,7 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
                       unsigned start, unsigned fetch, int elt_bias)
 {
    struct draw_context *draw = vsplit->draw;
-   unsigned raw_elem_idx = start + fetch + elt_bias;
    VSPLIT_CREATE_IDX(elts, start, fetch, elt_bias);
-
-   /* special care for DRAW_MAX_FETCH_IDX */
-   if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
-      vsplit->cache.has_max_fetch = TRUE;
-   }
-
    vsplit_add_cache(vsplit, elt_idx, ofbias);
 }
 
@@ -296,6 +315,9 @@ struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
    vsplit->base.flush   = vsplit_flush;
    vsplit->base.destroy = vsplit_destroy;
    vsplit->draw = draw;
+   vsplit->cache.ways = debug_get_num_option("DRAW_VSPLIT_CACHE_WAYS",
+                                             MAP_WAYS);
+   vsplit->cache.ways = CLAMP(vsplit->cache.ways, 1, MAP_MAX_WAYS);
 
    for (i = 0; i < SEGMENT_SIZE; i++)
       vsplit->identity_draw_elts[i] = i;
@@ -118,9 +118,17 @@ CONCAT(vsplit_primitive_, ELT_TYPE)(struct vsplit_frontend *vsplit,
       draw_elts = vsplit->draw_elts;
    }
 
-   return vsplit->middle->run_linear_elts(vsplit->middle,
-                                          fetch_start, fetch_count,
-                                          draw_elts, icount, 0x0);
+   if (!vsplit->middle->run_linear_elts(vsplit->middle,
+                                        fetch_start, fetch_count,
+                                        draw_elts, icount, 0x0))
+      return FALSE;
+
+   /* every vertex in the range is shaded once, used or not */
+   draw->vertex_cache_stats.indices += icount;
+   draw->vertex_cache_stats.hits += icount > fetch_count ?
+      icount - fetch_count : 0;
+
+   return TRUE;
 }
 
 /**
@@ -154,9 +154,18 @@ draw_vs_init( struct draw_context *draw )
    draw->dump_vs = debug_get_option_gallium_dump_vs();
 
    if (!draw->llvm) {
+      unsigned i;
+
       draw->vs.tgsi.machine = tgsi_exec_machine_create();
       if (!draw->vs.tgsi.machine)
          return FALSE;
+
+      draw->vs.tgsi.thread_machine[0] = draw->vs.tgsi.machine;
+      for (i = 1; i <= draw->pt.nr_threads; i++) {
+         draw->vs.tgsi.thread_machine[i] = tgsi_exec_machine_create();
+         if (!draw->vs.tgsi.thread_machine[i])
+            return FALSE;
+      }
    }
 
    draw->vs.emit_cache = translate_cache_create();
@@ -179,8 +188,15 @@ draw_vs_destroy( struct draw_context *draw )
    if (draw->vs.emit_cache)
       translate_cache_destroy(draw->vs.emit_cache);
 
-   if (!draw->llvm)
+   if (!draw->llvm) {
+      unsigned i;
+
+      for (i = 1; i <= draw->pt.nr_threads; i++) {
+         if (draw->vs.tgsi.thread_machine[i])
+            tgsi_exec_machine_destroy(draw->vs.tgsi.thread_machine[i]);
+      }
       tgsi_exec_machine_destroy(draw->vs.tgsi.machine);
+   }
 }
 
 
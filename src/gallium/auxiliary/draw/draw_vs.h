@@ -143,6 +143,20 @@ struct draw_vertex_shader {
 		       unsigned input_stride,
 		       unsigned output_stride );
 
+   /* Like run_linear, but may be called from vertex processing thread
+    * 'thread' concurrently with the other threads.  NULL if the shader
+    * can't be run that way.
+    */
+   void (*run_linear_thread)( struct draw_vertex_shader *shader,
+                              unsigned thread,
+                              const float (*input)[4],
+                              float (*output)[4],
+                              const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                              const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                              unsigned count,
+                              unsigned input_stride,
+                              unsigned output_stride );
+
 
    void (*delete)( struct draw_vertex_shader * );
 };
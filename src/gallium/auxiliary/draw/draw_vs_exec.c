@@ -62,6 +62,7 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
 		 struct draw_context *draw )
 {
    struct exec_vertex_shader *evs = exec_vertex_shader(shader);
+   unsigned i;
 
    debug_assert(!draw->llvm);
    /* Specify the vertex program to interpret/execute.
@@ -72,6 +73,18 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
                                     shader->state.tokens,
                                     draw->vs.tgsi.sampler);
    }
+
+   if (shader->run_linear_thread) {
+      for (i = 1; i <= draw->pt.nr_threads; i++) {
+         struct tgsi_exec_machine *machine = draw->vs.tgsi.thread_machine[i];
+
+         if (machine->Tokens != shader->state.tokens) {
+            tgsi_exec_machine_bind_shader(machine,
+                                          shader->state.tokens,
+                                          draw->vs.tgsi.sampler);
+         }
+      }
+   }
 }
 
 
@@ -82,17 +95,16 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
  * it's time to try doing all the other stuff separately.
  */
 static void
-vs_exec_run_linear( struct draw_vertex_shader *shader,
-		    const float (*input)[4],
-		    float (*output)[4],
-                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
-                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
-		    unsigned count,
-		    unsigned input_stride,
-		    unsigned output_stride )
+vs_exec_run_machine( struct draw_vertex_shader *shader,
+                     struct tgsi_exec_machine *machine,
+                     const float (*input)[4],
+                     float (*output)[4],
+                     const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                     const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                     unsigned count,
+                     unsigned input_stride,
+                     unsigned output_stride )
 {
-   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
-   struct tgsi_exec_machine *machine = evs->machine;
    unsigned int i, j;
    unsigned slot;
    boolean clamp_vertex_color = shader->draw->rasterizer->clamp_vertex_color;
@@ -211,6 +223,45 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 
 
 
+static void
+vs_exec_run_linear( struct draw_vertex_shader *shader,
+		    const float (*input)[4],
+		    float (*output)[4],
+                    const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                    const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+		    unsigned count,
+		    unsigned input_stride,
+		    unsigned output_stride )
+{
+   struct exec_vertex_shader *evs = exec_vertex_shader(shader);
+
+   vs_exec_run_machine(shader, evs->machine, input, output,
+                       constants, const_size, count,
+                       input_stride, output_stride);
+}
+
+
+/* Each thread has its own machine, bound to the shader in prepare.
+ */
+static void
+vs_exec_run_linear_thread( struct draw_vertex_shader *shader,
+                           unsigned thread,
+                           const float (*input)[4],
+                           float (*output)[4],
+                           const void *constants[PIPE_MAX_CONSTANT_BUFFERS],
+                           const unsigned const_size[PIPE_MAX_CONSTANT_BUFFERS],
+                           unsigned count,
+                           unsigned input_stride,
+                           unsigned output_stride )
+{
+   vs_exec_run_machine(shader, shader->draw->vs.tgsi.thread_machine[thread],
+                       input, output, constants, const_size, count,
+                       input_stride, output_stride);
+}
+
+
+
+
 static void
 vs_exec_delete( struct draw_vertex_shader *dvs )
 {
@@ -241,6 +292,10 @@ draw_create_vs_exec(struct draw_context *draw,
    vs->base.draw = draw;
    vs->base.prepare = vs_exec_prepare;
    vs->base.run_linear = vs_exec_run_linear;
+   /* The sampler isn't safe to use from several threads at once. */
+   if (vs->base.info.file_max[TGSI_FILE_SAMPLER] < 0 &&
+       vs->base.info.file_max[TGSI_FILE_SAMPLER_VIEW] < 0)
+      vs->base.run_linear_thread = vs_exec_run_linear_thread;
    vs->base.delete = vs_exec_delete;
    vs->base.create_variant = draw_vs_create_variant_generic;
    vs->machine = draw->vs.tgsi.machine;
@@ -1419,6 +1419,40 @@ void sse2_punpcklqdq( struct x86_function *p, struct x86_reg dst, struct x86_reg
    emit_modrm( p, dst, src );
 }
 
+/* SSE4.1 zero/sign extensions: src's low 4 bytes or words into dwords */
+
+void sse41_pmovzxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_3ub(p, 0x66, 0x0f, 0x38);
+   emit_1ub(p, 0x31);
+   emit_modrm( p, dst, src );
+}
+
+void sse41_pmovsxbd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_3ub(p, 0x66, 0x0f, 0x38);
+   emit_1ub(p, 0x21);
+   emit_modrm( p, dst, src );
+}
+
+void sse41_pmovzxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_3ub(p, 0x66, 0x0f, 0x38);
+   emit_1ub(p, 0x33);
+   emit_modrm( p, dst, src );
+}
+
+void sse41_pmovsxwd( struct x86_function *p, struct x86_reg dst, struct x86_reg src )
+{
+   DUMP_RR( dst, src );
+   emit_3ub(p, 0x66, 0x0f, 0x38);
+   emit_1ub(p, 0x23);
+   emit_modrm( p, dst, src );
+}
+
 void sse2_psllw_imm( struct x86_function *p, struct x86_reg dst, unsigned imm )
 {
    DUMP_RI(dst, imm);
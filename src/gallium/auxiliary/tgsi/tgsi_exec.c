@@ -58,6 +58,7 @@
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_util.h"
 #include "tgsi_exec.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
@@ -843,6 +844,12 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 }
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(decode, "TGSI_EXEC_DECODE", TRUE)
+
+static void
+decode_instructions(struct tgsi_exec_machine *mach);
+
+
 /**
  * Initialize machine state by expanding tokens to full instructions,
  * allocating temporary storage, setting up constants, etc.
@@ -881,6 +888,9 @@ tgsi_exec_machine_bind_shader(
       mach->Instructions = NULL;
       mach->NumInstructions = 0;
 
+      FREE(mach->Ops);
+      mach->Ops = NULL;
+
       return;
    }
 
@@ -1020,6 +1030,8 @@ tgsi_exec_machine_bind_shader(
    FREE(mach->Instructions);
    mach->Instructions = instructions;
    mach->NumInstructions = numInstructions;
+
+   decode_instructions(mach);
 }
 
 
@@ -1038,6 +1050,7 @@ tgsi_exec_machine_create( void )
    mach->Addrs = &mach->Temps[TGSI_EXEC_TEMP_ADDR];
    mach->MaxGeometryShaderOutputs = TGSI_MAX_TOTAL_VERTICES;
    mach->Predicates = &mach->Temps[TGSI_EXEC_TEMP_P0];
+   mach->DecodeInstructions = debug_get_option_decode();
 
    mach->Inputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_INPUTS, 16);
    mach->Outputs = align_malloc(sizeof(struct tgsi_exec_vector) * PIPE_MAX_SHADER_OUTPUTS, 16);
@@ -1081,6 +1094,7 @@ tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
       FREE(mach->Instructions);
+      FREE(mach->Ops);
       FREE(mach->Declarations);
 
       align_free(mach->Inputs);
@@ -5130,6 +5144,627 @@ exec_instruction(
 }
 
 
+/*
+ * Pre-decoded instructions.
+ *
+ * exec_instruction() re-examines the full instruction every time it runs:
+ * a switch on the opcode, then for every channel of every operand a walk
+ * through fetch_source()/store_dest() which handle indirection, 2D files,
+ * predicates and all the register files.  Most instructions of most
+ * shaders need none of that, so at bind time each instruction is decoded
+ * into a tgsi_exec_op which holds a pointer to the function executing it
+ * and its operands resolved to the registers they address.  The run loop
+ * then just calls one function per instruction.
+ *
+ * Only simple float ALU instructions with direct operands are decoded;
+ * everything else is executed by exec_instruction() as before, so the
+ * results are identical either way.
+ */
+
+enum op_src_kind {
+   OP_SRC_VECTOR,     /**< TEMP, INPUT or OUTPUT register */
+   OP_SRC_IMMEDIATE,
+   OP_SRC_CONSTANT
+};
+
+struct tgsi_exec_op_src {
+   enum op_src_kind kind;
+   boolean absolute;
+   boolean negate;
+   /** OP_SRC_VECTOR: register channel, per swizzled channel */
+   const union tgsi_exec_channel *chan[TGSI_NUM_CHANNELS];
+   /** OP_SRC_IMMEDIATE: immediate value, per swizzled channel */
+   const float *imm[TGSI_NUM_CHANNELS];
+   /** OP_SRC_CONSTANT: buffer and dword position, per swizzled channel */
+   unsigned buf;
+   int pos[TGSI_NUM_CHANNELS];
+};
+
+struct tgsi_exec_op;
+
+typedef void (* tgsi_exec_op_func)(struct tgsi_exec_machine *mach,
+                                   const struct tgsi_exec_op *op,
+                                   int *pc);
+
+struct tgsi_exec_op {
+   tgsi_exec_op_func func;
+
+   /** The instruction, for the functions falling back to exec_instruction() */
+   const struct tgsi_full_instruction *inst;
+
+   /** For the generic functions: the micro op implementing the instruction */
+   union {
+      micro_unary_op unary;
+      micro_binary_op binary;
+      micro_trinary_op trinary;
+   } micro;
+
+   struct tgsi_exec_op_src src[3];
+
+   struct tgsi_exec_vector *dst;
+   boolean dst_output;   /**< dst is relative to the current output vertex */
+   unsigned writemask;
+   boolean saturate;
+};
+
+
+static inline void
+fetch_op_src(const struct tgsi_exec_machine *mach,
+             const struct tgsi_exec_op_src *src,
+             uint chan,
+             union tgsi_exec_channel *dst)
+{
+   switch (src->kind) {
+   case OP_SRC_VECTOR:
+      *dst = *src->chan[chan];
+      break;
+
+   case OP_SRC_IMMEDIATE:
+      dst->f[0] =
+      dst->f[1] =
+      dst->f[2] =
+      dst->f[3] = *src->imm[chan];
+      break;
+
+   case OP_SRC_CONSTANT:
+      {
+         const int pos = src->pos[chan];
+         uint value = 0;
+
+         assert(mach->Consts[src->buf]);
+
+         /* const buffer bounds check, as in fetch_src_file_channel() */
+         if (pos < (int) mach->ConstsSize[src->buf])
+            value = ((const uint *) mach->Consts[src->buf])[pos];
+
+         dst->u[0] =
+         dst->u[1] =
+         dst->u[2] =
+         dst->u[3] = value;
+      }
+      break;
+   }
+
+   if (src->absolute)
+      micro_abs(dst, dst);
+   if (src->negate)
+      micro_neg(dst, dst);
+}
+
+
+static inline void
+store_op_dst(struct tgsi_exec_machine *mach,
+             const struct tgsi_exec_op *op,
+             const struct tgsi_exec_vector *val)
+{
+   struct tgsi_exec_vector *dst = op->dst;
+   const uint execmask = mach->ExecMask;
+   uint chan, i;
+
+   if (op->dst_output)
+      dst += mach->Temps[TEMP_OUTPUT_I].xyzw[TEMP_OUTPUT_C].u[0];
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (!(op->writemask & (1 << chan)))
+         continue;
+
+      if (!op->saturate) {
+         if (execmask == 0xf) {
+            dst->xyzw[chan] = val->xyzw[chan];
+         }
+         else {
+            for (i = 0; i < TGSI_QUAD_SIZE; i++)
+               if (execmask & (1 << i))
+                  dst->xyzw[chan].i[i] = val->xyzw[chan].i[i];
+         }
+      }
+      else {
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            if (execmask & (1 << i)) {
+               if (val->xyzw[chan].f[i] < 0.0f)
+                  dst->xyzw[chan].f[i] = 0.0f;
+               else if (val->xyzw[chan].f[i] > 1.0f)
+                  dst->xyzw[chan].f[i] = 1.0f;
+               else
+                  dst->xyzw[chan].i[i] = val->xyzw[chan].i[i];
+            }
+      }
+   }
+}
+
+
+static void
+exec_op_interp(struct tgsi_exec_machine *mach,
+               const struct tgsi_exec_op *op,
+               int *pc)
+{
+   exec_instruction(mach, op->inst, pc);
+}
+
+static void
+exec_op_mov(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   struct tgsi_exec_vector dst;
+   uint chan;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      if (op->writemask & (1 << chan))
+         fetch_op_src(mach, &op->src[0], chan, &dst.xyzw[chan]);
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_add(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src0, src1;
+   uint chan, i;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src0);
+         fetch_op_src(mach, &op->src[1], chan, &src1);
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            dst.xyzw[chan].f[i] = src0.f[i] + src1.f[i];
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_mul(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src0, src1;
+   uint chan, i;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src0);
+         fetch_op_src(mach, &op->src[1], chan, &src1);
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            dst.xyzw[chan].f[i] = src0.f[i] * src1.f[i];
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_mad(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src0, src1, src2;
+   uint chan, i;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src0);
+         fetch_op_src(mach, &op->src[1], chan, &src1);
+         fetch_op_src(mach, &op->src[2], chan, &src2);
+         for (i = 0; i < TGSI_QUAD_SIZE; i++)
+            dst.xyzw[chan].f[i] = src0.f[i] * src1.f[i] + src2.f[i];
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+/**
+ * DP2, DP3 and DP4, with the same order of operations as exec_dp3().
+ */
+static inline void
+exec_op_dot(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            uint num_chans)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src0, src1, sum;
+   uint chan, i;
+
+   fetch_op_src(mach, &op->src[0], TGSI_CHAN_X, &src0);
+   fetch_op_src(mach, &op->src[1], TGSI_CHAN_X, &src1);
+   for (i = 0; i < TGSI_QUAD_SIZE; i++)
+      sum.f[i] = src0.f[i] * src1.f[i];
+
+   for (chan = TGSI_CHAN_Y; chan < num_chans; chan++) {
+      fetch_op_src(mach, &op->src[0], chan, &src0);
+      fetch_op_src(mach, &op->src[1], chan, &src1);
+      for (i = 0; i < TGSI_QUAD_SIZE; i++)
+         sum.f[i] = src0.f[i] * src1.f[i] + sum.f[i];
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++)
+      dst.xyzw[chan] = sum;
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_dp2(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   (*pc)++;
+   exec_op_dot(mach, op, 2);
+}
+
+static void
+exec_op_dp3(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   (*pc)++;
+   exec_op_dot(mach, op, 3);
+}
+
+static void
+exec_op_dp4(struct tgsi_exec_machine *mach,
+            const struct tgsi_exec_op *op,
+            int *pc)
+{
+   (*pc)++;
+   exec_op_dot(mach, op, 4);
+}
+
+static void
+exec_op_scalar_unary(struct tgsi_exec_machine *mach,
+                     const struct tgsi_exec_op *op,
+                     int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src;
+   uint chan;
+
+   (*pc)++;
+
+   fetch_op_src(mach, &op->src[0], TGSI_CHAN_X, &src);
+   op->micro.unary(&dst.xyzw[TGSI_CHAN_X], &src);
+   for (chan = TGSI_CHAN_Y; chan < TGSI_NUM_CHANNELS; chan++)
+      dst.xyzw[chan] = dst.xyzw[TGSI_CHAN_X];
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_vector_unary(struct tgsi_exec_machine *mach,
+                     const struct tgsi_exec_op *op,
+                     int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src;
+   uint chan;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src);
+         op->micro.unary(&dst.xyzw[chan], &src);
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_vector_binary(struct tgsi_exec_machine *mach,
+                      const struct tgsi_exec_op *op,
+                      int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src[2];
+   uint chan;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src[0]);
+         fetch_op_src(mach, &op->src[1], chan, &src[1]);
+         op->micro.binary(&dst.xyzw[chan], &src[0], &src[1]);
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+static void
+exec_op_vector_trinary(struct tgsi_exec_machine *mach,
+                       const struct tgsi_exec_op *op,
+                       int *pc)
+{
+   struct tgsi_exec_vector dst;
+   union tgsi_exec_channel src[3];
+   uint chan;
+
+   (*pc)++;
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (op->writemask & (1 << chan)) {
+         fetch_op_src(mach, &op->src[0], chan, &src[0]);
+         fetch_op_src(mach, &op->src[1], chan, &src[1]);
+         fetch_op_src(mach, &op->src[2], chan, &src[2]);
+         op->micro.trinary(&dst.xyzw[chan], &src[0], &src[1], &src[2]);
+      }
+   }
+
+   store_op_dst(mach, op, &dst);
+}
+
+
+/**
+ * Resolve a source operand to the registers it reads.
+ * \return FALSE if the operand needs the general fetch_source() path
+ */
+static boolean
+decode_src(struct tgsi_exec_machine *mach,
+           const struct tgsi_full_src_register *reg,
+           struct tgsi_exec_op_src *src)
+{
+   const int index = reg->Register.Index;
+   uint chan;
+
+   if (reg->Register.Indirect)
+      return FALSE;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+   case TGSI_FILE_INPUT:
+   case TGSI_FILE_OUTPUT:
+      {
+         const struct tgsi_exec_vector *file;
+
+         if (reg->Register.Dimension)
+            return FALSE;
+
+         if (reg->Register.File == TGSI_FILE_TEMPORARY) {
+            if (index >= TGSI_EXEC_NUM_TEMPS)
+               return FALSE;
+            file = mach->Temps;
+         }
+         else if (reg->Register.File == TGSI_FILE_INPUT) {
+            file = mach->Inputs;
+         }
+         else {
+            file = mach->Outputs;
+         }
+
+         src->kind = OP_SRC_VECTOR;
+         for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+            uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+            src->chan[chan] = &file[index].xyzw[swizzle];
+         }
+      }
+      break;
+
+   case TGSI_FILE_IMMEDIATE:
+      if (reg->Register.Dimension || index >= (int) mach->ImmLimit)
+         return FALSE;
+
+      src->kind = OP_SRC_IMMEDIATE;
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+         src->imm[chan] = &mach->Imms[index][swizzle];
+      }
+      break;
+
+   case TGSI_FILE_CONSTANT:
+      src->buf = 0;
+      if (reg->Register.Dimension) {
+         if (reg->Dimension.Indirect ||
+             reg->Dimension.Index >= PIPE_MAX_CONSTANT_BUFFERS)
+            return FALSE;
+         src->buf = reg->Dimension.Index;
+      }
+
+      src->kind = OP_SRC_CONSTANT;
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         uint swizzle = tgsi_util_get_full_src_register_swizzle(reg, chan);
+         src->pos[chan] = index * 4 + swizzle;
+      }
+      break;
+
+   default:
+      return FALSE;
+   }
+
+   src->absolute = reg->Register.Absolute;
+   src->negate = reg->Register.Negate;
+   return TRUE;
+}
+
+
+/**
+ * Decode an instruction into a function executing it directly, if it is
+ * one of the float ALU instructions exec_instruction() would execute with
+ * exec_vector_*(), exec_scalar_unary() or exec_dpN() and all of its
+ * operands can be resolved at bind time.
+ */
+static void
+decode_instruction(struct tgsi_exec_machine *mach,
+                   const struct tgsi_full_instruction *inst,
+                   struct tgsi_exec_op *op)
+{
+   const struct tgsi_full_dst_register *reg = &inst->Dst[0];
+   tgsi_exec_op_func func = NULL;
+   uint num_src, i;
+
+   memset(op, 0, sizeof *op);
+   op->func = exec_op_interp;
+   op->inst = inst;
+
+   if (!mach->DecodeInstructions)
+      return;
+
+   switch (inst->Instruction.Opcode) {
+   case TGSI_OPCODE_MOV:
+      func = exec_op_mov;
+      break;
+   case TGSI_OPCODE_ADD:
+      func = exec_op_add;
+      break;
+   case TGSI_OPCODE_MUL:
+      func = exec_op_mul;
+      break;
+   case TGSI_OPCODE_MAD:
+      func = exec_op_mad;
+      break;
+   case TGSI_OPCODE_DP2:
+      func = exec_op_dp2;
+      break;
+   case TGSI_OPCODE_DP3:
+      func = exec_op_dp3;
+      break;
+   case TGSI_OPCODE_DP4:
+      func = exec_op_dp4;
+      break;
+   case TGSI_OPCODE_RCP:
+      func = exec_op_scalar_unary;
+      op->micro.unary = micro_rcp;
+      break;
+   case TGSI_OPCODE_RSQ:
+      func = exec_op_scalar_unary;
+      op->micro.unary = micro_rsq;
+      break;
+   case TGSI_OPCODE_ABS:
+      func = exec_op_vector_unary;
+      op->micro.unary = micro_abs;
+      break;
+   case TGSI_OPCODE_FLR:
+      func = exec_op_vector_unary;
+      op->micro.unary = micro_flr;
+      break;
+   case TGSI_OPCODE_FRC:
+      func = exec_op_vector_unary;
+      op->micro.unary = micro_frc;
+      break;
+   case TGSI_OPCODE_SUB:
+      func = exec_op_vector_binary;
+      op->micro.binary = micro_sub;
+      break;
+   case TGSI_OPCODE_MIN:
+      func = exec_op_vector_binary;
+      op->micro.binary = micro_min;
+      break;
+   case TGSI_OPCODE_MAX:
+      func = exec_op_vector_binary;
+      op->micro.binary = micro_max;
+      break;
+   case TGSI_OPCODE_SLT:
+      func = exec_op_vector_binary;
+      op->micro.binary = micro_slt;
+      break;
+   case TGSI_OPCODE_SGE:
+      func = exec_op_vector_binary;
+      op->micro.binary = micro_sge;
+      break;
+   case TGSI_OPCODE_LRP:
+      func = exec_op_vector_trinary;
+      op->micro.trinary = micro_lrp;
+      break;
+   case TGSI_OPCODE_CMP:
+      func = exec_op_vector_trinary;
+      op->micro.trinary = micro_cmp;
+      break;
+   default:
+      return;
+   }
+
+   if (inst->Instruction.Predicate ||
+       inst->Instruction.NumDstRegs != 1 ||
+       reg->Register.Indirect ||
+       reg->Register.Dimension)
+      return;
+
+   switch (reg->Register.File) {
+   case TGSI_FILE_TEMPORARY:
+      if (reg->Register.Index >= TGSI_EXEC_NUM_TEMPS)
+         return;
+      op->dst = &mach->Temps[reg->Register.Index];
+      break;
+   case TGSI_FILE_OUTPUT:
+      op->dst = &mach->Outputs[reg->Register.Index];
+      op->dst_output = TRUE;
+      break;
+   default:
+      return;
+   }
+
+   num_src = inst->Instruction.NumSrcRegs;
+   assert(num_src <= Elements(op->src));
+   for (i = 0; i < num_src; i++) {
+      if (!decode_src(mach, &inst->Src[i], &op->src[i]))
+         return;
+   }
+
+   op->writemask = reg->Register.WriteMask;
+   op->saturate = inst->Instruction.Saturate;
+   op->func = func;
+}
+
+
+/**
+ * (Re)build mach->Ops from mach->Instructions.
+ */
+static void
+decode_instructions(struct tgsi_exec_machine *mach)
+{
+   uint i;
+
+   FREE(mach->Ops);
+   mach->Ops = NULL;
+
+   if (!mach->NumInstructions)
+      return;
+
+   mach->Ops = MALLOC(mach->NumInstructions * sizeof(struct tgsi_exec_op));
+   if (!mach->Ops)
+      return;
+
+   for (i = 0; i < mach->NumInstructions; i++)
+      decode_instruction(mach, &mach->Instructions[i], &mach->Ops[i]);
+}
+
+
 /**
  * Run TGSI interpreter.
  * \return bitmask of "alive" quad components
@@ -5194,7 +5829,13 @@ tgsi_exec_machine_run( struct tgsi_exec_machine *mach )
 #endif
 
          assert(pc < (int) mach->NumInstructions);
-         exec_instruction(mach, mach->Instructions + pc, &pc);
+         if (mach->Ops) {
+            const struct tgsi_exec_op *op = &mach->Ops[pc];
+            op->func(mach, op, &pc);
+         }
+         else {
+            exec_instruction(mach, mach->Instructions + pc, &pc);
+         }
 
 #if DEBUG_EXECUTION
          for (i = 0; i < TGSI_EXEC_NUM_TEMPS + TGSI_EXEC_NUM_TEMP_EXTRAS; i++) {
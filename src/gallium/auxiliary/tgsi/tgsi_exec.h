@@ -270,6 +270,8 @@ enum tgsi_break_type {
 #define TGSI_EXEC_MAX_BREAK_STACK (TGSI_EXEC_MAX_LOOP_NESTING + TGSI_EXEC_MAX_SWITCH_NESTING)
 
 
+struct tgsi_exec_op;
+
 /**
  * Run-time virtual machine state for executing TGSI shader.
  */
@@ -362,6 +364,11 @@ struct tgsi_exec_machine
    struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
+   /** Instructions decoded for direct execution, parallel to Instructions */
+   struct tgsi_exec_op *Ops;
+   /** Whether to decode instructions at bind time (TGSI_EXEC_DECODE) */
+   boolean DecodeInstructions;
+
    struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
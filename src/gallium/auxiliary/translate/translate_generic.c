@@ -260,97 +260,97 @@ emit_B8G8R8A8_UNORM( const void *attrib, void *ptr)
 static void
 emit_B10G10R10A2_UNORM( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= ((uint32_t)(CLAMP(src[2], 0, 1) * 0x3ff)) & 0x3ff;
    value |= (((uint32_t)(CLAMP(src[1], 0, 1) * 0x3ff)) & 0x3ff) << 10;
    value |= (((uint32_t)(CLAMP(src[0], 0, 1) * 0x3ff)) & 0x3ff) << 20;
    value |= ((uint32_t)(CLAMP(src[3], 0, 1) * 0x3)) << 30;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_B10G10R10A2_USCALED( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= ((uint32_t)CLAMP(src[2], 0, 1023)) & 0x3ff;
    value |= (((uint32_t)CLAMP(src[1], 0, 1023)) & 0x3ff) << 10;
    value |= (((uint32_t)CLAMP(src[0], 0, 1023)) & 0x3ff) << 20;
    value |= ((uint32_t)CLAMP(src[3], 0, 3)) << 30;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_B10G10R10A2_SNORM( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= (uint32_t)(((uint32_t)(CLAMP(src[2], -1, 1) * 0x1ff)) & 0x3ff) ;
    value |= (uint32_t)((((uint32_t)(CLAMP(src[1], -1, 1) * 0x1ff)) & 0x3ff) << 10) ;
    value |= (uint32_t)((((uint32_t)(CLAMP(src[0], -1, 1) * 0x1ff)) & 0x3ff) << 20) ;
    value |= (uint32_t)(((uint32_t)(CLAMP(src[3], -1, 1) * 0x1)) << 30) ;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_B10G10R10A2_SSCALED( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= (uint32_t)(((uint32_t)CLAMP(src[2], -512, 511)) & 0x3ff) ;
    value |= (uint32_t)((((uint32_t)CLAMP(src[1], -512, 511)) & 0x3ff) << 10) ;
    value |= (uint32_t)((((uint32_t)CLAMP(src[0], -512, 511)) & 0x3ff) << 20) ;
    value |= (uint32_t)(((uint32_t)CLAMP(src[3], -2, 1)) << 30) ;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_R10G10B10A2_UNORM( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= ((uint32_t)(CLAMP(src[0], 0, 1) * 0x3ff)) & 0x3ff;
    value |= (((uint32_t)(CLAMP(src[1], 0, 1) * 0x3ff)) & 0x3ff) << 10;
    value |= (((uint32_t)(CLAMP(src[2], 0, 1) * 0x3ff)) & 0x3ff) << 20;
    value |= ((uint32_t)(CLAMP(src[3], 0, 1) * 0x3)) << 30;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_R10G10B10A2_USCALED( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= ((uint32_t)CLAMP(src[0], 0, 1023)) & 0x3ff;
    value |= (((uint32_t)CLAMP(src[1], 0, 1023)) & 0x3ff) << 10;
    value |= (((uint32_t)CLAMP(src[2], 0, 1023)) & 0x3ff) << 20;
    value |= ((uint32_t)CLAMP(src[3], 0, 3)) << 30;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_R10G10B10A2_SNORM( const void *attrib, void *ptr )
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= (uint32_t)(((uint32_t)(CLAMP(src[0], -1, 1) * 0x1ff)) & 0x3ff) ;
    value |= (uint32_t)((((uint32_t)(CLAMP(src[1], -1, 1) * 0x1ff)) & 0x3ff) << 10) ;
    value |= (uint32_t)((((uint32_t)(CLAMP(src[2], -1, 1) * 0x1ff)) & 0x3ff) << 20) ;
    value |= (uint32_t)(((uint32_t)(CLAMP(src[3], -1, 1) * 0x1)) << 30) ;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void
 emit_R10G10B10A2_SSCALED( const void *attrib, void *ptr)
 {
-   float *src = (float *)ptr;
+   const float *src = (const float *)attrib;
    uint32_t value = 0;
    value |= (uint32_t)(((uint32_t)CLAMP(src[0], -512, 511)) & 0x3ff) ;
    value |= (uint32_t)((((uint32_t)CLAMP(src[1], -512, 511)) & 0x3ff) << 10) ;
    value |= (uint32_t)((((uint32_t)CLAMP(src[2], -512, 511)) & 0x3ff) << 20) ;
    value |= (uint32_t)(((uint32_t)CLAMP(src[3], -2, 1)) << 30) ;
-   *(uint32_t *)attrib = util_le32_to_cpu(value);
+   *(uint32_t *)ptr = util_le32_to_cpu(value);
 }
 
 static void 
@@ -64,7 +64,7 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_CONSTS 7
+#define NUM_CONSTS 16
 
 enum
 {
@@ -74,7 +74,16 @@ enum
    CONST_INV_32767,
    CONST_INV_65535,
    CONST_INV_2147483647,
-   CONST_255
+   CONST_INV_4294967295,
+   CONST_255,
+   CONST_65536,
+   CONST_HALF_MAGIC,
+   CONST_10_10_10_2_BIAS,
+   CONST_10_10_10_2_THRESHOLD,
+   CONST_10_10_10_2_RANGE,
+   CONST_10_10_10_2_UNORM,
+   CONST_10_10_10_2_SNORM,
+   CONST_10_10_10_2_SCALED
 };
 
 #define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
@@ -85,7 +94,45 @@ static float consts[NUM_CONSTS][4] = {
    C(1.0 / 32767.0),
    C(1.0 / 65535.0),
    C(1.0 / 2147483647.0),
-   C(255.0)
+   C(1.0 / 4294967295.0),
+   C(255.0),
+   C(65536.0),
+   C(5192296858534827628530496329220096.0), /* 2^112, see util_half_to_float */
+   /* The 10_10_10_2 channels are converted in place, still shifted by
+    * 0, 10, 20 and 30 bits, and the scales make up for it.
+    */
+   {0, 0, 0, 2147483648.0f},
+   {512.0f, 512.0f * 1024, 512.0f * 1024 * 1024, 2147483648.0f},
+   {1024.0f, 1024.0f * 1024, 1024.0f * 1024 * 1024, 0},
+   {1.0f / 0x3ff, (1.0f / 0x3ff) / 1024, (1.0f / 0x3ff) / (1024 * 1024),
+    (1.0f / 0x3) / (1024 * 1024 * 1024)},
+   {1.0f / 0x1ff, (1.0f / 0x1ff) / 1024, (1.0f / 0x1ff) / (1024 * 1024),
+    1.0f / (1024 * 1024 * 1024)},
+   {1.0f, 1.0f / 1024, 1.0f / (1024 * 1024), 1.0f / (1024 * 1024 * 1024)}
+};
+
+#undef C
+
+#define NUM_INT_CONSTS 6
+
+enum
+{
+   INT_CONST_ONE_W,
+   INT_CONST_HALF_SIGN,
+   INT_CONST_HALF_EXP_MANTISSA,
+   INT_CONST_FLOAT_EXP,
+   INT_CONST_10_10_10_2_MASK,
+   INT_CONST_10_10_10_2_SIGN
+};
+
+#define C(v) {(v), (v), (v), (v)}
+static const uint32_t int_consts[NUM_INT_CONSTS][4] = {
+   {0, 0, 0, 1},
+   C(0x8000),
+   C(0x7fff),
+   C(0x7f800000),
+   {0x3ff, 0x3ff << 10, 0x3ff << 20, 0x3u << 30},
+   {0, 0, 0, 0x80000000}
 };
 
 #undef C
@@ -101,6 +148,7 @@ struct translate_sse
    struct x86_function *func;
 
      PIPE_ALIGN_VAR(16) float consts[NUM_CONSTS][4];
+     PIPE_ALIGN_VAR(16) uint32_t int_consts[NUM_INT_CONSTS][4];
    int8_t reg_to_const[16];
    int8_t const_to_reg[NUM_CONSTS];
 
@@ -173,6 +221,36 @@ get_const(struct translate_sse *p, unsigned id)
 }
 
 
+/* The constants below are used straight from memory, without caching them
+ * in registers.
+ */
+static struct x86_reg
+get_const_mem(struct translate_sse *p, unsigned id)
+{
+   return x86_make_disp(p->machine_EDI, get_offset(p, &p->consts[id][0]));
+}
+
+
+static struct x86_reg
+get_int_const(struct translate_sse *p, unsigned id)
+{
+   return x86_make_disp(p->machine_EDI, get_offset(p, &p->int_consts[id][0]));
+}
+
+
+/* take an XMM register from the constant cache, for temporary values */
+static struct x86_reg
+get_temp_xmm(struct translate_sse *p, unsigned idx)
+{
+   if (p->reg_to_const[idx] >= 0) {
+      p->const_to_reg[p->reg_to_const[idx]] = -1;
+      p->reg_to_const[idx] = -1;
+   }
+
+   return x86_make_reg(file_XMM, idx);
+}
+
+
 /* load the data in a SSE2 register, padding with zeros */
 static boolean
 emit_load_sse2(struct translate_sse *p,
@@ -329,6 +407,110 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* convert the zero extended 16-bit floats in data's lanes to 32-bit floats,
+ * exactly like util_half_to_float() does
+ */
+static void
+emit_half_to_float(struct translate_sse *p, struct x86_reg data)
+{
+   struct x86_reg sign = x86_make_reg(file_XMM, 1);
+   struct x86_reg infnan = get_temp_xmm(p, 2);
+
+   sse_movaps(p->func, sign, data);
+   sse_andps(p->func, sign, get_int_const(p, INT_CONST_HALF_SIGN));
+   sse2_pslld_imm(p->func, sign, 16);
+
+   /* exponent / mantissa, and adjust */
+   sse_andps(p->func, data, get_int_const(p, INT_CONST_HALF_EXP_MANTISSA));
+   sse2_pslld_imm(p->func, data, 13);
+   sse_mulps(p->func, data, get_const_mem(p, CONST_HALF_MAGIC));
+
+   /* inf / nan */
+   sse_movaps(p->func, infnan, data);
+   sse_cmpps(p->func, infnan, get_const_mem(p, CONST_65536), cc_NotLessThan);
+   sse_andps(p->func, infnan, get_int_const(p, INT_CONST_FLOAT_EXP));
+   sse_orps(p->func, data, infnan);
+
+   sse_orps(p->func, data, sign);
+}
+
+
+/* whether two channels have the same type, regardless of their position */
+static boolean
+same_channel_type(const struct util_format_channel_description *a,
+                  const struct util_format_channel_description *b)
+{
+   return a->type == b->type &&
+          a->normalized == b->normalized &&
+          a->pure_integer == b->pure_integer &&
+          a->size == b->size;
+}
+
+
+static boolean
+is_10_10_10_2(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->block.bits != 32 || desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; ++i) {
+      if (desc->channel[i].shift != i * 10 ||
+          desc->channel[i].size != (i < 3 ? 10 : 2) ||
+          desc->channel[i].type != desc->channel[0].type ||
+          desc->channel[i].normalized != desc->channel[0].normalized ||
+          desc->channel[i].pure_integer != desc->channel[0].pure_integer)
+         return FALSE;
+   }
+
+   return desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED ||
+          desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED;
+}
+
+
+/* load a 10_10_10_2 packed attribute, converted to floats like the
+ * u_format unpack functions do
+ */
+static void
+emit_load_10_10_10_2(struct translate_sse *p, struct x86_reg data,
+                     struct x86_reg src,
+                     const struct util_format_description *desc)
+{
+   /* each channel in its own lane, still shifted */
+   sse2_movd(p->func, data, src);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+   sse_andps(p->func, data, get_int_const(p, INT_CONST_10_10_10_2_MASK));
+
+   if (desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED) {
+      /* the 2-bit channel reaches the sign bit: convert it minus 2^31 */
+      sse_xorps(p->func, data, get_int_const(p, INT_CONST_10_10_10_2_SIGN));
+      sse2_cvtdq2ps(p->func, data, data);
+      sse_addps(p->func, data, get_const_mem(p, CONST_10_10_10_2_BIAS));
+   }
+   else {
+      struct x86_reg tmp = get_temp_xmm(p, 2);
+
+      /* the 2-bit channel is sign extended by the conversion, the others
+       * need their range subtracted when negative
+       */
+      sse2_cvtdq2ps(p->func, data, data);
+      sse_movaps(p->func, tmp, data);
+      sse_cmpps(p->func, tmp, get_const_mem(p, CONST_10_10_10_2_THRESHOLD),
+                cc_NotLessThan);
+      sse_andps(p->func, tmp, get_const_mem(p, CONST_10_10_10_2_RANGE));
+      sse_subps(p->func, data, tmp);
+   }
+
+   if (!desc->channel[0].normalized)
+      sse_mulps(p->func, data, get_const_mem(p, CONST_10_10_10_2_SCALED));
+   else if (desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED)
+      sse_mulps(p->func, data, get_const_mem(p, CONST_10_10_10_2_UNORM));
+   else
+      sse_mulps(p->func, data, get_const_mem(p, CONST_10_10_10_2_SNORM));
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -471,28 +653,34 @@ translate_attr_convert(struct translate_sse *p,
         UTIL_FORMAT_SWIZZLE_NONE, UTIL_FORMAT_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed, int_output;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
-      return FALSE;
-
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
-      if (memcmp
-          (&input_desc->channel[i], &input_desc->channel[0],
-           sizeof(input_desc->channel[0])))
+   packed = is_10_10_10_2(input_desc);
+   if (packed) {
+      if (input_desc->channel[0].pure_integer)
+         return FALSE;
+   }
+   else {
+      if (input_desc->channel[0].size & 7)
          return FALSE;
+
+      for (i = 1; i < input_desc->nr_channels; ++i) {
+         if (!same_channel_type(&input_desc->channel[i],
+                                &input_desc->channel[0]))
+            return FALSE;
+      }
    }
 
    for (i = 1; i < output_desc->nr_channels; ++i) {
-      if (memcmp
-          (&output_desc->channel[i], &output_desc->channel[0],
-           sizeof(output_desc->channel[0]))) {
+      if (!same_channel_type(&output_desc->channel[i],
+                             &output_desc->channel[0])) {
          return FALSE;
       }
    }
@@ -502,13 +690,24 @@ translate_attr_convert(struct translate_sse *p,
          swizzle[output_desc->swizzle[i]] = input_desc->swizzle[i];
    }
 
+   /* pure integers widened to 32 bits, like draw fetches them */
+   int_output = !packed
+      && input_desc->channel[0].pure_integer
+      && output_desc->channel[0].pure_integer
+      && output_desc->channel[0].size == 32
+      && output_desc->channel[0].type == input_desc->channel[0].type;
+
    if ((x86_target_caps(p->func) & X86_SSE) &&
        (0 || a->output_format == PIPE_FORMAT_R32_FLOAT
         || a->output_format == PIPE_FORMAT_R32G32_FLOAT
         || a->output_format == PIPE_FORMAT_R32G32B32_FLOAT
-        || a->output_format == PIPE_FORMAT_R32G32B32A32_FLOAT)) {
+        || a->output_format == PIPE_FORMAT_R32G32B32A32_FLOAT
+        || int_output)) {
       struct x86_reg dataXMM = x86_make_reg(file_XMM, 0);
 
+      if (int_output)
+         imms[1] = 1;
+
       for (i = 0; i < output_desc->nr_channels; ++i) {
          if (swizzle[i] == UTIL_FORMAT_SWIZZLE_0
              && i >= input_desc->nr_channels)
@@ -523,7 +722,12 @@ translate_attr_convert(struct translate_sse *p,
       }
 
       if (needed_chans > 0) {
-         switch (input_desc->channel[0].type) {
+         if (packed) {
+            if (!(x86_target_caps(p->func) & X86_SSE2))
+               return FALSE;
+            emit_load_10_10_10_2(p, dataXMM, src, input_desc);
+         }
+         else switch (input_desc->channel[0].type) {
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
                return FALSE;
@@ -531,25 +735,52 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovzx */
             switch (input_desc->channel[0].size) {
             case 8:
-               /* TODO: this may be inefficient due to get_identity() being
-                *  used both as a float and integer register.
-                */
-               sse2_punpcklbw(p->func, dataXMM, get_const(p, CONST_IDENTITY));
-               sse2_punpcklbw(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovzxbd(p->func, dataXMM, dataXMM);
+               }
+               else {
+                  /* TODO: this may be inefficient due to get_identity() being
+                   *  used both as a float and integer register.
+                   */
+                  sse2_punpcklbw(p->func, dataXMM,
+                                 get_const(p, CONST_IDENTITY));
+                  sse2_punpcklbw(p->func, dataXMM,
+                                 get_const(p, CONST_IDENTITY));
+               }
                break;
             case 16:
-               sse2_punpcklwd(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+               if (x86_target_caps(p->func) & X86_SSE4_1)
+                  sse41_pmovzxwd(p->func, dataXMM, dataXMM);
+               else
+                  sse2_punpcklwd(p->func, dataXMM,
+                                 get_const(p, CONST_IDENTITY));
                break;
-            case 32:           /* we lose precision here */
-               sse2_psrld_imm(p->func, dataXMM, 1);
+            case 32:
                break;
             default:
                return FALSE;
             }
-            sse2_cvtdq2ps(p->func, dataXMM, dataXMM);
+            if (int_output)
+               break;
+            if (input_desc->channel[0].size == 32) {
+               /* convert the 16-bit halves separately, so that the only
+                * rounding is in adding them back
+                */
+               struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+
+               sse_movaps(p->func, tmpXMM, dataXMM);
+               sse2_psrld_imm(p->func, tmpXMM, 16);
+               sse2_pslld_imm(p->func, dataXMM, 16);
+               sse2_psrld_imm(p->func, dataXMM, 16);
+               sse2_cvtdq2ps(p->func, tmpXMM, tmpXMM);
+               sse2_cvtdq2ps(p->func, dataXMM, dataXMM);
+               sse_mulps(p->func, tmpXMM, get_const_mem(p, CONST_65536));
+               sse_addps(p->func, dataXMM, tmpXMM);
+            }
+            else
+               sse2_cvtdq2ps(p->func, dataXMM, dataXMM);
             if (input_desc->channel[0].normalized) {
                struct x86_reg factor;
                switch (input_desc->channel[0].size) {
@@ -560,7 +791,7 @@ translate_attr_convert(struct translate_sse *p,
                   factor = get_const(p, CONST_INV_65535);
                   break;
                case 32:
-                  factor = get_const(p, CONST_INV_2147483647);
+                  factor = get_const(p, CONST_INV_4294967295);
                   break;
                default:
                   assert(0);
@@ -572,9 +803,6 @@ translate_attr_convert(struct translate_sse *p,
                }
                sse_mulps(p->func, dataXMM, factor);
             }
-            else if (input_desc->channel[0].size == 32)
-               /* compensate for the bit we threw away to fit u32 into s32 */
-               sse_addps(p->func, dataXMM, dataXMM);
             break;
          case UTIL_FORMAT_TYPE_SIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
@@ -583,22 +811,33 @@ translate_attr_convert(struct translate_sse *p,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
 
-            /* TODO: add support for SSE4.1 pmovsx */
             switch (input_desc->channel[0].size) {
             case 8:
-               sse2_punpcklbw(p->func, dataXMM, dataXMM);
-               sse2_punpcklbw(p->func, dataXMM, dataXMM);
-               sse2_psrad_imm(p->func, dataXMM, 24);
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovsxbd(p->func, dataXMM, dataXMM);
+               }
+               else {
+                  sse2_punpcklbw(p->func, dataXMM, dataXMM);
+                  sse2_punpcklbw(p->func, dataXMM, dataXMM);
+                  sse2_psrad_imm(p->func, dataXMM, 24);
+               }
                break;
             case 16:
-               sse2_punpcklwd(p->func, dataXMM, dataXMM);
-               sse2_psrad_imm(p->func, dataXMM, 16);
+               if (x86_target_caps(p->func) & X86_SSE4_1) {
+                  sse41_pmovsxwd(p->func, dataXMM, dataXMM);
+               }
+               else {
+                  sse2_punpcklwd(p->func, dataXMM, dataXMM);
+                  sse2_psrad_imm(p->func, dataXMM, 16);
+               }
                break;
             case 32:           /* we lose precision here */
                break;
             default:
                return FALSE;
             }
+            if (int_output)
+               break;
             sse2_cvtdq2ps(p->func, dataXMM, dataXMM);
             if (input_desc->channel[0].normalized) {
                struct x86_reg factor;
@@ -623,10 +862,9 @@ translate_attr_convert(struct translate_sse *p,
                sse_mulps(p->func, dataXMM, factor);
             }
             break;
-
-            break;
          case UTIL_FORMAT_TYPE_FLOAT:
-            if (input_desc->channel[0].size != 32
+            if (input_desc->channel[0].size != 16
+                && input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
             }
@@ -636,6 +874,15 @@ translate_attr_convert(struct translate_sse *p,
                needed_chans = CHANNELS_0001;
             }
             switch (input_desc->channel[0].size) {
+            case 16:
+               if (!(x86_target_caps(p->func) & X86_SSE2))
+                  return FALSE;
+               emit_load_sse2(p, dataXMM, src, 2 * input_desc->nr_channels);
+               sse2_punpcklwd(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+               emit_half_to_float(p, dataXMM);
+               if (needed_chans == CHANNELS_0001)
+                  sse_orps(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+               break;
             case 32:
                emit_load_float32(p, dataXMM, src, needed_chans,
                                  input_desc->nr_channels);
@@ -654,6 +901,20 @@ translate_attr_convert(struct translate_sse *p,
             return FALSE;
          }
 
+         /* the integer loads leave zero in missing channels: make a
+          * missing W one before swizzling, rather than storing it apart
+          */
+         if (!packed
+             && input_desc->channel[0].type != UTIL_FORMAT_TYPE_FLOAT
+             && input_desc->nr_channels <= 3
+             && swizzle[3] == UTIL_FORMAT_SWIZZLE_1) {
+            if (int_output)
+               sse_orps(p->func, dataXMM, get_int_const(p, INT_CONST_ONE_W));
+            else
+               sse_orps(p->func, dataXMM, get_const(p, CONST_IDENTITY));
+            swizzle[3] = UTIL_FORMAT_SWIZZLE_W;
+         }
+
          if (!id_swizzle) {
             sse_shufps(p->func, dataXMM, dataXMM,
                        SHUF(swizzle[0], swizzle[1], swizzle[2], swizzle[3]));
@@ -883,8 +1144,8 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
-   else if (!memcmp(&output_desc->channel[0], &input_desc->channel[0],
-                    sizeof(output_desc->channel[0]))) {
+   else if (same_channel_type(&output_desc->channel[0],
+                              &input_desc->channel[0])) {
       struct x86_reg tmp = p->tmp_EAX;
       unsigned i;
 
@@ -1491,6 +1752,7 @@ translate_sse2_create(const struct translate_key *key)
 
    memset(p, 0, sizeof(*p));
    memcpy(p->consts, consts, sizeof(consts));
+   memcpy(p->int_consts, int_consts, sizeof(int_consts));
 
    p->translate.key = *key;
    p->translate.release = translate_sse_release;
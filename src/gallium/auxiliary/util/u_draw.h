@@ -142,6 +142,26 @@ util_draw_range_elements(struct pipe_context *pipe,
 }
 
 
+/**
+ * Do several draws sharing their state, see pipe_context::multi_draw.
+ */
+static inline void
+util_draw_multi(struct pipe_context *pipe,
+                const struct pipe_draw_info *info,
+                unsigned num_draws)
+{
+   unsigned i;
+
+   if (pipe->multi_draw) {
+      pipe->multi_draw(pipe, info, num_draws);
+      return;
+   }
+
+   for (i = 0; i < num_draws; i++)
+      pipe->draw_vbo(pipe, &info[i]);
+}
+
+
 /* This converts an indirect draw into a direct draw by mapping the indirect
  * buffer, extracting its arguments, and calling pipe->draw_vbo.
  */
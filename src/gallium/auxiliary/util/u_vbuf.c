@@ -44,7 +44,8 @@
  *
  * All needed uploads and translations are performed every draw command, but
  * only the subset of vertices needed for that draw command is uploaded or
- * translated. (the module never translates whole buffers)
+ * translated. The exception are translations of static vertex buffers,
+ * see below.
  *
  *
  * The module consists of two main parts:
@@ -81,6 +82,15 @@
  * rate down.
  *
  *
+ * 3) Static translations (u_vbuf_translate_static)
+ *
+ * If the state tracker reports every write to a buffer through
+ * u_vbuf_invalidate_buffer and enables it, buffers with a static usage
+ * which are translated a second time in the same way are translated as
+ * a whole into a buffer that is kept until the sources are written to or
+ * the entry is evicted. Draws reading them then need no translation.
+ *
+ *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
  */
@@ -95,7 +105,7 @@
 #include "translate/translate.h"
 #include "translate/translate_cache.h"
 #include "cso_cache/cso_cache.h"
-#include "cso_cache/cso_hash.h"
+#include "util/index_minmax.h"
 
 struct u_vbuf_elements {
    unsigned count;
@@ -133,6 +143,31 @@ struct u_vbuf_elements {
    void *driver_cso;
 };
 
+/* A whole-buffer translation of static vertex buffers with one translate
+ * key.  Unused if vb_mask is 0. */
+struct u_vbuf_static_translation {
+   struct translate_key key;
+   uint32_t vb_mask;
+
+   /* The source vertex buffers, referenced. */
+   struct pipe_resource *src_buffer[PIPE_MAX_ATTRIBS];
+   unsigned src_offset[PIPE_MAX_ATTRIBS];
+   unsigned src_stride[PIPE_MAX_ATTRIBS];
+
+   /* Vertices [0, num_vertices) translated.  NULL until the sources have
+    * been seen twice. */
+   struct pipe_resource *buffer;
+   unsigned num_vertices;
+
+   /* Set if the sources are too big to translate as a whole. */
+   boolean uncacheable;
+
+   unsigned last_used;
+};
+
+#define U_VBUF_NUM_STATIC_TRANSLATIONS 16
+#define U_VBUF_MAX_STATIC_TRANSLATION_SIZE (16 * 1024 * 1024)
+
 enum {
    VB_VERTEX = 0,
    VB_INSTANCE = 1,
@@ -184,6 +219,13 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Whether translations of static buffers are kept, see
+    * u_vbuf_enable_static_translations. */
+   boolean static_translations_enabled;
+   struct u_vbuf_static_translation
+      static_translations[U_VBUF_NUM_STATIC_TRANSLATIONS];
+   unsigned static_translation_stamp;
 };
 
 static void *
@@ -328,7 +370,7 @@ u_vbuf_set_vertex_elements_internal(struct u_vbuf *mgr, unsigned count,
 {
    struct pipe_context *pipe = mgr->pipe;
    unsigned key_size, hash_key;
-   struct cso_hash_iter iter;
+   struct cso_velements *cso;
    struct u_vbuf_elements *ve;
    struct cso_velems_state velems_state;
 
@@ -338,21 +380,19 @@ u_vbuf_set_vertex_elements_internal(struct u_vbuf *mgr, unsigned count,
    memcpy(velems_state.velems, states,
           sizeof(struct pipe_vertex_element) * count);
    hash_key = cso_construct_key((void*)&velems_state, key_size);
-   iter = cso_find_state_template(mgr->cso_cache, hash_key, CSO_VELEMENTS,
-                                  (void*)&velems_state, key_size);
+   cso = cso_find_state_template(mgr->cso_cache, hash_key, CSO_VELEMENTS,
+                                 &velems_state, key_size);
 
-   if (cso_hash_iter_is_null(iter)) {
-      struct cso_velements *cso = MALLOC_STRUCT(cso_velements);
+   if (!cso) {
+      cso = MALLOC_STRUCT(cso_velements);
       memcpy(&cso->state, &velems_state, key_size);
       cso->data = u_vbuf_create_vertex_elements(mgr, count, states);
       cso->delete_state = (cso_state_callback)u_vbuf_delete_vertex_elements;
       cso->context = (void*)mgr;
 
-      iter = cso_insert_state(mgr->cso_cache, hash_key, CSO_VELEMENTS, cso);
-      ve = cso->data;
-   } else {
-      ve = ((struct cso_velements *)cso_hash_iter_data(iter))->data;
+      cso_insert_state(mgr->cso_cache, hash_key, CSO_VELEMENTS, cso);
    }
+   ve = cso->data;
 
    assert(ve);
 
@@ -368,6 +408,62 @@ void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
    mgr->ve = u_vbuf_set_vertex_elements_internal(mgr, count, states);
 }
 
+static void
+u_vbuf_release_static_translation(struct u_vbuf_static_translation *entry)
+{
+   uint32_t mask = entry->vb_mask;
+
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      pipe_resource_reference(&entry->src_buffer[i], NULL);
+   }
+   pipe_resource_reference(&entry->buffer, NULL);
+   entry->vb_mask = 0;
+   entry->num_vertices = 0;
+   entry->uncacheable = FALSE;
+}
+
+/**
+ * Keep whole-buffer translations of static vertex buffers.  Only for
+ * state trackers which call u_vbuf_invalidate_buffer for every write to
+ * a buffer other than through a persistent mapping.
+ */
+void u_vbuf_enable_static_translations(struct u_vbuf *mgr, boolean enable)
+{
+   unsigned i;
+
+   mgr->static_translations_enabled = enable;
+
+   if (!enable) {
+      for (i = 0; i < U_VBUF_NUM_STATIC_TRANSLATIONS; i++)
+         u_vbuf_release_static_translation(&mgr->static_translations[i]);
+   }
+}
+
+/**
+ * Drop the translations made from a buffer whose contents change.
+ */
+void u_vbuf_invalidate_buffer(struct u_vbuf *mgr,
+                              struct pipe_resource *buffer)
+{
+   unsigned i;
+
+   if (!buffer || !mgr->static_translations_enabled)
+      return;
+
+   for (i = 0; i < U_VBUF_NUM_STATIC_TRANSLATIONS; i++) {
+      struct u_vbuf_static_translation *entry = &mgr->static_translations[i];
+      uint32_t mask = entry->vb_mask;
+
+      while (mask) {
+         if (entry->src_buffer[u_bit_scan(&mask)] == buffer) {
+            u_vbuf_release_static_translation(entry);
+            break;
+         }
+      }
+   }
+}
+
 void u_vbuf_destroy(struct u_vbuf *mgr)
 {
    struct pipe_screen *screen = mgr->pipe->screen;
@@ -388,12 +484,217 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   for (i = 0; i < U_VBUF_NUM_STATIC_TRANSLATIONS; i++)
+      u_vbuf_release_static_translation(&mgr->static_translations[i]);
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
 }
 
+static boolean
+u_vbuf_is_static_buffer(const struct pipe_vertex_buffer *vb)
+{
+   return vb->buffer && !vb->user_buffer &&
+          (vb->buffer->usage == PIPE_USAGE_DEFAULT ||
+           vb->buffer->usage == PIPE_USAGE_IMMUTABLE) &&
+          !(vb->buffer->flags & PIPE_RESOURCE_FLAG_MAP_PERSISTENT);
+}
+
+static boolean
+u_vbuf_static_translation_matches(struct u_vbuf *mgr,
+                                  const struct u_vbuf_static_translation *entry,
+                                  const struct translate_key *key,
+                                  uint32_t vb_mask)
+{
+   uint32_t mask = vb_mask;
+
+   if (entry->vb_mask != vb_mask ||
+       translate_key_compare(&entry->key, key) != 0)
+      return FALSE;
+
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+
+      if (entry->src_buffer[i] != vb->buffer ||
+          entry->src_offset[i] != vb->buffer_offset ||
+          entry->src_stride[i] != vb->stride)
+         return FALSE;
+   }
+   return TRUE;
+}
+
+/* The number of vertices, counting from vertex 0, that all elements of the
+ * key can read from the bound buffers. */
+static unsigned
+u_vbuf_static_num_vertices(struct u_vbuf *mgr, const struct translate_key *key)
+{
+   unsigned num_vertices = ~0u;
+   unsigned i;
+
+   for (i = 0; i < key->nr_elements; i++) {
+      const struct translate_element *te = &key->element[i];
+      const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[te->input_buffer];
+      unsigned end = vb->buffer_offset + te->input_offset +
+                     util_format_get_blocksize(te->input_format);
+
+      if (end > vb->buffer->width0)
+         return 0;
+
+      if (vb->stride) {
+         num_vertices = MIN2(num_vertices,
+                             (vb->buffer->width0 - end) / vb->stride + 1);
+      }
+   }
+
+   /* Only constant attribs. */
+   return num_vertices == ~0u ? 1 : num_vertices;
+}
+
+static boolean
+u_vbuf_build_static_translation(struct u_vbuf *mgr,
+                                struct u_vbuf_static_translation *entry)
+{
+   struct pipe_context *pipe = mgr->pipe;
+   struct pipe_transfer *vb_transfer[PIPE_MAX_ATTRIBS] = {0};
+   struct pipe_transfer *out_transfer;
+   struct translate *tr;
+   unsigned num_vertices, mask;
+   uint8_t *out_map;
+
+   num_vertices = u_vbuf_static_num_vertices(mgr, &entry->key);
+   if (!num_vertices ||
+       num_vertices > U_VBUF_MAX_STATIC_TRANSLATION_SIZE /
+                      entry->key.output_stride) {
+      entry->uncacheable = TRUE;
+      return FALSE;
+   }
+
+   entry->buffer = pipe_buffer_create(pipe->screen, PIPE_BIND_VERTEX_BUFFER,
+                                      PIPE_USAGE_DEFAULT,
+                                      num_vertices * entry->key.output_stride);
+   if (!entry->buffer)
+      return FALSE;
+
+   out_map = pipe_buffer_map(pipe, entry->buffer,
+                             PIPE_TRANSFER_WRITE |
+                             PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                             &out_transfer);
+   if (!out_map) {
+      pipe_resource_reference(&entry->buffer, NULL);
+      return FALSE;
+   }
+
+   tr = translate_cache_find(mgr->translate_cache, &entry->key);
+
+   mask = entry->vb_mask;
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+      struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[i];
+      uint8_t *map;
+
+      map = pipe_buffer_map_range(pipe, vb->buffer, vb->buffer_offset,
+                                  vb->buffer->width0 - vb->buffer_offset,
+                                  PIPE_TRANSFER_READ, &vb_transfer[i]);
+      if (!map) {
+         num_vertices = 0;
+         break;
+      }
+      tr->set_buffer(tr, i, map, vb->stride, num_vertices - 1);
+   }
+
+   if (num_vertices)
+      tr->run(tr, 0, num_vertices, 0, 0, out_map);
+
+   mask = entry->vb_mask;
+   while (mask) {
+      unsigned i = u_bit_scan(&mask);
+
+      if (vb_transfer[i])
+         pipe_buffer_unmap(pipe, vb_transfer[i]);
+   }
+   pipe_buffer_unmap(pipe, out_transfer);
+
+   if (!num_vertices) {
+      pipe_resource_reference(&entry->buffer, NULL);
+      return FALSE;
+   }
+
+   entry->num_vertices = num_vertices;
+   return TRUE;
+}
+
+/* Bind a whole-buffer translation of the vertex buffers in vb_mask if
+ * there is one covering [start_vertex, start_vertex + num_vertices), making
+ * it the first time these buffers are seen a second time. */
+static boolean
+u_vbuf_translate_static(struct u_vbuf *mgr, struct translate_key *key,
+                        unsigned vb_mask, unsigned out_vb,
+                        int start_vertex, unsigned num_vertices)
+{
+   struct u_vbuf_static_translation *entry = NULL, *victim = NULL;
+   unsigned mask, i;
+
+   if (start_vertex < 0)
+      return FALSE;
+
+   mask = vb_mask;
+   while (mask) {
+      if (!u_vbuf_is_static_buffer(&mgr->vertex_buffer[u_bit_scan(&mask)]))
+         return FALSE;
+   }
+
+   for (i = 0; i < U_VBUF_NUM_STATIC_TRANSLATIONS; i++) {
+      struct u_vbuf_static_translation *it = &mgr->static_translations[i];
+
+      if (it->vb_mask &&
+          u_vbuf_static_translation_matches(mgr, it, key, vb_mask)) {
+         entry = it;
+         break;
+      }
+
+      /* Prefer a free entry, then the least recently used one. */
+      if (!victim ||
+          (victim->vb_mask &&
+           (!it->vb_mask || it->last_used < victim->last_used)))
+         victim = it;
+   }
+
+   if (!entry) {
+      /* Remember the sources, but don't translate them as a whole until
+       * they're used again: they may be written before the next draw. */
+      u_vbuf_release_static_translation(victim);
+      victim->key = *key;
+      victim->vb_mask = vb_mask;
+      mask = vb_mask;
+      while (mask) {
+         unsigned vb_index = u_bit_scan(&mask);
+         const struct pipe_vertex_buffer *vb = &mgr->vertex_buffer[vb_index];
+
+         pipe_resource_reference(&victim->src_buffer[vb_index], vb->buffer);
+         victim->src_offset[vb_index] = vb->buffer_offset;
+         victim->src_stride[vb_index] = vb->stride;
+      }
+      victim->last_used = ++mgr->static_translation_stamp;
+      return FALSE;
+   }
+
+   entry->last_used = ++mgr->static_translation_stamp;
+
+   if (entry->uncacheable ||
+       (!entry->buffer && !u_vbuf_build_static_translation(mgr, entry)) ||
+       start_vertex + num_vertices > entry->num_vertices)
+      return FALSE;
+
+   mgr->real_vertex_buffer[out_vb].buffer_offset = 0;
+   mgr->real_vertex_buffer[out_vb].stride = key->output_stride;
+   pipe_resource_reference(&mgr->real_vertex_buffer[out_vb].buffer,
+                           entry->buffer);
+   return TRUE;
+}
+
 static enum pipe_error
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          unsigned vb_mask, unsigned out_vb,
@@ -407,6 +708,11 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    uint8_t *out_map;
    unsigned out_offset, mask;
 
+   if (!unroll_indices && mgr->static_translations_enabled &&
+       u_vbuf_translate_static(mgr, key, vb_mask, out_vb,
+                               start_vertex, num_vertices))
+      return PIPE_OK;
+
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
 
@@ -1030,7 +1336,6 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
 {
    struct pipe_transfer *transfer = NULL;
    const void *indices;
-   unsigned i;
 
    if (ib->user_buffer) {
       indices = (uint8_t*)ib->user_buffer +
@@ -1043,70 +1348,16 @@ static void u_vbuf_get_minmax_index(struct pipe_context *pipe,
    }
 
    switch (ib->index_size) {
-   case 4: {
-      const unsigned *ui_indices = (const unsigned*)indices;
-      unsigned max_ui = 0;
-      unsigned min_ui = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restart_index) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-            if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-         }
-      }
-      *out_min_index = min_ui;
-      *out_max_index = max_ui;
-      break;
-   }
-   case 2: {
-      const unsigned short *us_indices = (const unsigned short*)indices;
-      unsigned max_us = 0;
-      unsigned min_us = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restart_index) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *out_min_index = min_us;
-      *out_max_index = max_us;
-      break;
-   }
+   case 4:
+   case 2:
    case 1: {
-      const unsigned char *ub_indices = (const unsigned char*)indices;
-      unsigned max_ub = 0;
-      unsigned min_ub = ~0U;
-      if (primitive_restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restart_index) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *out_min_index = min_ub;
-      *out_max_index = max_ub;
+      unsigned min_index, max_index;
+
+      util_index_minmax(ib->index_size, indices, count,
+                        primitive_restart, restart_index,
+                        &min_index, &max_index);
+      *out_min_index = min_index;
+      *out_max_index = max_index;
       break;
    }
    default:
@@ -63,6 +63,10 @@ u_vbuf_create(struct pipe_context *pipe,
 
 void u_vbuf_destroy(struct u_vbuf *mgr);
 
+void u_vbuf_enable_static_translations(struct u_vbuf *mgr, boolean enable);
+void u_vbuf_invalidate_buffer(struct u_vbuf *mgr,
+                              struct pipe_resource *buffer);
+
 /* State and draw functions. */
 void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
                                 const struct pipe_vertex_element *states);
@@ -49,9 +49,13 @@
  * All the other drawing functions are implemented in terms of this function.
  * Basically, map the vertex buffers (and drawing surfaces), then hand off
  * the drawing to the 'draw' module.
+ * The buffers are mapped and the draw module flushed only once for all the
+ * draws, so that their primitives are binned together.
  */
 static void
-llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
+llvmpipe_multi_draw(struct pipe_context *pipe,
+                    const struct pipe_draw_info *info,
+                    unsigned num_draws)
 {
    struct llvmpipe_context *lp = llvmpipe_context(pipe);
    struct draw_context *draw = lp->draw;
@@ -61,11 +65,6 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    if (!llvmpipe_check_render_cond(lp))
       return;
 
-   if (info->indirect) {
-      util_draw_indirect(pipe, info);
-      return;
-   }
-
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
@@ -129,7 +128,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
                                     lp->active_statistics_queries > 0);
 
    /* draw! */
-   draw_vbo(draw, info);
+   for (i = 0; i < num_draws; i++)
+      draw_vbo(draw, &info[i]);
 
    /*
     * unmap vertex/index buffers
@@ -162,8 +162,21 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
 }
 
 
+static void
+llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
+{
+   if (info->indirect) {
+      util_draw_indirect(pipe, info);
+      return;
+   }
+
+   llvmpipe_multi_draw(pipe, info, 1);
+}
+
+
 void
 llvmpipe_init_draw_funcs(struct llvmpipe_context *llvmpipe)
 {
    llvmpipe->pipe.draw_vbo = llvmpipe_draw_vbo;
+   llvmpipe->pipe.multi_draw = llvmpipe_multi_draw;
 }
@@ -102,6 +102,10 @@ lp_print_counters(void)
       debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
       debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
 
+      debug_printf("llvmpipe: nr_resource_copy:             %9u\n", lp_count.nr_resource_copy);
+      debug_printf("llvmpipe:   nr_resource_copy_direct:    %9u\n", lp_count.nr_resource_copy_direct);
+      debug_printf("llvmpipe:   resource_copy_bytes:        %9llu\n", (unsigned long long) lp_count.resource_copy_bytes);
+
       debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
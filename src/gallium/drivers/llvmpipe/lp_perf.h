@@ -62,6 +62,10 @@ struct lp_counters
    unsigned nr_color_tile_clear;
    unsigned nr_color_tile_load;
    unsigned nr_color_tile_store;
+
+   unsigned nr_resource_copy;
+   unsigned nr_resource_copy_direct;
+   uint64_t resource_copy_bytes;
 };
 
 
@@ -33,6 +33,67 @@
 #include "lp_surface.h"
 #include "lp_texture.h"
 #include "lp_query.h"
+#include "lp_perf.h"
+#include "lp_screen.h"
+
+
+/**
+ * Copy between two textures living in llvmpipe's own memory by addressing
+ * their images directly.  Going through util_resource_copy_region() costs
+ * two transfer allocations and another pair of scene reference checks per
+ * call, which is most of the time spent on the small rectangles that
+ * glCopyImageSubData() and texture-to-texture glCopyTexSubImage() produce.
+ *
+ * \return FALSE if the resources need the generic transfer path.
+ */
+static boolean
+lp_resource_copy_direct(struct pipe_context *pipe,
+                        struct pipe_resource *dst, unsigned dst_level,
+                        unsigned dstx, unsigned dsty, unsigned dstz,
+                        struct pipe_resource *src, unsigned src_level,
+                        const struct pipe_box *src_box)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct llvmpipe_resource *dst_lpr = llvmpipe_resource(dst);
+   struct llvmpipe_resource *src_lpr = llvmpipe_resource(src);
+   const enum pipe_format format = dst->format;
+   ubyte *dst_map;
+   const ubyte *src_map;
+
+   if (!llvmpipe_resource_is_texture(dst) ||
+       !llvmpipe_resource_is_texture(src) ||
+       dst_lpr->dt || src_lpr->dt)
+      return FALSE;
+
+   assert(util_format_get_blocksize(format) ==
+          util_format_get_blocksize(src->format));
+
+   dst_map = llvmpipe_get_texture_image_address(dst_lpr, dstz, dst_level);
+   src_map = llvmpipe_get_texture_image_address(src_lpr, src_box->z,
+                                                src_level);
+   if (!dst_map || !src_map)
+      return FALSE;
+
+   util_copy_box(dst_map, format,
+                 dst_lpr->row_stride[dst_level],
+                 dst_lpr->img_stride[dst_level],
+                 dstx, dsty, 0,
+                 src_box->width, src_box->height, src_box->depth,
+                 src_map,
+                 src_lpr->row_stride[src_level],
+                 src_lpr->img_stride[src_level],
+                 src_box->x, src_box->y, 0);
+
+   /* let sharing contexts know the texture changed, like a write map does */
+   screen->timestamp++;
+
+   LP_COUNT(nr_resource_copy_direct);
+   LP_COUNT_ADD(resource_copy_bytes,
+                util_format_get_nblocks(format, src_box->width,
+                                        src_box->height) *
+                util_format_get_blocksize(format) * src_box->depth);
+   return TRUE;
+}
 
 
 static void
@@ -42,6 +103,8 @@ lp_resource_copy(struct pipe_context *pipe,
                  struct pipe_resource *src, unsigned src_level,
                  const struct pipe_box *src_box)
 {
+   LP_COUNT(nr_resource_copy);
+
    llvmpipe_flush_resource(pipe,
                            dst, dst_level,
                            FALSE, /* read_only */
@@ -56,6 +119,10 @@ lp_resource_copy(struct pipe_context *pipe,
                            FALSE, /* do_not_block */
                            "blit src");
 
+   if (lp_resource_copy_direct(pipe, dst, dst_level, dstx, dsty, dstz,
+                               src, src_level, src_box))
+      return;
+
    util_resource_copy_region(pipe, dst, dst_level, dstx, dsty, dstz,
                              src, src_level, src_box);
 }
@@ -316,7 +316,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->tex_data) {
+      if (lpr->tex_data && !lpr->userBuffer) {
          align_free(lpr->tex_data);
          lpr->tex_data = NULL;
       }
@@ -474,6 +474,61 @@ no_lpr:
 }
 
 
+/**
+ * Wrap user memory as a 2D render target.
+ *
+ * The memory must hold the image in exactly the layout
+ * llvmpipe_texture_layout() picks for the template, which the caller can
+ * check by mapping the resource and comparing the stride.  Since the
+ * rasterizer reads and writes whole LP_RASTER_BLOCK_SIZE blocks, only
+ * heights for which that layout needs no padding rows are accepted;
+ * otherwise NULL is returned and the caller should fall back to
+ * resource_create().
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   struct llvmpipe_resource *lpr;
+
+   if ((templat->target != PIPE_TEXTURE_2D &&
+        templat->target != PIPE_TEXTURE_RECT) ||
+       templat->last_level != 0 ||
+       templat->array_size != 1 ||
+       templat->nr_samples > 1 ||
+       util_format_is_compressed(templat->format) ||
+       templat->height0 % LP_RASTER_BLOCK_SIZE != 0 ||
+       ((uintptr_t) user_memory) % MAX2(64, util_cpu_caps.cacheline) != 0)
+      return NULL;
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = &screen->base;
+
+   if (!llvmpipe_texture_layout(screen, lpr, false)) {
+      FREE(lpr);
+      return NULL;
+   }
+
+   lpr->tex_data = user_memory;
+   lpr->userBuffer = TRUE;
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static boolean
 llvmpipe_resource_get_handle(struct pipe_screen *screen,
                             struct pipe_resource *pt,
@@ -799,6 +854,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
    screen->resource_create = llvmpipe_resource_create;
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
    screen->can_create_resource = llvmpipe_can_create_resource;
 }
@@ -46,6 +46,7 @@
 #include "sp_surface.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_rast_threads.h"
 #include "sp_texture.h"
 #include "sp_query.h"
 #include "sp_screen.h"
@@ -73,6 +74,9 @@ softpipe_destroy( struct pipe_context *pipe )
    if (softpipe->draw)
       draw_destroy( softpipe->draw );
 
+   if (softpipe->rast_threads)
+      sp_rast_threads_destroy(softpipe->rast_threads);
+
    if (softpipe->quad.shade)
       softpipe->quad.shade->destroy( softpipe->quad.shade );
 
@@ -185,12 +189,37 @@ softpipe_render_condition( struct pipe_context *pipe,
 
 
 
+/**
+ * Sum the lookup counters of all the context's texture caches, including
+ * the rasterizer threads' ones.
+ */
+void
+softpipe_get_tex_cache_stats(struct softpipe_context *softpipe,
+                             struct sp_tex_tile_cache_stats *stats)
+{
+   uint i, sh;
+
+   memset(stats, 0, sizeof *stats);
+
+   for (sh = 0; sh < Elements(softpipe->tex_cache); sh++) {
+      for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+         if (softpipe->tex_cache[sh][i])
+            sp_tex_tile_cache_add_stats(softpipe->tex_cache[sh][i], stats);
+      }
+   }
+
+   if (softpipe->rast_threads)
+      sp_rast_threads_add_tex_cache_stats(softpipe->rast_threads, stats);
+}
+
+
 struct pipe_context *
 softpipe_create_context(struct pipe_screen *screen,
 			void *priv, unsigned flags)
 {
    struct softpipe_screen *sp_screen = softpipe_screen(screen);
    struct softpipe_context *softpipe = CALLOC_STRUCT(softpipe_context);
+   unsigned num_threads;
    uint i, sh;
 
    util_init_math();
@@ -202,6 +231,10 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->dump_fs = debug_get_bool_option( "SOFTPIPE_DUMP_FS", FALSE );
    softpipe->dump_gs = debug_get_bool_option( "SOFTPIPE_DUMP_GS", FALSE );
 
+   softpipe->tex_cache_ways = debug_get_num_option("SOFTPIPE_TEX_CACHE_WAYS", 4);
+   softpipe->tex_cache_ways = CLAMP(softpipe->tex_cache_ways, 1,
+                                    TEX_TILE_MAX_WAYS);
+
    softpipe->pipe.screen = screen;
    softpipe->pipe.destroy = softpipe_destroy;
    softpipe->pipe.priv = priv;
@@ -220,6 +253,7 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->pipe.set_framebuffer_state = softpipe_set_framebuffer_state;
 
    softpipe->pipe.draw_vbo = softpipe_draw_vbo;
+   softpipe->pipe.multi_draw = softpipe_multi_draw;
 
    softpipe->pipe.clear = softpipe_clear;
    softpipe->pipe.flush = softpipe_flush_wrapped;
@@ -275,6 +309,16 @@ softpipe_create_context(struct pipe_screen *screen,
    if (debug_get_bool_option( "SOFTPIPE_NO_RAST", FALSE ))
       softpipe->no_rast = TRUE;
 
+   if (debug_get_bool_option( "SOFTPIPE_NO_SSE_SAMPLING", FALSE ))
+      softpipe->no_sse_sampling = TRUE;
+
+   num_threads = debug_get_num_option("SOFTPIPE_NUM_THREADS", 0);
+   num_threads = MIN2(num_threads, SP_MAX_THREADS - 1);
+   if (num_threads) {
+      /* Without worker threads, rasterize on the application thread. */
+      softpipe->rast_threads = sp_rast_threads_create(softpipe, num_threads);
+   }
+
    softpipe->vbuf_backend = sp_create_vbuf_backend(softpipe);
    if (!softpipe->vbuf_backend)
       goto fail;
@@ -51,10 +51,12 @@ struct draw_context;
 struct draw_stage;
 struct softpipe_tile_cache;
 struct softpipe_tex_tile_cache;
+struct sp_rast_threads;
 struct sp_fragment_shader;
 struct sp_vertex_shader;
 struct sp_velems_state;
 struct sp_so_state;
+struct sp_tex_tile_cache_stats;
 
 struct softpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -157,13 +159,7 @@ struct softpipe_context {
    } pstipple;
 
    /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   struct quad_pipeline quad;
 
    /** TGSI exec things */
    struct {
@@ -179,6 +175,9 @@ struct softpipe_context {
    struct vbuf_render *vbuf_backend;
    struct draw_stage *vbuf;
 
+   /** Rasterizer threads, if SOFTPIPE_NUM_THREADS asked for any */
+   struct sp_rast_threads *rast_threads;
+
    struct blitter_context *blitter;
 
    boolean dirty_render_cache;
@@ -196,10 +195,12 @@ struct softpipe_context {
     * of sp_sampler_view?
     */
    struct softpipe_tex_tile_cache *tex_cache[PIPE_SHADER_GEOMETRY+1][PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned tex_cache_ways;  /**< associativity of the texture caches */
 
    unsigned dump_fs : 1;
    unsigned dump_gs : 1;
    unsigned no_rast : 1;
+   unsigned no_sse_sampling : 1;
 };
 
 
@@ -219,6 +220,10 @@ softpipe_user_buffer_create(struct pipe_screen *screen,
                             unsigned bytes,
 			    unsigned bind_flags);
 
+void
+softpipe_get_tex_cache_stats(struct softpipe_context *softpipe,
+                             struct sp_tex_tile_cache_stats *stats);
+
 #define SP_UNREFERENCED         0
 #define SP_REFERENCED_FOR_READ  (1 << 0)
 #define SP_REFERENCED_FOR_WRITE (1 << 1)
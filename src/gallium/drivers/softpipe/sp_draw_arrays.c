@@ -56,10 +56,14 @@
  * For non-instanced drawing, instanceCount should be 1.
  * When the min/max element indexes aren't known, minIndex should be 0
  * and maxIndex should be ~0.
+ *
+ * Several draws with the same state are handed to the draw module between
+ * a single mapping of the buffers and a single flush.
  */
 void
-softpipe_draw_vbo(struct pipe_context *pipe,
-                  const struct pipe_draw_info *info)
+softpipe_multi_draw(struct pipe_context *pipe,
+                    const struct pipe_draw_info *info,
+                    unsigned num_draws)
 {
    struct softpipe_context *sp = softpipe_context(pipe);
    struct draw_context *draw = sp->draw;
@@ -69,11 +73,6 @@ softpipe_draw_vbo(struct pipe_context *pipe,
    if (!softpipe_check_render_cond(sp))
       return;
 
-   if (info->indirect) {
-      util_draw_indirect(pipe, info);
-      return;
-   }
-
    sp->reduced_api_prim = u_reduced_prim(info->mode);
 
    if (sp->dirty) {
@@ -144,7 +143,8 @@ softpipe_draw_vbo(struct pipe_context *pipe,
                                     sp->active_statistics_queries > 0);
 
    /* draw! */
-   draw_vbo(draw, info);
+   for (i = 0; i < num_draws; i++)
+      draw_vbo(draw, &info[i]);
 
    /* unmap vertex/index buffers - will cause draw module to flush */
    for (i = 0; i < sp->num_vertex_buffers; i++) {
@@ -171,3 +171,16 @@ softpipe_draw_vbo(struct pipe_context *pipe,
    /* Note: leave drawing surfaces mapped */
    sp->dirty_render_cache = TRUE;
 }
+
+
+void
+softpipe_draw_vbo(struct pipe_context *pipe,
+                  const struct pipe_draw_info *info)
+{
+   if (info->indirect) {
+      util_draw_indirect(pipe, info);
+      return;
+   }
+
+   softpipe_multi_draw(pipe, info, 1);
+}
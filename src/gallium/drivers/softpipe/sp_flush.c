@@ -38,6 +38,7 @@
 #include "sp_state.h"
 #include "sp_tile_cache.h"
 #include "sp_tex_tile_cache.h"
+#include "sp_rast_threads.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
 
@@ -60,6 +61,9 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      if (softpipe->rast_threads)
+         sp_rast_threads_flush_tex_caches(softpipe->rast_threads);
    }
 
    /* If this is a swapbuffers, just flush color buffers.
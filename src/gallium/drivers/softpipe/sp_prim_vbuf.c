@@ -49,6 +49,12 @@
 #define SP_MAX_VBUF_INDEXES 1024
 #define SP_MAX_VBUF_SIZE    4096
 
+/* Primitives are only handed over to the rasterizer threads at the end of
+ * each draw, so let draws be much bigger when there are any.
+ */
+#define SP_MAX_THREADED_VBUF_INDEXES (16 * 1024)
+#define SP_MAX_THREADED_VBUF_SIZE    (256 * 1024)
+
 typedef const float (*cptrf4)[4];
 
 /**
@@ -345,6 +351,8 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   sp_setup_flush(setup);
 }
 
 
@@ -585,6 +593,8 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   sp_setup_flush(setup);
 }
 
 /*
@@ -650,8 +660,14 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    assert(sp->draw);
 
-   cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
-   cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   if (sp->rast_threads) {
+      cvbr->base.max_indices = SP_MAX_THREADED_VBUF_INDEXES;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_THREADED_VBUF_SIZE;
+   }
+   else {
+      cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
+      cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   }
 
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
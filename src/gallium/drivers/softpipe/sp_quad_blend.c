@@ -40,6 +40,7 @@
 #include "sp_quad.h"
 #include "sp_tile_cache.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_threads.h"
 
 
 enum format
@@ -932,9 +933,10 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
-                                 quads[0]->input.x0, 
-                                 quads[0]->input.y0, quads[0]->input.layer);
+            = sp_quad_get_cached_tile(qs, softpipe->cbuf_cache[cbuf],
+                                      quads[0]->input.x0,
+                                      quads[0]->input.y0,
+                                      quads[0]->input.layer);
          const boolean clamp = bqs->clamp[cbuf];
          const float *blend_color;
          const boolean dual_source_blend = util_blend_state_is_dual(blend, cbuf);
@@ -1035,9 +1037,9 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_cached_tile(qs, qs->softpipe->cbuf_cache[0],
+                                quads[0]->input.x0,
+                                quads[0]->input.y0, quads[0]->input.layer);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1109,9 +1111,9 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_cached_tile(qs, qs->softpipe->cbuf_cache[0],
+                                quads[0]->input.x0,
+                                quads[0]->input.y0, quads[0]->input.layer);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
@@ -1177,9 +1179,9 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
-                           quads[0]->input.x0, 
-                           quads[0]->input.y0, quads[0]->input.layer);
+      = sp_quad_get_cached_tile(qs, qs->softpipe->cbuf_cache[0],
+                                quads[0]->input.x0,
+                                quads[0]->input.y0, quads[0]->input.layer);
 
    for (q = 0; q < nr; q++) {
       struct quad_header *quad = quads[q];
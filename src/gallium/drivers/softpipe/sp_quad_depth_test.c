@@ -38,6 +38,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_threads.h"
 #include "sp_tile_cache.h"
 #include "sp_state.h"           /* for sp_fragment_shader */
 
@@ -799,9 +800,10 @@ depth_test_quads_fallback(struct quad_stage *qs,
 
       data.ps = qs->softpipe->framebuffer.zsbuf;
       data.format = data.ps->format;
-      data.tile = sp_get_cached_tile(qs->softpipe->zsbuf_cache, 
-                                     quads[0]->input.x0, 
-                                     quads[0]->input.y0, quads[0]->input.layer);
+      data.tile = sp_quad_get_cached_tile(qs, qs->softpipe->zsbuf_cache,
+                                          quads[0]->input.x0,
+                                          quads[0]->input.y0,
+                                          quads[0]->input.layer);
       data.clamp = !qs->softpipe->rasterizer->depth_clip;
 
       near_val = qs->softpipe->viewport.translate[2] - qs->softpipe->viewport.scale[2];
@@ -841,8 +843,11 @@ depth_test_quads_fallback(struct quad_stage *qs,
    }
 
    if (qs->softpipe->active_query_count) {
+      uint64_t *occlusion_count = qs->thread ?
+         &qs->thread->occlusion_count : &qs->softpipe->occlusion_count;
+
       for (i = 0; i < nr; i++) 
-         qs->softpipe->occlusion_count += mask_count[quads[i]->inout.mask];
+         *occlusion_count += mask_count[quads[i]->inout.mask];
    }
 
    if (nr)
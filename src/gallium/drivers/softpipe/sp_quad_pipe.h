@@ -34,6 +34,7 @@
 
 struct softpipe_context;
 struct quad_header;
+struct sp_rast_thread;
 
 
 /**
@@ -43,6 +44,7 @@ struct quad_header;
  */
 struct quad_stage {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *thread;  /**< NULL in the context's own pipeline */
 
    struct quad_stage *next;
 
@@ -67,6 +69,20 @@ struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_colormask_stage( struct softpipe_context *softpipe );
 struct quad_stage *sp_quad_output_stage( struct softpipe_context *softpipe );
 
-void sp_build_quad_pipeline(struct softpipe_context *sp);
+
+/**
+ * The quad stages, and the order they're currently run in.
+ */
+struct quad_pipeline {
+   struct quad_stage *shade;
+   struct quad_stage *depth_test;
+   struct quad_stage *blend;
+   struct quad_stage *pstipple;
+   struct quad_stage *first; /**< points to one of the above stages */
+};
+
+
+void sp_build_quad_pipeline(struct softpipe_context *sp,
+                            struct quad_pipeline *quad);
 
 #endif /* SP_QUAD_PIPE_H */
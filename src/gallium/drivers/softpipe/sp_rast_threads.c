@@ -0,0 +1,714 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Tile-parallel rasterization.
+ *
+ * Instead of rasterizing primitives as they come, the setup code bins them
+ * by the TILE_SIZE x TILE_SIZE tiles of the color and depth tile caches
+ * they may touch.  At the end of each draw call the binned primitives are
+ * rasterized tile by tile, each tile's primitives in their original order
+ * and clipped to the tile, by the worker threads and the application
+ * thread.  Each of these runs its own setup and quad pipeline, with its
+ * own fragment shader machine and texture caches.
+ *
+ * A tile always goes to the thread owning its position in the (direct
+ * mapped) tile caches, so no two threads ever touch the same cache entry.
+ * Quads never straddle tiles, and the 16 pixel spans setup shades at once
+ * never straddle them either, so every pixel goes through exactly the same
+ * computations as when rasterizing serially.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "sp_context.h"
+#include "sp_quad.h"
+#include "sp_rast_threads.h"
+#include "sp_setup.h"
+#include "sp_state.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+
+
+/**
+ * A binned primitive.
+ */
+struct sp_rast_prim {
+   unsigned type;  /**< QUAD_PRIM_POINT, LINE, TRI */
+   const float (*v[3])[4];
+};
+
+
+/**
+ * The primitives touching one tile, as indices into the prims array.
+ */
+struct sp_rast_bin {
+   unsigned *prims;
+   unsigned count;
+   unsigned size;
+};
+
+
+struct sp_rast_threads {
+   struct softpipe_context *softpipe;
+
+   unsigned num_threads;   /**< including the application thread */
+   unsigned num_workers;   /**< worker threads started */
+   struct sp_rast_thread thread[SP_MAX_THREADS];
+
+   pipe_mutex mutex;
+   pipe_condvar work_ready;   /**< a batch was started, or exit */
+   pipe_condvar work_done;    /**< all workers are done with the batch */
+   unsigned batch;   /**< incremented for every batch given to the workers */
+   unsigned busy;    /**< number of workers still on the batch */
+   boolean exit;
+
+   struct sp_rast_prim *prims;
+   unsigned num_prims;
+   unsigned max_prims;
+
+   /* Bins for the framebuffer's tiles, row by row */
+   struct sp_rast_bin *bins;
+   unsigned tiles_x, tiles_y;
+   unsigned max_bins;
+
+   /* Bins with primitives in them */
+   unsigned *touched;
+   unsigned num_touched;
+};
+
+
+/**
+ * Rasterize the primitives of one tile.
+ */
+static void
+rasterize_tile(struct sp_rast_threads *threads,
+               struct sp_rast_thread *thread,
+               unsigned tile)
+{
+   const struct pipe_scissor_state *cliprect = &threads->softpipe->cliprect;
+   const struct sp_rast_bin *bin = &threads->bins[tile];
+   const unsigned x = (tile % threads->tiles_x) * TILE_SIZE;
+   const unsigned y = (tile / threads->tiles_x) * TILE_SIZE;
+   unsigned i;
+
+   thread->cliprect.minx = MAX2(cliprect->minx, x);
+   thread->cliprect.miny = MAX2(cliprect->miny, y);
+   thread->cliprect.maxx = MIN2(cliprect->maxx, x + TILE_SIZE);
+   thread->cliprect.maxy = MIN2(cliprect->maxy, y + TILE_SIZE);
+
+   for (i = 0; i < bin->count; i++) {
+      const struct sp_rast_prim *prim = &threads->prims[bin->prims[i]];
+
+      switch (prim->type) {
+      case QUAD_PRIM_POINT:
+         sp_setup_point(thread->setup, prim->v[0]);
+         break;
+      case QUAD_PRIM_LINE:
+         sp_setup_line(thread->setup, prim->v[0], prim->v[1]);
+         break;
+      case QUAD_PRIM_TRI:
+         sp_setup_tri(thread->setup, prim->v[0], prim->v[1], prim->v[2]);
+         break;
+      default:
+         assert(0);
+      }
+   }
+}
+
+
+/**
+ * Rasterize the tiles owned by a thread, or all of them.
+ */
+static void
+rasterize_tiles(struct sp_rast_threads *threads,
+                struct sp_rast_thread *thread,
+                boolean all)
+{
+   unsigned i;
+
+   for (i = 0; i < threads->num_touched; i++) {
+      const unsigned tile = threads->touched[i];
+      const unsigned tx = tile % threads->tiles_x;
+      const unsigned ty = tile / threads->tiles_x;
+
+      if (all ||
+          CACHE_POS(tx, ty, 0) % threads->num_threads == thread->index)
+         rasterize_tile(threads, thread, tile);
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE( thread_function, init_data )
+{
+   struct sp_rast_thread *thread = (struct sp_rast_thread *) init_data;
+   struct sp_rast_threads *threads = thread->threads;
+   char thread_name[16];
+
+   util_snprintf(thread_name, sizeof thread_name, "softpipe-%u",
+                 thread->index);
+   pipe_thread_setname(thread_name);
+
+   pipe_mutex_lock(threads->mutex);
+
+   while (!threads->exit) {
+      if (thread->batch != threads->batch) {
+         thread->batch = threads->batch;
+
+         pipe_mutex_unlock(threads->mutex);
+         rasterize_tiles(threads, thread, FALSE);
+         pipe_mutex_lock(threads->mutex);
+
+         if (--threads->busy == 0)
+            pipe_condvar_broadcast(threads->work_done);
+      }
+      else {
+         pipe_condvar_wait(threads->work_ready, threads->mutex);
+      }
+   }
+
+   pipe_mutex_unlock(threads->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Mirror the fragment sampler views in the thread's own texture caches.
+ * \return FALSE if out of memory
+ */
+static boolean
+update_samplers(struct sp_rast_threads *threads,
+                struct sp_rast_thread *thread)
+{
+   struct softpipe_context *softpipe = threads->softpipe;
+   const struct sp_tgsi_sampler *sampler =
+      softpipe->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   const unsigned num_views =
+      softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT];
+   unsigned i;
+
+   memcpy(thread->sampler->sp_sampler, sampler->sp_sampler,
+          sizeof sampler->sp_sampler);
+
+   for (i = 0; i < MAX2(num_views, thread->num_sampler_views); i++) {
+      struct pipe_sampler_view *view = i < num_views ?
+         softpipe->sampler_views[PIPE_SHADER_FRAGMENT][i] : NULL;
+      struct softpipe_tex_tile_cache *tc = thread->tex_cache[i];
+
+      if (view && !tc) {
+         tc = sp_create_tex_tile_cache(&softpipe->pipe);
+         if (!tc)
+            return FALSE;
+         thread->tex_cache[i] = tc;
+      }
+
+      if (tc) {
+         sp_tex_tile_cache_set_sampler_view(tc, view);
+
+         if (tc->texture) {
+            struct softpipe_resource *spt = softpipe_resource(tc->texture);
+            if (spt->timestamp != tc->timestamp) {
+               sp_tex_tile_cache_validate_texture(tc);
+               tc->timestamp = spt->timestamp;
+            }
+         }
+      }
+
+      thread->sampler->sp_sview[i] = sampler->sp_sview[i];
+      if (view)
+         thread->sampler->sp_sview[i].cache = tc;
+   }
+
+   thread->num_sampler_views = num_views;
+
+   return TRUE;
+}
+
+
+/**
+ * Get a thread ready to rasterize the current batch.
+ * \return FALSE if out of memory
+ */
+static boolean
+begin_thread(struct sp_rast_threads *threads,
+             struct sp_rast_thread *thread,
+             const struct setup_context *setup)
+{
+   struct softpipe_context *softpipe = threads->softpipe;
+
+   if (!update_samplers(threads, thread))
+      return FALSE;
+
+   if (thread->fs_variant != softpipe->fs_variant) {
+      softpipe->fs_variant->prepare(softpipe->fs_variant,
+                                    thread->fs_machine,
+                                    (struct tgsi_sampler *) thread->sampler);
+      thread->fs_variant = softpipe->fs_variant;
+   }
+
+   sp_build_quad_pipeline(softpipe, &thread->quad);
+   thread->quad.first->begin(thread->quad.first);
+
+   sp_setup_prepare_replay(thread->setup, setup, &thread->quad,
+                           &thread->cliprect);
+
+   return TRUE;
+}
+
+
+/**
+ * Allocate the color and depth tile cache entries of all the binned tiles
+ * up front, so that the threads don't compete for memory.
+ * \return FALSE if out of memory
+ */
+static boolean
+reserve_tiles(struct sp_rast_threads *threads)
+{
+   struct softpipe_context *softpipe = threads->softpipe;
+   const struct pipe_framebuffer_state *fb = &softpipe->framebuffer;
+   unsigned i, j;
+
+   for (i = 0; i < threads->num_touched; i++) {
+      const unsigned tile = threads->touched[i];
+      const union tile_address addr =
+         tile_address((tile % threads->tiles_x) * TILE_SIZE,
+                      (tile / threads->tiles_x) * TILE_SIZE, 0);
+
+      for (j = 0; j < fb->nr_cbufs; j++) {
+         if (fb->cbufs[j] &&
+             !sp_tile_cache_reserve(softpipe->cbuf_cache[j], addr))
+            return FALSE;
+      }
+
+      if (fb->zsbuf &&
+          !sp_tile_cache_reserve(softpipe->zsbuf_cache, addr))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Rasterize all the binned primitives.
+ * \param setup  the setup context which binned them
+ */
+void
+sp_rast_threads_flush(struct sp_rast_threads *threads,
+                      const struct setup_context *setup)
+{
+   struct softpipe_context *softpipe = threads->softpipe;
+   boolean parallel;
+   unsigned i;
+
+   if (!threads->num_touched) {
+      threads->num_prims = 0;
+      return;
+   }
+
+   /* Computed on first use, which mustn't happen on several threads. */
+   (void) softpipe_get_vertex_info(softpipe);
+
+   /* A single tile is cheaper to rasterize here than to hand over. */
+   parallel = threads->num_touched > 1 && reserve_tiles(threads);
+   for (i = 0; parallel && i < threads->num_threads; i++)
+      parallel = begin_thread(threads, &threads->thread[i], setup);
+
+   if (parallel) {
+      pipe_mutex_lock(threads->mutex);
+      threads->busy = threads->num_threads - 1;
+      threads->batch++;
+      pipe_condvar_broadcast(threads->work_ready);
+      pipe_mutex_unlock(threads->mutex);
+
+      rasterize_tiles(threads, &threads->thread[0], FALSE);
+
+      pipe_mutex_lock(threads->mutex);
+      while (threads->busy)
+         pipe_condvar_wait(threads->work_done, threads->mutex);
+      pipe_mutex_unlock(threads->mutex);
+
+      for (i = 0; i < threads->num_threads; i++) {
+         struct sp_rast_thread *thread = &threads->thread[i];
+
+         softpipe->occlusion_count += thread->occlusion_count;
+         softpipe->pipeline_statistics.ps_invocations +=
+            thread->ps_invocations;
+         thread->occlusion_count = 0;
+         thread->ps_invocations = 0;
+      }
+
+      /* The threads moved tiles around behind the last tile lookups. */
+      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+         softpipe->cbuf_cache[i]->last_tile_addr.bits.invalid = 1;
+      softpipe->zsbuf_cache->last_tile_addr.bits.invalid = 1;
+   }
+   else {
+      /* Go through the tiles one after the other with the context's own
+       * quad pipeline.
+       */
+      struct sp_rast_thread *thread = &threads->thread[0];
+
+      sp_setup_prepare_replay(thread->setup, setup, &softpipe->quad,
+                              &thread->cliprect);
+      rasterize_tiles(threads, thread, TRUE);
+   }
+
+   for (i = 0; i < threads->num_touched; i++)
+      threads->bins[threads->touched[i]].count = 0;
+   threads->num_touched = 0;
+   threads->num_prims = 0;
+}
+
+
+/**
+ * Size the bins for the current framebuffer.
+ * \return FALSE if out of memory
+ */
+static boolean
+begin_binning(struct sp_rast_threads *threads)
+{
+   const struct pipe_framebuffer_state *fb = &threads->softpipe->framebuffer;
+   const unsigned tiles_x = align(fb->width, TILE_SIZE) / TILE_SIZE;
+   const unsigned tiles_y = align(fb->height, TILE_SIZE) / TILE_SIZE;
+   const unsigned num_bins = tiles_x * tiles_y;
+
+   assert(!threads->num_touched);
+
+   if (num_bins > threads->max_bins) {
+      struct sp_rast_bin *bins = CALLOC(num_bins, sizeof *bins);
+      unsigned *touched = MALLOC(num_bins * sizeof *touched);
+      unsigned i;
+
+      if (!bins || !touched) {
+         FREE(bins);
+         FREE(touched);
+         return FALSE;
+      }
+
+      for (i = 0; i < threads->max_bins; i++)
+         FREE(threads->bins[i].prims);
+      FREE(threads->bins);
+      FREE(threads->touched);
+
+      threads->bins = bins;
+      threads->touched = touched;
+      threads->max_bins = num_bins;
+   }
+
+   threads->tiles_x = tiles_x;
+   threads->tiles_y = tiles_y;
+
+   return TRUE;
+}
+
+
+/**
+ * Queue a primitive for rasterization in all the tiles of the given pixel
+ * rectangle, which must lie within the framebuffer.
+ * \return FALSE if out of memory.  The primitive must then be rasterized
+ *         by the caller, and everything binned before it has been.
+ */
+boolean
+sp_rast_threads_bin(struct sp_rast_threads *threads,
+                    const struct setup_context *setup,
+                    unsigned type,
+                    const float (*v0)[4],
+                    const float (*v1)[4],
+                    const float (*v2)[4],
+                    int minx, int miny, int maxx, int maxy)
+{
+   struct sp_rast_prim *prim;
+   unsigned tx, ty;
+
+   assert(minx < maxx && miny < maxy);
+
+   if (!threads->num_prims && !begin_binning(threads))
+      return FALSE;
+
+   if (threads->num_prims == threads->max_prims) {
+      const unsigned max_prims = MAX2(2 * threads->max_prims, 256);
+      struct sp_rast_prim *prims =
+         REALLOC(threads->prims, threads->max_prims * sizeof *prims,
+                 max_prims * sizeof *prims);
+      if (!prims) {
+         sp_rast_threads_flush(threads, setup);
+         return FALSE;
+      }
+      threads->prims = prims;
+      threads->max_prims = max_prims;
+   }
+
+   /* Make room in all the bins first, so as to either queue the primitive
+    * everywhere or nowhere.
+    */
+   for (ty = miny / TILE_SIZE; ty <= (maxy - 1) / TILE_SIZE; ty++) {
+      for (tx = minx / TILE_SIZE; tx <= (maxx - 1) / TILE_SIZE; tx++) {
+         struct sp_rast_bin *bin = &threads->bins[ty * threads->tiles_x + tx];
+
+         assert(tx < threads->tiles_x && ty < threads->tiles_y);
+
+         if (bin->count == bin->size) {
+            const unsigned size = MAX2(2 * bin->size, 16);
+            unsigned *prims = REALLOC(bin->prims,
+                                      bin->size * sizeof *prims,
+                                      size * sizeof *prims);
+            if (!prims) {
+               sp_rast_threads_flush(threads, setup);
+               return FALSE;
+            }
+            bin->prims = prims;
+            bin->size = size;
+         }
+      }
+   }
+
+   prim = &threads->prims[threads->num_prims];
+   prim->type = type;
+   prim->v[0] = v0;
+   prim->v[1] = v1;
+   prim->v[2] = v2;
+
+   for (ty = miny / TILE_SIZE; ty <= (maxy - 1) / TILE_SIZE; ty++) {
+      for (tx = minx / TILE_SIZE; tx <= (maxx - 1) / TILE_SIZE; tx++) {
+         const unsigned tile = ty * threads->tiles_x + tx;
+         struct sp_rast_bin *bin = &threads->bins[tile];
+
+         if (!bin->count)
+            threads->touched[threads->num_touched++] = tile;
+
+         bin->prims[bin->count++] = threads->num_prims;
+      }
+   }
+
+   threads->num_prims++;
+
+   return TRUE;
+}
+
+
+/**
+ * Flush the texture caches of all threads.
+ */
+void
+sp_rast_threads_flush_tex_caches(struct sp_rast_threads *threads)
+{
+   unsigned i, j;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         if (threads->thread[i].tex_cache[j])
+            sp_flush_tex_tile_cache(threads->thread[i].tex_cache[j]);
+      }
+   }
+}
+
+
+void
+sp_rast_threads_add_tex_cache_stats(const struct sp_rast_threads *threads,
+                                    struct sp_tex_tile_cache_stats *stats)
+{
+   unsigned i, j;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      for (j = 0; j < PIPE_MAX_SHADER_SAMPLER_VIEWS; j++) {
+         if (threads->thread[i].tex_cache[j])
+            sp_tex_tile_cache_add_stats(threads->thread[i].tex_cache[j],
+                                        stats);
+      }
+   }
+}
+
+
+/**
+ * Called before a fragment shader variant is deleted.
+ */
+void
+sp_rast_threads_unbind_fs(struct sp_rast_threads *threads,
+                          const struct sp_fragment_shader_variant *var)
+{
+   unsigned i;
+
+   for (i = 0; i < threads->num_threads; i++) {
+      struct sp_rast_thread *thread = &threads->thread[i];
+
+      if (thread->fs_variant == var) {
+         tgsi_exec_machine_bind_shader(thread->fs_machine, NULL, NULL);
+         thread->fs_variant = NULL;
+      }
+   }
+}
+
+
+static boolean
+init_thread(struct sp_rast_threads *threads, unsigned index)
+{
+   struct softpipe_context *softpipe = threads->softpipe;
+   struct sp_rast_thread *thread = &threads->thread[index];
+
+   thread->threads = threads;
+   thread->index = index;
+
+   thread->setup = sp_setup_create_context(softpipe);
+   thread->fs_machine = tgsi_exec_machine_create();
+   thread->sampler = sp_create_tgsi_sampler();
+   thread->quad.shade = sp_quad_shade_stage(softpipe);
+   thread->quad.depth_test = sp_quad_depth_test_stage(softpipe);
+   thread->quad.blend = sp_quad_blend_stage(softpipe);
+   thread->quad.pstipple = sp_quad_polygon_stipple_stage(softpipe);
+
+   if (!thread->setup || !thread->fs_machine || !thread->sampler ||
+       !thread->quad.shade || !thread->quad.depth_test ||
+       !thread->quad.blend || !thread->quad.pstipple)
+      return FALSE;
+
+   thread->quad.shade->thread = thread;
+   thread->quad.depth_test->thread = thread;
+   thread->quad.blend->thread = thread;
+   thread->quad.pstipple->thread = thread;
+
+   return TRUE;
+}
+
+
+static void
+destroy_thread(struct sp_rast_thread *thread)
+{
+   unsigned i;
+
+   if (thread->setup)
+      sp_setup_destroy_context(thread->setup);
+
+   if (thread->quad.shade)
+      thread->quad.shade->destroy(thread->quad.shade);
+   if (thread->quad.depth_test)
+      thread->quad.depth_test->destroy(thread->quad.depth_test);
+   if (thread->quad.blend)
+      thread->quad.blend->destroy(thread->quad.blend);
+   if (thread->quad.pstipple)
+      thread->quad.pstipple->destroy(thread->quad.pstipple);
+
+   if (thread->fs_machine)
+      tgsi_exec_machine_destroy(thread->fs_machine);
+
+   for (i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++) {
+      if (thread->tex_cache[i]) {
+         sp_tex_tile_cache_set_sampler_view(thread->tex_cache[i], NULL);
+         sp_destroy_tex_tile_cache(thread->tex_cache[i]);
+      }
+   }
+
+   FREE(thread->sampler);
+}
+
+
+/**
+ * \param num_threads  number of worker threads, besides the application
+ *                     thread
+ * \return NULL if out of memory or no worker thread could be started;
+ *         otherwise fewer than num_threads workers may be running
+ */
+struct sp_rast_threads *
+sp_rast_threads_create(struct softpipe_context *softpipe,
+                       unsigned num_threads)
+{
+   struct sp_rast_threads *threads = CALLOC_STRUCT(sp_rast_threads);
+   unsigned i;
+
+   if (!threads)
+      return NULL;
+
+   assert(num_threads < SP_MAX_THREADS);
+
+   threads->softpipe = softpipe;
+   pipe_mutex_init(threads->mutex);
+   pipe_condvar_init(threads->work_ready);
+   pipe_condvar_init(threads->work_done);
+
+   for (i = 0; i <= num_threads; i++) {
+      threads->num_threads = i + 1;
+      if (!init_thread(threads, i)) {
+         sp_rast_threads_destroy(threads);
+         return NULL;
+      }
+   }
+
+   /* Thread 0 is the application thread. */
+   for (i = 1; i <= num_threads; i++) {
+      threads->thread[i].thread = pipe_thread_create(thread_function,
+                                                     &threads->thread[i]);
+      if (!threads->thread[i].thread)
+         break;
+      threads->num_workers = i;
+   }
+
+   if (!threads->num_workers) {
+      sp_rast_threads_destroy(threads);
+      return NULL;
+   }
+
+   /* Tiles are dealt out over num_threads, so drop the threads that
+    * failed to start before any work is queued.
+    */
+   while (threads->num_threads > threads->num_workers + 1)
+      destroy_thread(&threads->thread[--threads->num_threads]);
+
+   return threads;
+}
+
+
+void
+sp_rast_threads_destroy(struct sp_rast_threads *threads)
+{
+   unsigned i;
+
+   pipe_mutex_lock(threads->mutex);
+   threads->exit = TRUE;
+   pipe_condvar_broadcast(threads->work_ready);
+   pipe_mutex_unlock(threads->mutex);
+
+   for (i = 1; i <= threads->num_workers; i++)
+      pipe_thread_wait(threads->thread[i].thread);
+
+   for (i = 0; i < threads->num_threads; i++)
+      destroy_thread(&threads->thread[i]);
+
+   for (i = 0; i < threads->max_bins; i++)
+      FREE(threads->bins[i].prims);
+   FREE(threads->bins);
+   FREE(threads->touched);
+   FREE(threads->prims);
+
+   pipe_condvar_destroy(threads->work_done);
+   pipe_condvar_destroy(threads->work_ready);
+   pipe_mutex_destroy(threads->mutex);
+
+   FREE(threads);
+}
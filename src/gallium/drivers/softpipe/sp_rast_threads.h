@@ -0,0 +1,131 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef SP_RAST_THREADS_H
+#define SP_RAST_THREADS_H
+
+#include "pipe/p_state.h"
+#include "os/os_thread.h"
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of threads rasterizing, including the application thread */
+#define SP_MAX_THREADS 8
+
+
+struct setup_context;
+struct sp_tgsi_sampler;
+struct sp_fragment_shader_variant;
+struct softpipe_tex_tile_cache;
+struct sp_tex_tile_cache_stats;
+struct sp_rast_threads;
+
+
+/**
+ * Everything a thread needs to run the quad pipeline on its own tiles.
+ * Thread 0 is the application thread.
+ */
+struct sp_rast_thread {
+   struct sp_rast_threads *threads;
+   unsigned index;
+   pipe_thread thread;
+   unsigned batch;  /**< last batch this thread rasterized */
+
+   struct setup_context *setup;
+   struct quad_pipeline quad;
+   struct pipe_scissor_state cliprect;  /**< current tile, clipped */
+
+   struct tgsi_exec_machine *fs_machine;
+   const struct sp_fragment_shader_variant *fs_variant;  /**< bound to it */
+   struct sp_tgsi_sampler *sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned num_sampler_views;
+
+   /* Added to the context's counters after each batch */
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+};
+
+
+/** The fragment shader machine a quad stage should run. */
+static inline struct tgsi_exec_machine *
+sp_quad_fs_machine(const struct quad_stage *qs)
+{
+   return qs->thread ? qs->thread->fs_machine : qs->softpipe->fs_machine;
+}
+
+
+/**
+ * Get a color or depth/stencil buffer tile for a quad stage.  Each
+ * rasterizer thread owns distinct positions in the tile caches, but must
+ * leave the caches' last tile lookup alone.
+ */
+static inline struct softpipe_cached_tile *
+sp_quad_get_cached_tile(const struct quad_stage *qs,
+                        struct softpipe_tile_cache *tc,
+                        int x, int y, int layer)
+{
+   if (qs->thread)
+      return sp_find_cached_tile_concurrent(tc, tile_address(x, y, layer));
+
+   return sp_get_cached_tile(tc, x, y, layer);
+}
+
+
+struct sp_rast_threads *
+sp_rast_threads_create(struct softpipe_context *softpipe, unsigned num_threads);
+
+void
+sp_rast_threads_destroy(struct sp_rast_threads *threads);
+
+boolean
+sp_rast_threads_bin(struct sp_rast_threads *threads,
+                    const struct setup_context *setup,
+                    unsigned type,
+                    const float (*v0)[4],
+                    const float (*v1)[4],
+                    const float (*v2)[4],
+                    int minx, int miny, int maxx, int maxy);
+
+void
+sp_rast_threads_flush(struct sp_rast_threads *threads,
+                      const struct setup_context *setup);
+
+void
+sp_rast_threads_flush_tex_caches(struct sp_rast_threads *threads);
+
+void
+sp_rast_threads_add_tex_cache_stats(const struct sp_rast_threads *threads,
+                                    struct sp_tex_tile_cache_stats *stats);
+
+void
+sp_rast_threads_unbind_fs(struct sp_rast_threads *threads,
+                          const struct sp_fragment_shader_variant *var);
+
+#endif /* SP_RAST_THREADS_H */
@@ -35,6 +35,7 @@
 #include "sp_context.h"
 #include "sp_quad.h"
 #include "sp_quad_pipe.h"
+#include "sp_rast_threads.h"
 #include "sp_setup.h"
 #include "sp_state.h"
 #include "draw/draw_context.h"
@@ -75,6 +76,13 @@ struct edge {
 struct setup_context {
    struct softpipe_context *softpipe;
 
+   struct quad_pipeline *pipeline;   /**< where the quads go */
+   const struct pipe_scissor_state *cliprect;
+
+   /** Bin primitives for these threads to rasterize, instead of doing it */
+   struct sp_rast_threads *threads;
+   boolean replay;   /**< rasterizing binned primitives */
+
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
     * Codegen will help cope with this.
@@ -128,7 +136,7 @@ struct setup_context {
 static inline void
 quad_clip(struct setup_context *setup, struct quad_header *quad)
 {
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect;
+   const struct pipe_scissor_state *cliprect = setup->cliprect;
    const int minx = (int) cliprect->minx;
    const int maxx = (int) cliprect->maxx;
    const int miny = (int) cliprect->miny;
@@ -162,13 +170,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip( setup, quad );
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct quad_stage *first = setup->pipeline->first;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      first->run( first, &quad, 1 );
    }
 }
 
@@ -203,7 +211,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->pipeline->first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -709,7 +717,7 @@ subtriangle(struct setup_context *setup,
             struct edge *eright,
             int lines)
 {
-   const struct pipe_scissor_state *cliprect = &setup->softpipe->cliprect;
+   const struct pipe_scissor_state *cliprect = setup->cliprect;
    const int minx = (int) cliprect->minx;
    const int maxx = (int) cliprect->maxx;
    const int miny = (int) cliprect->miny;
@@ -775,6 +783,79 @@ subtriangle(struct setup_context *setup,
 }
 
 
+/**
+ * Clamp the start of a bounding box to the cliprect.
+ */
+static inline int
+bbox_start(float x, int min, int max)
+{
+   if (x <= (float) min)
+      return min;
+   if (x >= (float) max)
+      return max;
+   return (int) x;
+}
+
+
+/**
+ * Clamp the end of a bounding box to the cliprect.
+ */
+static inline int
+bbox_end(float x, int min, int max)
+{
+   if (x >= (float) max)
+      return max;
+   if (x <= (float) min)
+      return min;
+   return (int) x;
+}
+
+
+/**
+ * Bin a primitive for the rasterizer threads, by the bounding box of its
+ * vertices grown by 'margin' pixels, which must cover every pixel it may
+ * produce.
+ * \return FALSE if the primitive must be rasterized right away instead
+ */
+static boolean
+bin_prim(struct setup_context *setup, unsigned type,
+         const float (*v0)[4],
+         const float (*v1)[4],
+         const float (*v2)[4],
+         float margin)
+{
+   const struct pipe_scissor_state *cliprect = setup->cliprect;
+   const float xmin = MIN3(v0[0][0], v1[0][0], v2[0][0]) - margin;
+   const float ymin = MIN3(v0[0][1], v1[0][1], v2[0][1]) - margin;
+   const float xmax = MAX3(v0[0][0], v1[0][0], v2[0][0]) + margin + 1.0f;
+   const float ymax = MAX3(v0[0][1], v1[0][1], v2[0][1]) + margin + 1.0f;
+   int minx = (int) cliprect->minx;
+   int miny = (int) cliprect->miny;
+   int maxx = (int) cliprect->maxx;
+   int maxy = (int) cliprect->maxy;
+
+   /* NaNs would slip through MIN3/MAX3, bin those everywhere. */
+   if (!util_is_nan(v0[0][0] + v0[0][1] + v1[0][0] + v1[0][1] +
+                    v2[0][0] + v2[0][1] + margin)) {
+      const int x0 = bbox_start(xmin, minx, maxx);
+      const int y0 = bbox_start(ymin, miny, maxy);
+      const int x1 = bbox_end(xmax, minx, maxx);
+      const int y1 = bbox_end(ymax, miny, maxy);
+
+      minx = x0;
+      miny = y0;
+      maxx = x1;
+      maxy = y1;
+   }
+
+   if (minx >= maxx || miny >= maxy)
+      return TRUE;  /* nothing to draw */
+
+   return sp_rast_threads_bin(setup->threads, setup, type, v0, v1, v2,
+                              minx, miny, maxx, maxy);
+}
+
+
 /**
  * Recalculate prim's determinant.  This is needed as we don't have
  * get this information through the vbuf_render interface & we must
@@ -830,6 +911,14 @@ sp_setup_tri(struct setup_context *setup,
    if (!setup_sort_vertices( setup, det, v0, v1, v2 ))
       return;
 
+   if (setup->threads &&
+       bin_prim(setup, QUAD_PRIM_TRI, v0, v1, v2, 1.0f)) {
+      if (setup->softpipe->active_statistics_queries) {
+         setup->softpipe->pipeline_statistics.c_primitives++;
+      }
+      return;
+   }
+
    setup_tri_coefficients( setup );
    setup_tri_edges( setup );
 
@@ -862,7 +951,8 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   /* binned primitives were counted when binned */
+   if (setup->softpipe->active_statistics_queries && !setup->replay) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1096,6 +1186,10 @@ sp_setup_line(struct setup_context *setup,
    if (dx == 0 && dy == 0)
       return;
 
+   if (setup->threads &&
+       bin_prim(setup, QUAD_PRIM_LINE, v0, v1, v1, 1.0f))
+      return;
+
    if (!setup_line_coefficients(setup, v0, v1))
       return;
 
@@ -1233,6 +1327,10 @@ sp_setup_point(struct setup_context *setup,
 
    assert(setup->softpipe->reduced_prim == PIPE_PRIM_POINTS);
 
+   if (setup->threads &&
+       bin_prim(setup, QUAD_PRIM_POINT, v0, v0, v0, halfSize + 2.0f))
+      return;
+
    if (setup->softpipe->layer_slot > 0) {
       layer = *(unsigned *)v0[setup->softpipe->layer_slot];
       layer = MIN2(layer, setup->max_layer);
@@ -1449,6 +1547,13 @@ sp_setup_prepare(struct setup_context *setup)
 
    setup->max_layer = max_layer;
 
+   setup->pipeline = &sp->quad;
+   setup->cliprect = &sp->cliprect;
+   setup->replay = FALSE;
+
+   /* The bins don't know about layers. */
+   setup->threads = sp->layer_slot > 0 ? NULL : sp->rast_threads;
+
    sp->quad.first->begin( sp->quad.first );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
@@ -1464,6 +1569,40 @@ sp_setup_prepare(struct setup_context *setup)
 }
 
 
+/**
+ * Prepare a rasterizer thread's setup context to rasterize the primitives
+ * binned by another setup context, into the given quad pipeline and
+ * within the given rectangle.
+ */
+void
+sp_setup_prepare_replay(struct setup_context *setup,
+                        const struct setup_context *binner,
+                        struct quad_pipeline *pipeline,
+                        const struct pipe_scissor_state *cliprect)
+{
+   setup->pipeline = pipeline;
+   setup->cliprect = cliprect;
+   setup->threads = NULL;
+   setup->replay = TRUE;
+
+   setup->nr_vertex_attrs = binner->nr_vertex_attrs;
+   setup->max_layer = binner->max_layer;
+   setup->cull_face = binner->cull_face;
+}
+
+
+/**
+ * Called by vbuf code at the end of each draw, while the vertices are
+ * still around, to rasterize the primitives binned for the threads.
+ */
+void
+sp_setup_flush(struct setup_context *setup)
+{
+   if (setup->threads)
+      sp_rast_threads_flush(setup->threads, setup);
+}
+
+
 void
 sp_setup_destroy_context(struct setup_context *setup)
 {
@@ -1481,6 +1620,8 @@ sp_setup_create_context(struct softpipe_context *softpipe)
    unsigned i;
 
    setup->softpipe = softpipe;
+   setup->pipeline = &softpipe->quad;
+   setup->cliprect = &softpipe->cliprect;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
@@ -29,6 +29,7 @@
 #include "sp_state.h"
 #include "sp_fs.h"
 #include "sp_texture.h"
+#include "sp_rast_threads.h"
 
 #include "pipe/p_defines.h"
 #include "util/u_memory.h"
@@ -189,6 +190,9 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
+      if (softpipe->rast_threads)
+         sp_rast_threads_unbind_fs(softpipe->rast_threads, var);
+
       var->delete(var, softpipe->fs_machine);
    }
 
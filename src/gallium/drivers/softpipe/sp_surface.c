@@ -28,8 +28,66 @@
 #include "util/u_format.h"
 #include "util/u_surface.h"
 #include "sp_context.h"
+#include "sp_flush.h"
 #include "sp_surface.h"
 #include "sp_query.h"
+#include "sp_texture.h"
+
+
+/**
+ * resource_copy_region() which addresses softpipe's own texture memory
+ * directly, rather than allocating and mapping a pair of transfers for
+ * every (typically small) glCopyImageSubData() rectangle.  Display targets
+ * and buffers still go through util_resource_copy_region().
+ */
+static void
+sp_resource_copy(struct pipe_context *pipe,
+                 struct pipe_resource *dst, unsigned dst_level,
+                 unsigned dstx, unsigned dsty, unsigned dstz,
+                 struct pipe_resource *src, unsigned src_level,
+                 const struct pipe_box *src_box)
+{
+   struct softpipe_resource *dst_spr = softpipe_resource(dst);
+   struct softpipe_resource *src_spr = softpipe_resource(src);
+
+   if (dst->target == PIPE_BUFFER || src->target == PIPE_BUFFER ||
+       dst_spr->dt || src_spr->dt) {
+      util_resource_copy_region(pipe, dst, dst_level, dstx, dsty, dstz,
+                                src, src_level, src_box);
+      return;
+   }
+
+   softpipe_flush_resource(pipe, dst, dst_level,
+                           src_box->depth > 1 ? -1 : (int) dstz,
+                           0, /* flush_flags */
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE); /* do_not_block */
+   softpipe_flush_resource(pipe, src, src_level,
+                           src_box->depth > 1 ? -1 : src_box->z,
+                           0, /* flush_flags */
+                           TRUE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE); /* do_not_block */
+
+   assert(util_format_get_blocksize(dst->format) ==
+          util_format_get_blocksize(src->format));
+
+   util_copy_box((ubyte *) dst_spr->data +
+                 sp_get_tex_image_offset(dst_spr, dst_level, dstz),
+                 dst->format,
+                 dst_spr->stride[dst_level], dst_spr->img_stride[dst_level],
+                 dstx, dsty, 0,
+                 src_box->width, src_box->height, src_box->depth,
+                 (const ubyte *) src_spr->data +
+                 sp_get_tex_image_offset(src_spr, src_level, src_box->z),
+                 src_spr->stride[src_level], src_spr->img_stride[src_level],
+                 src_box->x, src_box->y, 0);
+
+   /* expire the tile caches, as a write transfer would */
+   dst_spr->timestamp++;
+}
+
 
 static void sp_blit(struct pipe_context *pipe,
                     const struct pipe_blit_info *info)
@@ -132,7 +190,7 @@ softpipe_clear_depth_stencil(struct pipe_context *pipe,
 void
 sp_init_surface_functions(struct softpipe_context *sp)
 {
-   sp->pipe.resource_copy_region = util_resource_copy_region;
+   sp->pipe.resource_copy_region = sp_resource_copy;
    sp->pipe.clear_render_target = softpipe_clear_render_target;
    sp->pipe.clear_depth_stencil = softpipe_clear_depth_stencil;
    sp->pipe.blit = sp_blit;
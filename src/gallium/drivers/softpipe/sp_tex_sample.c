@@ -41,6 +41,9 @@
 #include "util/u_format.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_sse.h"
+#include "sp_context.h"
 #include "sp_quad.h"   /* only for #define QUAD_* tokens */
 #include "sp_tex_sample.h"
 #include "sp_texture.h"
@@ -2544,16 +2547,16 @@ mip_filter_linear_2d_linear_repeat_POT(
    for (j = 0; j < TGSI_QUAD_SIZE; j++) {
       const int level0 = psview->u.tex.first_level + (int)lod[j];
       struct img_filter_args args;
-      /* Catches both negative and large values of level0:
-       */
       args.s = s[j];
       args.t = t[j];
       args.p = p[j];
       args.face_id = filt_args->faces[j];
       args.offset = filt_args->offset;
       args.gather_only = filt_args->control == TGSI_SAMPLER_GATHER;
-      if ((unsigned)level0 >= psview->u.tex.last_level) {
-         if (level0 < 0)
+      /* As in mip_filter_linear, magnification uses the base level only:
+       */
+      if (lod[j] < 0.0 || level0 >= (int) psview->u.tex.last_level) {
+         if (lod[j] < 0.0)
             args.level = psview->u.tex.first_level;
          else
             args.level = psview->u.tex.last_level;
@@ -2611,6 +2614,382 @@ static const struct sp_filter_funcs funcs_linear_2d_linear_repeat_POT = {
    mip_filter_linear_2d_linear_repeat_POT
 };
 
+#if defined(PIPE_ARCH_SSE)
+
+/*
+ * SSE versions of the most common samplers: normalized coordinates into
+ * power of two 2D textures, the same repeat or clamp to edge wrap mode for
+ * S and T, the same nearest or linear filter for minification and
+ * magnification, and no or linear mipmap filtering.  A quad is sampled as
+ * a whole: the four fragments' texel coordinates and weights are computed
+ * in SSE registers, each fragment's texels are filtered as RGBA vectors,
+ * and the results are transposed into the SoA layout tgsi_exec uses.
+ *
+ * The arithmetic is done in the same order as in the scalar paths above
+ * (rounding included, see ifloor4), so the results are the same.  There's
+ * nothing format specific to do, as the texture tile cache holds all
+ * formats as float RGBA.
+ */
+
+
+/**
+ * util_ifloor() of four floats, with util_ifloor()'s own rounding.
+ */
+static inline __m128i
+ifloor4(__m128 f)
+{
+   const __m128d magic = _mm_set1_pd((3 << 22) + 0.5);
+   const __m128d lo = _mm_cvtps_pd(f);
+   const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(f, f));
+   const __m128 a = _mm_movelh_ps(_mm_cvtpd_ps(_mm_add_pd(magic, lo)),
+                                  _mm_cvtpd_ps(_mm_add_pd(magic, hi)));
+   const __m128 b = _mm_movelh_ps(_mm_cvtpd_ps(_mm_sub_pd(magic, lo)),
+                                  _mm_cvtpd_ps(_mm_sub_pd(magic, hi)));
+
+   return _mm_srai_epi32(_mm_sub_epi32(_mm_castps_si128(a),
+                                       _mm_castps_si128(b)), 1);
+}
+
+
+/** Clamp four ints to [0, max] */
+static inline __m128i
+iclamp4(__m128i x, __m128i max)
+{
+   __m128i over;
+
+   x = _mm_andnot_si128(_mm_srai_epi32(x, 31), x);
+   over = _mm_cmpgt_epi32(x, max);
+   return _mm_or_si128(_mm_andnot_si128(over, x), _mm_and_si128(over, max));
+}
+
+
+static inline __m128
+lerp4(__m128 a, __m128 v0, __m128 v1)
+{
+   return _mm_add_ps(v0, _mm_mul_ps(a, _mm_sub_ps(v1, v0)));
+}
+
+
+/**
+ * Nearest texel coordinates of four fragments along one axis, as in
+ * img_filter_2d_nearest_repeat_POT and wrap_nearest_clamp_to_edge.
+ */
+static inline __m128i
+wrap_nearest4(unsigned wrap, __m128 s, __m128 size, __m128i max, int offset)
+{
+   const __m128 u = _mm_add_ps(_mm_mul_ps(s, size),
+                               _mm_set1_ps((float) offset));
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT)
+      return _mm_and_si128(ifloor4(u), max);
+   else
+      return iclamp4(ifloor4(u), max);
+}
+
+
+/**
+ * The two texel coordinates and the weight of four fragments along one
+ * axis, as in img_filter_2d_linear_repeat_POT and
+ * wrap_linear_clamp_to_edge.
+ */
+static inline void
+wrap_linear4(unsigned wrap, __m128 s, __m128 size, __m128i max, int offset,
+             union m128i *i0, union m128i *i1, __m128 *w)
+{
+   __m128 u;
+   __m128i flr;
+
+   if (wrap == PIPE_TEX_WRAP_REPEAT) {
+      u = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(s, size), _mm_set1_ps(0.5f)),
+                     _mm_set1_ps((float) offset));
+      flr = ifloor4(u);
+      i0->m = _mm_and_si128(flr, max);
+      i1->m = _mm_and_si128(_mm_add_epi32(i0->m, _mm_set1_epi32(1)), max);
+   }
+   else {
+      u = _mm_add_ps(_mm_mul_ps(s, size), _mm_set1_ps((float) offset));
+      u = _mm_min_ps(_mm_max_ps(u, _mm_setzero_ps()), size);
+      u = _mm_sub_ps(u, _mm_set1_ps(0.5f));
+      flr = ifloor4(u);
+      i0->m = iclamp4(flr, max);
+      i1->m = iclamp4(_mm_add_epi32(flr, _mm_set1_epi32(1)), max);
+   }
+
+   *w = _mm_sub_ps(u, _mm_cvtepi32_ps(flr));
+}
+
+
+/**
+ * Filter the texels of four fragments, each at its own mipmap level.
+ * Returns each fragment's RGBA in one register.
+ */
+static inline void
+img_filter_2d_quad_sse(const struct sp_sampler_view *sp_sview,
+                       unsigned filter, unsigned wrap,
+                       const unsigned level[TGSI_QUAD_SIZE],
+                       const float s[TGSI_QUAD_SIZE],
+                       const float t[TGSI_QUAD_SIZE],
+                       const int8_t *offset,
+                       __m128 texel[TGSI_QUAD_SIZE])
+{
+   unsigned width[TGSI_QUAD_SIZE], height[TGSI_QUAD_SIZE];
+   __m128 widthf, heightf;
+   __m128i xmax, ymax;
+   union tex_tile_address addr;
+   int j;
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      width[j] = pot_level_size(sp_sview->xpot, level[j]);
+      height[j] = pot_level_size(sp_sview->ypot, level[j]);
+   }
+   widthf = _mm_setr_ps((float) width[0], (float) width[1],
+                        (float) width[2], (float) width[3]);
+   heightf = _mm_setr_ps((float) height[0], (float) height[1],
+                         (float) height[2], (float) height[3]);
+   xmax = _mm_setr_epi32(width[0] - 1, width[1] - 1,
+                         width[2] - 1, width[3] - 1);
+   ymax = _mm_setr_epi32(height[0] - 1, height[1] - 1,
+                         height[2] - 1, height[3] - 1);
+
+   addr.value = 0;
+
+   if (filter == PIPE_TEX_FILTER_NEAREST) {
+      union m128i x, y;
+
+      x.m = wrap_nearest4(wrap, _mm_loadu_ps(s), widthf, xmax, offset[0]);
+      y.m = wrap_nearest4(wrap, _mm_loadu_ps(t), heightf, ymax, offset[1]);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         addr.bits.level = level[j];
+         texel[j] = _mm_loadu_ps(get_texel_2d_no_border(sp_sview, addr,
+                                                        x.ui[j], y.ui[j]));
+      }
+   }
+   else {
+      union m128i x0, x1, y0, y1;
+      union { __m128 m; float f[4]; } xw, yw;
+
+      wrap_linear4(wrap, _mm_loadu_ps(s), widthf, xmax, offset[0],
+                   &x0, &x1, &xw.m);
+      wrap_linear4(wrap, _mm_loadu_ps(t), heightf, ymax, offset[1],
+                   &y0, &y1, &yw.m);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         const float *tx[4];
+         __m128 a, b;
+
+         addr.bits.level = level[j];
+
+         /* All four texels in one tile, or not: */
+         if ((x0.ui[j] % TEX_TILE_SIZE) != TEX_TILE_SIZE - 1 &&
+             (y0.ui[j] % TEX_TILE_SIZE) != TEX_TILE_SIZE - 1 &&
+             x1.ui[j] == x0.ui[j] + 1 && y1.ui[j] == y0.ui[j] + 1)
+            get_texel_quad_2d_no_border_single_tile(sp_sview, addr,
+                                                    x0.ui[j], y0.ui[j], tx);
+         else
+            get_texel_quad_2d_no_border(sp_sview, addr, x0.ui[j], y0.ui[j],
+                                        x1.ui[j], y1.ui[j], tx);
+
+         a = lerp4(_mm_set1_ps(xw.f[j]),
+                   _mm_loadu_ps(tx[0]), _mm_loadu_ps(tx[1]));
+         b = lerp4(_mm_set1_ps(xw.f[j]),
+                   _mm_loadu_ps(tx[2]), _mm_loadu_ps(tx[3]));
+         texel[j] = lerp4(_mm_set1_ps(yw.f[j]), a, b);
+      }
+   }
+}
+
+
+static inline void
+store_quad_sse(__m128 texel[TGSI_QUAD_SIZE],
+               float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   _MM_TRANSPOSE4_PS(texel[0], texel[1], texel[2], texel[3]);
+   _mm_storeu_ps(rgba[0], texel[0]);
+   _mm_storeu_ps(rgba[1], texel[1]);
+   _mm_storeu_ps(rgba[2], texel[2]);
+   _mm_storeu_ps(rgba[3], texel[3]);
+}
+
+
+/**
+ * As mip_filter_none_no_filter_select, for a whole quad.
+ */
+static inline void
+mip_filter_none_2d_sse(const struct sp_sampler_view *sp_sview,
+                       unsigned filter, unsigned wrap,
+                       const float s[TGSI_QUAD_SIZE],
+                       const float t[TGSI_QUAD_SIZE],
+                       const struct filter_args *filt_args,
+                       float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const unsigned first = sp_sview->base.u.tex.first_level;
+   const unsigned level[TGSI_QUAD_SIZE] = { first, first, first, first };
+   __m128 texel[TGSI_QUAD_SIZE];
+
+   img_filter_2d_quad_sse(sp_sview, filter, wrap, level, s, t,
+                          filt_args->offset, texel);
+   store_quad_sse(texel, rgba);
+}
+
+
+/**
+ * As mip_filter_linear, for a whole quad.
+ */
+static inline void
+mip_filter_linear_2d_sse(const struct sp_sampler_view *sp_sview,
+                         const struct sp_sampler *sp_samp,
+                         unsigned filter, unsigned wrap,
+                         const float s[TGSI_QUAD_SIZE],
+                         const float t[TGSI_QUAD_SIZE],
+                         const float p[TGSI_QUAD_SIZE],
+                         const float lod_in[TGSI_QUAD_SIZE],
+                         const struct filter_args *filt_args,
+                         float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])
+{
+   const struct pipe_sampler_view *psview = &sp_sview->base;
+   unsigned level0[TGSI_QUAD_SIZE], level1[TGSI_QUAD_SIZE];
+   float lod[TGSI_QUAD_SIZE];
+   boolean blend[TGSI_QUAD_SIZE], any_blend = FALSE;
+   __m128 texel[TGSI_QUAD_SIZE];
+   int j;
+
+   compute_lambda_lod(sp_sview, sp_samp, s, t, p, lod_in,
+                      filt_args->control, lod);
+
+   for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+      const int level = psview->u.tex.first_level + (int)lod[j];
+
+      blend[j] = FALSE;
+      if (lod[j] < 0.0)
+         level0[j] = psview->u.tex.first_level;
+      else if (level >= (int) psview->u.tex.last_level)
+         level0[j] = psview->u.tex.last_level;
+      else {
+         level0[j] = level;
+         blend[j] = any_blend = TRUE;
+      }
+      level1[j] = blend[j] ? level0[j] + 1 : level0[j];
+   }
+
+   img_filter_2d_quad_sse(sp_sview, filter, wrap, level0, s, t,
+                          filt_args->offset, texel);
+
+   if (any_blend) {
+      __m128 texel1[TGSI_QUAD_SIZE];
+
+      img_filter_2d_quad_sse(sp_sview, filter, wrap, level1, s, t,
+                             filt_args->offset, texel1);
+
+      for (j = 0; j < TGSI_QUAD_SIZE; j++) {
+         if (blend[j])
+            texel[j] = lerp4(_mm_set1_ps(frac(lod[j])), texel[j], texel1[j]);
+      }
+   }
+
+   store_quad_sse(texel, rgba);
+}
+
+
+/**
+ * Define the mip filter funcs of one filter and wrap mode combination,
+ * for softpipe_create_sampler_state to pick from.
+ */
+#define SP_FILTER_FUNCS_2D_SSE(name, filter, wrap)                        \
+static void                                                               \
+mip_filter_none_2d_##name(const struct sp_sampler_view *sp_sview,         \
+                          const struct sp_sampler *sp_samp,               \
+                          img_filter_func min_filter,                     \
+                          img_filter_func mag_filter,                     \
+                          const float s[TGSI_QUAD_SIZE],                  \
+                          const float t[TGSI_QUAD_SIZE],                  \
+                          const float p[TGSI_QUAD_SIZE],                  \
+                          const float c0[TGSI_QUAD_SIZE],                 \
+                          const float lod_in[TGSI_QUAD_SIZE],             \
+                          const struct filter_args *filt_args,            \
+                          float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])  \
+{                                                                         \
+   mip_filter_none_2d_sse(sp_sview, filter, wrap, s, t, filt_args, rgba); \
+}                                                                         \
+                                                                          \
+static void                                                               \
+mip_filter_linear_2d_##name(const struct sp_sampler_view *sp_sview,       \
+                            const struct sp_sampler *sp_samp,             \
+                            img_filter_func min_filter,                   \
+                            img_filter_func mag_filter,                   \
+                            const float s[TGSI_QUAD_SIZE],                \
+                            const float t[TGSI_QUAD_SIZE],                \
+                            const float p[TGSI_QUAD_SIZE],                \
+                            const float c0[TGSI_QUAD_SIZE],               \
+                            const float lod_in[TGSI_QUAD_SIZE],           \
+                            const struct filter_args *filt_args,          \
+                            float rgba[TGSI_NUM_CHANNELS][TGSI_QUAD_SIZE])\
+{                                                                         \
+   mip_filter_linear_2d_sse(sp_sview, sp_samp, filter, wrap,              \
+                            s, t, p, lod_in, filt_args, rgba);            \
+}                                                                         \
+                                                                          \
+static const struct sp_filter_funcs funcs_none_2d_##name = {              \
+   mip_rel_level_none,                                                    \
+   mip_filter_none_2d_##name                                              \
+};                                                                        \
+                                                                          \
+static const struct sp_filter_funcs funcs_linear_2d_##name = {            \
+   mip_rel_level_linear,                                                  \
+   mip_filter_linear_2d_##name                                            \
+};
+
+SP_FILTER_FUNCS_2D_SSE(nearest_repeat_POT_sse,
+                       PIPE_TEX_FILTER_NEAREST, PIPE_TEX_WRAP_REPEAT)
+SP_FILTER_FUNCS_2D_SSE(nearest_clamp_to_edge_POT_sse,
+                       PIPE_TEX_FILTER_NEAREST, PIPE_TEX_WRAP_CLAMP_TO_EDGE)
+SP_FILTER_FUNCS_2D_SSE(linear_repeat_POT_sse,
+                       PIPE_TEX_FILTER_LINEAR, PIPE_TEX_WRAP_REPEAT)
+SP_FILTER_FUNCS_2D_SSE(linear_clamp_to_edge_POT_sse,
+                       PIPE_TEX_FILTER_LINEAR, PIPE_TEX_WRAP_CLAMP_TO_EDGE)
+
+#undef SP_FILTER_FUNCS_2D_SSE
+
+
+/**
+ * Get the SSE filter funcs for sampling power of two 2D views with the
+ * given sampler, or NULL if it isn't one of the common cases.
+ */
+static const struct sp_filter_funcs *
+get_pot2d_filter_funcs_sse(const struct pipe_sampler_state *sampler)
+{
+   const boolean mip_linear =
+      sampler->min_mip_filter == PIPE_TEX_MIPFILTER_LINEAR;
+
+   if (!sampler->normalized_coords ||
+       sampler->min_img_filter != sampler->mag_img_filter ||
+       sampler->wrap_s != sampler->wrap_t ||
+       sampler->max_anisotropy > 1 ||
+       (sampler->min_mip_filter != PIPE_TEX_MIPFILTER_NONE && !mip_linear))
+      return NULL;
+
+   switch (sampler->wrap_s) {
+   case PIPE_TEX_WRAP_REPEAT:
+      if (sampler->min_img_filter == PIPE_TEX_FILTER_NEAREST)
+         return mip_linear ? &funcs_linear_2d_nearest_repeat_POT_sse :
+                             &funcs_none_2d_nearest_repeat_POT_sse;
+      else
+         return mip_linear ? &funcs_linear_2d_linear_repeat_POT_sse :
+                             &funcs_none_2d_linear_repeat_POT_sse;
+   case PIPE_TEX_WRAP_CLAMP_TO_EDGE:
+      if (sampler->min_img_filter == PIPE_TEX_FILTER_NEAREST)
+         return mip_linear ? &funcs_linear_2d_nearest_clamp_to_edge_POT_sse :
+                             &funcs_none_2d_nearest_clamp_to_edge_POT_sse;
+      else
+         return mip_linear ? &funcs_linear_2d_linear_clamp_to_edge_POT_sse :
+                             &funcs_none_2d_linear_clamp_to_edge_POT_sse;
+   default:
+      return NULL;
+   }
+}
+
+#endif /* PIPE_ARCH_SSE */
+
 /**
  * Do shadow/depth comparisons.
  */
@@ -3021,6 +3400,8 @@ get_filters(const struct sp_sampler_view *sp_sview,
          *min = get_img_filter(sp_sview, &sp_samp->base,
                                PIPE_TEX_FILTER_LINEAR, true);
       }
+   } else if (sp_sview->pot2d && sp_samp->pot2d_filter_funcs) {
+      *funcs = sp_samp->pot2d_filter_funcs;
    } else if (sp_sview->pot2d & sp_samp->min_mag_equal_repeat_linear) {
       *funcs = &funcs_linear_2d_linear_repeat_POT;
    } else {
@@ -3401,6 +3782,11 @@ softpipe_create_sampler_state(struct pipe_context *pipe,
       samp->min_mag_equal = TRUE;
    }
 
+#if defined(PIPE_ARCH_SSE)
+   if (util_cpu_caps.has_sse2 && !softpipe_context(pipe)->no_sse_sampling)
+      samp->pot2d_filter_funcs = get_pot2d_filter_funcs_sse(sampler);
+#endif
+
    return (void *)samp;
 }
 
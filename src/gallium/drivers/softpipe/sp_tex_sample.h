@@ -140,6 +140,9 @@ struct sp_sampler {
    wrap_linear_func linear_texcoord_p;
 
    const struct sp_filter_funcs *filter_funcs;
+
+   /** Faster filter funcs for power of two 2D views, if any */
+   const struct sp_filter_funcs *pot2d_filter_funcs;
 };
 
 
@@ -37,17 +37,34 @@
 #include "util/u_tile.h"
 #include "util/u_format.h"
 #include "util/u_math.h"
+#include "util/u_sse.h"
 #include "sp_context.h"
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
    
 
+/**
+ * Mark all the cached tiles as invalid/empty.
+ */
+static void
+invalidate_tiles(struct softpipe_tex_tile_cache *tc)
+{
+   uint pos;
+
+   for (pos = 0; pos < Elements(tc->tile_addrs); pos++) {
+      tc->tile_addrs[pos].bits.invalid = 1;
+      tc->last_used[pos] = 0;
+   }
+   tc->last_tile_addr.bits.invalid = 1;
+   tc->last_miss.bits.invalid = 1;
+}
+
+
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
 {
    struct softpipe_tex_tile_cache *tc;
-   uint pos;
 
    /* make sure max texture size works */
    assert((TEX_TILE_SIZE << TEX_ADDR_BITS) >= (1 << (SP_MAX_TEXTURE_2D_LEVELS-1)));
@@ -55,10 +72,19 @@ sp_create_tex_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
+      tc->ways = softpipe_context(pipe)->tex_cache_ways;
+      assert(tc->ways >= 1 && tc->ways <= TEX_TILE_MAX_WAYS);
+      invalidate_tiles(tc);
+
+      /* this allocation allows us to guarantee that allocation
+       * failures are never fatal later
+       */
+      tc->tile = MALLOC_STRUCT( softpipe_tex_cached_tile );
+      if (!tc->tile)
+      {
+         FREE(tc);
+         return NULL;
       }
-      tc->last_tile = &tc->entries[0]; /* any tile */
    }
    return tc;
 }
@@ -71,8 +97,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
       uint pos;
 
       for (pos = 0; pos < Elements(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
+         FREE(tc->entries[pos]);
       }
+      FREE(tc->tile);
+
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
@@ -92,14 +120,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 void
 sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
 {
-   unsigned i;
-
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < Elements(tc->entries); i++) {
-      tc->entries[i].addr.bits.invalid = 1;
-   }
+   invalidate_tiles(tc);
 }
 
 static boolean
@@ -124,7 +148,6 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
                                    struct pipe_sampler_view *view)
 {
    struct pipe_resource *texture = view ? view->texture : NULL;
-   uint i;
 
    assert(!tc->transfer);
 
@@ -147,9 +170,7 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < Elements(tc->entries); i++) {
-         tc->entries[i].addr.bits.invalid = 1;
-      }
+      invalidate_tiles(tc);
 
       tc->tex_z = -1; /* any invalid value here */
    }
@@ -165,37 +186,203 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
-   int pos;
-
    if (tc->texture) {
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
+      invalidate_tiles(tc);
       tc->tex_z = -1;
    }
 
 }
 
 
+/**
+ * Add the cache's lookup counters to 'stats'.
+ */
+void
+sp_tex_tile_cache_add_stats(const struct softpipe_tex_tile_cache *tc,
+                            struct sp_tex_tile_cache_stats *stats)
+{
+   stats->hits += tc->stats.hits;
+   stats->misses += tc->stats.misses;
+   stats->prefetches += tc->stats.prefetches;
+}
+
+
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the cache set where we'd hope to find the cached texture tile.
  */
 static inline uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_set( union tex_tile_address addr )
 {
    uint entry = (addr.bits.x + 
                  addr.bits.y * 9 + 
                  addr.bits.z +
                  addr.bits.level * 7);
 
-   return entry % NUM_TEX_TILE_ENTRIES;
+   return entry % NUM_TEX_TILE_SETS;
+}
+
+
+/**
+ * Return the position of the tile in the cache, or -1 if it isn't cached,
+ * in which case 'victim' is the least recently used entry of its set.
+ */
+static inline int
+tex_cache_lookup(const struct softpipe_tex_tile_cache *tc,
+                 union tex_tile_address addr, uint *victim)
+{
+   const uint first = tex_cache_set(addr) * tc->ways;
+   uint pos;
+
+   *victim = first;
+   for (pos = first; pos < first + tc->ways; pos++) {
+      if (tc->tile_addrs[pos].value == addr.value)
+         return pos;
+      if (tc->last_used[pos] < tc->last_used[*victim])
+         *victim = pos;
+   }
+
+   return -1;
+}
+
+
+static struct softpipe_tex_cached_tile *
+alloc_tile(struct softpipe_tex_tile_cache *tc)
+{
+   struct softpipe_tex_cached_tile *tile =
+      MALLOC_STRUCT(softpipe_tex_cached_tile);
+   if (!tile)
+   {
+      /* in this case, steal an existing tile */
+      if (!tc->tile)
+      {
+         unsigned pos;
+         for (pos = 0; pos < Elements(tc->entries); ++pos) {
+            if (!tc->entries[pos])
+               continue;
+
+            tc->tile = tc->entries[pos];
+            tc->entries[pos] = NULL;
+            tc->tile_addrs[pos].bits.invalid = 1;
+            tc->last_used[pos] = 0;
+            break;
+         }
+
+         /* this should never happen */
+         if (!tc->tile)
+            abort();
+      }
+
+      tile = tc->tile;
+      tc->tile = NULL;
+
+      tc->last_tile_addr.bits.invalid = 1;
+   }
+   return tile;
 }
 
+
+/**
+ * Map the texture level and layer/slice of 'addr', if not mapped yet.
+ */
+static void
+map_texture_level(struct softpipe_tex_tile_cache *tc,
+                  union tex_tile_address addr)
+{
+   /* check if we need to get a new transfer */
+   if (!tc->tex_trans ||
+       tc->tex_level != addr.bits.level ||
+       tc->tex_z != addr.bits.z) {
+      /* get new transfer (view into texture) */
+      unsigned width, height, layer;
+
+      if (tc->tex_trans_map) {
+         tc->pipe->transfer_unmap(tc->pipe, tc->tex_trans);
+         tc->tex_trans = NULL;
+         tc->tex_trans_map = NULL;
+      }
+
+      width = u_minify(tc->texture->width0, addr.bits.level);
+      if (tc->texture->target == PIPE_TEXTURE_1D_ARRAY) {
+         height = tc->texture->array_size;
+         layer = 0;
+      }
+      else {
+         height = u_minify(tc->texture->height0, addr.bits.level);
+         layer = addr.bits.z;
+      }
+
+      tc->tex_trans_map =
+         pipe_transfer_map(tc->pipe, tc->texture,
+                           addr.bits.level,
+                           layer,
+                           PIPE_TRANSFER_READ | PIPE_TRANSFER_UNSYNCHRONIZED,
+                           0, 0, width, height, &tc->tex_trans);
+
+      tc->tex_level = addr.bits.level;
+      tc->tex_z = addr.bits.z;
+   }
+}
+
+
+/**
+ * On a miss, prefetch the next tile in the direction the misses are
+ * walking the texture, which follows the texture coordinate gradient of
+ * the quads being sampled.  The texels are only brought into the CPU
+ * caches, in the texture's own format: like any other tile, it's only
+ * converted if and when it is looked up.
+ */
+static void
+prefetch_next_tile(struct softpipe_tex_tile_cache *tc,
+                   union tex_tile_address addr)
+{
+#if defined(PIPE_ARCH_SSE)
+   const union tex_tile_address prev = tc->last_miss;
+   const struct util_format_description *desc;
+   union tex_tile_address next;
+   unsigned x, y, width, height, row, row_bytes, offset, victim;
+   int dx, dy;
+
+   if (prev.bits.invalid ||
+       prev.bits.level != addr.bits.level ||
+       prev.bits.z != addr.bits.z)
+      return;
+
+   dx = (int) addr.bits.x - (int) prev.bits.x;
+   dy = (int) addr.bits.y - (int) prev.bits.y;
+   if (dx < -1 || dx > 1 || dy < -1 || dy > 1 || (dx == 0 && dy == 0) ||
+       ((int) addr.bits.x + dx) < 0 || ((int) addr.bits.y + dy) < 0)
+      return;
+
+   next = addr;
+   next.bits.x += dx;
+   next.bits.y += dy;
+   x = next.bits.x * TEX_TILE_SIZE;
+   y = next.bits.y * TEX_TILE_SIZE;
+   if (x >= tc->tex_trans->box.width || y >= tc->tex_trans->box.height ||
+       tex_cache_lookup(tc, next, &victim) >= 0)
+      return;
+
+   desc = util_format_description(tc->format);
+   width = MIN2(TEX_TILE_SIZE, tc->tex_trans->box.width - x);
+   height = MIN2(TEX_TILE_SIZE, tc->tex_trans->box.height - y);
+   row_bytes = DIV_ROUND_UP(width, desc->block.width) * desc->block.bits / 8;
+
+   for (row = 0; row < height; row += desc->block.height) {
+      const char *src = (const char *) tc->tex_trans_map +
+         (y + row) / desc->block.height * tc->tex_trans->stride +
+         x / desc->block.width * desc->block.bits / 8;
+
+      for (offset = 0; offset < row_bytes; offset += 64)
+         _mm_prefetch(src + offset, _MM_HINT_T0);
+   }
+
+   tc->stats.prefetches++;
+#endif
+}
+
+
 /**
  * Similar to sp_get_cached_tile() but for textures.
  * Tiles are read-only and indexed with more params.
@@ -205,57 +392,29 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
                         union tex_tile_address addr )
 {
    struct softpipe_tex_cached_tile *tile;
-   boolean zs = util_format_is_depth_or_stencil(tc->format);
+   uint victim;
+   int pos = tex_cache_lookup(tc, addr, &victim);
 
-   tile = tc->entries + tex_cache_pos( addr );
-
-   if (addr.value != tile->addr.value) {
+   if (pos >= 0) {
+      tc->stats.hits++;
+      tile = tc->entries[pos];
+   }
+   else {
+      boolean zs = util_format_is_depth_or_stencil(tc->format);
 
       /* cache miss.  Most misses are because we've invalidated the
        * texture cache previously -- most commonly on binding a new
        * texture.  Currently we effectively flush the cache on texture
        * bind.
        */
-#if 0
-      _debug_printf("miss at %u:  x=%d y=%d z=%d face=%d level=%d\n"
-                    "   tile %u:  x=%d y=%d z=%d face=%d level=%d\n",
-                    pos, x/TILE_SIZE, y/TILE_SIZE, z, face, level,
-                    pos, tile->addr.bits.x, tile->addr.bits.y, tile->z, tile->face, tile->level);
-#endif
-
-      /* check if we need to get a new transfer */
-      if (!tc->tex_trans ||
-          tc->tex_level != addr.bits.level ||
-          tc->tex_z != addr.bits.z) {
-         /* get new transfer (view into texture) */
-         unsigned width, height, layer;
-
-         if (tc->tex_trans_map) {
-            tc->pipe->transfer_unmap(tc->pipe, tc->tex_trans);
-            tc->tex_trans = NULL;
-            tc->tex_trans_map = NULL;
-         }
+      tc->stats.misses++;
 
-         width = u_minify(tc->texture->width0, addr.bits.level);
-         if (tc->texture->target == PIPE_TEXTURE_1D_ARRAY) {
-            height = tc->texture->array_size;
-            layer = 0;
-         }
-         else {
-            height = u_minify(tc->texture->height0, addr.bits.level);
-            layer = addr.bits.z;
-         }
+      pos = victim;
+      if (!tc->entries[pos])
+         tc->entries[pos] = alloc_tile(tc);
+      tile = tc->entries[pos];
 
-         tc->tex_trans_map =
-            pipe_transfer_map(tc->pipe, tc->texture,
-                              addr.bits.level,
-                              layer,
-                              PIPE_TRANSFER_READ | PIPE_TRANSFER_UNSYNCHRONIZED,
-                              0, 0, width, height, &tc->tex_trans);
-
-         tc->tex_level = addr.bits.level;
-         tc->tex_z = addr.bits.z;
-      }
+      map_texture_level(tc, addr);
 
       /* Get tile from the transfer (view into texture), explicitly passing
        * the image format.
@@ -285,9 +444,17 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
                                    tc->format,
                                    (float *) tile->data.color);
       }
-      tile->addr = addr;
+      tc->tile_addrs[pos] = addr;
+
+      prefetch_next_tile(tc, addr);
+      tc->last_miss = addr;
    }
 
+   /* The last tile is always the most recently used one, so that updating
+    * its time here, and not on each sp_get_cached_tile_tex() hit, is enough.
+    */
+   tc->last_used[pos] = ++tc->clock;
+   tc->last_tile_addr = addr;
    tc->last_tile = tile;
    return tile;
 }
@@ -64,7 +64,6 @@ union tex_tile_address {
 
 struct softpipe_tex_cached_tile
 {
-   union tex_tile_address addr;
    union {
       float color[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
       unsigned int colorui[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
@@ -73,12 +72,23 @@ struct softpipe_tex_cached_tile
 };
 
 /*
- * The number of cache entries.
- * Should not be decreased to lower than 16, and even that
- * seems too low to avoid cache thrashing in some cases (because
- * the cache is direct mapped, see tex_cache_pos() function).
+ * The cache is set associative, with LRU replacement within a set.
+ * The number of ways is SOFTPIPE_TEX_CACHE_WAYS (4 by default), the
+ * tiles themselves are only allocated when first needed.
  */
-#define NUM_TEX_TILE_ENTRIES 16
+#define NUM_TEX_TILE_SETS 16
+#define TEX_TILE_MAX_WAYS 8
+#define NUM_TEX_TILE_ENTRIES (NUM_TEX_TILE_SETS * TEX_TILE_MAX_WAYS)
+
+
+/** Lookup counters, for tuning the cache to a workload */
+struct sp_tex_tile_cache_stats
+{
+   uint64_t hits;
+   uint64_t misses;
+   uint64_t prefetches;  /**< neighbouring tiles prefetched on misses */
+};
+
 
 struct softpipe_tex_tile_cache
 {
@@ -89,7 +99,13 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_TEX_TILE_ENTRIES];
+   unsigned ways;
+   union tex_tile_address tile_addrs[NUM_TEX_TILE_ENTRIES];
+   struct softpipe_tex_cached_tile *entries[NUM_TEX_TILE_ENTRIES];
+   unsigned last_used[NUM_TEX_TILE_ENTRIES];  /**< for LRU replacement */
+   unsigned clock;
+
+   struct softpipe_tex_cached_tile *tile;  /**< spare, for alloc failures */
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -101,7 +117,12 @@ struct softpipe_tex_tile_cache
    unsigned swizzle_a;
    enum pipe_format format;
 
-   struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
+   union tex_tile_address last_miss;  /**< to prefetch along */
+
+   struct sp_tex_tile_cache_stats stats;
+
+   union tex_tile_address last_tile_addr;
+   const struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
 };
 
 
@@ -121,6 +142,10 @@ sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc);
 extern void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc);
 
+void
+sp_tex_tile_cache_add_stats(const struct softpipe_tex_tile_cache *tc,
+                            struct sp_tex_tile_cache_stats *stats);
+
 
 
 extern const struct softpipe_tex_cached_tile *
@@ -151,8 +176,10 @@ static inline const struct softpipe_tex_cached_tile *
 sp_get_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                        union tex_tile_address addr )
 {
-   if (tc->last_tile->addr.value == addr.value)
+   if (tc->last_tile_addr.value == addr.value) {
+      tc->stats.hits++;
       return tc->last_tile;
+   }
 
    return sp_find_cached_tile_tex( tc, addr );
 }
@@ -110,6 +110,10 @@ softpipe_resource_data(struct pipe_resource *pt)
 }
 
 
+extern unsigned
+sp_get_tex_image_offset(const struct softpipe_resource *spr,
+                        unsigned level, unsigned layer);
+
 extern void
 softpipe_init_screen_texture_funcs(struct pipe_screen *screen);
 
@@ -32,6 +32,7 @@
  *    Brian Paul
  */
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
 #include "util/u_memory.h"
@@ -42,16 +43,6 @@ static struct softpipe_cached_tile *
 sp_alloc_tile(struct softpipe_tile_cache *tc);
 
 
-/**
- * Return the position in the cache for the tile that contains win pos (x,y).
- * We currently use a direct mapped cache so this is like a hack key.
- * At some point we should investige something more sophisticated, like
- * a LRU replacement policy.
- */
-#define CACHE_POS(x, y, l)                        \
-   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
-
-
 static inline int addr_to_clear_pos(union tile_address addr)
 {
    int pos;
@@ -76,14 +67,20 @@ is_clear_flag_set(const uint *bitvec, union tile_address addr, unsigned max)
 
 /**
  * Mark the tile at (x,y) as not cleared.
+ * Atomic, as the rasterizer threads may clear the flags of tiles sharing
+ * a word at the same time.
  */
 static inline void
 clear_clear_flag(uint *bitvec, union tile_address addr, unsigned max)
 {
    int pos;
+   uint *word, old;
    pos = addr_to_clear_pos(addr);
    assert(pos / 32 < max);
-   bitvec[pos / 32] &= ~(1 << (pos & 31));
+   word = &bitvec[pos / 32];
+   do {
+      old = *word;
+   } while (p_atomic_cmpxchg(word, old, old & ~(1 << (pos & 31))) != old);
 }
    
 
@@ -508,12 +505,10 @@ sp_alloc_tile(struct softpipe_tile_cache *tc)
 }
 
 /**
- * Get a tile from the cache.
- * \param x, y  position of tile, in pixels
+ * Get a tile from the cache, without updating the last tile lookup.
  */
-struct softpipe_cached_tile *
-sp_find_cached_tile(struct softpipe_tile_cache *tc, 
-                    union tile_address addr )
+static struct softpipe_cached_tile *
+find_tile(struct softpipe_tile_cache *tc, union tile_address addr)
 {
    struct pipe_transfer *pt;
    /* cache pos/entry: */
@@ -616,12 +611,61 @@ sp_find_cached_tile(struct softpipe_tile_cache *tc,
       }
    }
 
+   return tile;
+}
+
+
+/**
+ * Get a tile from the cache.
+ * \param x, y  position of tile, in pixels
+ */
+struct softpipe_cached_tile *
+sp_find_cached_tile(struct softpipe_tile_cache *tc, 
+                    union tile_address addr )
+{
+   struct softpipe_cached_tile *tile = find_tile(tc, addr);
+
    tc->last_tile = tile;
    tc->last_tile_addr = addr;
    return tile;
 }
 
 
+/**
+ * Get a tile from the cache, like sp_find_cached_tile(), but without
+ * touching the last tile lookup.  Several threads may call this at once
+ * as long as they look up tiles at different cache positions, and all
+ * those positions have been reserved with sp_tile_cache_reserve().
+ */
+struct softpipe_cached_tile *
+sp_find_cached_tile_concurrent(struct softpipe_tile_cache *tc,
+                               union tile_address addr)
+{
+   return find_tile(tc, addr);
+}
+
+
+/**
+ * Allocate the cache entry a tile goes to, if it isn't already.
+ * \return FALSE if out of memory.  The entry is then left for
+ *         sp_find_cached_tile() to take from another one, which is not
+ *         safe to do from several threads.
+ */
+boolean
+sp_tile_cache_reserve(struct softpipe_tile_cache *tc, union tile_address addr)
+{
+   const int pos = CACHE_POS(addr.bits.x,
+                             addr.bits.y, addr.bits.layer);
+
+   if (!tc->entries[pos]) {
+      tc->entries[pos] = MALLOC_STRUCT(softpipe_cached_tile);
+      if (!tc->entries[pos])
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
 
 
 
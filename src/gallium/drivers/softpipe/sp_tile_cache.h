@@ -79,6 +79,16 @@ struct softpipe_cached_tile
 #define NUM_ENTRIES 50
 
 
+/**
+ * Return the position in the cache for the tile that contains win pos (x,y).
+ * We currently use a direct mapped cache so this is like a hack key.
+ * At some point we should investige something more sophisticated, like
+ * a LRU replacement policy.
+ */
+#define CACHE_POS(x, y, l)                        \
+   (((x) + (y) * 5 + (l) * 10) % NUM_ENTRIES)
+
+
 struct softpipe_tile_cache
 {
    struct pipe_context *pipe;
@@ -127,6 +137,13 @@ extern struct softpipe_cached_tile *
 sp_find_cached_tile(struct softpipe_tile_cache *tc, 
                     union tile_address addr );
 
+extern struct softpipe_cached_tile *
+sp_find_cached_tile_concurrent(struct softpipe_tile_cache *tc,
+                               union tile_address addr);
+
+extern boolean
+sp_tile_cache_reserve(struct softpipe_tile_cache *tc, union tile_address addr);
+
 
 static inline union tile_address
 tile_address( unsigned x,
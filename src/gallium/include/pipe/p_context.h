@@ -94,6 +94,20 @@ struct pipe_context {
    /*@{*/
    void (*draw_vbo)( struct pipe_context *pipe,
                      const struct pipe_draw_info *info );
+
+   /**
+    * Draw num_draws ranges of the bound vertex and index buffers with the
+    * current state, as calling draw_vbo() for each of info[0..num_draws-1]
+    * would, but letting the driver set up the draw only once.  The draws
+    * must have the same mode, indexed and primitive restart settings, and
+    * none of them may be indirect or count from stream output.
+    *
+    * Optional, use util_draw_multi() to fall back to draw_vbo() for drivers
+    * which don't implement it.
+    */
+   void (*multi_draw)( struct pipe_context *pipe,
+                       const struct pipe_draw_info *info,
+                       unsigned num_draws );
    /*@}*/
 
    /**
@@ -386,6 +386,14 @@ struct st_context_iface
    void (*flush)(struct st_context_iface *stctxi, unsigned flags,
                  struct pipe_fence_handle **fence);
 
+   /**
+    * Wait for the commands queued on the context's GL command thread, if
+    * any, to be executed.  The pipe must not be used before this.
+    *
+    * This function is optional.
+    */
+   void (*thread_finish)(struct st_context_iface *stctxi);
+
    /**
     * Replace the texture image of a texture object at the specified level.
     *
@@ -38,9 +38,12 @@
  * With llvmpipe we could only render directly into the user's buffer when its
  * width and height is a multiple of the tile size (64 pixels).
  *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Because of these constraints we normally render into ordinary resources
+ * then copy the results to the user's buffer in the flush_front() function
+ * which is called when the app calls glFlush/Finish.  When the driver can
+ * wrap the user's buffer (resource_from_user_memory) with the stride the
+ * app asked for, and OSMESA_Y_UP is FALSE, we render into it directly and
+ * flush_front() only has to wait for rendering to finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -62,6 +65,7 @@
 #include "util/u_box.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_inlines.h"
 #include "util/u_memory.h"
 
 #include "postprocess/filters.h"
@@ -87,6 +91,9 @@ struct osmesa_buffer
 
    void *map;
 
+   /** Is the front color buffer a wrapper around the user's buffer? */
+   boolean direct;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -346,6 +353,14 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
                             &transfer);
 
+   if (osbuffer->direct && statt == ST_ATTACHMENT_FRONT_LEFT) {
+      /* Rendered in place; mapping the resource for reading was enough to
+       * wait for the rendering to land in the user's buffer.
+       */
+      pipe->transfer_unmap(pipe, transfer);
+      return TRUE;
+   }
+
    /*
     * Copy the color buffer from the resource to the user's buffer.
     */
@@ -376,6 +391,54 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
 }
 
 
+/**
+ * Try to wrap the user's buffer as the front color buffer, so that the
+ * driver renders straight into it.
+ * \return the new resource or NULL if the driver can't do that.
+ */
+static struct pipe_resource *
+osmesa_create_user_color_buffer(struct st_context_iface *stctx,
+                                struct osmesa_buffer *osbuffer,
+                                const struct pipe_resource *templat)
+{
+   OSMesaContext osmesa = (OSMesaContext) stctx->st_manager_private;
+   struct pipe_screen *screen = get_st_manager()->screen;
+   struct pipe_context *pipe = stctx->pipe;
+   struct pipe_resource *res;
+   struct pipe_transfer *transfer;
+   struct pipe_box box;
+   unsigned bpp, stride;
+
+   /* The driver only renders top-down. */
+   if (osmesa->y_up || !screen->resource_from_user_memory)
+      return NULL;
+
+   res = screen->resource_from_user_memory(screen, templat, osbuffer->map);
+   if (!res)
+      return NULL;
+
+   /* The driver picks the stride; only use the resource if it matches the
+    * layout of the user's buffer.
+    */
+   bpp = util_format_get_blocksize(templat->format);
+   stride = bpp * (osmesa->user_row_length ? osmesa->user_row_length
+                                          : osbuffer->width);
+
+   u_box_2d(0, 0, 1, 1, &box);
+   if (!pipe->transfer_map(pipe, res, 0,
+                           PIPE_TRANSFER_READ | PIPE_TRANSFER_UNSYNCHRONIZED,
+                           &box, &transfer)) {
+      pipe_resource_reference(&res, NULL);
+      return NULL;
+   }
+   if (transfer->stride != stride)
+      pipe_resource_reference(&res, NULL);
+   pipe->transfer_unmap(pipe, transfer);
+
+   return res;
+}
+
+
 /**
  * Called by the st manager to validate the framebuffer (allocate
  * its resources).
@@ -432,6 +495,16 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
 
       templat.format = format;
       templat.bind = bind;
+
+      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+         out[i] = osmesa_create_user_color_buffer(stctx, osbuffer, &templat);
+         osbuffer->direct = out[i] != NULL;
+         if (out[i]) {
+            osbuffer->textures[statts[i]] = out[i];
+            continue;
+         }
+      }
+
       out[i] = osbuffer->textures[statts[i]] =
          screen->resource_create(screen, &templat);
    }
@@ -685,6 +758,10 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
                                       osmesa->accum_format);
    }
 
+   /* A color buffer wrapping the old user buffer has to be replaced. */
+   if (osbuffer->direct && osbuffer->map != buffer)
+      p_atomic_inc(&osbuffer->stfb->stamp);
+
    osbuffer->width = width;
    osbuffer->height = height;
    osbuffer->map = buffer;
@@ -751,6 +828,10 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   /* Re-decide whether we can render directly into the user's buffer. */
+   if (osmesa->current_buffer)
+      p_atomic_inc(&osmesa->current_buffer->stfb->stamp);
 }
 
 
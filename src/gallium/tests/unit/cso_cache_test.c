@@ -0,0 +1,361 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for the CSO cache, run against a pipe
+ * context whose state functions do nothing.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_cache.h"
+#include "cso_cache/cso_context.h"
+
+
+static uintptr_t handles_created;
+static unsigned states_deleted;
+static unsigned states_bound;
+
+
+static int
+stub_get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   /* Keep u_vbuf out of the way. */
+   return param == PIPE_CAP_USER_VERTEX_BUFFERS;
+}
+
+static int
+stub_get_shader_param(struct pipe_screen *screen, unsigned shader,
+                      enum pipe_shader_cap param)
+{
+   return 0;
+}
+
+static boolean
+stub_is_format_supported(struct pipe_screen *screen,
+                         enum pipe_format format,
+                         enum pipe_texture_target target,
+                         unsigned sample_count,
+                         unsigned bindings)
+{
+   return TRUE;
+}
+
+static void *
+stub_create_blend_state(struct pipe_context *pipe,
+                        const struct pipe_blend_state *templ)
+{
+   return (void *)++handles_created;
+}
+
+static void *
+stub_create_rasterizer_state(struct pipe_context *pipe,
+                             const struct pipe_rasterizer_state *templ)
+{
+   return (void *)++handles_created;
+}
+
+static void *
+stub_create_sampler_state(struct pipe_context *pipe,
+                          const struct pipe_sampler_state *templ)
+{
+   return (void *)++handles_created;
+}
+
+static void
+stub_bind_state(struct pipe_context *pipe, void *state)
+{
+   states_bound++;
+}
+
+static void
+stub_delete_state(struct pipe_context *pipe, void *state)
+{
+   states_deleted++;
+}
+
+static void
+stub_bind_sampler_states(struct pipe_context *pipe, unsigned shader,
+                         unsigned start_slot, unsigned num_samplers,
+                         void **samplers)
+{
+}
+
+static void
+stub_set_constant_buffer(struct pipe_context *pipe, uint shader, uint index,
+                         struct pipe_constant_buffer *buf)
+{
+}
+
+static void
+stub_set_index_buffer(struct pipe_context *pipe,
+                      const struct pipe_index_buffer *ib)
+{
+}
+
+
+static void
+init_stub_pipe(struct pipe_screen *screen, struct pipe_context *pipe)
+{
+   memset(screen, 0, sizeof *screen);
+   screen->get_param = stub_get_param;
+   screen->get_shader_param = stub_get_shader_param;
+   screen->is_format_supported = stub_is_format_supported;
+
+   memset(pipe, 0, sizeof *pipe);
+   pipe->screen = screen;
+   pipe->create_blend_state = stub_create_blend_state;
+   pipe->bind_blend_state = stub_bind_state;
+   pipe->delete_blend_state = stub_delete_state;
+   pipe->create_rasterizer_state = stub_create_rasterizer_state;
+   pipe->bind_rasterizer_state = stub_bind_state;
+   pipe->delete_rasterizer_state = stub_delete_state;
+   pipe->create_sampler_state = stub_create_sampler_state;
+   pipe->bind_sampler_states = stub_bind_sampler_states;
+   pipe->delete_sampler_state = stub_delete_state;
+   pipe->bind_depth_stencil_alpha_state = stub_bind_state;
+   pipe->bind_fs_state = stub_bind_state;
+   pipe->bind_vs_state = stub_bind_state;
+   pipe->bind_vertex_elements_state = stub_bind_state;
+   pipe->set_constant_buffer = stub_set_constant_buffer;
+   pipe->set_index_buffer = stub_set_index_buffer;
+}
+
+
+static struct cso_rasterizer *
+new_rasterizer(unsigned i)
+{
+   struct cso_rasterizer *cso = CALLOC_STRUCT(cso_rasterizer);
+
+   cso->state.line_width = (float)i;
+   cso->data = (void *)++handles_created;
+   cso->delete_state = (cso_state_callback)stub_delete_state;
+   return cso;
+}
+
+
+/**
+ * Fill a small cache well past its maximum size while looking up one
+ * state all along; the cache must stay bounded and keep that state.
+ */
+static boolean
+test_lru_eviction(void)
+{
+   const unsigned max_size = 16;
+   struct cso_cache *cache = cso_cache_create();
+   struct cso_rasterizer *hot = new_rasterizer(0);
+   unsigned hash = cso_construct_key(&hot->state, sizeof hot->state);
+   unsigned deleted_before = states_deleted;
+   boolean success = TRUE;
+   unsigned i;
+
+   cso_set_maximum_cache_size(cache, max_size);
+   cso_insert_state(cache, hash, CSO_RASTERIZER, hot);
+
+   for (i = 1; i < 1000; i++) {
+      struct cso_rasterizer *cso = new_rasterizer(i);
+
+      cso_insert_state(cache, cso_construct_key(&cso->state,
+                                                sizeof cso->state),
+                       CSO_RASTERIZER, cso);
+
+      if (cso_find_state_template(cache, hash, CSO_RASTERIZER, &hot->state,
+                                  sizeof hot->state) != hot) {
+         printf("lru: most recently used state evicted after %u inserts\n",
+                i);
+         success = FALSE;
+         break;
+      }
+      if (cso_find_state_template(cache, cso_construct_key(&cso->state,
+                                                           sizeof cso->state),
+                                  CSO_RASTERIZER, &cso->state,
+                                  sizeof cso->state) != cso) {
+         printf("lru: state %u not found\n", i);
+         success = FALSE;
+         break;
+      }
+   }
+
+   if (success && i - (states_deleted - deleted_before) > max_size) {
+      printf("lru: %u states still cached, maximum is %u\n",
+             i - (states_deleted - deleted_before), max_size);
+      success = FALSE;
+   }
+
+   cso_cache_delete(cache);
+   return success;
+}
+
+
+/**
+ * Setting the bound state again must not bind anything, and restoring
+ * must rebind the saved state.
+ */
+static boolean
+test_redundant_binds(struct pipe_context *pipe)
+{
+   struct cso_context *cso = cso_create_context(pipe);
+   struct pipe_rasterizer_state a, b;
+   unsigned bound;
+   boolean success = TRUE;
+
+   memset(&a, 0, sizeof a);
+   memset(&b, 0, sizeof b);
+   b.flatshade = 1;
+
+   cso_set_rasterizer(cso, &a);
+   bound = states_bound;
+   cso_set_rasterizer(cso, &a);
+   if (states_bound != bound) {
+      printf("redundant rasterizer bound again\n");
+      success = FALSE;
+   }
+
+   cso_save_rasterizer(cso);
+   cso_set_rasterizer(cso, &b);
+   cso_restore_rasterizer(cso);
+   bound = states_bound;
+   cso_set_rasterizer(cso, &a);
+   cso_set_rasterizer(cso, &b);
+   if (states_bound != bound + 1) {
+      printf("restored rasterizer not tracked\n");
+      success = FALSE;
+   }
+
+   cso_destroy_context(cso);
+   return success;
+}
+
+
+static void
+report(const char *name, unsigned calls, int64_t start)
+{
+   double secs = (os_time_get_nano() - start) / 1e9;
+
+   printf("%-40s %8.2f M calls/s\n", name, calls / secs / 1e6);
+}
+
+static void
+benchmark(struct pipe_context *pipe)
+{
+   const unsigned calls = 4000000;
+   const unsigned many = 8192;
+   struct cso_context *cso = cso_create_context(pipe);
+   struct pipe_rasterizer_state *rast = CALLOC(many, sizeof *rast);
+   struct pipe_blend_state blend[8];
+   struct pipe_sampler_state sampler[16];
+   int64_t start;
+   unsigned i, j;
+
+   for (i = 0; i < many; i++) {
+      rast[i].line_width = (float)i;
+      rast[i].point_size = 1.0f;
+   }
+   memset(blend, 0, sizeof blend);
+   for (i = 0; i < 8; i++)
+      blend[i].rt[0].colormask = i;
+   memset(sampler, 0, sizeof sampler);
+   for (i = 0; i < 16; i++)
+      sampler[i].max_anisotropy = i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls; i++)
+      cso_set_rasterizer(cso, &rast[0]);
+   report("cso_set_rasterizer, same state", calls, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls; i++)
+      cso_set_blend(cso, &blend[i & 7]);
+   report("cso_set_blend, 8 states", calls, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls; i++)
+      cso_set_rasterizer(cso, &rast[i & 255]);
+   report("cso_set_rasterizer, 256 states", calls, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls; i++)
+      cso_set_rasterizer(cso, &rast[i % many]);
+   report("cso_set_rasterizer, 8192 states", calls, start);
+
+   /* Mostly a few states with the occasional rarely used one, which is
+    * what keeps a least recently used cache ahead of random eviction.
+    */
+   start = os_time_get_nano();
+   for (i = 0, j = 1; i < calls; i++) {
+      j = j * 1103515245 + 12345;
+      cso_set_rasterizer(cso, &rast[(j >> 16) % 10 ? (j >> 8) & 31 :
+                                    (j >> 4) % many]);
+   }
+   report("cso_set_rasterizer, 32 hot + 8192 cold", calls, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls / 16; i++) {
+      for (j = 0; j < 16; j++)
+         cso_single_sampler(cso, PIPE_SHADER_FRAGMENT, j,
+                            &sampler[(i + j) & 15]);
+      cso_single_sampler_done(cso, PIPE_SHADER_FRAGMENT);
+   }
+   report("cso_single_sampler, 16 rotating states", calls, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < calls / 16; i++) {
+      for (j = 0; j < 16; j++)
+         cso_single_sampler(cso, PIPE_SHADER_FRAGMENT, j, &sampler[j]);
+      cso_single_sampler_done(cso, PIPE_SHADER_FRAGMENT);
+   }
+   report("cso_single_sampler, 16 unchanged states", calls, start);
+
+   cso_destroy_context(cso);
+   FREE(rast);
+}
+
+
+int main(int argc, char **argv)
+{
+   struct pipe_screen screen;
+   struct pipe_context pipe;
+   boolean success = TRUE;
+
+   init_stub_pipe(&screen, &pipe);
+
+   success &= test_lru_eviction();
+   success &= test_redundant_binds(&pipe);
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark(&pipe);
+
+   return success ? 0 : 1;
+}
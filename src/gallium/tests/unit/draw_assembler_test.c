@@ -0,0 +1,293 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for the draw module's primitive assembler,
+ * which breaks up adjacency primitives drawn without a geometry shader.
+ * Primitives indexing the shaded vertices must render the same as ones
+ * with their vertices copied (DRAW_IA_COPY_VERTS), without copying any.
+ * Pass -b to compare triangles/second.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_prim.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+#include "draw/draw_context.h"
+#include "softpipe/sp_context.h"
+
+#include "sp_test_context.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+#define NUM_VERTS 6000
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   void *vs;
+   void *fs;
+   uint32_t pixels[WIDTH * HEIGHT];
+};
+
+
+static uint32_t indices[NUM_VERTS];
+
+
+static void
+init_prog(struct program *p, const char *copy_verts)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_VERTS, sizeof *vertices);
+   unsigned seed = 1;
+   unsigned i, j;
+
+   /* Small random triangles, each vertex of a random color, so that
+    * flat shading shows which vertex provoked a primitive.
+    */
+   for (i = 0; i < NUM_VERTS; i++) {
+      float *pos = vertices[i][0];
+      float *col = vertices[i][1];
+
+      for (j = 0; j < 2; j++) {
+         seed = seed * 1103515245 + 12345;
+         pos[j] = ((seed >> 16) & 0xffff) / 32767.5f - 1.0f;
+      }
+      pos[2] = 0.5f;
+      pos[3] = 1.0f;
+
+      for (j = 0; j < 3; j++) {
+         seed = seed * 1103515245 + 12345;
+         col[j] = ((seed >> 16) & 0xff) / 255.0f;
+      }
+      col[3] = 1.0f;
+   }
+
+   /* The draw module picks this up when softpipe creates it. */
+   setenv("DRAW_IA_COPY_VERTS", copy_verts, 1);
+
+   sp_test_context_init(&p->ctx, WIDTH, HEIGHT, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_NONE, vertices,
+                        NUM_VERTS * sizeof *vertices);
+   FREE(vertices);
+
+   p->ctx.rasterizer.flatshade = 1;
+   p->ctx.rasterizer.line_width = 1.0f;
+   cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_passthrough_shader(p->ctx.pipe,
+                                                 TGSI_SEMANTIC_COLOR,
+                                                 TGSI_INTERPOLATE_CONSTANT,
+                                                 TRUE);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw(struct program *p, unsigned mode, boolean indexed,
+     struct draw_assembler_stats *stats)
+{
+   struct pipe_draw_info info;
+
+   util_draw_init_info(&info);
+   info.mode = mode;
+   info.count = NUM_VERTS;
+   info.max_index = NUM_VERTS - 1;
+
+   if (indexed) {
+      struct pipe_index_buffer ib;
+
+      memset(&ib, 0, sizeof(ib));
+      ib.index_size = 4;
+      ib.user_buffer = indices;
+      p->ctx.pipe->set_index_buffer(p->ctx.pipe, &ib);
+      info.indexed = TRUE;
+   }
+
+   cso_draw_vbo(p->ctx.cso, &info);
+
+   if (stats)
+      draw_get_assembler_stats(softpipe_context(p->ctx.pipe)->draw, stats);
+}
+
+
+/* Clear, draw and read back the rendered pixels into p->pixels. */
+static void
+render(struct program *p, unsigned mode, boolean indexed,
+       struct draw_assembler_stats *stats)
+{
+   sp_test_context_clear(&p->ctx);
+   draw(p, mode, indexed, stats);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+
+   sp_test_context_read(&p->ctx, p->pixels);
+}
+
+
+static const unsigned modes[] = {
+   PIPE_PRIM_LINES_ADJACENCY,
+   PIPE_PRIM_LINE_STRIP_ADJACENCY,
+   PIPE_PRIM_TRIANGLES_ADJACENCY,
+   PIPE_PRIM_TRIANGLE_STRIP_ADJACENCY,
+};
+
+
+/*
+ * Draw every adjacency primitive type, from the vertex buffer and through
+ * an index buffer, with both programs and compare.
+ */
+static boolean
+test_assembler(struct program *indexing, struct program *copying)
+{
+   boolean success = TRUE;
+   unsigned m, indexed;
+
+   for (m = 0; m < Elements(modes); m++) {
+      for (indexed = 0; indexed < 2; indexed++) {
+         const unsigned prims = u_decomposed_prims_for_vertices(modes[m],
+                                                                NUM_VERTS);
+         const unsigned verts =
+            prims * u_vertices_per_prim(u_reduced_prim(modes[m]));
+         struct draw_assembler_stats stats, copy_stats;
+         const char *name = u_prim_name(modes[m]);
+
+         render(indexing, modes[m], indexed, &stats);
+         render(copying, modes[m], indexed, &copy_stats);
+
+         if (memcmp(indexing->pixels, copying->pixels,
+                    sizeof(indexing->pixels)) != 0) {
+            printf("%s%s rendered differently with indexed primitives\n",
+                   name, indexed ? ", indexed" : "");
+            success = FALSE;
+         }
+
+         if (stats.primitives != prims || stats.copied_vertices != 0 ||
+             copy_stats.primitives != prims ||
+             copy_stats.copied_vertices != verts) {
+            printf("%s%s: %u primitives, %u copied vertices, "
+                   "%u copying, %u copied vertices\n",
+                   name, indexed ? ", indexed" : "",
+                   stats.primitives, stats.copied_vertices,
+                   copy_stats.primitives, copy_stats.copied_vertices);
+            success = FALSE;
+         }
+      }
+   }
+
+   return success;
+}
+
+
+static void
+benchmark(struct program *indexing, struct program *copying)
+{
+   const unsigned frames = 100;
+   const unsigned mode = PIPE_PRIM_TRIANGLE_STRIP_ADJACENCY;
+   struct program *p[2] = { copying, indexing };
+   unsigned i, j;
+
+   for (i = 0; i < 2; i++) {
+      struct draw_assembler_stats stats;
+      int64_t start;
+      double secs;
+
+      /* Measure vertex processing and assembly, not rasterization. */
+      p[i]->ctx.rasterizer.rasterizer_discard = 1;
+      cso_set_rasterizer(p[i]->ctx.cso, &p[i]->ctx.rasterizer);
+
+      start = os_time_get_nano();
+      for (j = 0; j < frames; j++) {
+         draw(p[i], mode, FALSE, &stats);
+         p[i]->ctx.pipe->flush(p[i]->ctx.pipe, NULL, 0);
+      }
+      secs = (os_time_get_nano() - start) / 1e9;
+
+      printf("%-20s %8.2f K triangles/s, %u vertices copied per draw\n",
+             i ? "indexed primitives" : "copied vertices",
+             frames * stats.primitives / secs / 1e3,
+             stats.copied_vertices);
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   struct program *indexing = CALLOC_STRUCT(program);
+   struct program *copying = CALLOC_STRUCT(program);
+   boolean success;
+   unsigned i;
+
+   for (i = 0; i < NUM_VERTS; i++)
+      indices[i] = (i * 7919) % NUM_VERTS;
+
+   init_prog(indexing, "0");
+   init_prog(copying, "1");
+
+   success = test_assembler(indexing, copying);
+   printf("%s\n", success ? "PASS" : "FAIL");
+
+   if (argc > 1 && !strcmp(argv[1], "-b"))
+      benchmark(indexing, copying);
+
+   close_prog(indexing);
+   close_prog(copying);
+   FREE(indexing);
+   FREE(copying);
+
+   return success ? 0 : 1;
+}
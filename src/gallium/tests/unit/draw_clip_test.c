@@ -0,0 +1,323 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for the draw module's post-transform
+ * cliptest and guard band, run against softpipe.  Large triangles reaching
+ * past the viewport must render the same through the SSE and the scalar
+ * cliptest, and about the same with the guard band enabled, with fewer
+ * triangles being clipped.  Pass -b to compare triangles/second.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+#include "draw/draw_context.h"
+#include "softpipe/sp_context.h"
+
+#include "sp_test_context.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+#define NUM_TRIS 2000
+#define NUM_VERTS (NUM_TRIS * 3)
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   void *vs;
+   void *fs;
+   uint32_t pixels[WIDTH * HEIGHT];
+};
+
+
+static void
+init_prog(struct program *p)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_VERTS, sizeof *vertices);
+   unsigned seed = 1;
+   unsigned i, j;
+
+   /* Random triangles of a random color each, a quarter of them within
+    * the viewport, half reaching into the guard band and the rest past it.
+    */
+   for (i = 0; i < NUM_TRIS; i++) {
+      static const float extent[4] = { 0.9f, 1.9f, 1.9f, 4.0f };
+      const float e = extent[i % 4];
+      float color[3];
+
+      for (j = 0; j < 3; j++) {
+         seed = seed * 1103515245 + 12345;
+         color[j] = ((seed >> 16) & 0xff) / 255.0f;
+      }
+
+      for (j = 0; j < 3; j++) {
+         float *pos = vertices[i * 3 + j][0];
+         float *col = vertices[i * 3 + j][1];
+         const float w = 1.0f + (j & 1);
+
+         seed = seed * 1103515245 + 12345;
+         pos[0] = (((seed >> 16) & 0xffff) / 32767.5f - 1.0f) * e * w;
+         seed = seed * 1103515245 + 12345;
+         pos[1] = (((seed >> 16) & 0xffff) / 32767.5f - 1.0f) * e * w;
+         pos[2] = 0.5f * w;
+         pos[3] = w;
+         col[0] = color[0];
+         col[1] = color[1];
+         col[2] = color[2];
+         col[3] = 1.0f;
+      }
+   }
+
+   /* The viewport covers the whole render target, so that softpipe's
+    * framebuffer bounds do the scissoring a guard band needs.
+    */
+   sp_test_context_init(&p->ctx, WIDTH, HEIGHT, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_NONE, vertices,
+                        NUM_VERTS * sizeof *vertices);
+   FREE(vertices);
+
+   p->ctx.rasterizer.flatshade = 1;
+   cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_passthrough_shader(p->ctx.pipe,
+                                                 TGSI_SEMANTIC_COLOR,
+                                                 TGSI_INTERPOLATE_CONSTANT,
+                                                 TRUE);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+/* Select the SSE or the scalar cliptest, and whether to use a guard band. */
+static void
+set_mode(struct program *p, boolean sse, boolean guard_band)
+{
+   util_cpu_caps.has_sse2 = sse;
+   draw_set_driver_clipping(softpipe_context(p->ctx.pipe)->draw,
+                            FALSE, FALSE, guard_band, FALSE);
+}
+
+
+static void
+draw(struct program *p, struct draw_clip_stats *stats)
+{
+   struct pipe_draw_info info;
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.count = NUM_VERTS;
+   info.max_index = NUM_VERTS - 1;
+
+   cso_draw_vbo(p->ctx.cso, &info);
+
+   if (stats)
+      draw_get_clip_stats(softpipe_context(p->ctx.pipe)->draw, stats);
+}
+
+
+/* Clear, draw and read back the rendered pixels into p->pixels. */
+static void
+render(struct program *p, struct draw_clip_stats *stats)
+{
+   sp_test_context_clear(&p->ctx);
+   draw(p, stats);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+
+   sp_test_context_read(&p->ctx, p->pixels);
+}
+
+
+static boolean
+test_clipping(struct program *p)
+{
+   static uint32_t expected[WIDTH * HEIGHT];
+   struct draw_context *draw = softpipe_context(p->ctx.pipe)->draw;
+   struct draw_clip_stats stats, gb_stats;
+   boolean success = TRUE;
+   unsigned i, sse, diffs = 0;
+
+   draw_collect_clip_stats(draw, TRUE);
+
+   /* The scalar code is the reference. */
+   set_mode(p, FALSE, FALSE);
+   render(p, &stats);
+   memcpy(expected, p->pixels, sizeof(expected));
+
+   set_mode(p, TRUE, FALSE);
+   render(p, NULL);
+   if (memcmp(expected, p->pixels, sizeof(expected)) != 0) {
+      printf("SSE cliptest rendered differently\n");
+      success = FALSE;
+   }
+
+   if (stats.clipped == 0 || stats.guard_band != 0) {
+      printf("without guard band: %u clipped, %u guard band triangles\n",
+             stats.clipped, stats.guard_band);
+      success = FALSE;
+   }
+
+   set_mode(p, FALSE, TRUE);
+   render(p, &gb_stats);
+   memcpy(expected, p->pixels, sizeof(expected));
+
+   set_mode(p, TRUE, TRUE);
+   render(p, NULL);
+   if (memcmp(expected, p->pixels, sizeof(expected)) != 0) {
+      printf("SSE cliptest rendered differently with guard band\n");
+      success = FALSE;
+   }
+
+   if (gb_stats.clipped >= stats.clipped || gb_stats.guard_band == 0) {
+      printf("with guard band: %u clipped, %u guard band triangles\n",
+             gb_stats.clipped, gb_stats.guard_band);
+      success = FALSE;
+   }
+
+   /* Without counting them, the guard band triangles skip the pipeline
+    * unless their segment needs it anyway.
+    */
+   draw_collect_clip_stats(draw, FALSE);
+   for (sse = 0; sse < 2; sse++) {
+      set_mode(p, sse, TRUE);
+      render(p, NULL);
+      if (memcmp(expected, p->pixels, sizeof(expected)) != 0) {
+         printf("%s cliptest rendered differently with guard band, "
+                "without clip stats\n", sse ? "SSE" : "scalar");
+         success = FALSE;
+      }
+   }
+
+   /* Clipping may move the edges a bit, but no more than that. */
+   set_mode(p, TRUE, FALSE);
+   render(p, NULL);
+   for (i = 0; i < WIDTH * HEIGHT; i++) {
+      if (p->pixels[i] != expected[i])
+         diffs++;
+   }
+   if (diffs > WIDTH * HEIGHT / 100) {
+      printf("guard band changed %u of %u pixels\n", diffs, WIDTH * HEIGHT);
+      success = FALSE;
+   }
+
+   return success;
+}
+
+
+static void
+benchmark(struct program *p)
+{
+   static const struct {
+      const char *name;
+      boolean sse;
+      boolean guard_band;
+   } modes[] = {
+      { "scalar cliptest", FALSE, FALSE },
+      { "SSE cliptest", TRUE, FALSE },
+      { "SSE cliptest, guard band", TRUE, TRUE },
+   };
+   const unsigned frames = 50;
+   unsigned m, i;
+
+   /* Measure vertex processing and clipping, not rasterization, nor
+    * counting the guard band triangles.
+    */
+   draw_collect_clip_stats(softpipe_context(p->ctx.pipe)->draw, FALSE);
+   p->ctx.rasterizer.rasterizer_discard = 1;
+   cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+
+   for (m = 0; m < Elements(modes); m++) {
+      struct draw_clip_stats stats;
+      int64_t start;
+      double secs;
+
+      set_mode(p, modes[m].sse, modes[m].guard_band);
+
+      start = os_time_get_nano();
+      for (i = 0; i < frames; i++) {
+         draw(p, &stats);
+         p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+      }
+      secs = (os_time_get_nano() - start) / 1e9;
+
+      printf("%-28s %8.2f K triangles/s, %u clipped\n",
+             modes[m].name, frames * NUM_TRIS / secs / 1e3, stats.clipped);
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   boolean success = TRUE;
+
+   util_cpu_detect();
+
+   init_prog(p);
+
+   success &= test_clipping(p);
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark(p);
+
+   close_prog(p);
+   FREE(p);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,392 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for running geometry shaders on the draw
+ * module's vertex processing threads (DRAW_NUM_THREADS), against softpipe:
+ * a draw of many overlapping triangles, through a geometry shader that
+ * emits two triangles for each, one of them colored by its primitive ID,
+ * must render the same and count the same pipeline statistics with and
+ * without threads.  Pass -b to also measure input primitives/second
+ * against the number of threads (up to one less than the number of CPUs,
+ * or the number following -b), with a geometry shader heavy enough for it
+ * to dominate.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+
+#include "sp_test_context.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+#define NUM_TRIS 20000
+#define NUM_VERTS (NUM_TRIS * 3)
+
+/* Dependent MADs in the geometry shader, for the benchmark */
+#define NUM_MADS 64
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   struct pipe_resource *ibuf;
+   void *vs;
+   void *gs;
+   void *fs;
+};
+
+
+/*
+ * Emit each triangle with its blue channel replaced by its primitive ID
+ * modulo 256, then again shifted right by a quarter of the viewport.
+ */
+static void *
+create_gs(struct pipe_context *pipe, unsigned num_mads)
+{
+   static const char header[] =
+      "GEOM\n"
+      "PROPERTY GS_INPUT_PRIMITIVE TRIANGLES\n"
+      "PROPERTY GS_OUTPUT_PRIMITIVE TRIANGLE_STRIP\n"
+      "PROPERTY GS_MAX_OUTPUT_VERTICES 6\n"
+      "DCL IN[][0], POSITION\n"
+      "DCL IN[][1], COLOR\n"
+      "DCL IN[][2], PRIM_ID\n"
+      "DCL OUT[0], POSITION\n"
+      "DCL OUT[1], COLOR\n"
+      "DCL TEMP[0..1]\n"
+      "IMM[0] FLT32 { 0.00390625, 0.5, 0.5, 0.0 }\n"
+      "IMM[1] INT32 { 0, 0, 0, 0 }\n"
+      "  0: U2F TEMP[0].x, IN[0][2].xxxx\n"
+      "     MUL TEMP[0].x, TEMP[0].xxxx, IMM[0].xxxx\n"
+      "     FRC TEMP[0].x, TEMP[0].xxxx\n"
+      "     MOV TEMP[1], IN[0][1]\n";
+   static const char mad[] =
+      "     MAD TEMP[1], TEMP[1], IMM[0].yyyy, IMM[0].zzzz\n";
+   static const char footer[] =
+      "     MOV TEMP[1].z, TEMP[0].xxxx\n"
+      "     MOV OUT[0], IN[0][0]\n"
+      "     MOV OUT[1], TEMP[1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     MOV OUT[0], IN[1][0]\n"
+      "     MOV OUT[1], TEMP[1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     MOV OUT[0], IN[2][0]\n"
+      "     MOV OUT[1], TEMP[1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     ENDPRIM IMM[1].xxxx\n"
+      "     ADD OUT[0], IN[0][0], IMM[0].yzww\n"
+      "     MOV OUT[1], IN[0][1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     ADD OUT[0], IN[1][0], IMM[0].yzww\n"
+      "     MOV OUT[1], IN[1][1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     ADD OUT[0], IN[2][0], IMM[0].yzww\n"
+      "     MOV OUT[1], IN[2][1]\n"
+      "     EMIT IMM[1].xxxx\n"
+      "     ENDPRIM IMM[1].xxxx\n"
+      "     END\n";
+   char text[sizeof header + NUM_MADS * sizeof mad + sizeof footer];
+   struct tgsi_token tokens[1000];
+   struct pipe_shader_state state;
+   unsigned i;
+
+   strcpy(text, header);
+   for (i = 0; i < num_mads; i++)
+      strcat(text, mad);
+   strcat(text, footer);
+
+   if (!tgsi_text_translate(text, tokens, Elements(tokens)))
+      return NULL;
+
+   memset(&state, 0, sizeof(state));
+   state.tokens = tokens;
+   return pipe->create_gs_state(pipe, &state);
+}
+
+
+static void
+init_prog(struct program *p, unsigned num_threads, boolean heavy)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_VERTS, sizeof *vertices);
+   uint32_t *indices = CALLOC(NUM_VERTS, sizeof *indices);
+   struct pipe_context *pipe;
+   char value[16];
+   unsigned seed = 1;
+   unsigned i, j;
+
+   /* Random, largish triangles of a random color each. */
+   for (i = 0; i < NUM_TRIS; i++) {
+      float color[3];
+
+      for (j = 0; j < 3; j++) {
+         seed = seed * 1103515245 + 12345;
+         color[j] = ((seed >> 16) & 0xff) / 255.0f;
+      }
+
+      /* Stored backwards, and drawn through reversed indices, so that
+       * fetches aren't simply linear.
+       */
+      for (j = 0; j < 3; j++) {
+         unsigned v = NUM_VERTS - 1 - (i * 3 + j);
+         float *pos = vertices[v][0];
+
+         seed = seed * 1103515245 + 12345;
+         pos[0] = ((seed >> 16) & 0x3ff) / 512.0f - 1.0f;
+         seed = seed * 1103515245 + 12345;
+         pos[1] = ((seed >> 16) & 0x3ff) / 512.0f - 1.0f;
+         pos[2] = 0.0f;
+         pos[3] = 1.0f;
+         memcpy(vertices[v][1], color, sizeof color);
+         vertices[v][1][3] = 1.0f;
+
+         indices[i * 3 + j] = v;
+      }
+   }
+
+   /* The draw module picks this up when softpipe creates it. */
+   snprintf(value, sizeof value, "%u", num_threads);
+   setenv("DRAW_NUM_THREADS", value, 1);
+
+   sp_test_context_init(&p->ctx, WIDTH, HEIGHT, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_NONE, vertices,
+                        NUM_VERTS * sizeof *vertices);
+   pipe = p->ctx.pipe;
+   FREE(vertices);
+
+   p->ibuf = pipe_buffer_create(p->ctx.screen, PIPE_BIND_INDEX_BUFFER,
+                                PIPE_USAGE_DEFAULT,
+                                NUM_VERTS * sizeof *indices);
+   pipe_buffer_write(pipe, p->ibuf, 0, NUM_VERTS * sizeof *indices,
+                     indices);
+   FREE(indices);
+
+   /* The benchmark culls everything, to measure the shaders only. */
+   if (heavy) {
+      p->ctx.rasterizer.cull_face = PIPE_FACE_FRONT_AND_BACK;
+      cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+   }
+
+   p->vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->gs = create_gs(pipe, heavy ? NUM_MADS : 0);
+   p->fs = util_make_fragment_passthrough_shader(pipe,
+                                                 TGSI_SEMANTIC_COLOR,
+                                                 TGSI_INTERPOLATE_PERSPECTIVE,
+                                                 TRUE);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_geometry_shader_handle(p->ctx.cso, p->gs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_geometry_shader(p->ctx.cso, p->gs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+   pipe_resource_reference(&p->ibuf, NULL);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw(struct program *p, boolean indexed)
+{
+   struct pipe_draw_info info;
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.count = NUM_VERTS;
+   info.max_index = NUM_VERTS - 1;
+
+   if (indexed) {
+      struct pipe_index_buffer ib;
+
+      memset(&ib, 0, sizeof(ib));
+      ib.index_size = 4;
+      ib.buffer = p->ibuf;
+      p->ctx.pipe->set_index_buffer(p->ctx.pipe, &ib);
+      info.indexed = TRUE;
+   }
+
+   cso_draw_vbo(p->ctx.cso, &info);
+}
+
+
+/*
+ * Clear, draw and return a checksum of the rendered pixels, and the
+ * draw's pipeline statistics.
+ */
+static unsigned
+render(struct program *p, boolean indexed,
+       struct pipe_query_data_pipeline_statistics *stats)
+{
+   struct pipe_context *pipe = p->ctx.pipe;
+   struct pipe_query *query;
+   union pipe_query_result result;
+
+   sp_test_context_clear(&p->ctx);
+
+   query = pipe->create_query(pipe, PIPE_QUERY_PIPELINE_STATISTICS, 0);
+   pipe->begin_query(pipe, query);
+   draw(p, indexed);
+   pipe->end_query(pipe, query);
+   pipe->flush(pipe, NULL, 0);
+
+   pipe->get_query_result(pipe, query, TRUE, &result);
+   *stats = result.pipeline_statistics;
+   pipe->destroy_query(pipe, query);
+
+   return sp_test_context_checksum(&p->ctx, p->ctx.target);
+}
+
+
+static boolean
+test_same_rendering(void)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   struct pipe_query_data_pipeline_statistics expected_stats[2];
+   unsigned expected[2];
+   boolean success = TRUE;
+   unsigned i, threads;
+
+   init_prog(p, 0, FALSE);
+   for (i = 0; i < 2; i++)
+      expected[i] = render(p, i, &expected_stats[i]);
+   close_prog(p);
+
+   for (i = 0; i < 2; i++) {
+      if (expected_stats[i].gs_invocations != NUM_TRIS ||
+          expected_stats[i].gs_primitives != 2 * NUM_TRIS) {
+         printf("%s draw counted %u GS invocations, %u GS primitives\n",
+                i ? "indexed" : "linear",
+                (unsigned) expected_stats[i].gs_invocations,
+                (unsigned) expected_stats[i].gs_primitives);
+         success = FALSE;
+      }
+   }
+
+   for (threads = 1; threads <= 4; threads++) {
+      init_prog(p, threads, FALSE);
+      for (i = 0; i < 2; i++) {
+         struct pipe_query_data_pipeline_statistics stats;
+         unsigned sum = render(p, i, &stats);
+
+         if (sum != expected[i]) {
+            printf("%s draw with %u threads rendered differently: "
+                   "%08x vs %08x\n", i ? "indexed" : "linear",
+                   threads, sum, expected[i]);
+            success = FALSE;
+         }
+         if (memcmp(&stats, &expected_stats[i], sizeof stats) != 0) {
+            printf("%s draw with %u threads counted different pipeline "
+                   "statistics\n", i ? "indexed" : "linear", threads);
+            success = FALSE;
+         }
+      }
+      close_prog(p);
+   }
+
+   FREE(p);
+   return success;
+}
+
+
+static void
+benchmark(unsigned max_threads)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   const unsigned frames = 10;
+   unsigned threads, i;
+
+   for (threads = 0; threads <= max_threads; threads++) {
+      int64_t start;
+      double secs;
+
+      init_prog(p, threads, TRUE);
+
+      start = os_time_get_nano();
+      for (i = 0; i < frames; i++) {
+         draw(p, TRUE);
+         p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+      }
+      secs = (os_time_get_nano() - start) / 1e9;
+
+      printf("%u worker threads %8.2f M GS primitives/s\n",
+             threads, frames * NUM_TRIS / secs / 1e6);
+
+      close_prog(p);
+   }
+
+   FREE(p);
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_same_rendering();
+
+   /* -b [max worker threads] */
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      unsigned max_threads;
+
+      util_cpu_detect();
+      max_threads = MIN2(util_cpu_caps.nr_cpus, 8) - 1;
+      if (argc > 2)
+         max_threads = MIN2(atoi(argv[2]), 7);
+
+      benchmark(max_threads);
+   }
+
+   return success ? 0 : 1;
+}
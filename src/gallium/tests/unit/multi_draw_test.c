@@ -0,0 +1,215 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for pipe_context::multi_draw, run against
+ * softpipe: many small draws must render the same through multi_draw as
+ * through one draw_vbo call each.  Pass -b to also compare draws/second.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+
+#include "sp_test_context.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+#define NUM_DRAWS 256
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   void *vs;
+   void *fs;
+   struct pipe_draw_info draws[NUM_DRAWS];
+};
+
+
+static void
+init_prog(struct program *p)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_DRAWS * 3, sizeof *vertices);
+   unsigned i, j;
+
+   /* One small triangle per draw, in rows over the render target. */
+   for (i = 0; i < NUM_DRAWS; i++) {
+      float x = -1.0f + (i % 16) / 8.0f;
+      float y = -1.0f + (i / 16) / 8.0f;
+
+      for (j = 0; j < 3; j++) {
+         vertices[i * 3 + j][0][0] = x + (j == 1 ? 0.1f : 0.0f);
+         vertices[i * 3 + j][0][1] = y + (j == 2 ? 0.1f : 0.0f);
+         vertices[i * 3 + j][0][2] = 0.0f;
+         vertices[i * 3 + j][0][3] = 1.0f;
+         vertices[i * 3 + j][1][0] = (i & 7) / 7.0f;
+         vertices[i * 3 + j][1][1] = j / 2.0f;
+         vertices[i * 3 + j][1][2] = (i >> 3) / 31.0f;
+         vertices[i * 3 + j][1][3] = 1.0f;
+      }
+
+      util_draw_init_info(&p->draws[i]);
+      p->draws[i].mode = PIPE_PRIM_TRIANGLES;
+      p->draws[i].start = i * 3;
+      p->draws[i].count = 3;
+      p->draws[i].min_index = i * 3;
+      p->draws[i].max_index = i * 3 + 2;
+   }
+
+   sp_test_context_init(&p->ctx, WIDTH, HEIGHT, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_NONE, vertices,
+                        NUM_DRAWS * 3 * sizeof *vertices);
+   FREE(vertices);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_passthrough_shader(p->ctx.pipe,
+                                                 TGSI_SEMANTIC_COLOR,
+                                                 TGSI_INTERPOLATE_PERSPECTIVE,
+                                                 TRUE);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw_frame(struct program *p, boolean multi)
+{
+   unsigned i;
+
+   if (multi) {
+      cso_multi_draw(p->ctx.cso, p->draws, NUM_DRAWS);
+   } else {
+      for (i = 0; i < NUM_DRAWS; i++)
+         cso_draw_vbo(p->ctx.cso, &p->draws[i]);
+   }
+}
+
+
+/* Clear, draw and return a checksum of the rendered pixels. */
+static unsigned
+render(struct program *p, boolean multi)
+{
+   sp_test_context_clear(&p->ctx);
+   draw_frame(p, multi);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+
+   return sp_test_context_checksum(&p->ctx, p->ctx.target);
+}
+
+
+static boolean
+test_same_rendering(struct program *p)
+{
+   unsigned single = render(p, FALSE);
+   unsigned multi = render(p, TRUE);
+
+   if (single != multi) {
+      printf("multi_draw rendered differently: %08x vs %08x\n",
+             multi, single);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+
+static void
+report(const char *name, unsigned draws, int64_t start)
+{
+   double secs = (os_time_get_nano() - start) / 1e9;
+
+   printf("%-40s %8.2f K draws/s\n", name, draws / secs / 1e3);
+}
+
+static void
+benchmark(struct program *p)
+{
+   const unsigned frames = 200;
+   int64_t start;
+   unsigned i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < frames; i++) {
+      draw_frame(p, FALSE);
+      p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+   }
+   report("draw_vbo per draw", frames * NUM_DRAWS, start);
+
+   start = os_time_get_nano();
+   for (i = 0; i < frames; i++) {
+      draw_frame(p, TRUE);
+      p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+   }
+   report("multi_draw", frames * NUM_DRAWS, start);
+}
+
+
+int main(int argc, char **argv)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   boolean success = TRUE;
+
+   init_prog(p);
+
+   success &= test_same_rendering(p);
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark(p);
+
+   close_prog(p);
+   FREE(p);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "util/u_format.h"
+#include "util/u_inlines.h"
+#include "cso_cache/cso_context.h"
+#include "softpipe/sp_public.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "sp_test_context.h"
+
+
+static struct pipe_resource *
+create_surface_resource(struct sp_test_context *ctx, enum pipe_format format,
+                        unsigned bind)
+{
+   struct pipe_resource tmplt;
+
+   memset(&tmplt, 0, sizeof(tmplt));
+   tmplt.target = PIPE_TEXTURE_2D;
+   tmplt.format = format;
+   tmplt.width0 = ctx->width;
+   tmplt.height0 = ctx->height;
+   tmplt.depth0 = 1;
+   tmplt.array_size = 1;
+   tmplt.bind = bind;
+   return ctx->screen->resource_create(ctx->screen, &tmplt);
+}
+
+
+void
+sp_test_context_init(struct sp_test_context *ctx,
+                     unsigned width, unsigned height,
+                     enum pipe_format cbuf_format,
+                     enum pipe_format zsbuf_format,
+                     const void *vertices, unsigned vertices_size)
+{
+   struct pipe_surface surf_tmpl, *cbuf, *zsbuf = NULL;
+   struct pipe_framebuffer_state framebuffer;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state depthstencil;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem[2];
+   struct pipe_vertex_buffer vb;
+
+   memset(ctx, 0, sizeof *ctx);
+   ctx->screen = softpipe_create_screen(null_sw_create());
+   ctx->pipe = ctx->screen->context_create(ctx->screen, NULL, 0);
+   ctx->cso = cso_create_context(ctx->pipe);
+   ctx->width = width;
+   ctx->height = height;
+
+   ctx->vbuf = pipe_buffer_create(ctx->screen, PIPE_BIND_VERTEX_BUFFER,
+                                  PIPE_USAGE_DEFAULT, vertices_size);
+   pipe_buffer_write(ctx->pipe, ctx->vbuf, 0, vertices_size, vertices);
+
+   ctx->target = create_surface_resource(ctx, cbuf_format,
+                                         PIPE_BIND_RENDER_TARGET);
+   memset(&surf_tmpl, 0, sizeof(surf_tmpl));
+   surf_tmpl.format = cbuf_format;
+   cbuf = ctx->pipe->create_surface(ctx->pipe, ctx->target, &surf_tmpl);
+
+   if (zsbuf_format != PIPE_FORMAT_NONE) {
+      ctx->zsbuf = create_surface_resource(ctx, zsbuf_format,
+                                           PIPE_BIND_DEPTH_STENCIL);
+      surf_tmpl.format = zsbuf_format;
+      zsbuf = ctx->pipe->create_surface(ctx->pipe, ctx->zsbuf, &surf_tmpl);
+   }
+
+   memset(&framebuffer, 0, sizeof(framebuffer));
+   framebuffer.width = width;
+   framebuffer.height = height;
+   framebuffer.nr_cbufs = 1;
+   framebuffer.cbufs[0] = cbuf;
+   framebuffer.zsbuf = zsbuf;
+   cso_set_framebuffer(ctx->cso, &framebuffer);
+   pipe_surface_reference(&cbuf, NULL);
+   pipe_surface_reference(&zsbuf, NULL);
+
+   memset(&blend, 0, sizeof(blend));
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(ctx->cso, &blend);
+
+   memset(&depthstencil, 0, sizeof(depthstencil));
+   cso_set_depth_stencil_alpha(ctx->cso, &depthstencil);
+
+   ctx->rasterizer.cull_face = PIPE_FACE_NONE;
+   ctx->rasterizer.half_pixel_center = 1;
+   ctx->rasterizer.bottom_edge_rule = 1;
+   ctx->rasterizer.depth_clip = 1;
+   cso_set_rasterizer(ctx->cso, &ctx->rasterizer);
+
+   memset(&viewport, 0, sizeof(viewport));
+   viewport.scale[0] = width / 2.0f;
+   viewport.scale[1] = height / 2.0f;
+   viewport.scale[2] = 1.0f;
+   viewport.translate[0] = width / 2.0f;
+   viewport.translate[1] = height / 2.0f;
+   cso_set_viewport(ctx->cso, &viewport);
+
+   memset(velem, 0, sizeof(velem));
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   cso_set_vertex_elements(ctx->cso, 2, velem);
+
+   memset(&vb, 0, sizeof(vb));
+   vb.stride = 2 * 4 * sizeof(float);
+   vb.buffer = ctx->vbuf;
+   cso_set_vertex_buffers(ctx->cso, 0, 1, &vb);
+}
+
+
+void
+sp_test_context_destroy(struct sp_test_context *ctx)
+{
+   cso_destroy_context(ctx->cso);
+
+   pipe_resource_reference(&ctx->target, NULL);
+   pipe_resource_reference(&ctx->zsbuf, NULL);
+   pipe_resource_reference(&ctx->vbuf, NULL);
+
+   ctx->pipe->destroy(ctx->pipe);
+   ctx->screen->destroy(ctx->screen);
+}
+
+
+void
+sp_test_context_clear(struct sp_test_context *ctx)
+{
+   union pipe_color_union clear_color;
+   unsigned buffers = PIPE_CLEAR_COLOR;
+
+   if (ctx->zsbuf)
+      buffers |= PIPE_CLEAR_DEPTH;
+
+   memset(&clear_color, 0, sizeof(clear_color));
+   ctx->pipe->clear(ctx->pipe, buffers, &clear_color, 1.0, 0);
+}
+
+
+unsigned
+sp_test_context_checksum(struct sp_test_context *ctx,
+                         struct pipe_resource *res)
+{
+   const unsigned dwords =
+      ctx->width * util_format_get_blocksize(res->format) / 4;
+   struct pipe_transfer *transfer;
+   const uint32_t *pixels;
+   unsigned x, y, sum = 0;
+
+   pixels = pipe_transfer_map(ctx->pipe, res, 0, 0, PIPE_TRANSFER_READ,
+                              0, 0, ctx->width, ctx->height, &transfer);
+   for (y = 0; y < ctx->height; y++) {
+      for (x = 0; x < dwords; x++)
+         sum = sum * 31 + pixels[y * transfer->stride / 4 + x];
+   }
+   pipe_transfer_unmap(ctx->pipe, transfer);
+
+   return sum;
+}
+
+
+void
+sp_test_context_read(struct sp_test_context *ctx, void *pixels)
+{
+   const unsigned row_size =
+      ctx->width * util_format_get_blocksize(ctx->target->format);
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_transfer_map(ctx->pipe, ctx->target, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, ctx->width, ctx->height, &transfer);
+   for (y = 0; y < ctx->height; y++) {
+      memcpy((uint8_t *) pixels + y * row_size, map + y * transfer->stride,
+             row_size);
+   }
+   pipe_transfer_unmap(ctx->pipe, transfer);
+}
@@ -0,0 +1,94 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Softpipe context shared by the unit tests that render something: a
+ * render target, an optional depth buffer and a vertex buffer bound with
+ * no blending, no depth testing, no culling and a viewport covering the
+ * target.  The tests set their shaders and draw.
+ */
+
+#ifndef SP_TEST_CONTEXT_H
+#define SP_TEST_CONTEXT_H
+
+
+#include "pipe/p_format.h"
+#include "pipe/p_state.h"
+
+
+struct cso_context;
+struct pipe_context;
+struct pipe_screen;
+
+
+struct sp_test_context
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   unsigned width, height;
+   struct pipe_resource *target;
+   struct pipe_resource *zsbuf;
+   struct pipe_resource *vbuf;
+
+   /* Bound at init; change it and set it again through the cso context. */
+   struct pipe_rasterizer_state rasterizer;
+};
+
+
+/**
+ * Create the context, rendering to a width x height target of the given
+ * format and, unless zsbuf_format is PIPE_FORMAT_NONE, a depth buffer.
+ * The vertices are pairs of float4 attributes, a position and a color or
+ * texture coordinate.
+ */
+void
+sp_test_context_init(struct sp_test_context *ctx,
+                     unsigned width, unsigned height,
+                     enum pipe_format cbuf_format,
+                     enum pipe_format zsbuf_format,
+                     const void *vertices, unsigned vertices_size);
+
+void
+sp_test_context_destroy(struct sp_test_context *ctx);
+
+/** Clear the target to zero and the depth buffer, if any, to one. */
+void
+sp_test_context_clear(struct sp_test_context *ctx);
+
+/** Return a checksum of the target or the depth buffer. */
+unsigned
+sp_test_context_checksum(struct sp_test_context *ctx,
+                         struct pipe_resource *res);
+
+/** Read back the target, rows tightly packed. */
+void
+sp_test_context_read(struct sp_test_context *ctx, void *pixels);
+
+
+#endif /* SP_TEST_CONTEXT_H */
@@ -0,0 +1,278 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for softpipe's texture tile cache: a large
+ * texture minified on a rotated quad, so that sampling walks the texture
+ * diagonally, must render the same whatever the cache associativity
+ * (SOFTPIPE_TEX_CACHE_WAYS), with sane hit/miss counters.  Pass -b to also
+ * compare hit rates and texels/second.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+#include "softpipe/sp_context.h"
+#include "softpipe/sp_tex_tile_cache.h"
+
+#include "sp_test_context.h"
+
+
+#define TEX_SIZE 1024
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   struct pipe_resource *tex;
+   void *vs;
+   void *fs;
+};
+
+
+static void
+init_texture(struct program *p)
+{
+   struct pipe_resource tmplt;
+   struct pipe_sampler_view view_tmpl, *view;
+   struct pipe_sampler_state sampler;
+   uint32_t *texels = MALLOC(TEX_SIZE * TEX_SIZE * 4);
+   unsigned seed = 7;
+   struct pipe_box box;
+   unsigned i;
+
+   memset(&tmplt, 0, sizeof(tmplt));
+   tmplt.target = PIPE_TEXTURE_2D;
+   tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmplt.width0 = TEX_SIZE;
+   tmplt.height0 = TEX_SIZE;
+   tmplt.depth0 = 1;
+   tmplt.array_size = 1;
+   tmplt.bind = PIPE_BIND_SAMPLER_VIEW;
+   p->tex = p->ctx.screen->resource_create(p->ctx.screen, &tmplt);
+
+   for (i = 0; i < TEX_SIZE * TEX_SIZE; i++) {
+      seed = seed * 1103515245 + 12345;
+      texels[i] = seed;
+   }
+
+   u_box_2d(0, 0, TEX_SIZE, TEX_SIZE, &box);
+   p->ctx.pipe->transfer_inline_write(p->ctx.pipe, p->tex, 0,
+                                      PIPE_TRANSFER_WRITE, &box, texels,
+                                      TEX_SIZE * 4, 0);
+   FREE(texels);
+
+   u_sampler_view_default_template(&view_tmpl, p->tex, p->tex->format);
+   view = p->ctx.pipe->create_sampler_view(p->ctx.pipe, p->tex, &view_tmpl);
+   cso_set_sampler_views(p->ctx.cso, PIPE_SHADER_FRAGMENT, 1, &view);
+   pipe_sampler_view_reference(&view, NULL);
+
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+   cso_single_sampler(p->ctx.cso, PIPE_SHADER_FRAGMENT, 0, &sampler);
+   cso_single_sampler_done(p->ctx.cso, PIPE_SHADER_FRAGMENT);
+}
+
+
+static void
+init_prog(struct program *p, unsigned ways, unsigned width, unsigned height)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_GENERIC };
+   const uint semantic_indexes[] = { 0, 0 };
+   /* A full screen quad, with the texture rotated by about 30 degrees and
+    * minified 2.5 times on it.
+    */
+   const float vertices[4][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 0.00f, 0.00f, 0.0f, 1.0f } },
+      { {  1.0f, -1.0f, 0.0f, 1.0f }, { 0.43f, 0.25f, 0.0f, 1.0f } },
+      { { -1.0f,  1.0f, 0.0f, 1.0f }, { -0.25f, 0.43f, 0.0f, 1.0f } },
+      { {  1.0f,  1.0f, 0.0f, 1.0f }, { 0.18f, 0.68f, 0.0f, 1.0f } },
+   };
+   char value[16];
+
+   /* Softpipe picks this up when the context is created. */
+   snprintf(value, sizeof value, "%u", ways);
+   setenv("SOFTPIPE_TEX_CACHE_WAYS", value, 1);
+
+   sp_test_context_init(&p->ctx, width, height,
+                        PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_NONE,
+                        vertices, sizeof vertices);
+
+   init_texture(p);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_tex_shader(p->ctx.pipe, TGSI_TEXTURE_2D,
+                                         TGSI_INTERPOLATE_LINEAR,
+                                         TGSI_RETURN_TYPE_FLOAT);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+   pipe_resource_reference(&p->tex, NULL);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw(struct program *p)
+{
+   struct pipe_draw_info info;
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLE_STRIP;
+   info.count = 4;
+   cso_draw_vbo(p->ctx.cso, &info);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+}
+
+
+static boolean
+test_same_rendering(void)
+{
+   static const unsigned ways[] = { 1, 2, 4, 8 };
+   struct sp_tex_tile_cache_stats stats, direct_stats;
+   unsigned expected = 0;
+   boolean success = TRUE;
+   unsigned w;
+
+   for (w = 0; w < Elements(ways); w++) {
+      struct program *p = CALLOC_STRUCT(program);
+      unsigned sum;
+
+      init_prog(p, ways[w], 160, 120);
+      draw(p);
+      sum = sp_test_context_checksum(&p->ctx, p->ctx.target);
+      softpipe_get_tex_cache_stats(softpipe_context(p->ctx.pipe), &stats);
+      close_prog(p);
+      FREE(p);
+
+      if (w == 0) {
+         expected = sum;
+         direct_stats = stats;
+      }
+      else if (sum != expected) {
+         printf("%u ways: rendered differently: %08x vs %08x\n",
+                ways[w], sum, expected);
+         success = FALSE;
+      }
+
+      /* The same tiles get looked up whatever the associativity, and as
+       * the sets don't change with it, LRU can only miss less with more
+       * ways.
+       */
+      if (stats.hits + stats.misses !=
+          direct_stats.hits + direct_stats.misses ||
+          stats.misses == 0 || stats.misses > direct_stats.misses) {
+         printf("%u ways: bad counters: %llu hits, %llu misses\n",
+                ways[w], (unsigned long long) stats.hits,
+                (unsigned long long) stats.misses);
+         success = FALSE;
+      }
+   }
+
+   return success;
+}
+
+
+static void
+benchmark(void)
+{
+   static const unsigned ways[] = { 1, 2, 4, 8 };
+   const unsigned frames = 10;
+   unsigned w, i;
+
+   for (w = 0; w < Elements(ways); w++) {
+      struct program *p = CALLOC_STRUCT(program);
+      struct sp_tex_tile_cache_stats stats;
+      int64_t start;
+      double rate;
+
+      init_prog(p, ways[w], 1024, 1024);
+
+      start = os_time_get_nano();
+      for (i = 0; i < frames; i++)
+         draw(p);
+      rate = frames * p->ctx.width * p->ctx.height /
+             ((os_time_get_nano() - start) / 1e9);
+
+      softpipe_get_tex_cache_stats(softpipe_context(p->ctx.pipe), &stats);
+      printf("%u ways: %6.2f M texels/s, %5.2f%% hits, %llu misses, "
+             "%llu prefetches\n",
+             ways[w], rate / 1e6,
+             100.0 * stats.hits / (stats.hits + stats.misses),
+             (unsigned long long) stats.misses,
+             (unsigned long long) stats.prefetches);
+
+      close_prog(p);
+      FREE(p);
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_same_rendering();
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark();
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,315 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for softpipe's SSE texture sampling paths
+ * (disabled with SOFTPIPE_NO_SSE_SAMPLING): a perspective textured quad,
+ * magnified at the bottom and minified at the top, must render bit for bit
+ * the same with and without them, for every wrap mode, filter and mipmap
+ * filter they handle.  Pass -b to also compare texels/second.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+
+#include "sp_test_context.h"
+
+
+#define TEX_SIZE 64
+#define TEX_LEVELS 7
+
+
+struct sampler_test
+{
+   const char *name;
+   unsigned wrap;
+   unsigned filter;
+   unsigned mip_filter;
+};
+
+
+static const struct sampler_test tests[] = {
+   { "nearest repeat", PIPE_TEX_WRAP_REPEAT,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_NONE },
+   { "linear repeat", PIPE_TEX_WRAP_REPEAT,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NONE },
+   { "nearest clamp", PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_NONE },
+   { "linear clamp", PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_NONE },
+   { "nearest repeat mip", PIPE_TEX_WRAP_REPEAT,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_LINEAR },
+   { "linear repeat mip", PIPE_TEX_WRAP_REPEAT,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_LINEAR },
+   { "nearest clamp mip", PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+     PIPE_TEX_FILTER_NEAREST, PIPE_TEX_MIPFILTER_LINEAR },
+   { "linear clamp mip", PIPE_TEX_WRAP_CLAMP_TO_EDGE,
+     PIPE_TEX_FILTER_LINEAR, PIPE_TEX_MIPFILTER_LINEAR },
+};
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   struct pipe_resource *tex;
+   void *vs;
+   void *fs;
+};
+
+
+static void
+init_texture(struct program *p)
+{
+   struct pipe_resource tmplt;
+   struct pipe_sampler_view view_tmpl, *view;
+   uint32_t *texels = MALLOC(TEX_SIZE * TEX_SIZE * 4);
+   unsigned seed = 7;
+   unsigned level, i;
+
+   memset(&tmplt, 0, sizeof(tmplt));
+   tmplt.target = PIPE_TEXTURE_2D;
+   tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmplt.width0 = TEX_SIZE;
+   tmplt.height0 = TEX_SIZE;
+   tmplt.depth0 = 1;
+   tmplt.array_size = 1;
+   tmplt.last_level = TEX_LEVELS - 1;
+   tmplt.bind = PIPE_BIND_SAMPLER_VIEW;
+   p->tex = p->ctx.screen->resource_create(p->ctx.screen, &tmplt);
+
+   /* Random texels, so that each level looks different. */
+   for (level = 0; level < TEX_LEVELS; level++) {
+      const unsigned size = TEX_SIZE >> level;
+      struct pipe_box box;
+
+      for (i = 0; i < size * size; i++) {
+         seed = seed * 1103515245 + 12345;
+         texels[i] = seed;
+      }
+
+      u_box_2d(0, 0, size, size, &box);
+      p->ctx.pipe->transfer_inline_write(p->ctx.pipe, p->tex, level,
+                                         PIPE_TRANSFER_WRITE, &box, texels,
+                                         size * 4, 0);
+   }
+   FREE(texels);
+
+   u_sampler_view_default_template(&view_tmpl, p->tex, p->tex->format);
+   view = p->ctx.pipe->create_sampler_view(p->ctx.pipe, p->tex, &view_tmpl);
+   cso_set_sampler_views(p->ctx.cso, PIPE_SHADER_FRAGMENT, 1, &view);
+   pipe_sampler_view_reference(&view, NULL);
+}
+
+
+static void
+init_prog(struct program *p, boolean sse, unsigned width, unsigned height)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_GENERIC };
+   const uint semantic_indexes[] = { 0, 0 };
+   /* A quad seen in perspective, the far edge at w = 8, with texture
+    * coordinates going well outside [0, 1].
+    */
+   const float vertices[4][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { -0.3f, -0.2f, 0.0f, 1.0f } },
+      { {  1.0f, -1.0f, 0.0f, 1.0f }, {  1.4f, -0.2f, 0.0f, 1.0f } },
+      { { -8.0f,  8.0f, 0.0f, 8.0f }, { -2.7f, 15.0f, 0.0f, 1.0f } },
+      { {  8.0f,  8.0f, 0.0f, 8.0f }, { 12.9f, 15.0f, 0.0f, 1.0f } },
+   };
+
+   /* Softpipe picks this up when the context is created. */
+   setenv("SOFTPIPE_NO_SSE_SAMPLING", sse ? "0" : "1", 1);
+
+   /* A float target, so that no difference gets lost. */
+   sp_test_context_init(&p->ctx, width, height,
+                        PIPE_FORMAT_R32G32B32A32_FLOAT, PIPE_FORMAT_NONE,
+                        vertices, sizeof vertices);
+
+   init_texture(p);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_tex_shader(p->ctx.pipe, TGSI_TEXTURE_2D,
+                                         TGSI_INTERPOLATE_PERSPECTIVE,
+                                         TGSI_RETURN_TYPE_FLOAT);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+   pipe_resource_reference(&p->tex, NULL);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw(struct program *p, const struct sampler_test *test)
+{
+   struct pipe_sampler_state sampler;
+   struct pipe_draw_info info;
+
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.wrap_s = test->wrap;
+   sampler.wrap_t = test->wrap;
+   sampler.wrap_r = test->wrap;
+   sampler.min_img_filter = test->filter;
+   sampler.mag_img_filter = test->filter;
+   sampler.min_mip_filter = test->mip_filter;
+   sampler.normalized_coords = 1;
+   /* GL's defaults, which let magnification happen with mipmapping. */
+   sampler.min_lod = -1000.0f;
+   sampler.max_lod = 1000.0f;
+   cso_single_sampler(p->ctx.cso, PIPE_SHADER_FRAGMENT, 0, &sampler);
+   cso_single_sampler_done(p->ctx.cso, PIPE_SHADER_FRAGMENT);
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLE_STRIP;
+   info.count = 4;
+   cso_draw_vbo(p->ctx.cso, &info);
+}
+
+
+/* Draw and return a checksum of the rendered pixels. */
+static unsigned
+render(struct program *p, const struct sampler_test *test)
+{
+   draw(p, test);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+
+   return sp_test_context_checksum(&p->ctx, p->ctx.target);
+}
+
+
+static boolean
+test_same_rendering(void)
+{
+   struct program *scalar = CALLOC_STRUCT(program);
+   struct program *sse = CALLOC_STRUCT(program);
+   boolean success = TRUE;
+   unsigned t;
+
+   init_prog(scalar, FALSE, 160, 120);
+   init_prog(sse, TRUE, 160, 120);
+
+   for (t = 0; t < Elements(tests); t++) {
+      unsigned expected = render(scalar, &tests[t]);
+      unsigned sum = render(sse, &tests[t]);
+
+      if (sum != expected) {
+         printf("%s: SSE sampling rendered differently: %08x vs %08x\n",
+                tests[t].name, sum, expected);
+         success = FALSE;
+      }
+   }
+
+   close_prog(scalar);
+   close_prog(sse);
+   FREE(scalar);
+   FREE(sse);
+
+   return success;
+}
+
+
+static double
+time_sampler(struct program *p, const struct sampler_test *test)
+{
+   const unsigned frames = 10;
+   int64_t start;
+   unsigned i;
+
+   start = os_time_get_nano();
+   for (i = 0; i < frames; i++) {
+      draw(p, test);
+      p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+   }
+
+   return frames * p->ctx.width * p->ctx.height /
+          ((os_time_get_nano() - start) / 1e9);
+}
+
+
+static void
+benchmark(void)
+{
+   struct program *scalar = CALLOC_STRUCT(program);
+   struct program *sse = CALLOC_STRUCT(program);
+   unsigned t;
+
+   init_prog(scalar, FALSE, 512, 512);
+   init_prog(sse, TRUE, 512, 512);
+
+   for (t = 0; t < Elements(tests); t++) {
+      double before = time_sampler(scalar, &tests[t]);
+      double after = time_sampler(sse, &tests[t]);
+
+      printf("%-20s scalar %6.2f M texels/s, SSE %6.2f M texels/s (%.2fx)\n",
+             tests[t].name, before / 1e6, after / 1e6, after / before);
+   }
+
+   close_prog(scalar);
+   close_prog(sse);
+   FREE(scalar);
+   FREE(sse);
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_same_rendering();
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark();
+
+   return success ? 0 : 1;
+}
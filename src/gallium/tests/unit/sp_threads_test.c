@@ -0,0 +1,361 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for softpipe's rasterizer threads
+ * (SOFTPIPE_NUM_THREADS): overlapping, textured, blended and depth tested
+ * triangles, lines and points, on a framebuffer which isn't a multiple of
+ * the tile size, must give the same colors, depths and occlusion count
+ * with and without threads.  Pass -b to also measure frames/second on a
+ * large framebuffer against the number of threads (up to one less than the
+ * number of CPUs, or the number following -b).
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_box.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "os/os_time.h"
+#include "cso_cache/cso_context.h"
+
+#include "sp_test_context.h"
+
+
+#define TEX_SIZE 32
+#define NUM_TRIS 2000
+#define NUM_VERTS (NUM_TRIS * 3)
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   struct pipe_resource *tex;
+   struct pipe_query *query;
+   void *vs;
+   void *fs;
+};
+
+
+static unsigned
+next_rand(unsigned *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return (*seed >> 16) & 0x7fff;
+}
+
+
+static void
+init_texture(struct program *p)
+{
+   struct pipe_resource tmplt;
+   struct pipe_sampler_view view_tmpl, *view;
+   struct pipe_sampler_state sampler;
+   uint32_t texels[TEX_SIZE * TEX_SIZE];
+   struct pipe_box box;
+   unsigned seed = 7;
+   unsigned i;
+
+   memset(&tmplt, 0, sizeof(tmplt));
+   tmplt.target = PIPE_TEXTURE_2D;
+   tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmplt.width0 = TEX_SIZE;
+   tmplt.height0 = TEX_SIZE;
+   tmplt.depth0 = 1;
+   tmplt.array_size = 1;
+   tmplt.bind = PIPE_BIND_SAMPLER_VIEW;
+   p->tex = p->ctx.screen->resource_create(p->ctx.screen, &tmplt);
+
+   for (i = 0; i < TEX_SIZE * TEX_SIZE; i++)
+      texels[i] = next_rand(&seed) | next_rand(&seed) << 15 |
+                  next_rand(&seed) << 30;
+
+   u_box_2d(0, 0, TEX_SIZE, TEX_SIZE, &box);
+   p->ctx.pipe->transfer_inline_write(p->ctx.pipe, p->tex, 0,
+                                      PIPE_TRANSFER_WRITE, &box, texels,
+                                      TEX_SIZE * 4, 0);
+
+   u_sampler_view_default_template(&view_tmpl, p->tex, p->tex->format);
+   view = p->ctx.pipe->create_sampler_view(p->ctx.pipe, p->tex, &view_tmpl);
+   cso_set_sampler_views(p->ctx.cso, PIPE_SHADER_FRAGMENT, 1, &view);
+   pipe_sampler_view_reference(&view, NULL);
+
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+   cso_single_sampler(p->ctx.cso, PIPE_SHADER_FRAGMENT, 0, &sampler);
+   cso_single_sampler_done(p->ctx.cso, PIPE_SHADER_FRAGMENT);
+}
+
+
+static void
+init_prog(struct program *p, unsigned num_threads,
+          unsigned width, unsigned height)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                   TGSI_SEMANTIC_GENERIC };
+   const uint semantic_indexes[] = { 0, 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_VERTS, sizeof *vertices);
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state depthstencil;
+   char value[16];
+   unsigned seed = 1;
+   unsigned i, j;
+
+   /* Random triangles, most of them small, at random depths and with
+    * random texture coordinates.
+    */
+   for (i = 0; i < NUM_TRIS; i++) {
+      float size = next_rand(&seed) % 8 ? 0.2f : 1.0f;
+      float cx = next_rand(&seed) / 16384.0f - 1.0f;
+      float cy = next_rand(&seed) / 16384.0f - 1.0f;
+      float z = next_rand(&seed) / 32768.0f;
+
+      for (j = 0; j < 3; j++) {
+         float *pos = vertices[i * 3 + j][0];
+         float *tex = vertices[i * 3 + j][1];
+
+         pos[0] = cx + (next_rand(&seed) / 16384.0f - 1.0f) * size;
+         pos[1] = cy + (next_rand(&seed) / 16384.0f - 1.0f) * size;
+         pos[2] = z;
+         pos[3] = 1.0f;
+         tex[0] = next_rand(&seed) / 8192.0f;
+         tex[1] = next_rand(&seed) / 8192.0f;
+         tex[2] = 0.0f;
+         tex[3] = 1.0f;
+      }
+   }
+
+   /* Softpipe picks this up when the context is created. */
+   snprintf(value, sizeof value, "%u", num_threads);
+   setenv("SOFTPIPE_NUM_THREADS", value, 1);
+
+   sp_test_context_init(&p->ctx, width, height, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_Z32_UNORM, vertices,
+                        NUM_VERTS * sizeof *vertices);
+   FREE(vertices);
+
+   /* Alpha blending, so that the result depends on the drawing order. */
+   memset(&blend, 0, sizeof(blend));
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(p->ctx.cso, &blend);
+
+   memset(&depthstencil, 0, sizeof(depthstencil));
+   depthstencil.depth.enabled = 1;
+   depthstencil.depth.writemask = 1;
+   depthstencil.depth.func = PIPE_FUNC_LEQUAL;
+   cso_set_depth_stencil_alpha(p->ctx.cso, &depthstencil);
+
+   p->ctx.rasterizer.point_size = 9.0f;
+   p->ctx.rasterizer.line_width = 3.0f;
+   cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+
+   init_texture(p);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 2, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_fragment_tex_shader(p->ctx.pipe, TGSI_TEXTURE_2D,
+                                         TGSI_INTERPOLATE_LINEAR,
+                                         TGSI_RETURN_TYPE_FLOAT);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+
+   p->query = p->ctx.pipe->create_query(p->ctx.pipe,
+                                        PIPE_QUERY_OCCLUSION_COUNTER, 0);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   p->ctx.pipe->destroy_query(p->ctx.pipe, p->query);
+
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+   pipe_resource_reference(&p->tex, NULL);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+static void
+draw(struct program *p)
+{
+   struct pipe_draw_info info;
+
+   sp_test_context_clear(&p->ctx);
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.count = NUM_VERTS;
+   cso_draw_vbo(p->ctx.cso, &info);
+
+   /* Wide lines and points over the same vertices, a third of them each. */
+   info.mode = PIPE_PRIM_LINES;
+   info.count = NUM_VERTS / 3;
+   cso_draw_vbo(p->ctx.cso, &info);
+
+   info.mode = PIPE_PRIM_POINTS;
+   info.start = NUM_VERTS / 3;
+   cso_draw_vbo(p->ctx.cso, &info);
+}
+
+
+struct result
+{
+   unsigned color;
+   unsigned depth;
+   uint64_t samples;
+};
+
+
+static void
+render(struct program *p, struct result *result)
+{
+   union pipe_query_result samples;
+
+   p->ctx.pipe->begin_query(p->ctx.pipe, p->query);
+   draw(p);
+   p->ctx.pipe->end_query(p->ctx.pipe, p->query);
+   p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+
+   p->ctx.pipe->get_query_result(p->ctx.pipe, p->query, TRUE, &samples);
+
+   result->color = sp_test_context_checksum(&p->ctx, p->ctx.target);
+   result->depth = sp_test_context_checksum(&p->ctx, p->ctx.zsbuf);
+   result->samples = samples.u64;
+}
+
+
+static boolean
+test_same_rendering(void)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   struct result expected, result;
+   boolean success = TRUE;
+   unsigned threads;
+
+   init_prog(p, 0, 250, 171);
+   render(p, &expected);
+   close_prog(p);
+
+   for (threads = 1; threads <= 4; threads++) {
+      init_prog(p, threads, 250, 171);
+      render(p, &result);
+      close_prog(p);
+
+      if (result.color != expected.color ||
+          result.depth != expected.depth ||
+          result.samples != expected.samples) {
+         printf("%u threads rendered differently: color %08x vs %08x, "
+                "depth %08x vs %08x, %llu vs %llu samples\n", threads,
+                result.color, expected.color, result.depth, expected.depth,
+                (unsigned long long) result.samples,
+                (unsigned long long) expected.samples);
+         success = FALSE;
+      }
+   }
+
+   FREE(p);
+   return success;
+}
+
+
+static void
+benchmark(unsigned max_threads)
+{
+   struct program *p = CALLOC_STRUCT(program);
+   const unsigned frames = 10;
+   unsigned threads, i;
+
+   for (threads = 0; threads <= max_threads; threads++) {
+      int64_t start;
+      double secs;
+
+      init_prog(p, threads, 1024, 1024);
+
+      start = os_time_get_nano();
+      for (i = 0; i < frames; i++) {
+         draw(p);
+         p->ctx.pipe->flush(p->ctx.pipe, NULL, 0);
+      }
+      secs = (os_time_get_nano() - start) / 1e9;
+
+      printf("%u worker threads %8.2f frames/s\n", threads, frames / secs);
+
+      close_prog(p);
+   }
+
+   FREE(p);
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+
+   success &= test_same_rendering();
+
+   /* -b [max worker threads] */
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      unsigned max_threads;
+
+      util_cpu_detect();
+      max_threads = MIN2(util_cpu_caps.nr_cpus, 8) - 1;
+      if (argc > 2)
+         max_threads = MIN2(atoi(argv[2]), 7);
+
+      benchmark(max_threads);
+   }
+
+   return success ? 0 : 1;
+}
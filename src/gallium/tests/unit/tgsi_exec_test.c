@@ -0,0 +1,280 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and micro-benchmark for tgsi_exec's pre-decoded instructions.
+ * A few vertex shaders are run on random inputs with and without
+ * instruction decoding, and must produce bit-identical outputs.  Pass -b
+ * to compare quads/second.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_exec.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+
+
+#define NUM_INPUTS 3
+#define NUM_OUTPUTS 3
+#define NUM_CONSTS 16
+#define NUM_QUADS 1024
+
+
+struct shader_test
+{
+   const char *name;
+   const char *text;
+};
+
+
+/* Position transform and two-sided diffuse lighting. */
+static const char transform_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], COLOR\n"
+   "DCL OUT[2], GENERIC[0]\n"
+   "DCL CONST[0..15]\n"
+   "DCL TEMP[0..3]\n"
+   "IMM[0] FLT32 { 0.5, 2.0, -1.0, 0.0 }\n"
+   "  0: MUL TEMP[0], IN[0].xxxx, CONST[0]\n"
+   "  1: MAD TEMP[0], IN[0].yyyy, CONST[1], TEMP[0]\n"
+   "  2: MAD TEMP[0], IN[0].zzzz, CONST[2], TEMP[0]\n"
+   "  3: ADD OUT[0], TEMP[0], CONST[3]\n"
+   "  4: DP3 TEMP[1].x, IN[1], CONST[4]\n"
+   "  5: DP3 TEMP[1].y, IN[1], CONST[5]\n"
+   "  6: DP3 TEMP[1].z, IN[1], CONST[6]\n"
+   "  7: DP3 TEMP[2].x, TEMP[1], TEMP[1]\n"
+   "  8: RSQ TEMP[2].x, |TEMP[2].xxxx|\n"
+   "  9: MUL TEMP[1].xyz, TEMP[1], TEMP[2].xxxx\n"
+   " 10: DP3 TEMP[3], TEMP[1], CONST[8]\n"
+   " 11: MAX TEMP[3], TEMP[3], -TEMP[3]\n"
+   " 12: MAD_SAT OUT[1].xyz, TEMP[3], CONST[9], CONST[10]\n"
+   " 13: MOV OUT[1].w, CONST[9].wwww\n"
+   " 14: DP4 TEMP[0].x, IN[2], CONST[11]\n"
+   " 15: DP2 TEMP[0].y, IN[2].zwzw, IMM[0].xyxy\n"
+   " 16: RCP TEMP[0].z, IN[2].wwww\n"
+   " 17: MOV OUT[2], -TEMP[0].zyxw\n"
+   " 18: END\n";
+
+/* Control flow, so that decoded instructions run with partial exec masks,
+ * and instructions which are not decoded interleaved with ones which are.
+ */
+static const char control_flow_text[] =
+   "VERT\n"
+   "DCL IN[0]\n"
+   "DCL IN[1]\n"
+   "DCL IN[2]\n"
+   "DCL OUT[0], POSITION\n"
+   "DCL OUT[1], COLOR\n"
+   "DCL OUT[2], GENERIC[0]\n"
+   "DCL CONST[0..15]\n"
+   "DCL TEMP[0..3]\n"
+   "DCL ADDR[0]\n"
+   "IMM[0] FLT32 { 0.5, 2.0, -1.0, 4.0 }\n"
+   "  0: MOV OUT[0], IN[0]\n"
+   "  1: SLT TEMP[0], IN[1], IMM[0].xxxx\n"
+   "  2: IF TEMP[0].xxxx\n"
+   "  3:    SUB TEMP[1], IN[1], IN[2]\n"
+   "  4:    FRC TEMP[2], TEMP[1]\n"
+   "  5:    LRP OUT[1], IN[1].xxxx, TEMP[2], IN[2]\n"
+   "  6: ELSE\n"
+   "  7:    FLR TEMP[1], IN[2]\n"
+   "  8:    CMP TEMP[2], TEMP[1], IN[1], -IN[2]\n"
+   "  9:    MIN_SAT OUT[1], TEMP[2], |IN[0]|\n"
+   " 10: ENDIF\n"
+   " 11: MUL TEMP[3], IN[2].wwww, IMM[0].wwww\n"
+   " 12: ABS TEMP[3], TEMP[3]\n"
+   " 13: ARL ADDR[0].x, TEMP[3].xxxx\n"
+   " 14: ADD TEMP[3], CONST[ADDR[0].x], OUT[0]\n"
+   " 15: SGE TEMP[0], TEMP[3], OUT[1].wzyx\n"
+   " 16: MAD OUT[2], TEMP[0], TEMP[3], OUT[1]\n"
+   " 17: END\n";
+
+
+static const struct shader_test tests[] = {
+   { "transform", transform_text },
+   { "control flow", control_flow_text },
+};
+
+
+static float consts[NUM_CONSTS][4];
+static struct tgsi_exec_vector inputs[NUM_QUADS][NUM_INPUTS];
+
+
+static float
+rand_float(void)
+{
+   return (float) rand() / RAND_MAX * 2.0f - 1.0f;
+}
+
+
+static void
+init_data(void)
+{
+   unsigned q, i, c, j;
+
+   for (i = 0; i < NUM_CONSTS; i++)
+      for (c = 0; c < 4; c++)
+         consts[i][c] = rand_float();
+
+   for (q = 0; q < NUM_QUADS; q++)
+      for (i = 0; i < NUM_INPUTS; i++)
+         for (c = 0; c < 4; c++)
+            for (j = 0; j < TGSI_QUAD_SIZE; j++)
+               inputs[q][i].xyzw[c].f[j] = rand_float();
+}
+
+
+static struct tgsi_exec_machine *
+create_machine(const struct tgsi_token *tokens, boolean decode)
+{
+   struct tgsi_exec_machine *mach = tgsi_exec_machine_create();
+   const void *bufs[1] = { consts };
+   unsigned sizes[1] = { sizeof consts };
+
+   mach->DecodeInstructions = decode;
+   tgsi_exec_machine_bind_shader(mach, tokens, NULL);
+   tgsi_exec_set_constant_buffers(mach, 1, bufs, sizes);
+
+   return mach;
+}
+
+
+static void
+run_quad(struct tgsi_exec_machine *mach, unsigned q)
+{
+   memcpy(mach->Inputs, inputs[q], sizeof inputs[q]);
+   tgsi_exec_machine_run(mach);
+}
+
+
+static boolean
+test_shader(const struct shader_test *test)
+{
+   struct tgsi_token tokens[1024];
+   struct tgsi_exec_machine *interp, *decoded;
+   boolean success = TRUE;
+   unsigned q;
+
+   if (!tgsi_text_translate(test->text, tokens, Elements(tokens))) {
+      printf("%s: failed to translate shader\n", test->name);
+      return FALSE;
+   }
+
+   interp = create_machine(tokens, FALSE);
+   decoded = create_machine(tokens, TRUE);
+
+   for (q = 0; q < NUM_QUADS; q++) {
+      run_quad(interp, q);
+      run_quad(decoded, q);
+
+      if (memcmp(interp->Outputs, decoded->Outputs,
+                 NUM_OUTPUTS * sizeof(struct tgsi_exec_vector)) != 0) {
+         printf("%s: quad %u: outputs differ\n", test->name, q);
+         success = FALSE;
+         break;
+      }
+   }
+
+   tgsi_exec_machine_destroy(interp);
+   tgsi_exec_machine_destroy(decoded);
+
+   return success;
+}
+
+
+static double
+time_shader(const struct tgsi_token *tokens, boolean decode)
+{
+   struct tgsi_exec_machine *mach = create_machine(tokens, decode);
+   const unsigned passes = 200;
+   int64_t start;
+   unsigned p, q;
+   double secs;
+
+   start = os_time_get_nano();
+   for (p = 0; p < passes; p++)
+      for (q = 0; q < NUM_QUADS; q++)
+         run_quad(mach, q);
+   secs = (os_time_get_nano() - start) / 1e9;
+
+   tgsi_exec_machine_destroy(mach);
+
+   return passes * NUM_QUADS / secs;
+}
+
+
+static void
+benchmark(void)
+{
+   unsigned t;
+
+   for (t = 0; t < Elements(tests); t++) {
+      struct tgsi_token tokens[1024];
+      double interp, decoded;
+
+      if (!tgsi_text_translate(tests[t].text, tokens, Elements(tokens)))
+         continue;
+
+      interp = time_shader(tokens, FALSE);
+      decoded = time_shader(tokens, TRUE);
+
+      printf("%-14s interpreted %8.0f quads/s, decoded %8.0f quads/s (%.2fx)\n",
+             tests[t].name, interp, decoded, decoded / interp);
+   }
+}
+
+
+int main(int argc, char **argv)
+{
+   boolean success = TRUE;
+   unsigned t;
+
+   init_data();
+
+   for (t = 0; t < Elements(tests); t++) {
+      if (!test_shader(&tests[t]))
+         success = FALSE;
+   }
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0)
+      benchmark();
+
+   printf("%s\n", success ? "PASS" : "FAIL");
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case and benchmark for the draw module's post-transform vertex cache,
+ * run against softpipe.  A grid mesh is drawn with its triangles in row
+ * order and shuffled, counting vertex shader invocations.  Pass -b to print
+ * the average number of invocations per triangle (ACMR) for each.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "cso_cache/cso_context.h"
+#include "draw/draw_context.h"
+#include "softpipe/sp_context.h"
+
+#include "sp_test_context.h"
+
+
+#define WIDTH 64
+#define HEIGHT 64
+
+/* Vertices per side of the grid.  With rows of 256 cells, the vertices
+ * above and below each other land in the same cache set, which is what a
+ * direct-mapped cache does worst on.
+ */
+#define GRID 257
+#define NUM_VERTS (GRID * GRID)
+#define NUM_TRIS ((GRID - 1) * (GRID - 1) * 2)
+#define NUM_INDICES (NUM_TRIS * 3)
+
+
+struct program
+{
+   struct sp_test_context ctx;
+   struct pipe_query *query;
+   void *vs;
+   void *fs;
+};
+
+
+static void
+init_prog(struct program *p, const char *ways)
+{
+   const uint semantic_names[] = { TGSI_SEMANTIC_POSITION };
+   const uint semantic_indexes[] = { 0 };
+   float (*vertices)[2][4] = CALLOC(NUM_VERTS, sizeof *vertices);
+   unsigned i;
+
+   for (i = 0; i < NUM_VERTS; i++) {
+      vertices[i][0][0] = -1.0f + 2.0f * (i % GRID) / (GRID - 1);
+      vertices[i][0][1] = -1.0f + 2.0f * (i / GRID) / (GRID - 1);
+      vertices[i][0][2] = 0.0f;
+      vertices[i][0][3] = 1.0f;
+   }
+
+   /* The draw module picks this up when softpipe creates it. */
+   setenv("DRAW_VSPLIT_CACHE_WAYS", ways, 1);
+
+   sp_test_context_init(&p->ctx, WIDTH, HEIGHT, PIPE_FORMAT_B8G8R8A8_UNORM,
+                        PIPE_FORMAT_NONE, vertices,
+                        NUM_VERTS * sizeof *vertices);
+   FREE(vertices);
+
+   p->query = p->ctx.pipe->create_query(p->ctx.pipe,
+                                        PIPE_QUERY_PIPELINE_STATISTICS, 0);
+
+   /* Only vertex processing is of interest. */
+   p->ctx.rasterizer.cull_face = PIPE_FACE_FRONT_AND_BACK;
+   cso_set_rasterizer(p->ctx.cso, &p->ctx.rasterizer);
+
+   p->vs = util_make_vertex_passthrough_shader(p->ctx.pipe, 1, semantic_names,
+                                               semantic_indexes, FALSE);
+   p->fs = util_make_empty_fragment_shader(p->ctx.pipe);
+   cso_set_vertex_shader_handle(p->ctx.cso, p->vs);
+   cso_set_fragment_shader_handle(p->ctx.cso, p->fs);
+}
+
+
+static void
+close_prog(struct program *p)
+{
+   cso_delete_vertex_shader(p->ctx.cso, p->vs);
+   cso_delete_fragment_shader(p->ctx.cso, p->fs);
+   p->ctx.pipe->destroy_query(p->ctx.pipe, p->query);
+
+   sp_test_context_destroy(&p->ctx);
+}
+
+
+/* Two triangles per grid cell, in row order. */
+static void
+make_grid(uint32_t *indices)
+{
+   unsigned x, y;
+
+   for (y = 0; y < GRID - 1; y++) {
+      for (x = 0; x < GRID - 1; x++) {
+         const uint32_t v = y * GRID + x;
+
+         *indices++ = v;
+         *indices++ = v + 1;
+         *indices++ = v + GRID;
+         *indices++ = v + GRID;
+         *indices++ = v + 1;
+         *indices++ = v + GRID + 1;
+      }
+   }
+}
+
+
+static void
+shuffle_triangles(uint32_t *indices)
+{
+   unsigned seed = 1;
+   unsigned i, j, k;
+
+   for (i = NUM_TRIS - 1; i > 0; i--) {
+      seed = seed * 1103515245 + 12345;
+      j = (seed >> 8) % (i + 1);
+
+      for (k = 0; k < 3; k++) {
+         uint32_t tmp = indices[i * 3 + k];
+         indices[i * 3 + k] = indices[j * 3 + k];
+         indices[j * 3 + k] = tmp;
+      }
+   }
+}
+
+
+/* Draw the mesh and return the number of vertex shader invocations. */
+static unsigned
+count_invocations(struct program *p, const uint32_t *indices,
+                  struct draw_vertex_cache_stats *stats)
+{
+   struct pipe_index_buffer ib;
+   struct pipe_draw_info info;
+   union pipe_query_result result;
+
+   memset(&ib, 0, sizeof(ib));
+   ib.index_size = 4;
+   ib.user_buffer = indices;
+   p->ctx.pipe->set_index_buffer(p->ctx.pipe, &ib);
+
+   util_draw_init_info(&info);
+   info.mode = PIPE_PRIM_TRIANGLES;
+   info.indexed = TRUE;
+   info.count = NUM_INDICES;
+   info.max_index = NUM_VERTS - 1;
+
+   p->ctx.pipe->begin_query(p->ctx.pipe, p->query);
+   cso_draw_vbo(p->ctx.cso, &info);
+   p->ctx.pipe->end_query(p->ctx.pipe, p->query);
+
+   draw_get_vertex_cache_stats(softpipe_context(p->ctx.pipe)->draw, stats);
+
+   p->ctx.pipe->get_query_result(p->ctx.pipe, p->query, TRUE, &result);
+
+   return (unsigned) result.pipeline_statistics.vs_invocations;
+}
+
+
+static const char *order_names[] = { "row order", "shuffled" };
+
+
+/* Count the invocations for each order of the triangles. */
+static boolean
+test_invocations(struct program *p, uint32_t *indices[2],
+                 unsigned invocations[2], boolean verbose)
+{
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < 2; i++) {
+      struct draw_vertex_cache_stats stats;
+
+      invocations[i] = count_invocations(p, indices[i], &stats);
+
+      if (stats.indices != NUM_INDICES ||
+          stats.indices - stats.hits != invocations[i]) {
+         printf("%s: %u of %u indices hit the cache, but %u invocations\n",
+                order_names[i], stats.hits, stats.indices, invocations[i]);
+         success = FALSE;
+      }
+
+      if (verbose)
+         printf("   %-12s ACMR %.3f, hit rate %5.1f%%\n", order_names[i],
+                (double) invocations[i] / NUM_TRIS,
+                100.0 * stats.hits / stats.indices);
+   }
+
+   return success;
+}
+
+
+int main(int argc, char **argv)
+{
+   const boolean verbose = argc > 1 && strcmp(argv[1], "-b") == 0;
+   struct program *p = CALLOC_STRUCT(program);
+   uint32_t *indices[2];
+   unsigned direct[2], assoc[2];
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < 2; i++)
+      indices[i] = MALLOC(NUM_INDICES * sizeof(uint32_t));
+
+   make_grid(indices[0]);
+   memcpy(indices[1], indices[0], NUM_INDICES * sizeof(uint32_t));
+   shuffle_triangles(indices[1]);
+
+   if (verbose)
+      printf("direct-mapped cache:\n");
+   init_prog(p, "1");
+   success &= test_invocations(p, indices, direct, verbose);
+   close_prog(p);
+
+   if (verbose)
+      printf("4-way cache:\n");
+   init_prog(p, "4");
+   success &= test_invocations(p, indices, assoc, verbose);
+   close_prog(p);
+
+   for (i = 0; i < 2; i++) {
+      if (assoc[i] > direct[i]) {
+         printf("%s: 4-way cache did worse than direct-mapped: %u vs %u\n",
+                order_names[i], assoc[i], direct[i]);
+         success = FALSE;
+      }
+   }
+
+   for (i = 0; i < 2; i++)
+      FREE(indices[i]);
+   FREE(p);
+
+   return success ? 0 : 1;
+}
@@ -0,0 +1,442 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2015 Intel Corporation
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# This script generates marshal_generated.c and marshal_generated.h, which
+# contain the glthread entry points: one function per GL function that
+# either packs its arguments into the current glthread batch or waits for
+# the driver thread to go idle and calls the function directly.
+
+import argparse
+import re
+import license
+import gl_XML
+
+
+# Functions that must not return before the driver thread has caught up,
+# even though their parameters could be queued.
+forced_sync = set([
+    'Finish',
+    ])
+
+# Functions that change the buffer and vertex array bindings glthread
+# tracks on the application side.  The named function in glthread.c is
+# called with the same arguments before the command is queued.
+tracked_functions = {
+    'BindBuffer': '_mesa_glthread_BindBuffer',
+    'DeleteBuffers': '_mesa_glthread_DeleteBuffers',
+    'BindVertexArray': '_mesa_glthread_BindVertexArray',
+    'BindVertexArrayAPPLE': '_mesa_glthread_BindVertexArray',
+    'DeleteVertexArrays': '_mesa_glthread_DeleteVertexArrays',
+    'VertexArrayElementBuffer': '_mesa_glthread_VertexArrayElementBuffer',
+    }
+
+# Synchronous functions after which the tracked bindings have to be read
+# back from the context.
+sync_tracked_functions = {
+    'PopClientAttrib': '_mesa_glthread_PopClientAttrib',
+    }
+
+# Draws that source vertices through the current VAO.
+draw_arrays_functions = set([
+    'ArrayElement',
+    'DrawArrays',
+    'DrawArraysInstancedARB',
+    'DrawArraysInstancedBaseInstance',
+    'DrawTransformFeedback',
+    'DrawTransformFeedbackInstanced',
+    'DrawTransformFeedbackStream',
+    'DrawTransformFeedbackStreamInstanced',
+    ])
+
+# Draws that additionally read indices through the element array buffer.
+# The indices pointer is an offset into that buffer and is queued as is.
+draw_elements_functions = set([
+    'DrawElements',
+    'DrawRangeElements',
+    'DrawElementsInstancedARB',
+    'DrawElementsBaseVertex',
+    'DrawElementsInstancedBaseVertex',
+    'DrawRangeElementsBaseVertex',
+    'DrawElementsInstancedBaseInstance',
+    'DrawElementsInstancedBaseVertexBaseInstance',
+    ])
+
+# Names the generated code uses for its own locals.
+reserved_names = set(['ctx', 'cmd', 'cmd_size', 'variable_data'])
+
+
+def is_vertex_pointer_function(func):
+    """Whether func records a vertex array pointer without reading it."""
+    if func.name.startswith('Get'):
+        return False
+    return (re.search(r'Pointer(EXT|OES|NV)?$', func.name) is not None or
+            func.name == 'InterleavedArrays')
+
+
+class marshal_function(object):
+    """Marshalling information for one GL function."""
+
+    def __init__(self, func):
+        self.name = func.name
+        self.func = func
+        self.params = [p for p in func.parameters if not p.is_padding]
+        self.fixed_params = []
+        self.variable_params = []
+        self.by_value_params = []
+        self.is_vertex_pointer = is_vertex_pointer_function(func)
+
+        for p in self.params:
+            if p.name in reserved_names:
+                raise Exception('{0}: parameter name {1!r} clashes with the '
+                                'generated code'.format(func.name, p.name))
+
+        self.is_async = self._classify()
+
+    def _classify(self):
+        """Sort the parameters and decide whether func can be queued."""
+        if self.name in forced_sync or self.name in sync_tracked_functions:
+            return False
+        if self.func.return_type != 'void':
+            return False
+
+        for p in self.params:
+            if not p.is_pointer():
+                self.fixed_params.append(p)
+            elif (self.is_vertex_pointer or
+                  (self.name in draw_elements_functions and
+                   p.name == 'indices')):
+                self.by_value_params.append(p)
+            elif (p.is_output or p.is_image() or p.count_parameter_list or
+                  p.type_string().count('*') > 1):
+                return False
+            elif p.count:
+                self.fixed_params.append(p)
+            elif p.counter:
+                self.variable_params.append(p)
+            else:
+                # Nothing says how much memory the pointer covers.
+                return False
+        return True
+
+    def fixed_fields(self):
+        """The (type, name, size) of the fields at the start of the command,
+        largest first so that they pack without holes."""
+        fields = []
+        for p in self.by_value_params:
+            fields.append((p.type_string(), p.name, 8))
+        for p in self.fixed_params:
+            if p.is_pointer():
+                continue
+            fields.append((p.type_string(), p.name, p.size()))
+        for p in self.variable_params:
+            fields.append(('bool', p.name + '_null', 1))
+        fields.sort(key=lambda f: -f[2])
+        return fields
+
+    def array_fields(self):
+        return [p for p in self.fixed_params if p.is_pointer()]
+
+
+class PrintCode(gl_XML.gl_print_base):
+
+    def __init__(self, functions):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2015 Intel Corporation', 'Intel Corporation')
+        self.functions = functions
+
+    def printRealHeader(self):
+        print '#include "api_exec.h"'
+        print '#include "context.h"'
+        print '#include "dispatch.h"'
+        print '#include "glthread.h"'
+        print '#include "macros.h"'
+        print '#include "marshal.h"'
+        print '#include "marshal_generated.h"'
+        print ''
+
+    def print_sync_call(self, m, indent):
+        func = m.func
+        call = 'CALL_{0}(ctx->CurrentDispatch, ({1}));'.format(
+            func.name, func.get_called_parameter_string())
+        print indent + '_mesa_glthread_begin_sync(ctx);'
+        if func.return_type == 'void':
+            print indent + call
+        else:
+            print indent + '{0} result = {1}'.format(func.return_type, call)
+        if m.name in sync_tracked_functions:
+            print indent + '{0}(ctx);'.format(sync_tracked_functions[m.name])
+        print indent + '_mesa_glthread_end_sync(ctx);'
+        if func.return_type != 'void':
+            print indent + 'return result;'
+
+    def print_sync_body(self, m):
+        print '/* {0}: marshalled synchronously */'.format(m.name)
+        print 'static {0} GLAPIENTRY'.format(m.func.return_type)
+        print '_mesa_marshal_{0}({1})'.format(
+            m.name, m.func.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        self.print_sync_call(m, '   ')
+        print '}'
+        print ''
+
+    def print_struct(self, m):
+        print '/* {0}: marshalled asynchronously */'.format(m.name)
+        print 'struct marshal_cmd_{0}'.format(m.name)
+        print '{'
+        print '   struct marshal_cmd_base cmd_base;'
+        for type, name, size in m.fixed_fields():
+            print '   {0} {1};'.format(type, name)
+        for p in m.array_fields():
+            print '   {0} {1}[{2}];'.format(
+                p.get_base_type_string(), p.name, p.count * p.count_scale)
+        for p in m.variable_params:
+            print '   /* Next {0} * {1} bytes are {2} {3}[{0}], unless ' \
+                '{3}_null */'.format(p.counter, p.size(),
+                                     p.get_base_type_string(), p.name)
+        print '};'
+        print ''
+
+    def print_unmarshal(self, m):
+        print 'static inline void'
+        print '_mesa_unmarshal_{0}(struct gl_context *ctx, ' \
+            'const struct marshal_cmd_{0} *cmd)'.format(m.name)
+        print '{'
+        for p in m.params:
+            if p in m.variable_params:
+                print '   {0} {1};'.format(p.type_string(), p.name)
+            elif p.is_pointer():
+                print '   {0} {1} = cmd->{1};'.format(p.type_string(), p.name)
+            else:
+                print '   const {0} {1} = cmd->{1};'.format(
+                    p.type_string(), p.name)
+        if m.variable_params:
+            print '   const char *variable_data = (const char *) cmd +'
+            print '      ALIGN(sizeof(*cmd), 8);'
+            for p in m.variable_params:
+                print '   if (cmd->{0}_null) {{'.format(p.name)
+                print '      {0} = NULL;'.format(p.name)
+                print '   } else {'
+                print '      {0} = ({1}) variable_data;'.format(
+                    p.name, p.type_string())
+                print '      variable_data += ALIGN({0} * {1}, 8);'.format(
+                    p.counter, p.size())
+                print '   }'
+        print '   CALL_{0}(ctx->CurrentDispatch, ({1}));'.format(
+            m.name, m.func.get_called_parameter_string())
+        print '}'
+        print ''
+
+    def print_async_body(self, m):
+        func = m.func
+        print 'static void GLAPIENTRY'
+        print '_mesa_marshal_{0}({1})'.format(
+            m.name, func.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        print '   size_t cmd_size = sizeof(struct marshal_cmd_{0});'.format(
+            m.name)
+        has_fields = m.fixed_fields() or m.array_fields()
+        if has_fields:
+            print '   struct marshal_cmd_{0} *cmd;'.format(m.name)
+        if m.variable_params:
+            print '   char *variable_data;'
+        print ''
+
+        if m.is_vertex_pointer:
+            print '   _mesa_glthread_vertex_pointer(ctx, {0});'.format(
+                m.by_value_params[0].name)
+        if m.name in tracked_functions:
+            print '   {0}(ctx, {1});'.format(
+                tracked_functions[m.name], func.get_called_parameter_string())
+
+        fallback = False
+        if m.name in draw_arrays_functions:
+            print '   if (_mesa_glthread_draw_needs_sync(ctx, false))'
+            print '      goto fallback_to_sync;'
+            fallback = True
+        elif m.name in draw_elements_functions:
+            print '   if (_mesa_glthread_draw_needs_sync(ctx, true))'
+            print '      goto fallback_to_sync;'
+            fallback = True
+
+        if m.variable_params:
+            counters = []
+            for p in m.variable_params:
+                if p.counter not in counters:
+                    counters.append(p.counter)
+            for c in counters:
+                print '   if (unlikely({0} < 0 || {0} > MARSHAL_MAX_CMD_SIZE))'.format(c)
+                print '      goto fallback_to_sync;'
+            print '   cmd_size = ALIGN(cmd_size, 8);'
+            for p in m.variable_params:
+                print '   if ({0} != NULL)'.format(p.name)
+                print '      cmd_size += ALIGN({0} * {1}, 8);'.format(
+                    p.counter, p.size())
+            print '   if (unlikely(cmd_size > MARSHAL_MAX_CMD_SIZE))'
+            print '      goto fallback_to_sync;'
+            fallback = True
+        if fallback:
+            print ''
+
+        print '   {0}_mesa_glthread_allocate_command(ctx, ' \
+            'DISPATCH_CMD_{1}, cmd_size);'.format(
+                'cmd = ' if has_fields else '', m.name)
+        for type, name, size in m.fixed_fields():
+            if name.endswith('_null') and \
+               name[:-5] in [p.name for p in m.variable_params]:
+                print '   cmd->{0} = {1} == NULL;'.format(name, name[:-5])
+            else:
+                print '   cmd->{0} = {0};'.format(name)
+        for p in m.array_fields():
+            print '   memcpy(cmd->{0}, {0}, {1});'.format(p.name, p.size())
+        if m.variable_params:
+            print '   variable_data = (char *) cmd + ALIGN(sizeof(*cmd), 8);'
+            for p in m.variable_params:
+                print '   if ({0} != NULL) {{'.format(p.name)
+                print '      memcpy(variable_data, {0}, {1} * {2});'.format(
+                    p.name, p.counter, p.size())
+                print '      variable_data += ALIGN({0} * {1}, 8);'.format(
+                    p.counter, p.size())
+                print '   }'
+        if m.name == 'Flush':
+            print '   _mesa_glthread_flush_batch(ctx);'
+
+        if fallback:
+            print '   return;'
+            print ''
+            print 'fallback_to_sync:'
+            self.print_sync_call(m, '   ')
+        print '}'
+        print ''
+
+    def print_unmarshal_dispatch(self):
+        print 'size_t'
+        print '_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, ' \
+            'const void *cmd)'
+        print '{'
+        print '   const struct marshal_cmd_base *cmd_base = cmd;'
+        print ''
+        print '   switch (cmd_base->cmd_id) {'
+        for m in self.functions:
+            if not m.is_async:
+                continue
+            print '   case DISPATCH_CMD_{0}:'.format(m.name)
+            print '      _mesa_unmarshal_{0}(ctx, (const struct ' \
+                'marshal_cmd_{0} *) cmd);'.format(m.name)
+            print '      break;'
+        print '   default:'
+        print '      assert(!"Unexpected glthread command id");'
+        print '      break;'
+        print '   }'
+        print ''
+        print '   return cmd_base->cmd_size;'
+        print '}'
+        print ''
+
+    def print_create_marshal_table(self):
+        print 'struct _glapi_table *'
+        print '_mesa_create_marshal_table(const struct gl_context *ctx)'
+        print '{'
+        print '   struct _glapi_table *table;'
+        print ''
+        print '   table = _mesa_alloc_dispatch_table();'
+        print '   if (table == NULL)'
+        print '      return NULL;'
+        print ''
+        for m in self.functions:
+            print '   SET_{0}(table, _mesa_marshal_{0});'.format(m.name)
+        print ''
+        print '   return table;'
+        print '}'
+
+    def printBody(self, api):
+        for m in self.functions:
+            if m.is_async:
+                self.print_struct(m)
+                self.print_unmarshal(m)
+                self.print_async_body(m)
+            else:
+                self.print_sync_body(m)
+        self.print_unmarshal_dispatch()
+        self.print_create_marshal_table()
+
+
+class PrintHeader(gl_XML.gl_print_base):
+
+    def __init__(self, functions):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2015 Intel Corporation', 'Intel Corporation')
+        self.header_tag = '_MARSHAL_GENERATED_H'
+        self.functions = functions
+
+    def printBody(self, api):
+        print '/**'
+        print ' * Ids of the commands glthread can queue.'
+        print ' */'
+        print 'enum marshal_dispatch_cmd_id'
+        print '{'
+        for m in self.functions:
+            if m.is_async:
+                print '   DISPATCH_CMD_{0},'.format(m.name)
+        print '   NUM_DISPATCH_CMD,'
+        print '};'
+        print ''
+
+
+def _parser():
+    """Parse arguments and return namespace."""
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-f',
+                        dest='filename',
+                        default='gl_and_es_API.xml',
+                        help='an xml file describing an API')
+    parser.add_argument('-m',
+                        dest='mode',
+                        choices=['code', 'header'],
+                        default='code',
+                        help='generate the marshalling code or its header')
+    return parser.parse_args()
+
+
+def main():
+    """Main function."""
+    args = _parser()
+    api = gl_XML.parse_GL_API(args.filename)
+    functions = [marshal_function(f) for f in api.functionIterateByOffset()]
+
+    if args.mode == 'header':
+        printer = PrintHeader(functions)
+    else:
+        printer = PrintCode(functions)
+    printer.Print(api)
+
+
+if __name__ == '__main__':
+    main()
@@ -30,6 +30,7 @@
 #include "main/mtypes.h"
 #include "main/macros.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "intel_blit.h"
 #include "intel_buffer_objects.h"
@@ -95,6 +96,8 @@ intel_bufferobj_free(struct gl_context * ctx, struct gl_buffer_object *obj)
     * (though it does if you call glDeleteBuffers)
     */
    _mesa_buffer_unmap_all_mappings(ctx, obj);
+   vbo_delete_minmax_cache(obj);
+   mtx_destroy(&obj->MinMaxCacheMutex);
 
    _mesa_align_free(intel_obj->sys_buffer);
 
@@ -34,8 +34,7 @@
 
 #include <stdint.h>
 #include "main/mtypes.h"
-
-typedef void *(*mem_copy_fn)(void *dest, const void *src, size_t n);
+#include "util/tiled_memcpy.h"
 
 void
 linear_to_tiled(uint32_t xt1, uint32_t xt2,
@@ -28,6 +28,7 @@
 #include "main/imports.h"
 #include "main/mtypes.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "radeon_common.h"
 #include "radeon_buffer_objects.h"
@@ -71,6 +72,8 @@ radeonDeleteBufferObject(struct gl_context * ctx,
         radeon_bo_unref(radeon_obj->bo);
     }
 
+    vbo_delete_minmax_cache(obj);
+    mtx_destroy(&obj->MinMaxCacheMutex);
     free(radeon_obj);
 }
 
@@ -563,6 +563,61 @@ _mesa_validate_DrawArrays(struct gl_context *ctx, GLenum mode, GLsizei count)
 }
 
 
+/**
+ * Error checking for glMultiDrawArrays().  The mode and the rendering
+ * state are checked even if all the counts are zero.  With GLES3
+ * transform feedback, the primitives of all the ranges are counted
+ * against the buffers at once, so nothing is counted unless all of them
+ * can be drawn.
+ * \return GL_TRUE if OK to render (some counts may still be zero)
+ */
+GLboolean
+_mesa_validate_MultiDrawArrays(struct gl_context *ctx, GLenum mode,
+                               const GLsizei *count, GLsizei primcount)
+{
+   struct gl_transform_feedback_object *xfb_obj
+      = ctx->TransformFeedback.CurrentObject;
+   GLsizei i;
+
+   FLUSH_CURRENT(ctx, 0);
+
+   if (primcount < 0) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glMultiDrawArrays(primcount)");
+      return GL_FALSE;
+   }
+
+   for (i = 0; i < primcount; i++) {
+      if (count[i] < 0) {
+         _mesa_error(ctx, GL_INVALID_VALUE, "glMultiDrawArrays(count)");
+         return GL_FALSE;
+      }
+   }
+
+   if (!_mesa_valid_prim_mode(ctx, mode, "glMultiDrawArrays"))
+      return GL_FALSE;
+
+   if (!check_valid_to_render(ctx, "glMultiDrawArrays"))
+      return GL_FALSE;
+
+   /* See _mesa_validate_DrawArrays(). */
+   if (_mesa_is_gles3(ctx) && _mesa_is_xfb_active_and_unpaused(ctx)) {
+      size_t prim_count = 0;
+
+      for (i = 0; i < primcount; i++)
+         prim_count += vbo_count_tessellated_primitives(mode, count[i], 1);
+
+      if (xfb_obj->GlesRemainingPrims < prim_count) {
+         _mesa_error(ctx, GL_INVALID_OPERATION,
+                     "glMultiDrawArrays(exceeds transform feedback size)");
+         return GL_FALSE;
+      }
+      xfb_obj->GlesRemainingPrims -= prim_count;
+   }
+
+   return GL_TRUE;
+}
+
+
 GLboolean
 _mesa_validate_DrawArraysInstanced(struct gl_context *ctx, GLenum mode, GLint first,
                                    GLsizei count, GLsizei numInstances)
@@ -43,6 +43,7 @@
 #include "glformats.h"
 #include "texstore.h"
 #include "transformfeedback.h"
+#include "vbo/vbo.h"
 
 
 /* Debug flags */
@@ -419,12 +420,14 @@ _mesa_delete_buffer_object(struct gl_context *ctx,
 {
    (void) ctx;
 
+   vbo_delete_minmax_cache(bufObj);
    _mesa_align_free(bufObj->Data);
 
    /* assign strange values here to help w/ debugging */
    bufObj->RefCount = -1000;
    bufObj->Name = ~0;
 
+   mtx_destroy(&bufObj->MinMaxCacheMutex);
    mtx_destroy(&bufObj->Mutex);
    free(bufObj->Label);
    free(bufObj);
@@ -490,6 +493,7 @@ _mesa_initialize_buffer_object(struct gl_context *ctx,
 {
    memset(obj, 0, sizeof(struct gl_buffer_object));
    mtx_init(&obj->Mutex, mtx_plain);
+   mtx_init(&obj->MinMaxCacheMutex, mtx_plain);
    obj->RefCount = 1;
    obj->Name = name;
    obj->Usage = GL_STATIC_DRAW_ARB;
@@ -972,6 +976,12 @@ bind_buffer_object(struct gl_context *ctx, GLenum target, GLuint buffer)
 
    /* bind new buffer */
    _mesa_reference_buffer_object(ctx, bindTarget, newBufObj);
+
+   /* Pixel pack buffers are written by the driver, not through the buffer
+    * object API; remember that so their contents aren't assumed static.
+    */
+   if (target == GL_PIXEL_PACK_BUFFER && buffer != 0)
+      newBufObj->UsageHistory |= USAGE_PIXEL_PACK_BUFFER;
 }
 
 
@@ -1468,6 +1478,7 @@ _mesa_buffer_storage(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
    bufObj->Immutable = GL_TRUE;
 
    assert(ctx->Driver.BufferData);
@@ -1581,6 +1592,7 @@ _mesa_buffer_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1678,6 +1690,7 @@ _mesa_buffer_sub_data(struct gl_context *ctx, struct gl_buffer_object *bufObj,
       return;
 
    bufObj->Written = GL_TRUE;
+   bufObj->MinMaxCacheDirty = true;
 
    assert(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData(ctx, offset, size, data, bufObj);
@@ -1793,6 +1806,9 @@ _mesa_clear_buffer_sub_data(struct gl_context *ctx,
       return;
    }
 
+   if (size > 0)
+      bufObj->MinMaxCacheDirty = true;
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       if (size > 0) {
@@ -2210,6 +2226,8 @@ _mesa_copy_buffer_sub_data(struct gl_context *ctx,
       }
    }
 
+   dst->MinMaxCacheDirty = true;
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -2402,8 +2420,10 @@ _mesa_map_buffer_range(struct gl_context *ctx,
       assert(bufObj->Mappings[MAP_USER].AccessFlags == access);
    }
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
       bufObj->Written = GL_TRUE;
+      bufObj->MinMaxCacheDirty = true;
+   }
 
 #ifdef VBO_DEBUG
    if (strstr(func, "Range") == NULL) { /* If not MapRange */
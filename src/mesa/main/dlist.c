@@ -1547,6 +1547,48 @@ invalidate_saved_current_state(struct gl_context *ctx)
 }
 
 
+/**
+ * Whether glEnable/Disable(cap) can be left out of the list being
+ * compiled because the list already set the capability that way.
+ * Remembers the new state otherwise.  By avoiding these state changes we
+ * have a better chance of coalescing the drawing commands around them.
+ */
+static GLboolean
+enable_is_redundant(struct gl_context *ctx, GLenum cap, GLboolean state)
+{
+   GLenum *caps = ctx->ListState.Current.EnableCap;
+   GLboolean *states = ctx->ListState.Current.EnableState;
+   const GLuint n = ARRAY_SIZE(ctx->ListState.Current.EnableCap);
+   GLuint i;
+
+   for (i = 0; i < n; i++) {
+      if (caps[i] == cap) {
+         if (states[i] == state)
+            return GL_TRUE;
+         states[i] = state;
+         return GL_FALSE;
+      }
+   }
+
+   i = ctx->ListState.Current.NextEnable++ % n;
+   caps[i] = cap;
+   states[i] = state;
+   return GL_FALSE;
+}
+
+
+static void
+forget_enable(struct gl_context *ctx, GLenum cap)
+{
+   GLuint i;
+
+   for (i = 0; i < ARRAY_SIZE(ctx->ListState.Current.EnableCap); i++) {
+      if (ctx->ListState.Current.EnableCap[i] == cap)
+         ctx->ListState.Current.EnableCap[i] = 0;
+   }
+}
+
+
 static void GLAPIENTRY
 save_CallList(GLuint list)
 {
@@ -1889,12 +1931,19 @@ save_ColorMaterial(GLenum face, GLenum mode)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
 
-   n = alloc_instruction(ctx, OPCODE_COLOR_MATERIAL, 2);
-   if (n) {
-      n[1].e = face;
-      n[2].e = mode;
+   /* Don't compile this call if it's a no-op. */
+   if (ctx->ListState.Current.ColorMaterialFace != face ||
+       ctx->ListState.Current.ColorMaterialMode != mode) {
+      SAVE_FLUSH_VERTICES(ctx);
+      ctx->ListState.Current.ColorMaterialFace = face;
+      ctx->ListState.Current.ColorMaterialMode = mode;
+      n = alloc_instruction(ctx, OPCODE_COLOR_MATERIAL, 2);
+      if (n) {
+         n[1].e = face;
+         n[2].e = mode;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_ColorMaterial(ctx->Exec, (face, mode));
@@ -2122,10 +2171,14 @@ save_Disable(GLenum cap)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
-   n = alloc_instruction(ctx, OPCODE_DISABLE, 1);
-   if (n) {
-      n[1].e = cap;
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (!enable_is_redundant(ctx, cap, GL_FALSE)) {
+      SAVE_FLUSH_VERTICES(ctx);
+      n = alloc_instruction(ctx, OPCODE_DISABLE, 1);
+      if (n) {
+         n[1].e = cap;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_Disable(ctx->Exec, (cap));
@@ -2144,6 +2197,9 @@ save_DisableIndexed(GLuint index, GLenum cap)
       n[1].ui = index;
       n[2].e = cap;
    }
+
+   /* glEnable/Disable(cap) no longer set every index the same way. */
+   forget_enable(ctx, cap);
    if (ctx->ExecuteFlag) {
       CALL_Disablei(ctx->Exec, (index, cap));
    }
@@ -2197,10 +2253,14 @@ save_Enable(GLenum cap)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
-   n = alloc_instruction(ctx, OPCODE_ENABLE, 1);
-   if (n) {
-      n[1].e = cap;
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   if (!enable_is_redundant(ctx, cap, GL_TRUE)) {
+      SAVE_FLUSH_VERTICES(ctx);
+      n = alloc_instruction(ctx, OPCODE_ENABLE, 1);
+      if (n) {
+         n[1].e = cap;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_Enable(ctx->Exec, (cap));
@@ -2220,6 +2280,9 @@ save_EnableIndexed(GLuint index, GLenum cap)
       n[1].ui = index;
       n[2].e = cap;
    }
+
+   /* glEnable/Disable(cap) no longer set every index the same way. */
+   forget_enable(ctx, cap);
    if (ctx->ExecuteFlag) {
       CALL_Enablei(ctx->Exec, (index, cap));
    }
@@ -2622,10 +2685,16 @@ save_LineWidth(GLfloat width)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
-   n = alloc_instruction(ctx, OPCODE_LINE_WIDTH, 1);
-   if (n) {
-      n[1].f = width;
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   /* Don't compile this call if it's a no-op. */
+   if (ctx->ListState.Current.LineWidth != width || width <= 0.0F) {
+      SAVE_FLUSH_VERTICES(ctx);
+      ctx->ListState.Current.LineWidth = width;
+      n = alloc_instruction(ctx, OPCODE_LINE_WIDTH, 1);
+      if (n) {
+         n[1].f = width;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_LineWidth(ctx->Exec, (width));
@@ -3121,10 +3190,16 @@ save_PointSize(GLfloat size)
 {
    GET_CURRENT_CONTEXT(ctx);
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
-   n = alloc_instruction(ctx, OPCODE_POINT_SIZE, 1);
-   if (n) {
-      n[1].f = size;
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   /* Don't compile this call if it's a no-op. */
+   if (ctx->ListState.Current.PointSize != size || size <= 0.0F) {
+      SAVE_FLUSH_VERTICES(ctx);
+      ctx->ListState.Current.PointSize = size;
+      n = alloc_instruction(ctx, OPCODE_POINT_SIZE, 1);
+      if (n) {
+         n[1].f = size;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_PointSize(ctx->Exec, (size));
@@ -3136,12 +3211,25 @@ static void GLAPIENTRY
 save_PolygonMode(GLenum face, GLenum mode)
 {
    GET_CURRENT_CONTEXT(ctx);
+   GLenum *current = ctx->ListState.Current.PolygonMode;
+   GLboolean front = face == GL_FRONT || face == GL_FRONT_AND_BACK;
+   GLboolean back = face == GL_BACK || face == GL_FRONT_AND_BACK;
    Node *n;
-   ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
-   n = alloc_instruction(ctx, OPCODE_POLYGON_MODE, 2);
-   if (n) {
-      n[1].e = face;
-      n[2].e = mode;
+   ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
+
+   /* Don't compile this call if it's a no-op. */
+   if ((!front && !back) ||
+       (front && current[0] != mode) || (back && current[1] != mode)) {
+      SAVE_FLUSH_VERTICES(ctx);
+      if (front)
+         current[0] = mode;
+      if (back)
+         current[1] = mode;
+      n = alloc_instruction(ctx, OPCODE_POLYGON_MODE, 2);
+      if (n) {
+         n[1].e = face;
+         n[2].e = mode;
+      }
    }
    if (ctx->ExecuteFlag) {
       CALL_PolygonMode(ctx->Exec, (face, mode));
@@ -3217,6 +3305,10 @@ save_PopAttrib(void)
    GET_CURRENT_CONTEXT(ctx);
    ASSERT_OUTSIDE_SAVE_BEGIN_END_AND_FLUSH(ctx);
    (void) alloc_instruction(ctx, OPCODE_POP_ATTRIB, 0);
+
+   /* This restores state the list may have set. */
+   invalidate_saved_current_state( ctx );
+
    if (ctx->ExecuteFlag) {
       CALL_PopAttrib(ctx->Exec, ());
    }
@@ -3581,24 +3673,21 @@ save_ShadeModel(GLenum mode)
    Node *n;
    ASSERT_OUTSIDE_SAVE_BEGIN_END(ctx);
 
-   if (ctx->ExecuteFlag) {
-      CALL_ShadeModel(ctx->Exec, (mode));
-   }
-
    /* Don't compile this call if it's a no-op.
     * By avoiding this state change we have a better chance of
     * coalescing subsequent drawing commands into one batch.
     */
-   if (ctx->ListState.Current.ShadeModel == mode)
-      return;
-
-   SAVE_FLUSH_VERTICES(ctx);
-
-   ctx->ListState.Current.ShadeModel = mode;
-
-   n = alloc_instruction(ctx, OPCODE_SHADE_MODEL, 1);
-   if (n) {
-      n[1].e = mode;
+   if (ctx->ListState.Current.ShadeModel != mode) {
+      /* Vertices before the call are executed when they are flushed. */
+      SAVE_FLUSH_VERTICES(ctx);
+      ctx->ListState.Current.ShadeModel = mode;
+      n = alloc_instruction(ctx, OPCODE_SHADE_MODEL, 1);
+      if (n) {
+         n[1].e = mode;
+      }
+   }
+   if (ctx->ExecuteFlag) {
+      CALL_ShadeModel(ctx->Exec, (mode));
    }
 }
 
@@ -4358,6 +4447,10 @@ save_ActiveTextureARB(GLenum target)
    if (n) {
       n[1].e = target;
    }
+
+   /* Texture target enables are per unit. */
+   memset(ctx->ListState.Current.EnableCap, 0,
+          sizeof ctx->ListState.Current.EnableCap);
    if (ctx->ExecuteFlag) {
       CALL_ActiveTexture(ctx->Exec, (target));
    }
@@ -495,7 +495,7 @@ static const int extra_core_ARB_color_buffer_float_and_new_buffers[] = {
  * understood by all GL APIs (OpenGL, GLES and GLES2), enums shared
  * between OpenGL and GLES, enums exclusive to GLES, etc for the
  * remaining combinations. To look up the enums valid in a given API
- * we will use a hash table specific to that API. These tables are in
+ * we will use a lookup table specific to that API. These tables are in
  * turn generated at build time and included through get_hash.h.
  */
 
@@ -504,22 +504,22 @@ static const int extra_core_ARB_color_buffer_float_and_new_buffers[] = {
 /* All we need now is a way to look up the value struct from the enum.
  * The code generated by gcc for the old generated big switch
  * statement is a big, balanced, open coded if/else tree, essentially
- * an unrolled binary search.  It would be natural to sort the new
- * enum table and use bsearch(), but we will use a read-only hash
- * table instead.  bsearch() has a nice guaranteed worst case
- * performance, but we're also guaranteed to hit that worst case
- * (log2(n) iterations) for about half the enums.  Instead, using an
- * open addressing hash table, we can find the enum on the first try
- * for 80% of the enums, 1 collision for 10% and never more than 5
- * collisions for any enum (typical numbers).  And the code is very
- * simple, even though it feels a little magic. */
+ * an unrolled binary search, and an open addressing hash table still
+ * needs a loop comparing enums to find the entry.  Applications that
+ * poll many values per frame pay for that on every query, so instead
+ * each API has a table indexed by the high bits of the enum, giving
+ * the page of the 'pages' array holding the index in 'values' of each
+ * enum with those high bits.  A lookup is then two dependent loads
+ * without any loop or comparison.  Pages without any valid enum all
+ * share page 0, which holds only the invalid index 0, and pages that
+ * are the same for several APIs are shared too, which keeps the tables
+ * small despite the enums being spread out over a wide range. */
 
 #ifdef GET_DEBUG
 static void
 print_table_stats(int api)
 {
-   int i, j, collisions[11], count, hash, mask;
-   const struct value_desc *d;
+   int i, j, count, used_pages;
    const char *api_names[] = {
       [API_OPENGL_COMPAT] = "GL",
       [API_OPENGL_CORE] = "GL_CORE",
@@ -530,43 +530,30 @@ print_table_stats(int api)
 
    api_name = api < ARRAY_SIZE(api_names) ? api_names[api] : "N/A";
    count = 0;
-   mask = ARRAY_SIZE(table(api)) - 1;
-   memset(collisions, 0, sizeof collisions);
+   used_pages = 0;
 
-   for (i = 0; i < ARRAY_SIZE(table(api)); i++) {
+   for (i = 0; i < GET_NUM_PAGES; i++) {
       if (!table(api)[i])
          continue;
-      count++;
-      d = &values[table(api)[i]];
-      hash = (d->pname * prime_factor);
-      j = 0;
-      while (1) {
-         if (values[table(api)[hash & mask]].pname == d->pname)
-            break;
-         hash += prime_step;
-         j++;
-      }
-
-      if (j < 10)
-         collisions[j]++;
-      else
-         collisions[10]++;
+      used_pages++;
+      for (j = 0; j <= GET_PAGE_MASK; j++)
+         if (pages[table(api)[i]][j])
+            count++;
    }
 
-   printf("number of enums for %s: %d (total %ld)\n",
-         api_name, count, ARRAY_SIZE(values));
-   for (i = 0; i < ARRAY_SIZE(collisions) - 1; i++)
-      if (collisions[i] > 0)
-         printf("  %d enums with %d %scollisions\n",
-               collisions[i], i, i == 10 ? "or more " : "");
+   printf("number of enums for %s: %d (total %ld) in %d of %d pages, "
+          "%ld distinct pages for all APIs\n",
+          api_name, count, ARRAY_SIZE(values), used_pages, GET_NUM_PAGES,
+          ARRAY_SIZE(pages));
 }
 #endif
 
 /**
- * Initialize the enum hash for a given API 
+ * Initialize the enum lookup for a given API
  *
- * This is called from one_time_init() to insert the enum values that
- * are valid for the API in question into the enum hash table.
+ * The lookup tables are generated at build time, so this is only called
+ * from one_time_init() to print statistics about the table of the API in
+ * question when GET_DEBUG is defined.
  *
  * \param the current context, for determining the API in question
  */
@@ -1206,8 +1193,8 @@ static const struct value_desc error_value =
 /**
  * Find the struct value_desc corresponding to the enum 'pname'.
  * 
- * We hash the enum value to get an index into the 'table' array,
- * which holds the index in the 'values' array of struct value_desc.
+ * We look up the page of the enum value in the API's 'table' array, and
+ * the index in the 'values' array of struct value_desc in that page.
  * Once we've found the entry, we do the extra checks, if any, then
  * look up the value and return a pointer to it.
  *
@@ -1230,12 +1217,11 @@ find_value(const char *func, GLenum pname, void **p, union value *v)
 {
    GET_CURRENT_CONTEXT(ctx);
    struct gl_texture_unit *unit;
-   int mask, hash;
    const struct value_desc *d;
-   int api;
+   int api, idx;
 
    api = ctx->API;
-   /* We index into the table_set[] list of per-API hash tables using the API's
+   /* We index into the table_set[] list of per-API lookup tables using the API's
     * value in the gl_api enum. Since GLES 3 doesn't have an API_OPENGL* enum
     * value since it's compatible with GLES2 its entry in table_set[] is at the
     * end.
@@ -1247,27 +1233,20 @@ find_value(const char *func, GLenum pname, void **p, union value *v)
    if (_mesa_is_gles31(ctx)) {
       api = API_OPENGL_LAST + 2;
    }
-   mask = ARRAY_SIZE(table(api)) - 1;
-   hash = (pname * prime_factor);
-   while (1) {
-      int idx = table(api)[hash & mask];
-
-      /* If the enum isn't valid, the hash walk ends with index 0,
-       * pointing to the first entry of values[] which doesn't hold
-       * any valid enum. */
-      if (unlikely(idx == 0)) {
-         _mesa_error(ctx, GL_INVALID_ENUM, "%s(pname=%s)", func,
-               _mesa_enum_to_string(pname));
-         return &error_value;
-      }
+   idx = 0;
+   if (likely(pname < GET_NUM_PAGES << GET_PAGE_SHIFT))
+      idx = pages[table(api)[pname >> GET_PAGE_SHIFT]][pname & GET_PAGE_MASK];
 
-      d = &values[idx];
-      if (likely(d->pname == pname))
-         break;
-
-      hash += prime_step;
+   /* If the enum isn't valid, the lookup gives index 0, pointing to the
+    * first entry of values[] which doesn't hold any valid enum. */
+   if (unlikely(idx == 0)) {
+      _mesa_error(ctx, GL_INVALID_ENUM, "%s(pname=%s)", func,
+            _mesa_enum_to_string(pname));
+      return &error_value;
    }
 
+   d = &values[idx];
+
    if (unlikely(d->extra && !check_extra(ctx, func, d)))
       return &error_value;
 
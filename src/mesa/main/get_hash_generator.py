@@ -26,8 +26,9 @@
 # FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 # IN THE SOFTWARE.
 
-# Generate a C header file containing hash tables of glGet parameter
-# names for each GL API. The generated file is to be included by glGet.c
+# Generate a C header file containing direct lookup tables of glGet
+# parameter names for each GL API. The generated file is to be included by
+# glGet.c
 
 import os, sys, imp, getopt
 from collections import defaultdict
@@ -40,16 +41,19 @@ GLAPI = "%s/../../mapi/glapi/gen" % cur_dir
 sys.path.append(GLAPI)
 import gl_XML
 
-prime_factor = 89
-prime_step = 281
-hash_table_size = 1024
+# Enums are looked up in pages of page_size consecutive enum values, so
+# that the ranges of enums not accepted by glGet only cost one entry each in
+# the page tables.
+page_shift = 6
+page_size = 1 << page_shift
 
 gl_apis=set(["GL", "GL_CORE", "GLES", "GLES2", "GLES3", "GLES31"])
 
-def print_header():
-   print "typedef const unsigned short table_t[%d];\n" % (hash_table_size)
-   print "static const int prime_factor = %d, prime_step = %d;\n" % \
-          (prime_factor, prime_step)
+def print_header(num_pages):
+   print "#define GET_PAGE_SHIFT %d" % (page_shift)
+   print "#define GET_PAGE_MASK %d" % (page_size - 1)
+   print "#define GET_NUM_PAGES %d\n" % (num_pages)
+   print "typedef const unsigned short table_t[GET_NUM_PAGES];\n"
 
 def print_params(params):
    print "static const struct value_desc values[] = {"
@@ -77,25 +81,51 @@ def api_index(api):
 def table_name(api):
    return "table_" + api_name(api)
 
-def print_table(api, table):
-   print "static table_t %s = {" % (table_name(api))
+def print_pages(pages):
+   print "static const unsigned short pages[][%d] = {" % (page_size)
+   row_size = 8
+   for page in pages:
+      print "   {"
+      for i in range(0, page_size, row_size):
+         idx_val = ["%4d" % v for v in page[i : i + row_size]]
+         print " " * 6 + ", ".join(idx_val) + ","
+      print "   },"
+   print "};\n"
 
-   # convert sparse (index, value) table into a dense table
-   dense_table = [0] * hash_table_size
-   for i, v in table:
-      dense_table[i] = v
+def print_table(api, page_indices):
+   print "static table_t %s = {" % (table_name(api))
 
-   row_size = 4
-   for i in range(0, hash_table_size, row_size):
-      row = dense_table[i : i + row_size]
-      idx_val = ["%4d" % v for v in row]
+   row_size = 8
+   for i in range(0, len(page_indices), row_size):
+      idx_val = ["%3d" % v for v in page_indices[i : i + row_size]]
       print " " * 4 + ", ".join(idx_val) + ","
 
    print "};\n"
 
+# Split each table into pages, sharing the pages that are the same in several
+# tables.  Page 0 is all invalid and stands in for every page without enums.
+def paginate_tables(tables, num_pages):
+   pages = [[0] * page_size]
+   page_index = {tuple(pages[0]): 0}
+
+   for table in tables:
+      dense_table = [0] * (num_pages * page_size)
+      for enum_val, idx in table["indices"]:
+         dense_table[enum_val] = idx
+
+      table["pages"] = []
+      for i in range(0, len(dense_table), page_size):
+         page = tuple(dense_table[i : i + page_size])
+         if page not in page_index:
+            page_index[page] = len(pages)
+            pages.append(list(page))
+         table["pages"].append(page_index[page])
+
+   return pages
+
 def print_tables(tables):
    for table in tables:
-      print_table(table["apis"][0], table["indices"])
+      print_table(table["apis"][0], table["pages"])
 
    dense_tables = ['NULL'] * len(api_enum)
    for table in tables:
@@ -124,13 +154,10 @@ def merge_tables(tables):
 
    return merged_tables
 
-def add_to_hash_table(table, hash_val, value):
-   while True:
-      index = hash_val & (hash_table_size - 1)
-      if index not in table:
-         table[index] = value
-         break
-      hash_val += prime_step
+# Some enums are listed under several names, the first one listed is used.
+def add_to_table(table, enum_val, value):
+   if enum_val not in table:
+      table[enum_val] = value
 
 def die(msg):
    sys.stderr.write("%s: %s\n" % (program, msg))
@@ -138,7 +165,7 @@ def die(msg):
 
 program = os.path.basename(sys.argv[0])
 
-def generate_hash_tables(enum_list, enabled_apis, param_descriptors):
+def generate_tables(enum_list, enabled_apis, param_descriptors):
    tables = defaultdict(lambda:{})
 
    # the first entry should be invalid, so that get.c:find_value can use
@@ -164,17 +191,16 @@ def generate_hash_tables(enum_list, enabled_apis, param_descriptors):
       for param in param_block["params"]:
          enum_name = param[0]
          enum_val = enum_list[enum_name].value
-         hash_val = enum_val * prime_factor
 
          for api in valid_apis:
-            add_to_hash_table(tables[api], hash_val, len(params))
-            # Also add GLES2 items to the GLES3 and GLES31 hash table
+            add_to_table(tables[api], enum_val, len(params))
+            # Also add GLES2 items to the GLES3 and GLES31 table
             if api == "GLES2":
-               add_to_hash_table(tables["GLES3"], hash_val, len(params))
-               add_to_hash_table(tables["GLES31"], hash_val, len(params))
-            # Also add GLES3 items to the GLES31 hash table
+               add_to_table(tables["GLES3"], enum_val, len(params))
+               add_to_table(tables["GLES31"], enum_val, len(params))
+            # Also add GLES3 items to the GLES31 table
             if api == "GLES3":
-               add_to_hash_table(tables["GLES31"], hash_val, len(params))
+               add_to_table(tables["GLES31"], enum_val, len(params))
          params.append(["GL_" + enum_name, param[1]])
 
    sorted_tables={}
@@ -217,9 +243,15 @@ if __name__ == '__main__':
    except Exception:
       die("couldn't parse API specification file %s\n" % api_desc_file)
 
-   (params, hash_tables) = generate_hash_tables(api_desc.enums_by_name,
-                              enabled_apis, get_hash_params.descriptor)
+   (params, tables) = generate_tables(api_desc.enums_by_name,
+                         enabled_apis, get_hash_params.descriptor)
+
+   max_enum = max([enum_val for table in tables
+                   for enum_val, idx in table["indices"]])
+   num_pages = (max_enum >> page_shift) + 1
+   pages = paginate_tables(tables, num_pages)
 
-   print_header()
+   print_header(num_pages)
    print_params(params)
-   print_tables(hash_tables)
+   print_pages(pages)
+   print_tables(tables)
@@ -0,0 +1,411 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file glthread.c
+ * The glthread driver thread and the state tracked on the application
+ * thread for deciding whether a call can be queued.
+ */
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/bufferobj.h"
+#include "main/glthread.h"
+#include "main/hash.h"
+#include "main/marshal.h"
+#include "main/mtypes.h"
+#include "glapi/glapi.h"
+
+
+bool
+_mesa_glthread_requested(const struct gl_context *ctx)
+{
+   const char *env = getenv("MESA_GLTHREAD");
+
+   /* Debug contexts promise synchronous error reporting. */
+   if (ctx->Const.ContextFlags & GL_CONTEXT_FLAG_DEBUG_BIT)
+      return false;
+
+   return env && strcmp(env, "0") != 0 && strcmp(env, "false") != 0;
+}
+
+
+static void
+glthread_unmarshal_batch(struct gl_context *ctx, struct glthread_batch *batch)
+{
+   size_t pos = 0;
+
+   while (pos < batch->used)
+      pos += _mesa_unmarshal_dispatch_cmd(ctx, (uint8_t *) batch->buffer + pos);
+
+   assert(pos == batch->used);
+   batch->used = 0;
+}
+
+
+static int
+glthread_worker(void *data)
+{
+   struct gl_context *ctx = data;
+   struct glthread_state *glthread = ctx->GLThread;
+
+   /* Make non-TLS glapi builds switch to per-thread current contexts. */
+   _glapi_check_multithread();
+   _glapi_set_context(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   mtx_lock(&glthread->mutex);
+   for (;;) {
+      struct glthread_batch *batch;
+
+      while (glthread->completed == glthread->submitted &&
+             !glthread->shutdown)
+         cnd_wait(&glthread->new_work, &glthread->mutex);
+
+      if (glthread->completed == glthread->submitted)
+         break;
+
+      batch = &glthread->batches[glthread->completed % MARSHAL_MAX_BATCHES];
+      mtx_unlock(&glthread->mutex);
+
+      glthread_unmarshal_batch(ctx, batch);
+
+      mtx_lock(&glthread->mutex);
+      glthread->completed++;
+      cnd_broadcast(&glthread->work_done);
+   }
+   mtx_unlock(&glthread->mutex);
+
+   return 0;
+}
+
+
+static struct glthread_vao *
+lookup_vao(struct glthread_state *glthread, GLuint name)
+{
+   struct glthread_vao *vao;
+
+   if (name == 0)
+      return &glthread->DefaultVAO;
+
+   vao = _mesa_HashLookup(glthread->VAOs, name);
+   if (vao)
+      return vao;
+
+   vao = CALLOC_STRUCT(glthread_vao);
+   if (!vao) {
+      /* Without tracking, assume the worst about this VAO's draws. */
+      glthread->DefaultVAO.HasUserPointer = true;
+      return &glthread->DefaultVAO;
+   }
+
+   vao->Name = name;
+   _mesa_HashInsert(glthread->VAOs, name, vao);
+   return vao;
+}
+
+
+static void
+free_vao(GLuint key, void *data, void *userData)
+{
+   free(data);
+}
+
+
+/**
+ * Read the tracked bindings back from the context.  Only valid while the
+ * driver thread is idle.
+ */
+static void
+read_bindings(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const struct gl_vertex_array_object *vao = ctx->Array.VAO;
+   struct glthread_vao *tracked = lookup_vao(glthread, vao->Name);
+   unsigned i;
+
+   glthread->ArrayBuffer = ctx->Array.ArrayBufferObj->Name;
+   glthread->CurrentVAO = tracked;
+   tracked->IndexBuffer = vao->IndexBufferObj->Name;
+   tracked->HasUserPointer = false;
+
+   for (i = 0; i < VERT_ATTRIB_MAX; i++) {
+      const struct gl_vertex_attrib_array *array = &vao->VertexAttrib[i];
+      const struct gl_vertex_buffer_binding *binding =
+         &vao->VertexBinding[array->VertexBinding];
+
+      if (array->Ptr && !_mesa_is_bufferobj(binding->BufferObj))
+         tracked->HasUserPointer = true;
+   }
+}
+
+
+/**
+ * Start the driver thread and create the dispatch table that queues calls
+ * to it.  Leaves the context unthreaded on failure.
+ */
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = CALLOC_STRUCT(glthread_state);
+
+   if (!glthread)
+      return;
+
+   ctx->MarshalExec = _mesa_create_marshal_table(ctx);
+   glthread->VAOs = _mesa_NewHashTable();
+   if (!ctx->MarshalExec || !glthread->VAOs)
+      goto fail;
+
+   mtx_init(&glthread->mutex, mtx_plain);
+   cnd_init(&glthread->new_work);
+   cnd_init(&glthread->work_done);
+   glthread->next = &glthread->batches[0];
+
+   ctx->GLThread = glthread;
+   read_bindings(ctx);
+
+   if (thrd_create(&glthread->thread, glthread_worker, ctx) != thrd_success) {
+      ctx->GLThread = NULL;
+      cnd_destroy(&glthread->work_done);
+      cnd_destroy(&glthread->new_work);
+      mtx_destroy(&glthread->mutex);
+      goto fail;
+   }
+   return;
+
+fail:
+   if (glthread->VAOs) {
+      _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
+      _mesa_DeleteHashTable(glthread->VAOs);
+   }
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   free(glthread);
+}
+
+
+/**
+ * Run what is still queued, stop the driver thread and go back to calling
+ * into the driver on the application thread.
+ */
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   _mesa_glthread_finish(ctx);
+
+   mtx_lock(&glthread->mutex);
+   glthread->shutdown = true;
+   cnd_signal(&glthread->new_work);
+   mtx_unlock(&glthread->mutex);
+   thrd_join(glthread->thread, NULL);
+
+   cnd_destroy(&glthread->work_done);
+   cnd_destroy(&glthread->new_work);
+   mtx_destroy(&glthread->mutex);
+
+   _mesa_HashDeleteAll(glthread->VAOs, free_vao, NULL);
+   _mesa_DeleteHashTable(glthread->VAOs);
+
+   if (_glapi_get_dispatch() == ctx->MarshalExec)
+      _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   free(glthread);
+   ctx->GLThread = NULL;
+}
+
+
+/**
+ * Hand the batch being filled to the driver thread and start a new one,
+ * waiting if all batches are still queued.
+ */
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread || glthread->next->used == 0)
+      return;
+
+   mtx_lock(&glthread->mutex);
+   glthread->submitted++;
+   cnd_signal(&glthread->new_work);
+
+   while (glthread->submitted - glthread->completed >= MARSHAL_MAX_BATCHES)
+      cnd_wait(&glthread->work_done, &glthread->mutex);
+
+   glthread->next =
+      &glthread->batches[glthread->submitted % MARSHAL_MAX_BATCHES];
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Wait for the driver thread to execute everything queued so far.  After
+ * this the context can be used directly until the next call is queued.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   /* Driver code running on the driver thread can't wait for itself. */
+   if (thrd_equal(thrd_current(), glthread->thread))
+      return;
+
+   _mesa_glthread_flush_batch(ctx);
+
+   mtx_lock(&glthread->mutex);
+   while (glthread->completed != glthread->submitted)
+      cnd_wait(&glthread->work_done, &glthread->mutex);
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Prepare for a call executed on the application thread: wait for the
+ * driver thread and let anything the call dispatches internally reach the
+ * driver rather than the queue.
+ */
+void
+_mesa_glthread_begin_sync(struct gl_context *ctx)
+{
+   _mesa_glthread_finish(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+}
+
+
+void
+_mesa_glthread_end_sync(struct gl_context *ctx)
+{
+   _glapi_set_dispatch(ctx->MarshalExec);
+}
+
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->ArrayBuffer = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      glthread->CurrentVAO->IndexBuffer = buffer;
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (n < 0 || !buffers)
+      return;
+
+   /* Deleting a buffer unbinds it from the current VAO only. */
+   for (i = 0; i < n; i++) {
+      if (buffers[i] == 0)
+         continue;
+      if (glthread->ArrayBuffer == buffers[i])
+         glthread->ArrayBuffer = 0;
+      if (glthread->CurrentVAO->IndexBuffer == buffers[i])
+         glthread->CurrentVAO->IndexBuffer = 0;
+   }
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->CurrentVAO = lookup_vao(glthread, array);
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (n < 0 || !arrays)
+      return;
+
+   for (i = 0; i < n; i++) {
+      struct glthread_vao *vao;
+
+      if (arrays[i] == 0)
+         continue;
+
+      vao = _mesa_HashLookup(glthread->VAOs, arrays[i]);
+      if (!vao)
+         continue;
+
+      if (glthread->CurrentVAO == vao)
+         glthread->CurrentVAO = &glthread->DefaultVAO;
+
+      _mesa_HashRemove(glthread->VAOs, arrays[i]);
+      free(vao);
+   }
+}
+
+
+void
+_mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                        GLuint vaobj, GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (vaobj != 0)
+      lookup_vao(glthread, vaobj)->IndexBuffer = buffer;
+}
+
+
+/**
+ * glPopClientAttrib restores bindings we can't know about; it runs
+ * synchronously and this reads them back afterwards.
+ */
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   read_bindings(ctx);
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file glthread.h
+ * Application-side GL command marshalling ("glthread").
+ *
+ * When enabled, the dispatch table installed on the application thread
+ * packs the arguments of most GL calls into batches that a driver thread
+ * unpacks and executes through ctx->CurrentDispatch.  Calls that return
+ * values, write to application memory or read application memory whose
+ * size isn't known up front wait for the driver thread to go idle and run
+ * directly on the application thread instead.
+ */
+
+#ifndef GLTHREAD_H
+#define GLTHREAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "main/glheader.h"
+#include "c11/threads.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_context;
+struct _mesa_HashTable;
+
+/** Size in bytes of one batch of queued commands. */
+#define MARSHAL_BATCH_SIZE (64 * 1024)
+
+/**
+ * Largest single command.  Anything larger, e.g. a big glBufferData, is
+ * executed synchronously rather than copied.
+ */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+/**
+ * Number of batches: one being filled by the application thread while the
+ * others wait for, or are being executed by, the driver thread.
+ */
+#define MARSHAL_MAX_BATCHES 4
+
+
+struct glthread_batch
+{
+   /** Bytes of buffer[] holding commands. */
+   size_t used;
+
+   /** Commands, each aligned to 8 bytes. */
+   uint64_t buffer[MARSHAL_BATCH_SIZE / 8];
+};
+
+
+/**
+ * The parts of a vertex array object the application thread needs to know
+ * about to decide whether a draw can be queued.
+ */
+struct glthread_vao
+{
+   GLuint Name;
+
+   /** Element array buffer bound to the VAO. */
+   GLuint IndexBuffer;
+
+   /**
+    * Set once a vertex array of the VAO has been pointed at application
+    * memory.  Draws then read that memory and have to be synchronous.
+    */
+   bool HasUserPointer;
+};
+
+
+struct glthread_state
+{
+   /** The driver thread. */
+   thrd_t thread;
+
+   /** Protects submitted, completed and shutdown. */
+   mtx_t mutex;
+
+   /** Signalled when a batch is submitted or on shutdown. */
+   cnd_t new_work;
+
+   /** Signalled when the driver thread has executed a batch. */
+   cnd_t work_done;
+
+   bool shutdown;
+
+   /**
+    * Batches submitted to and completed by the driver thread since the
+    * context was created.  Batch n lives in batches[n % MARSHAL_MAX_BATCHES].
+    */
+   unsigned submitted;
+   unsigned completed;
+
+   struct glthread_batch batches[MARSHAL_MAX_BATCHES];
+
+   /** The batch the application thread is filling. */
+   struct glthread_batch *next;
+
+   /** \name Bindings tracked on the application thread */
+   /*@{*/
+   GLuint ArrayBuffer;
+   struct glthread_vao *CurrentVAO;
+   struct glthread_vao DefaultVAO;
+   struct _mesa_HashTable *VAOs;
+   /*@}*/
+};
+
+
+extern bool
+_mesa_glthread_requested(const struct gl_context *ctx);
+
+extern void
+_mesa_glthread_init(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_destroy(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_flush_batch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_finish(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_begin_sync(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_end_sync(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+
+extern void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+extern void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array);
+
+extern void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays);
+
+extern void
+_mesa_glthread_VertexArrayElementBuffer(struct gl_context *ctx,
+                                        GLuint vaobj, GLuint buffer);
+
+extern void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GLTHREAD_H */
@@ -3,7 +3,8 @@
  * Generic hash table. 
  *
  * Used for display lists, texture objects, vertex/fragment programs,
- * buffer objects, etc.  The hash functions are thread-safe.
+ * buffer objects, etc.  The hash functions are thread-safe, and looking
+ * up names generated by glGen*() doesn't take a lock.
  * 
  * \note key=0 is illegal.
  *
@@ -37,6 +38,7 @@
 #include "glheader.h"
 #include "imports.h"
 #include "hash.h"
+#include "macros.h"
 #include "util/hash_table.h"
 
 /**
@@ -48,23 +50,63 @@
  * and we use a 1:1 mapping from GLuints to key pointers, so we need to be
  * able to track a GLuint that happens to match the deleted key outside of
  * struct hash_table.  We tell the hash table to use "1" as the deleted key
- * value, so that we test the deleted-key-in-the-table path as best we can.
+ * value, and key 1 always lives in the dense array below.
  */
 #define DELETED_KEY_VALUE 1
 
+/** Number of keys the dense array covers when the table is created. */
+#define MIN_DENSE_SIZE 64
+
+/**
+ * The dense array is only grown to cover a key if it stays at most this
+ * many times the number of objects in the table (or MIN_GROW_SIZE).
+ */
+#define MAX_DENSE_SPARSENESS 4
+#define MIN_GROW_SIZE 1024
+
+/**
+ * Directly indexed array holding the objects named [1, Size).
+ *
+ * Lookups read it without taking the mutex.  A grown array replaces it
+ * but the old one is only freed with the table, since a reader may still
+ * be looking at it.  Growth is geometric, so this at most doubles the
+ * memory used.
+ */
+struct dense_array {
+   GLuint Size;
+   struct dense_array *Retired;   /**< array this one replaced */
+   void *Slots[];
+};
+
 /**
  * The hash table data structure.  
  */
 struct _mesa_HashTable {
+   /** Names below Dense->Size, read without locking. */
+   struct dense_array *volatile Dense;
+   /** All other names, protected by Mutex. */
    struct hash_table *ht;
+   GLuint NumEntries;                    /**< objects in Dense and ht */
    GLuint MaxKey;                        /**< highest key inserted so far */
-   mtx_t Mutex;                /**< mutual exclusion lock */
+   mtx_t Mutex;                /**< mutual exclusion lock for writers */
    mtx_t WalkMutex;            /**< for _mesa_HashWalk() */
    GLboolean InDeleteAll;                /**< Debug check */
-   /** Value that would be in the table for DELETED_KEY_VALUE. */
-   void *deleted_key_data;
 };
 
+/**
+ * Make the stores done so far visible to other threads before the next
+ * one, for a reader which reaches the new data through the pointer stored
+ * next.  Readers rely on the address dependency for their side.
+ */
+#if defined(__GNUC__)
+#define publish_barrier() __sync_synchronize()
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define publish_barrier() _ReadWriteBarrier()
+#else
+#error "no memory barrier for this compiler"
+#endif
+
 /** @{
  * Mapping from our use of GLuint as both the key and the hash value to the
  * hash_table.h API
@@ -72,17 +114,10 @@ struct _mesa_HashTable {
  * There exist many integer hash functions, designed to avoid collisions when
  * the integers are spread across key space with some patterns.  In GL, the
  * pattern (in the case of glGen*()ed object IDs) is that the keys are unique
- * contiguous integers starting from 1.  Because of that, we just use the key
- * as the hash value, to minimize the cost of the hash function.  If objects
- * are never deleted, we will never see a collision in the table, because the
- * table resizes itself when it approaches full, and thus key % table_size ==
- * key.
- *
- * The case where we could have collisions for genned objects would be
- * something like: glGenBuffers(&a, 100); glDeleteBuffers(&a + 50, 50);
- * glGenBuffers(&b, 100), because objects 1-50 and 101-200 are allocated at
- * the end of that sequence, instead of 1-150.  So far it doesn't appear to be
- * a problem.
+ * contiguous integers starting from 1, and these end up in the dense array.
+ * The keys left for the hash table are the few names the application chose
+ * itself, so we just use the key as the hash value, to minimize the cost of
+ * the hash function.
  */
 static bool
 uint_key_compare(const void *a, const void *b)
@@ -109,6 +144,18 @@ uint_key(GLuint id)
 }
 /** @} */
 
+
+static struct dense_array *
+dense_array_create(GLuint size)
+{
+   struct dense_array *dense =
+      calloc(1, sizeof(struct dense_array) + size * sizeof(void *));
+
+   if (dense)
+      dense->Size = size;
+   return dense;
+}
+
 /**
  * Create a new hash table.
  * 
@@ -122,7 +169,11 @@ _mesa_NewHashTable(void)
    if (table) {
       table->ht = _mesa_hash_table_create(NULL, uint_key_hash,
                                           uint_key_compare);
-      if (table->ht == NULL) {
+      table->Dense = dense_array_create(MIN_DENSE_SIZE);
+      if (table->ht == NULL || table->Dense == NULL) {
+         if (table->ht)
+            _mesa_hash_table_destroy(table->ht, NULL);
+         free(table->Dense);
          free(table);
          _mesa_error_no_memory(__func__);
          return NULL;
@@ -152,14 +203,23 @@ _mesa_NewHashTable(void)
 void
 _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 {
+   struct dense_array *dense;
+
    assert(table);
 
-   if (_mesa_hash_table_next_entry(table->ht, NULL) != NULL) {
+   if (table->NumEntries) {
       _mesa_problem(NULL, "In _mesa_DeleteHashTable, found non-freed data");
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   dense = table->Dense;
+   while (dense) {
+      struct dense_array *retired = dense->Retired;
+      free(dense);
+      dense = retired;
+   }
+
    mtx_destroy(&table->Mutex);
    mtx_destroy(&table->WalkMutex);
    free(table);
@@ -168,19 +228,20 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
 
 /**
- * Lookup an entry in the hash table, without locking.
+ * Lookup an entry in the hash table, with the mutex locked.
  * \sa _mesa_HashLookup
  */
 static inline void *
 _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct dense_array *dense = table->Dense;
    const struct hash_entry *entry;
 
    assert(table);
    assert(key);
 
-   if (key == DELETED_KEY_VALUE)
-      return table->deleted_key_data;
+   if (key < dense->Size)
+      return dense->Slots[key];
 
    entry = _mesa_hash_table_search(table->ht, uint_key(key));
    if (!entry)
@@ -192,6 +253,9 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Names in the dense array are looked up without locking; only names
+ * the application chose itself, outside of it, need the mutex.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -201,8 +265,18 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct dense_array *dense = table->Dense;
    void *res;
+
    assert(table);
+   assert(key);
+
+   if (likely(key < dense->Size))
+      return ((void *volatile *) dense->Slots)[key];
+
+   /* The dense array may have grown to cover the key meanwhile, which
+    * _mesa_HashLookup_unlocked checks again.
+    */
    mtx_lock(&table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    mtx_unlock(&table->Mutex);
@@ -258,10 +332,56 @@ _mesa_HashUnlockMutex(struct _mesa_HashTable *table)
 }
 
 
+/**
+ * Grow the dense array to cover \p key if it doesn't get too sparse,
+ * moving the entries it now covers out of the hash table.
+ */
+static void
+grow_dense_array(struct _mesa_HashTable *table, GLuint key)
+{
+   struct dense_array *old = table->Dense, *dense;
+   struct hash_entry *entry;
+   GLuint size = old->Size;
+
+   if (key >= 1u << 31)
+      return;
+
+   while (size <= key)
+      size *= 2;
+
+   if (size > MAX2(MIN_GROW_SIZE,
+                   MAX_DENSE_SPARSENESS * (table->NumEntries + 1)))
+      return;
+
+   dense = dense_array_create(size);
+   if (!dense)
+      return;
+
+   memcpy(dense->Slots, old->Slots, old->Size * sizeof(void *));
+   hash_table_foreach(table->ht, entry) {
+      if ((uintptr_t)entry->key < size)
+         dense->Slots[(uintptr_t)entry->key] = entry->data;
+   }
+   dense->Retired = old;
+
+   publish_barrier();
+   table->Dense = dense;
+
+   /* Lookups of these keys now find them in the dense array, or wait for
+    * the mutex and then do.
+    */
+   hash_table_foreach(table->ht, entry) {
+      if ((uintptr_t)entry->key < size)
+         _mesa_hash_table_remove(table->ht, entry);
+   }
+}
+
+
 static inline void
 _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
 {
    uint32_t hash = uint_hash(key);
+   struct dense_array *dense;
    struct hash_entry *entry;
 
    assert(table);
@@ -270,14 +390,22 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = data;
+   if (key >= table->Dense->Size)
+      grow_dense_array(table, key);
+
+   dense = table->Dense;
+   if (key < dense->Size) {
+      /* A NULL slot is an unused name. */
+      table->NumEntries += (data != NULL) - (dense->Slots[key] != NULL);
+      publish_barrier();
+      dense->Slots[key] = data;
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
       if (entry) {
          entry->data = data;
       } else {
          _mesa_hash_table_insert_pre_hashed(table->ht, hash, uint_key(key), data);
+         table->NumEntries++;
       }
    }
 }
@@ -331,6 +459,7 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
 void
 _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
 {
+   struct dense_array *dense;
    struct hash_entry *entry;
 
    assert(table);
@@ -344,11 +473,18 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
    }
 
    mtx_lock(&table->Mutex);
-   if (key == DELETED_KEY_VALUE) {
-      table->deleted_key_data = NULL;
+   dense = table->Dense;
+   if (key < dense->Size) {
+      if (dense->Slots[key]) {
+         dense->Slots[key] = NULL;
+         table->NumEntries--;
+      }
    } else {
       entry = _mesa_hash_table_search(table->ht, uint_key(key));
-      _mesa_hash_table_remove(table->ht, entry);
+      if (entry) {
+         _mesa_hash_table_remove(table->ht, entry);
+         table->NumEntries--;
+      }
    }
    mtx_unlock(&table->Mutex);
 }
@@ -369,20 +505,26 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
                     void (*callback)(GLuint key, void *data, void *userData),
                     void *userData)
 {
+   struct dense_array *dense;
    struct hash_entry *entry;
+   GLuint key;
 
    assert(table);
    assert(callback);
    mtx_lock(&table->Mutex);
    table->InDeleteAll = GL_TRUE;
+   dense = table->Dense;
+   for (key = 1; key < dense->Size; key++) {
+      if (dense->Slots[key]) {
+         callback(key, dense->Slots[key], userData);
+         dense->Slots[key] = NULL;
+      }
+   }
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
    }
-   if (table->deleted_key_data) {
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
-      table->deleted_key_data = NULL;
-   }
+   table->NumEntries = 0;
    table->InDeleteAll = GL_FALSE;
    mtx_unlock(&table->Mutex);
 }
@@ -407,16 +549,22 @@ _mesa_HashWalk(const struct _mesa_HashTable *table,
 {
    /* cast-away const */
    struct _mesa_HashTable *table2 = (struct _mesa_HashTable *) table;
+   const struct dense_array *dense;
    struct hash_entry *entry;
+   GLuint key;
 
    assert(table);
    assert(callback);
    mtx_lock(&table2->WalkMutex);
+   dense = table->Dense;
+   for (key = 1; key < dense->Size; key++) {
+      void *data = ((void *volatile *) dense->Slots)[key];
+      if (data)
+         callback(key, data, userData);
+   }
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
    }
-   if (table->deleted_key_data)
-      callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
    mtx_unlock(&table2->WalkMutex);
 }
 
@@ -434,8 +582,6 @@ debug_print_entry(GLuint key, void *data, void *userData)
 void
 _mesa_HashPrint(const struct _mesa_HashTable *table)
 {
-   if (table->deleted_key_data)
-      debug_print_entry(DELETED_KEY_VALUE, table->deleted_key_data, NULL);
    _mesa_HashWalk(table, debug_print_entry, NULL);
 }
 
@@ -496,14 +642,5 @@ _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 GLuint
 _mesa_HashNumEntries(const struct _mesa_HashTable *table)
 {
-   struct hash_entry *entry;
-   GLuint count = 0;
-
-   if (table->deleted_key_data)
-      count++;
-
-   hash_table_foreach(table->ht, entry)
-      count++;
-
-   return count;
+   return table->NumEntries;
 }
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file marshal.h
+ * Helpers used by the generated glthread entry points in
+ * marshal_generated.c.
+ */
+
+#ifndef MARSHAL_H
+#define MARSHAL_H
+
+#include "main/glthread.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "util/macros.h"
+
+/**
+ * Header of every queued command.  The command's parameters follow it.
+ */
+struct marshal_cmd_base
+{
+   /** One of enum marshal_dispatch_cmd_id. */
+   uint16_t cmd_id;
+
+   /** Size of the command including this header, a multiple of 8. */
+   uint16_t cmd_size;
+};
+
+
+/**
+ * Reserve \p size bytes for a command in the batch being filled, handing
+ * the batch to the driver thread first if it is full.
+ */
+static inline void *
+_mesa_glthread_allocate_command(struct gl_context *ctx, uint16_t cmd_id,
+                                size_t size)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_batch *next = glthread->next;
+   struct marshal_cmd_base *cmd_base;
+   const size_t aligned_size = ALIGN(size, 8);
+
+   assert(aligned_size <= MARSHAL_MAX_CMD_SIZE);
+
+   if (unlikely(next->used + aligned_size > MARSHAL_BATCH_SIZE)) {
+      _mesa_glthread_flush_batch(ctx);
+      next = glthread->next;
+   }
+
+   cmd_base = (struct marshal_cmd_base *)
+      ((uint8_t *) next->buffer + next->used);
+   next->used += aligned_size;
+   cmd_base->cmd_id = cmd_id;
+   cmd_base->cmd_size = aligned_size;
+   return cmd_base;
+}
+
+
+/**
+ * Called for gl*Pointer: a pointer set while no array buffer is bound
+ * points at application memory.
+ */
+static inline void
+_mesa_glthread_vertex_pointer(struct gl_context *ctx, const void *pointer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->ArrayBuffer == 0 && pointer != NULL)
+      glthread->CurrentVAO->HasUserPointer = true;
+}
+
+
+/**
+ * Whether a draw reads application memory at the time of the call, which
+ * the driver thread could only do after the application has moved on.
+ */
+static inline bool
+_mesa_glthread_draw_needs_sync(const struct gl_context *ctx, bool indexed)
+{
+   const struct glthread_vao *vao = ctx->GLThread->CurrentVAO;
+
+   return vao->HasUserPointer || (indexed && vao->IndexBuffer == 0);
+}
+
+
+extern size_t
+_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd);
+
+extern struct _glapi_table *
+_mesa_create_marshal_table(const struct gl_context *ctx);
+
+#endif /* MARSHAL_H */
@@ -45,6 +45,14 @@
 #include "math/m_matrix.h"
 
 
+static const GLfloat Identity[16] = {
+   1.0, 0.0, 0.0, 0.0,
+   0.0, 1.0, 0.0, 0.0,
+   0.0, 0.0, 1.0, 0.0,
+   0.0, 0.0, 0.0, 1.0
+};
+
+
 /**
  * Apply a perspective projection matrix.
  *
@@ -140,7 +148,7 @@ _mesa_Ortho( GLdouble left, GLdouble right,
  *
  * \sa glMatrixMode().
  *
- * Flushes the vertices, validates the parameter and updates
+ * Validates the parameter and updates
  * __struct gl_contextRec::CurrentStack and gl_transform_attrib::MatrixMode
  * with the specified matrix stack.
  */
@@ -151,7 +159,11 @@ _mesa_MatrixMode( GLenum mode )
 
    if (ctx->Transform.MatrixMode == mode && mode != GL_TEXTURE)
       return;
-   FLUSH_VERTICES(ctx, _NEW_TRANSFORM);
+
+   /* Selecting a stack doesn't change how anything is drawn, so there's no
+    * need to flush vertices.
+    */
+   ctx->NewState |= _NEW_TRANSFORM;
 
    switch (mode) {
    case GL_MODELVIEW:
@@ -256,8 +268,8 @@ _mesa_PushMatrix( void )
  *
  * \sa glPopMatrix().
  * 
- * Flushes the vertices, verifies the current matrix stack is not empty, and
- * moves the stack head down.
+ * Verifies the current matrix stack is not empty, flushes the vertices if
+ * the matrix changes, and moves the stack head down.
  * Marks __struct gl_contextRec::NewState with the dirty stack flag.
  */
 void GLAPIENTRY
@@ -266,8 +278,6 @@ _mesa_PopMatrix( void )
    GET_CURRENT_CONTEXT(ctx);
    struct gl_matrix_stack *stack = ctx->CurrentStack;
 
-   FLUSH_VERTICES(ctx, 0);
-
    if (MESA_VERBOSE&VERBOSE_API)
       _mesa_debug(ctx, "glPopMatrix %s\n",
                   _mesa_enum_to_string(ctx->Transform.MatrixMode));
@@ -284,6 +294,14 @@ _mesa_PopMatrix( void )
       }
       return;
    }
+
+   /* Vertices drawn with the current matrix only need flushing if it
+    * changes, which it often doesn't after glPushMatrix.
+    */
+   if (memcmp(stack->Stack[stack->Depth - 1].m, stack->Top->m,
+              16 * sizeof(GLfloat)) != 0)
+      FLUSH_VERTICES(ctx, 0);
+
    stack->Depth--;
    stack->Top = &(stack->Stack[stack->Depth]);
    ctx->NewState |= stack->DirtyFlag;
@@ -295,8 +313,8 @@ _mesa_PopMatrix( void )
  *
  * \sa glLoadIdentity().
  *
- * Flushes the vertices and calls _math_matrix_set_identity() with the
- * top-most matrix in the current stack.
+ * Unless it already is the identity, flushes the vertices and calls
+ * _math_matrix_set_identity() with the top-most matrix in the current stack.
  * Marks __struct gl_contextRec::NewState with the stack dirty flag.
  */
 void GLAPIENTRY
@@ -304,11 +322,13 @@ _mesa_LoadIdentity( void )
 {
    GET_CURRENT_CONTEXT(ctx);
 
-   FLUSH_VERTICES(ctx, 0);
-
    if (MESA_VERBOSE & VERBOSE_API)
       _mesa_debug(ctx, "glLoadIdentity()\n");
 
+   if (memcmp(ctx->CurrentStack->Top->m, Identity, sizeof(Identity)) == 0)
+      return;
+
+   FLUSH_VERTICES(ctx, 0);
    _math_matrix_set_identity( ctx->CurrentStack->Top );
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
 }
@@ -338,6 +358,9 @@ _mesa_LoadMatrixf( const GLfloat *m )
           m[2], m[6], m[10], m[14],
           m[3], m[7], m[11], m[15]);
 
+   if (memcmp(ctx->CurrentStack->Top->m, m, 16 * sizeof(GLfloat)) == 0)
+      return;
+
    FLUSH_VERTICES(ctx, 0);
    _math_matrix_loadf( ctx->CurrentStack->Top, m );
    ctx->NewState |= ctx->CurrentStack->DirtyFlag;
@@ -37,11 +37,39 @@
 #include "texstore.h"
 #include "image.h"
 #include "macros.h"
+#include "c11/threads.h"
+#include "util/format_srgb.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
 
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __F16C__
+#include <immintrin.h>
+#endif
+#ifdef HAVE_PTHREAD
+#include <unistd.h>
+#endif
+
+
+/** Don't hand a worker thread less than this many bytes of dest image */
+#define MIPMAP_MIN_BYTES_PER_THREAD (128 * 1024)
+
+/** Upper bound on the number of threads used for one mipmap level */
+#define MIPMAP_MAX_THREADS 8
+
+
+static inline GLboolean
+is_srgb8_datatype(GLenum datatype)
+{
+   return datatype >= MESA_MIPMAP_SRGB8 &&
+          datatype <= MESA_MIPMAP_SRGB8_ALPHA(3);
+}
+
+
 static GLint
 bytes_per_pixel(GLenum datatype, GLuint comps)
 {
@@ -51,6 +79,9 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
        datatype == GL_UNSIGNED_INT_24_8_MESA)
       return 4;
 
+   if (is_srgb8_datatype(datatype))
+      return comps;
+
    b = _mesa_sizeof_packed_type(datatype);
    assert(b >= 0);
 
@@ -61,6 +92,153 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 }
 
 
+/**
+ * Average 2 (2D) or 4 (3D) rows of 8-bit sRGB texels.  The color channels
+ * are converted to linear space before they're averaged and re-encoded
+ * afterwards, so a level doesn't get darker than the one above it; the
+ * alpha channel named by the datatype is averaged as plain unorm8, rounding
+ * the same way as the GL_UNSIGNED_BYTE paths.
+ */
+static void
+do_row_srgb8(GLenum datatype, GLuint comps, GLint srcWidth,
+             const GLubyte *const *srcRows, GLuint numRows,
+             GLint dstWidth, GLubyte *dstRow)
+{
+   const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
+   const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
+   const GLuint alpha = datatype - MESA_MIPMAP_SRGB8_ALPHA(0);
+   const GLfloat scale = 1.0F / (2 * numRows);
+   GLuint i, j, k, comp, r;
+
+   assert(numRows == 2 || numRows == 4);
+
+   for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+        i++, j += colStride, k += colStride) {
+      for (comp = 0; comp < comps; comp++) {
+         if (comp == alpha) {
+            GLuint sum = 0;
+            for (r = 0; r < numRows; r++)
+               sum += srcRows[r][j * comps + comp] +
+                      srcRows[r][k * comps + comp];
+            dstRow[i * comps + comp] =
+               numRows == 2 ? sum / 4 : (sum + 4) >> 3;
+         }
+         else {
+            GLfloat sum = 0.0F;
+            for (r = 0; r < numRows; r++)
+               sum += util_format_srgb_8unorm_to_linear_float(
+                         srcRows[r][j * comps + comp]) +
+                      util_format_srgb_8unorm_to_linear_float(
+                         srcRows[r][k * comps + comp]);
+            dstRow[i * comps + comp] =
+               util_format_linear_float_to_srgb_8unorm(sum * scale);
+         }
+      }
+   }
+}
+
+
+/**
+ * \name SIMD versions of the most common 2:1 do_row() cases.
+ *
+ * Each returns the number of dest texels it produced; do_row() finishes
+ * the remainder with the scalar loop.  Results are bit-identical to the
+ * scalar code.
+ */
+/*@{*/
+#ifdef __SSE2__
+static GLuint
+do_row_ubyte4_sse2(const GLubyte *rowA, const GLubyte *rowB,
+                   GLuint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   GLuint i;
+
+   /* 8 source texels -> 4 dest texels per iteration */
+   for (i = 0; i + 4 <= dstWidth; i += 4) {
+      __m128i out[2];
+      int half;
+
+      for (half = 0; half < 2; half++) {
+         const __m128i a = _mm_loadu_si128((const __m128i *)
+                                           (rowA + 32 * (i / 4) + 16 * half));
+         const __m128i b = _mm_loadu_si128((const __m128i *)
+                                           (rowB + 32 * (i / 4) + 16 * half));
+         /* texels 0,1 and 2,3 widened to 16 bits, rows A and B summed */
+         const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                          _mm_unpacklo_epi8(b, zero));
+         const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                          _mm_unpackhi_epi8(b, zero));
+         /* add horizontally adjacent texels: (0 + 1), (2 + 3) */
+         const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi),
+                                           _mm_unpackhi_epi64(lo, hi));
+         out[half] = _mm_srli_epi16(sum, 2);
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + 4 * i),
+                       _mm_packus_epi16(out[0], out[1]));
+   }
+
+   return i;
+}
+
+
+static GLuint
+do_row_float4_sse2(const GLfloat *rowA, const GLfloat *rowB,
+                   GLuint colStride, GLuint k0,
+                   GLuint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i, j, k;
+
+   for (i = j = 0, k = k0; i < dstWidth;
+        i++, j += colStride, k += colStride) {
+      /* same summation order as the scalar code */
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(rowA + 4 * j),
+                              _mm_loadu_ps(rowA + 4 * k));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(rowB + 4 * j));
+      sum = _mm_add_ps(sum, _mm_loadu_ps(rowB + 4 * k));
+      _mm_storeu_ps(dst + 4 * i, _mm_mul_ps(sum, quarter));
+   }
+
+   return i;
+}
+#endif /* __SSE2__ */
+
+
+#ifdef __F16C__
+static GLuint
+do_row_half4_f16c(const GLhalfARB *rowA, const GLhalfARB *rowB,
+                  GLuint colStride, GLuint k0,
+                  GLuint dstWidth, GLhalfARB *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   GLuint i, j, k;
+
+   for (i = j = 0, k = k0; i < dstWidth;
+        i++, j += colStride, k += colStride) {
+      __m128 sum;
+
+      sum = _mm_add_ps(
+         _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (rowA + 4 * j))),
+         _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (rowA + 4 * k))));
+      sum = _mm_add_ps(sum,
+         _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (rowB + 4 * j))));
+      sum = _mm_add_ps(sum,
+         _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *) (rowB + 4 * k))));
+
+      /* round-to-nearest-even, like _mesa_float_to_half() */
+      _mm_storel_epi64((__m128i *) (dst + 4 * i),
+                       _mm_cvtps_ph(_mm_mul_ps(sum, quarter),
+                                    _MM_FROUND_TO_NEAREST_INT));
+   }
+
+   return i;
+}
+#endif /* __F16C__ */
+/*@}*/
+
+
 /**
  * \name Support macros for do_row and do_row_3d
  *
@@ -160,12 +338,24 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
 
-   if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
-      GLuint i, j, k;
+   if (is_srgb8_datatype(datatype)) {
+      const GLubyte *rows[2];
+      rows[0] = (const GLubyte *) srcRowA;
+      rows[1] = (const GLubyte *) srcRowB;
+      do_row_srgb8(datatype, comps, srcWidth, rows, 2,
+                   dstWidth, (GLubyte *) dstRow);
+   }
+
+   else if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
+      GLuint i = 0, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
       const GLubyte(*rowB)[4] = (const GLubyte(*)[4]) srcRowB;
       GLubyte(*dst)[4] = (GLubyte(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      if (colStride == 2)
+         i = do_row_ubyte4_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] + rowB[j][0] + rowB[k][0]) / 4;
          dst[i][1] = (rowA[j][1] + rowA[k][1] + rowB[j][1] + rowB[k][1]) / 4;
@@ -349,11 +539,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    }
 
    else if (datatype == GL_FLOAT && comps == 4) {
-      GLuint i, j, k;
+      GLuint i = 0, j, k;
       const GLfloat(*rowA)[4] = (const GLfloat(*)[4]) srcRowA;
       const GLfloat(*rowB)[4] = (const GLfloat(*)[4]) srcRowB;
       GLfloat(*dst)[4] = (GLfloat(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __SSE2__
+      i = do_row_float4_sse2(srcRowA, srcRowB, colStride, k0,
+                             dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          dst[i][0] = (rowA[j][0] + rowA[k][0] +
                       rowB[j][0] + rowB[k][0]) * 0.25F;
@@ -405,11 +599,15 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    }
 
    else if (datatype == GL_HALF_FLOAT_ARB && comps == 4) {
-      GLuint i, j, k, comp;
+      GLuint i = 0, j, k, comp;
       const GLhalfARB(*rowA)[4] = (const GLhalfARB(*)[4]) srcRowA;
       const GLhalfARB(*rowB)[4] = (const GLhalfARB(*)[4]) srcRowB;
       GLhalfARB(*dst)[4] = (GLhalfARB(*)[4]) dstRow;
-      for (i = j = 0, k = k0; i < (GLuint) dstWidth;
+#ifdef __F16C__
+      i = do_row_half4_f16c(srcRowA, srcRowB, colStride, k0,
+                            dstWidth, dstRow);
+#endif
+      for (j = i * colStride, k = j + k0; i < (GLuint) dstWidth;
            i++, j += colStride, k += colStride) {
          for (comp = 0; comp < 4; comp++) {
             GLfloat aj, ak, bj, bk;
@@ -791,7 +989,16 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(comps >= 1);
    assert(comps <= 4);
 
-   if ((datatype == GL_UNSIGNED_BYTE) && (comps == 4)) {
+   if (is_srgb8_datatype(datatype)) {
+      const GLubyte *rows[4];
+      rows[0] = (const GLubyte *) srcRowA;
+      rows[1] = (const GLubyte *) srcRowB;
+      rows[2] = (const GLubyte *) srcRowC;
+      rows[3] = (const GLubyte *) srcRowD;
+      do_row_srgb8(datatype, comps, srcWidth, rows, 4,
+                   dstWidth, (GLubyte *) dstRow);
+   }
+   else if ((datatype == GL_UNSIGNED_BYTE) && (comps == 4)) {
       DECLARE_ROW_POINTERS(GLubyte, 4);
 
       for (i = j = 0, k = k0; i < (GLuint) dstWidth;
@@ -1686,24 +1893,16 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
-/**
- * Down-sample a texture image to produce the next lower mipmap level.
- * \param comps  components per texel (1, 2, 3 or 4)
- * \param srcData  array[slice] of pointers to source image slices
- * \param dstData  array[slice] of pointers to dest image slices
- * \param srcRowStride  stride between source rows, in bytes
- * \param dstRowStride  stride between destination rows, in bytes
- */
-void
-_mesa_generate_mipmap_level(GLenum target,
-                            GLenum datatype, GLuint comps,
-                            GLint border,
-                            GLint srcWidth, GLint srcHeight, GLint srcDepth,
-                            const GLubyte **srcData,
-                            GLint srcRowStride,
-                            GLint dstWidth, GLint dstHeight, GLint dstDepth,
-                            GLubyte **dstData,
-                            GLint dstRowStride)
+static void
+generate_mipmap_level_serial(GLenum target,
+                             GLenum datatype, GLuint comps,
+                             GLint border,
+                             GLint srcWidth, GLint srcHeight, GLint srcDepth,
+                             const GLubyte **srcData,
+                             GLint srcRowStride,
+                             GLint dstWidth, GLint dstHeight, GLint dstDepth,
+                             GLubyte **dstData,
+                             GLint dstRowStride)
 {
    int i;
 
@@ -1759,6 +1958,179 @@ _mesa_generate_mipmap_level(GLenum target,
 }
 
 
+/**
+ * One worker's share of a mipmap level: a band of dest rows (2D), dest
+ * images (3D) or array slices, described as a smaller level of its own.
+ */
+struct mipmap_job
+{
+   GLenum target;
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, srcHeight, srcDepth;
+   const GLubyte **srcData;
+   GLint srcRowStride;
+   GLint dstWidth, dstHeight, dstDepth;
+   GLubyte **dstData;
+   GLint dstRowStride;
+   /* band pointers for 2D targets, which have a single slice */
+   const GLubyte *srcSlice;
+   GLubyte *dstSlice;
+};
+
+
+static int
+mipmap_job_run(void *data)
+{
+   struct mipmap_job *job = (struct mipmap_job *) data;
+
+   generate_mipmap_level_serial(job->target, job->datatype, job->comps, 0,
+                                job->srcWidth, job->srcHeight, job->srcDepth,
+                                job->srcData, job->srcRowStride,
+                                job->dstWidth, job->dstHeight, job->dstDepth,
+                                job->dstData, job->dstRowStride);
+   return 0;
+}
+
+
+static GLuint
+mipmap_max_threads(void)
+{
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+   const long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n > 1 ? MIN2((GLuint) n, MIPMAP_MAX_THREADS) : 1;
+#else
+   return 1;
+#endif
+}
+
+
+/**
+ * Down-sample a texture image to produce the next lower mipmap level.
+ *
+ * Large levels are split along their outermost dimension (rows for 2D
+ * images, images for 3D textures, slices for array textures) and the
+ * pieces are filtered on separate threads.  Every dest texel only depends
+ * on the source, so the result is the same as the single-threaded one.
+ *
+ * \param datatype  GL_UNSIGNED_BYTE, GL_FLOAT, etc. or one of the
+ *                  MESA_MIPMAP_SRGB8 pseudo types
+ * \param comps  components per texel (1, 2, 3 or 4)
+ * \param srcData  array[slice] of pointers to source image slices
+ * \param dstData  array[slice] of pointers to dest image slices
+ * \param srcRowStride  stride between source rows, in bytes
+ * \param dstRowStride  stride between destination rows, in bytes
+ */
+void
+_mesa_generate_mipmap_level(GLenum target,
+                            GLenum datatype, GLuint comps,
+                            GLint border,
+                            GLint srcWidth, GLint srcHeight, GLint srcDepth,
+                            const GLubyte **srcData,
+                            GLint srcRowStride,
+                            GLint dstWidth, GLint dstHeight, GLint dstDepth,
+                            GLubyte **dstData,
+                            GLint dstRowStride)
+{
+   struct mipmap_job jobs[MIPMAP_MAX_THREADS];
+   thrd_t threads[MIPMAP_MAX_THREADS];
+   GLboolean started[MIPMAP_MAX_THREADS];
+   const GLint dstBytes = dstRowStride * dstHeight * dstDepth;
+   GLboolean splitRows = GL_FALSE;
+   GLint units, first;
+   GLuint numJobs, i;
+
+   switch (target) {
+   case GL_TEXTURE_2D:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_X_ARB:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_X_ARB:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_Y_ARB:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y_ARB:
+   case GL_TEXTURE_CUBE_MAP_POSITIVE_Z_ARB:
+   case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z_ARB:
+      splitRows = GL_TRUE;
+      units = dstHeight;
+      break;
+   case GL_TEXTURE_3D:
+   case GL_TEXTURE_1D_ARRAY_EXT:
+   case GL_TEXTURE_2D_ARRAY_EXT:
+   case GL_TEXTURE_CUBE_MAP_ARRAY:
+      units = dstDepth;
+      break;
+   default:
+      units = 1;
+   }
+
+   numJobs = mipmap_max_threads();
+   numJobs = MIN2(numJobs, (GLuint) (dstBytes / MIPMAP_MIN_BYTES_PER_THREAD));
+   numJobs = MIN2(numJobs, (GLuint) units);
+
+   /* Borders are filled in after the interior; keep those levels simple. */
+   if (border || numJobs <= 1) {
+      generate_mipmap_level_serial(target, datatype, comps, border,
+                                   srcWidth, srcHeight, srcDepth,
+                                   srcData, srcRowStride,
+                                   dstWidth, dstHeight, dstDepth,
+                                   dstData, dstRowStride);
+      return;
+   }
+
+   for (i = 0, first = 0; i < numJobs; i++) {
+      struct mipmap_job *job = &jobs[i];
+      const GLint count = units / numJobs + (i < units % numJobs);
+
+      job->target = target;
+      job->datatype = datatype;
+      job->comps = comps;
+      job->srcWidth = srcWidth;
+      job->srcHeight = srcHeight;
+      job->srcDepth = srcDepth;
+      job->srcData = srcData;
+      job->srcRowStride = srcRowStride;
+      job->dstWidth = dstWidth;
+      job->dstHeight = dstHeight;
+      job->dstDepth = dstDepth;
+      job->dstData = dstData;
+      job->dstRowStride = dstRowStride;
+
+      if (splitRows) {
+         /* dest rows [first, first + count) */
+         const GLint step = (srcHeight > 1 && srcHeight > dstHeight) ? 2 : 1;
+         job->srcSlice = srcData[0] + first * step * srcRowStride;
+         job->dstSlice = dstData[0] + first * dstRowStride;
+         job->srcData = &job->srcSlice;
+         job->srcHeight = count * step;
+         job->dstData = &job->dstSlice;
+         job->dstHeight = count;
+      }
+      else {
+         /* dest images or array slices [first, first + count) */
+         const GLint step = srcDepth > dstDepth ? 2 : 1;
+         job->srcData = srcData + first * step;
+         job->srcDepth = count * step;
+         job->dstData = dstData + first;
+         job->dstDepth = count;
+      }
+
+      first += count;
+   }
+
+   /* The calling thread does the first piece itself. */
+   for (i = 1; i < numJobs; i++)
+      started[i] = thrd_create(&threads[i], mipmap_job_run,
+                               &jobs[i]) == thrd_success;
+
+   mipmap_job_run(&jobs[0]);
+
+   for (i = 1; i < numJobs; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else
+         mipmap_job_run(&jobs[i]);
+   }
+}
+
+
 /**
  * compute next (level+1) image size
  * \return GL_FALSE if no smaller size can be generated (eg. src is 1x1x1 size)
@@ -1876,6 +2248,31 @@ _mesa_prepare_mipmap_level(struct gl_context *ctx,
 }
 
 
+/**
+ * Pick the MESA_MIPMAP_SRGB8 pseudo datatype for 8-bit sRGB formats, so
+ * that they get filtered in linear space.  Other formats keep the
+ * datatype they were unpacked to.
+ */
+static GLenum
+mipmap_datatype(mesa_format format, GLenum datatype, GLuint comps)
+{
+   const uint32_t arrayFormat = _mesa_format_to_array_format(format);
+   uint8_t swizzle[4];
+
+   if (datatype != GL_UNSIGNED_BYTE ||
+       _mesa_get_format_color_encoding(format) != GL_SRGB ||
+       !arrayFormat)
+      return datatype;
+
+   /* alpha lives in whichever array channel feeds the W swizzle */
+   _mesa_array_format_get_swizzle(arrayFormat, swizzle);
+   if (swizzle[3] <= MESA_FORMAT_SWIZZLE_W && swizzle[3] < comps)
+      return MESA_MIPMAP_SRGB8_ALPHA(swizzle[3]);
+
+   return MESA_MIPMAP_SRGB8;
+}
+
+
 static void
 generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
 			     struct gl_texture_object *texObj,
@@ -1887,6 +2284,7 @@ generate_mipmap_uncompressed(struct gl_context *ctx, GLenum target,
    GLuint comps;
 
    _mesa_uncompressed_format_to_type_and_comps(srcImage->TexFormat, &datatype, &comps);
+   datatype = mipmap_datatype(srcImage->TexFormat, datatype, comps);
 
    for (level = texObj->BaseLevel; level < maxLevel; level++) {
       /* generate image[level+1] from image[level] */
@@ -2016,7 +2414,7 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
    GLint components;
    GLuint temp_src_row_stride, temp_src_img_stride; /* in bytes */
    GLubyte *temp_src = NULL, *temp_dst = NULL;
-   GLenum temp_datatype;
+   GLenum temp_datatype, filter_datatype;
    GLenum temp_base_format;
    GLubyte **temp_src_slices = NULL, **temp_dst_slices = NULL;
 
@@ -2049,6 +2447,16 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
 
    temp_base_format = _mesa_get_format_base_format(temp_format);
 
+   /* GetTexSubImage hands back sRGB texels still encoded */
+   if (temp_datatype == GL_UNSIGNED_BYTE &&
+       _mesa_get_format_color_encoding(srcImage->TexFormat) == GL_SRGB) {
+      filter_datatype = components == 4 ? MESA_MIPMAP_SRGB8_ALPHA(3)
+                                        : MESA_MIPMAP_SRGB8;
+   }
+   else {
+      filter_datatype = temp_datatype;
+   }
+
 
    /* allocate storage for the temporary, uncompressed image */
    temp_src_row_stride = _mesa_format_row_stride(temp_format, srcImage->Width);
@@ -2144,7 +2552,7 @@ generate_mipmap_compressed(struct gl_context *ctx, GLenum target,
       /* Rescale src image to dest image.
        * This will loop over the slices of a 2D array.
        */
-      _mesa_generate_mipmap_level(target, temp_datatype, components, border,
+      _mesa_generate_mipmap_level(target, filter_datatype, components, border,
                                   srcWidth, srcHeight, srcDepth,
                                   (const GLubyte **) temp_src_slices,
                                   temp_src_row_stride,
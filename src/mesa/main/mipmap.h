@@ -28,6 +28,18 @@
 
 #include "mtypes.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Pseudo datatypes for _mesa_generate_mipmap_level(): 8-bit sRGB-encoded
+ * texels, which are averaged in linear space.  With
+ * MESA_MIPMAP_SRGB8_ALPHA(c), channel c holds linear alpha instead.
+ */
+#define MESA_MIPMAP_SRGB8           0x10000
+#define MESA_MIPMAP_SRGB8_ALPHA(c)  (MESA_MIPMAP_SRGB8 + 1 + (c))
+
 
 extern void
 _mesa_generate_mipmap_level(GLenum target,
@@ -56,4 +68,8 @@ _mesa_next_mipmap_level_size(GLenum target, GLint border,
                        GLint srcWidth, GLint srcHeight, GLint srcDepth,
                        GLint *dstWidth, GLint *dstHeight, GLint *dstDepth);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* MIPMAP_H */
@@ -83,6 +83,8 @@ struct st_context;
 struct gl_uniform_storage;
 struct prog_instruction;
 struct gl_program_parameter_list;
+struct hash_table;
+struct glthread_state;
 struct set;
 struct set_entry;
 struct vbo_context;
@@ -1260,6 +1262,9 @@ typedef enum {
    USAGE_TEXTURE_BUFFER = 0x2,
    USAGE_ATOMIC_COUNTER_BUFFER = 0x4,
    USAGE_SHADER_STORAGE_BUFFER = 0x8,
+   USAGE_TRANSFORM_FEEDBACK_BUFFER = 0x10,
+   USAGE_PIXEL_PACK_BUFFER = 0x20,
+   USAGE_DISABLE_MINMAX_CACHE = 0x40,
 } gl_buffer_usage;
 
 
@@ -1282,6 +1287,13 @@ struct gl_buffer_object
    GLboolean Immutable; /**< GL_ARB_buffer_storage */
    gl_buffer_usage UsageHistory; /**< How has this buffer been used so far? */
 
+   /** Memoization of index min/max scans, see vbo_minmax_index.c */
+   struct hash_table *MinMaxCache;
+   unsigned MinMaxCacheHitIndices;
+   unsigned MinMaxCacheMissIndices;
+   bool MinMaxCacheDirty;
+   mtx_t MinMaxCacheMutex;
+
    struct gl_buffer_mapping Mappings[MAP_COUNT];
 };
 
@@ -3927,6 +3939,16 @@ struct gl_dlist_state
        * list.  Used to eliminate some redundant state changes.
        */
       GLenum ShadeModel;
+      GLfloat LineWidth;
+      GLfloat PointSize;
+      GLenum PolygonMode[2];            /**< front, back */
+      GLenum ColorMaterialFace;
+      GLenum ColorMaterialMode;
+
+      /** The last few capabilities enabled or disabled (0 if unused) */
+      GLenum EnableCap[8];
+      GLboolean EnableState[8];
+      GLuint NextEnable;
    } Current;
 };
 
@@ -4157,8 +4179,17 @@ struct gl_context
     * re-set on glXMakeCurrent().
     */
    struct _glapi_table *CurrentDispatch;
+   /**
+    * Dispatch table installed on the application thread when calls are
+    * queued to a glthread driver thread, NULL otherwise.  Queued calls are
+    * executed through CurrentDispatch.
+    */
+   struct _glapi_table *MarshalExec;
    /*@}*/
 
+   /** glthread state, NULL unless MESA_GLTHREAD is set (see glthread.h) */
+   struct glthread_state *GLThread;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
@@ -41,6 +41,7 @@
 #include "fbobject.h"
 #include "format_utils.h"
 #include "pixeltransfer.h"
+#include "streaming-memcpy.h"
 
 
 /**
@@ -221,6 +222,7 @@ readpixels_memcpy(struct gl_context *ctx,
          _mesa_get_read_renderbuffer_for_format(ctx, format);
    GLubyte *dst, *map;
    int dstStride, stride, j, texelBytes;
+   mesa_memcpy_func copy;
 
    /* Fail if memcpy cannot be used. */
    if (!readpixels_can_use_memcpy(ctx, format, type, packing)) {
@@ -239,15 +241,28 @@ readpixels_memcpy(struct gl_context *ctx,
    }
 
    texelBytes = _mesa_get_format_bytes(rb->Format);
+   copy = _mesa_get_transfer_memcpy((size_t) width * height * texelBytes);
 
    /* memcpy*/
-   for (j = 0; j < height; j++) {
-      memcpy(dst, map, width * texelBytes);
-      dst += dstStride;
-      map += stride;
+   if (dstStride == stride && stride == width * texelBytes) {
+      /* Both sides are tightly packed: one copy for the whole image. */
+      copy(dst, map, (size_t) stride * height);
+   }
+   else {
+      for (j = 0; j < height; j++) {
+         copy(dst, map, width * texelBytes);
+         dst += dstStride;
+         map += stride;
+      }
    }
 
    ctx->Driver.UnmapRenderbuffer(ctx, rb);
+
+   _mesa_perf_debug(ctx, MESA_DEBUG_SEVERITY_NOTIFICATION,
+                    "glReadPixels(%dx%d %s/%s) copied directly from the "
+                    "mapped renderbuffer\n", width, height,
+                    _mesa_enum_to_string(format),
+                    _mesa_enum_to_string(type));
    return GL_TRUE;
 }
 
@@ -877,6 +892,12 @@ _mesa_readpixels(struct gl_context *ctx,
          }
 
          /* Otherwise take the slow path. */
+         _mesa_perf_debug(ctx, MESA_DEBUG_SEVERITY_MEDIUM,
+                          "glReadPixels(%dx%d %s/%s) needs conversion, "
+                          "using the slow path\n",
+                          width, height, _mesa_enum_to_string(format),
+                          _mesa_enum_to_string(type));
+
          switch (format) {
          case GL_STENCIL_INDEX:
             read_stencil_pixels(ctx, x, y, width, height, type, pixels,
@@ -86,3 +86,74 @@ _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
       memcpy(d, s, len);
    }
 }
+
+/* Copies memory from src to dst, using MOVNTDQA loads and MOVNTDQ stores so
+ * that neither side of a large transfer ends up in the CPU caches.
+ */
+void
+_mesa_streaming_load_store_memcpy(void *restrict dst, void *restrict src,
+                                  size_t len)
+{
+   char *restrict d = dst;
+   char *restrict s = src;
+
+   /* memcpy() the misaligned header, so the stores are 16-byte aligned. */
+   if ((uintptr_t)d & 15) {
+      uintptr_t bytes_before_alignment_boundary = 16 - ((uintptr_t)d & 15);
+      assert(bytes_before_alignment_boundary < 16);
+
+      memcpy(d, s, MIN2(bytes_before_alignment_boundary, len));
+
+      s += MIN2(bytes_before_alignment_boundary, len);
+      d = (char *)ALIGN((uintptr_t)d, 16);
+      len -= MIN2(bytes_before_alignment_boundary, len);
+   }
+
+   if (len >= 64)
+      _mm_mfence();
+
+   if ((uintptr_t)s & 15) {
+      /* MOVNTDQA needs an aligned source; only stream the stores. */
+      while (len >= 64) {
+         __m128i temp1 = _mm_loadu_si128((__m128i *)s + 0);
+         __m128i temp2 = _mm_loadu_si128((__m128i *)s + 1);
+         __m128i temp3 = _mm_loadu_si128((__m128i *)s + 2);
+         __m128i temp4 = _mm_loadu_si128((__m128i *)s + 3);
+
+         _mm_stream_si128((__m128i *)d + 0, temp1);
+         _mm_stream_si128((__m128i *)d + 1, temp2);
+         _mm_stream_si128((__m128i *)d + 2, temp3);
+         _mm_stream_si128((__m128i *)d + 3, temp4);
+
+         d += 64;
+         s += 64;
+         len -= 64;
+      }
+   } else {
+      while (len >= 64) {
+         __m128i *dst_cacheline = (__m128i *)d;
+         __m128i *src_cacheline = (__m128i *)s;
+
+         __m128i temp1 = _mm_stream_load_si128(src_cacheline + 0);
+         __m128i temp2 = _mm_stream_load_si128(src_cacheline + 1);
+         __m128i temp3 = _mm_stream_load_si128(src_cacheline + 2);
+         __m128i temp4 = _mm_stream_load_si128(src_cacheline + 3);
+
+         _mm_stream_si128(dst_cacheline + 0, temp1);
+         _mm_stream_si128(dst_cacheline + 1, temp2);
+         _mm_stream_si128(dst_cacheline + 2, temp3);
+         _mm_stream_si128(dst_cacheline + 3, temp4);
+
+         d += 64;
+         s += 64;
+         len -= 64;
+      }
+   }
+
+   /* memcpy() the tail. */
+   if (len) {
+      memcpy(d, s, len);
+   }
+
+   _mm_sfence();
+}
@@ -31,3 +31,10 @@
  */
 void
 _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len);
+
+/* Copies memory from src to dst, streaming both the loads (MOVNTDQA) and
+ * the stores (MOVNTDQ) past the CPU caches.
+ */
+void
+_mesa_streaming_load_store_memcpy(void *restrict dst, void *restrict src,
+                                  size_t len);
@@ -0,0 +1,131 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * \file streaming-memcpy.c
+ * Cache-bypassing copies for large pixel transfers (glReadPixels,
+ * glGetTexImage, PBO packing).
+ */
+
+#include "main/macros.h"
+#include "main/streaming-memcpy.h"
+#include "x86/common_x86_asm.h"
+
+#if defined(USE_SSE41)
+#include "main/streaming-load-memcpy.h"
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/**
+ * Copies memory from src to dst using non-temporal (MOVNTDQ) stores, so the
+ * destination does not displace anything from the CPU caches.
+ */
+void *
+_mesa_streaming_store_memcpy(void *dst, const void *src, size_t len)
+{
+#ifdef __SSE2__
+   char *d = dst;
+   const char *s = src;
+
+   /* memcpy() the misaligned header so that <d> is 16-byte aligned. */
+   if ((uintptr_t)d & 15) {
+      size_t head = MIN2(16 - ((uintptr_t)d & 15), len);
+
+      memcpy(d, s, head);
+      d += head;
+      s += head;
+      len -= head;
+   }
+
+   while (len >= 64) {
+      __m128i temp1 = _mm_loadu_si128((const __m128i *)s + 0);
+      __m128i temp2 = _mm_loadu_si128((const __m128i *)s + 1);
+      __m128i temp3 = _mm_loadu_si128((const __m128i *)s + 2);
+      __m128i temp4 = _mm_loadu_si128((const __m128i *)s + 3);
+
+      _mm_stream_si128((__m128i *)d + 0, temp1);
+      _mm_stream_si128((__m128i *)d + 1, temp2);
+      _mm_stream_si128((__m128i *)d + 2, temp3);
+      _mm_stream_si128((__m128i *)d + 3, temp4);
+
+      d += 64;
+      s += 64;
+      len -= 64;
+   }
+
+   /* memcpy() the tail. */
+   if (len)
+      memcpy(d, s, len);
+
+   /* Make the non-temporal stores globally visible before the caller hands
+    * the buffer to anybody else (e.g. unmaps a PBO).
+    */
+   _mm_sfence();
+
+   return dst;
+#else
+   return memcpy(dst, src, len);
+#endif
+}
+
+
+#if defined(USE_SSE41)
+static void *
+streaming_load_store_memcpy(void *dst, const void *src, size_t len)
+{
+   _mesa_streaming_load_store_memcpy(dst, (void *) src, len);
+   return dst;
+}
+#endif
+
+
+/**
+ * Pick the memcpy() flavour to use for a pixel transfer of \p total_len
+ * bytes whose result won't be read back by the CPU soon.
+ *
+ * Small transfers use the regular memcpy(); once the transfer is too big to
+ * stay cache resident anyway both the loads (if SSE 4.1 is available, for
+ * uncached/write-combined driver mappings) and the stores stream past the
+ * caches.  The returned function may be called once per row.
+ */
+mesa_memcpy_func
+_mesa_get_transfer_memcpy(size_t total_len)
+{
+   if (total_len < MESA_STREAMING_MEMCPY_THRESHOLD)
+      return memcpy;
+
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1)
+      return streaming_load_store_memcpy;
+#endif
+
+#ifdef __SSE2__
+   return _mesa_streaming_store_memcpy;
+#else
+   return memcpy;
+#endif
+}
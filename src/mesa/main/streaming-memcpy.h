@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef STREAMING_MEMCPY_H
+#define STREAMING_MEMCPY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Transfers of at least this many bytes are considered too big to be worth
+ * keeping in the CPU caches: the data is unlikely to be touched again by
+ * the CPU before it is evicted, and pulling it in would only push out the
+ * working set of the application (and of anything else sharing the LLC).
+ */
+#define MESA_STREAMING_MEMCPY_THRESHOLD (4 * 1024 * 1024)
+
+typedef void *(*mesa_memcpy_func)(void *dst, const void *src, size_t len);
+
+void *
+_mesa_streaming_store_memcpy(void *dst, const void *src, size_t len);
+
+mesa_memcpy_func
+_mesa_get_transfer_memcpy(size_t total_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAMING_MEMCPY_H */
@@ -0,0 +1,325 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name dlist.cpp
+ *
+ * Check that display lists of many small primitives are replayed as fewer
+ * indexed draws of the same triangles, only when that draws the same, and
+ * (with --gtest_also_run_disabled_tests) compare the replay time of such a
+ * list with and without the index lists.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+/* Simulated cost of a draw call in the driver. */
+static unsigned driver_draw_ns;
+
+static unsigned draws;
+static unsigned prims_drawn;
+static bool indexed_draws;
+
+/* Each triangle drawn, as the three vertex positions' x coordinates. */
+typedef std::vector<float> triangle;
+static std::vector<triangle> triangles;
+
+static void
+spin_ns(unsigned ns)
+{
+   struct timespec start, now;
+
+   if (!ns)
+      return;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   do {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+   } while ((now.tv_sec - start.tv_sec) * 1000000000ll +
+            (now.tv_nsec - start.tv_nsec) < ns);
+}
+
+static float
+vertex_x(struct gl_context *ctx, GLuint i)
+{
+   const struct gl_client_array *pos = ctx->Array._DrawArrays[VERT_ATTRIB_POS];
+   const GLubyte *data = (const GLubyte *) pos->BufferObj->Data +
+                         (uintptr_t) pos->Ptr;
+
+   return *(const float *) (data + i * pos->StrideB);
+}
+
+/* Records the triangles of GL_TRIANGLES primitives only. */
+static void
+fake_draw_prims(struct gl_context *ctx,
+                const struct _mesa_prim *prims, GLuint nr_prims,
+                const struct _mesa_index_buffer *ib,
+                GLboolean index_bounds_valid,
+                GLuint min_index, GLuint max_index,
+                struct gl_transform_feedback_object *tfb_vertcount,
+                unsigned stream,
+                struct gl_buffer_object *indirect)
+{
+   const GLushort *indices = NULL;
+
+   draws++;
+   prims_drawn += nr_prims;
+   indexed_draws = ib != NULL;
+   spin_ns(driver_draw_ns);
+
+   if (ib) {
+      EXPECT_EQ((GLenum) GL_UNSIGNED_SHORT, ib->type);
+      indices = (const GLushort *) ((const GLubyte *) ib->obj->Data +
+                                    (uintptr_t) ib->ptr);
+   }
+
+   for (GLuint i = 0; i < nr_prims; i++) {
+      if (prims[i].mode != GL_TRIANGLES)
+         continue;
+      for (GLuint j = 0; j + 2 < prims[i].count; j += 3) {
+         triangle t;
+
+         for (GLuint k = 0; k < 3; k++) {
+            GLuint v = prims[i].start + j + k;
+            t.push_back(vertex_x(ctx, indices ? indices[v] : v));
+         }
+         triangles.push_back(t);
+      }
+   }
+}
+
+class DisplayList_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void compile_mesh(GLuint list, unsigned quads);
+   std::vector<triangle> call_list(GLuint list);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+DisplayList_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+
+   ctx.Version = 30;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   vbo_set_draw_func(&ctx, fake_draw_prims);
+
+   draws = 0;
+   prims_drawn = 0;
+   driver_draw_ns = 0;
+   triangles.clear();
+
+   _glapi_set_context(&ctx);
+   _glapi_set_dispatch(ctx.CurrentDispatch);
+}
+
+void
+DisplayList_test::TearDown()
+{
+   _glapi_set_dispatch(NULL);
+   _glapi_set_context(NULL);
+
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx);
+}
+
+/**
+ * Compile a strip of quads the way CAD applications do: one glBegin/End per
+ * face, with the state it needs set again for each face.  Vertices shared
+ * by neighbouring faces are sent again for each.
+ */
+void
+DisplayList_test::compile_mesh(GLuint list, unsigned quads)
+{
+   CALL_NewList(_glapi_get_dispatch(), (list, GL_COMPILE));
+   for (unsigned i = 0; i < quads; i++) {
+      struct _glapi_table *disp = _glapi_get_dispatch();
+
+      CALL_Enable(disp, (GL_DEPTH_TEST));
+      CALL_ShadeModel(disp, (GL_FLAT));
+      CALL_Begin(disp, (i % 2 ? GL_QUADS : GL_TRIANGLE_STRIP));
+      CALL_Vertex2f(disp, ((float) i, 0.0f));
+      CALL_Vertex2f(disp, ((float) i + 1, 0.0f));
+      if (i % 2) {
+         CALL_Vertex2f(disp, ((float) i + 1, 1.0f));
+         CALL_Vertex2f(disp, ((float) i, 1.0f));
+      } else {
+         CALL_Vertex2f(disp, ((float) i, 1.0f));
+         CALL_Vertex2f(disp, ((float) i + 1, 1.0f));
+      }
+      CALL_End(disp, ());
+   }
+   CALL_EndList(_glapi_get_dispatch(), ());
+}
+
+std::vector<triangle>
+DisplayList_test::call_list(GLuint list)
+{
+   draws = 0;
+   prims_drawn = 0;
+   triangles.clear();
+   CALL_CallList(_glapi_get_dispatch(), (list));
+   return triangles;
+}
+
+TEST_F(DisplayList_test, MergesPrimitives)
+{
+   std::vector<triangle> merged;
+
+   compile_mesh(1, 64);
+
+   merged = call_list(1);
+   EXPECT_TRUE(indexed_draws);
+   EXPECT_EQ(1u, prims_drawn);
+   EXPECT_EQ(128u, merged.size());
+
+   /* With another provoking vertex the faces are drawn as compiled, and
+    * would be split differently.
+    */
+   ctx.Light.ProvokingVertex = GL_FIRST_VERTEX_CONVENTION;
+   call_list(1);
+   EXPECT_FALSE(indexed_draws);
+   EXPECT_EQ(64u, prims_drawn);
+}
+
+TEST_F(DisplayList_test, SameTrianglesAsDrawModule)
+{
+   std::vector<triangle> drawn;
+
+   /* A strip and quads whose triangles the draw module would make with the
+    * provoking vertex last.
+    */
+   CALL_NewList(_glapi_get_dispatch(), (1, GL_COMPILE));
+   CALL_Begin(_glapi_get_dispatch(), (GL_TRIANGLE_STRIP));
+   for (unsigned i = 0; i < 5; i++)
+      CALL_Vertex2f(_glapi_get_dispatch(), ((float) i, 0.0f));
+   CALL_End(_glapi_get_dispatch(), ());
+   CALL_Begin(_glapi_get_dispatch(), (GL_QUADS));
+   for (unsigned i = 10; i < 14; i++)
+      CALL_Vertex2f(_glapi_get_dispatch(), ((float) i, 0.0f));
+   CALL_End(_glapi_get_dispatch(), ());
+   CALL_EndList(_glapi_get_dispatch(), ());
+
+   drawn = call_list(1);
+   EXPECT_EQ(1u, prims_drawn);
+   ASSERT_EQ(5u, drawn.size());
+
+   static const float tris[5][3] = {
+      { 0, 1, 2 }, { 2, 1, 3 }, { 2, 3, 4 },
+      { 10, 11, 13 }, { 11, 12, 13 },
+   };
+   for (unsigned i = 0; i < 5; i++) {
+      EXPECT_EQ(tris[i][0], drawn[i][0]);
+      EXPECT_EQ(tris[i][1], drawn[i][1]);
+      EXPECT_EQ(tris[i][2], drawn[i][2]);
+   }
+}
+
+TEST_F(DisplayList_test, PolygonModeKeepsPrimitives)
+{
+   compile_mesh(1, 8);
+
+   ctx.Polygon.FrontMode = GL_LINE;
+   call_list(1);
+   EXPECT_FALSE(indexed_draws);
+   EXPECT_EQ(8u, prims_drawn);
+   ctx.Polygon.FrontMode = GL_FILL;
+
+   call_list(1);
+   EXPECT_TRUE(indexed_draws);
+   EXPECT_EQ(1u, prims_drawn);
+}
+
+TEST_F(DisplayList_test, RedundantStateStillApplied)
+{
+   compile_mesh(1, 4);
+
+   CALL_Disable(_glapi_get_dispatch(), (GL_DEPTH_TEST));
+   CALL_ShadeModel(_glapi_get_dispatch(), (GL_SMOOTH));
+   call_list(1);
+   EXPECT_TRUE(ctx.Depth.Test);
+   EXPECT_EQ((GLenum) GL_FLAT, ctx.Light.ShadeModel);
+}
+
+static double
+replay_ms(GLuint list, unsigned calls)
+{
+   struct timespec start, end;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (unsigned i = 0; i < calls; i++)
+      CALL_CallList(_glapi_get_dispatch(), (list));
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   return (end.tv_sec - start.tv_sec) * 1000.0 +
+          (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+TEST_F(DisplayList_test, DISABLED_ReplayBenchmark)
+{
+   compile_mesh(1, 1000);
+
+   /* Roughly the cost of a draw call in a hardware driver. */
+   driver_draw_ns = 1000;
+
+   double merged = replay_ms(1, 100);
+
+   ctx.Light.ProvokingVertex = GL_FIRST_VERTEX_CONVENTION;
+   double unmerged = replay_ms(1, 100);
+
+   printf("100 replays of 1000 faces: per face %8.2f ms  "
+          "merged %8.2f ms  (%.2fx)\n", unmerged, merged, unmerged / merged);
+}
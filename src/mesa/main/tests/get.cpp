@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name get.cpp
+ *
+ * Check that glGet*v find the values of the enums valid in the context's
+ * API, reject the others, and (with --gtest_also_run_disabled_tests)
+ * measure how many state queries per second an application polling state
+ * can make.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/context.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+
+extern "C" {
+#include "main/get.h"
+}
+
+#ifndef GL_POINT_SIZE_ARRAY_OES
+#define GL_POINT_SIZE_ARRAY_OES 0x8B9C
+#endif
+
+class Get_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+};
+
+void
+Get_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+
+   ctx.Version = 30;
+
+   _glapi_set_context(&ctx);
+}
+
+void
+Get_test::TearDown()
+{
+   _glapi_set_context(NULL);
+
+   _mesa_free_context_data(&ctx);
+}
+
+TEST_F(Get_test, ValuesFromContext)
+{
+   GLfloat f[4];
+   GLint i[4];
+   GLboolean b;
+
+   ctx.Line.Width = 3.0f;
+   ctx.Depth.Func = GL_GREATER;
+   ctx.Color.BlendEnabled = 1;
+   ctx.Transform.RasterPositionUnclipped = GL_TRUE;
+
+   _mesa_GetFloatv(GL_LINE_WIDTH, f);
+   EXPECT_EQ(3.0f, f[0]);
+   _mesa_GetIntegerv(GL_LINE_WIDTH, i);
+   EXPECT_EQ(3, i[0]);
+   _mesa_GetIntegerv(GL_DEPTH_FUNC, i);
+   EXPECT_EQ(GL_GREATER, i[0]);
+   _mesa_GetBooleanv(GL_BLEND, &b);
+   EXPECT_EQ(GL_TRUE, b);
+
+   /* The enum furthest out. */
+   _mesa_GetBooleanv(GL_RASTER_POSITION_UNCLIPPED_IBM, &b);
+   EXPECT_EQ(GL_TRUE, b);
+
+   /* A value that isn't simply at an offset in the context. */
+   ctx.ViewportArray[0].X = 1.0f;
+   ctx.ViewportArray[0].Y = 2.0f;
+   ctx.ViewportArray[0].Width = 30.0f;
+   ctx.ViewportArray[0].Height = 40.0f;
+   _mesa_GetIntegerv(GL_VIEWPORT, i);
+   EXPECT_EQ(1, i[0]);
+   EXPECT_EQ(2, i[1]);
+   EXPECT_EQ(30, i[2]);
+   EXPECT_EQ(40, i[3]);
+
+   EXPECT_EQ((GLenum) GL_NO_ERROR, _mesa_GetError());
+}
+
+TEST_F(Get_test, InvalidEnums)
+{
+   static const GLenum invalid[] = {
+      0,
+      GL_LINE_WIDTH + 1,
+      GL_RASTER_POSITION_UNCLIPPED_IBM + 1,
+      0xffffffff,
+      /* Only valid in OpenGL ES 1.x. */
+      GL_POINT_SIZE_ARRAY_OES,
+   };
+   GLint i[4];
+
+   for (unsigned j = 0; j < ARRAY_SIZE(invalid); j++) {
+      _mesa_GetIntegerv(invalid[j], i);
+      EXPECT_EQ((GLenum) GL_INVALID_ENUM, _mesa_GetError());
+   }
+
+   /* Valid in OpenGL, but only with the extension. */
+   ctx.Extensions.ARB_shader_image_load_store = GL_FALSE;
+   _mesa_GetIntegerv(GL_MAX_IMAGE_UNITS, i);
+   EXPECT_EQ((GLenum) GL_INVALID_ENUM, _mesa_GetError());
+
+   ctx.Extensions.ARB_shader_image_load_store = GL_TRUE;
+   _mesa_GetIntegerv(GL_MAX_IMAGE_UNITS, i);
+   EXPECT_EQ((GLenum) GL_NO_ERROR, _mesa_GetError());
+}
+
+TEST_F(Get_test, DISABLED_QueryBenchmark)
+{
+   /* State a middleware layer checks before drawing. */
+   static const GLenum polled[] = {
+      GL_DEPTH_TEST, GL_DEPTH_FUNC, GL_DEPTH_WRITEMASK, GL_BLEND,
+      GL_BLEND_SRC, GL_CULL_FACE, GL_CULL_FACE_MODE, GL_FRONT_FACE,
+      GL_LINE_WIDTH, GL_POLYGON_OFFSET_FILL, GL_STENCIL_TEST,
+      GL_UNPACK_ALIGNMENT, GL_PACK_ALIGNMENT, GL_MATRIX_MODE,
+      GL_SHADE_MODEL, GL_LIGHTING,
+   };
+   const unsigned iterations = 1000000;
+   struct timespec start, end;
+   GLint value[16];
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (unsigned i = 0; i < iterations; i++)
+      for (unsigned j = 0; j < ARRAY_SIZE(polled); j++)
+         _mesa_GetIntegerv(polled[j], value);
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   double s = (end.tv_sec - start.tv_sec) +
+              (end.tv_nsec - start.tv_nsec) / 1000000000.0;
+
+   printf("%u glGetIntegerv: %8.2f ms  (%.1f M queries/s)\n",
+          (unsigned) (iterations * ARRAY_SIZE(polled)), s * 1000.0,
+          iterations * ARRAY_SIZE(polled) / s / 1000000.0);
+}
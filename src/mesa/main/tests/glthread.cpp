@@ -0,0 +1,248 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name glthread.cpp
+ *
+ * Check that calls made through the glthread dispatch table reach the
+ * context in order and that draws reading application memory are not
+ * queued, and (with --gtest_also_run_disabled_tests) compare the
+ * throughput of a CPU-bound draw loop with and without glthread.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/glthread.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+/* Simulated cost of validating and emitting a draw in the driver. */
+static unsigned driver_draw_ns;
+
+static thrd_t app_thread;
+static unsigned draws_on_app_thread;
+static unsigned draws_on_driver_thread;
+
+static void
+spin_ns(unsigned ns)
+{
+   struct timespec start, now;
+
+   if (!ns)
+      return;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   do {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+   } while ((now.tv_sec - start.tv_sec) * 1000000000ll +
+            (now.tv_nsec - start.tv_nsec) < ns);
+}
+
+static void
+record_draw(void)
+{
+   if (thrd_equal(thrd_current(), app_thread))
+      draws_on_app_thread++;
+   else
+      draws_on_driver_thread++;
+   spin_ns(driver_draw_ns);
+}
+
+static void GLAPIENTRY
+fake_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+   record_draw();
+}
+
+static void GLAPIENTRY
+fake_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                  const GLvoid *indices)
+{
+   record_draw();
+}
+
+class GLThread_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct _glapi_table *disp;
+};
+
+void
+GLThread_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+
+   ctx.Version = 30;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+
+   /* Stand-ins for the driver's draw entry points. */
+   SET_DrawArrays(ctx.Exec, fake_DrawArrays);
+   SET_DrawElements(ctx.Exec, fake_DrawElements);
+
+   app_thread = thrd_current();
+   draws_on_app_thread = 0;
+   draws_on_driver_thread = 0;
+   driver_draw_ns = 0;
+
+   _glapi_set_context(&ctx);
+   _mesa_glthread_init(&ctx);
+   ASSERT_TRUE(ctx.GLThread != NULL);
+   _glapi_set_dispatch(ctx.MarshalExec);
+   disp = ctx.MarshalExec;
+}
+
+void
+GLThread_test::TearDown()
+{
+   _mesa_glthread_destroy(&ctx);
+   _glapi_set_dispatch(NULL);
+   _glapi_set_context(NULL);
+}
+
+TEST_F(GLThread_test, QueuedCallsExecuteInOrder)
+{
+   /* Enough calls to wrap around all the batches several times. */
+   for (int i = 0; i < 100000; i++) {
+      if (i & 1)
+         CALL_Disable(disp, (GL_BLEND));
+      else
+         CALL_Enable(disp, (GL_BLEND));
+   }
+   EXPECT_FALSE(CALL_IsEnabled(disp, (GL_BLEND)));
+
+   CALL_Enable(disp, (GL_BLEND));
+   EXPECT_TRUE(CALL_IsEnabled(disp, (GL_BLEND)));
+
+   /* Errors raised by queued calls show up in glGetError. */
+   CALL_Enable(disp, (0xdead));
+   EXPECT_EQ((GLenum) GL_INVALID_ENUM, CALL_GetError(disp, ()));
+   EXPECT_EQ((GLenum) GL_NO_ERROR, CALL_GetError(disp, ()));
+}
+
+TEST_F(GLThread_test, OnlyBufferObjectDrawsAreQueued)
+{
+   static const GLfloat verts[3 * 3] = { 0 };
+   GLuint buffer = 2;
+
+   CALL_BindBuffer(disp, (GL_ARRAY_BUFFER, 1));
+   CALL_VertexPointer(disp, (3, GL_FLOAT, 0, NULL));
+   CALL_BindBuffer(disp, (GL_ELEMENT_ARRAY_BUFFER, 2));
+   EXPECT_EQ(1u, ctx.GLThread->ArrayBuffer);
+   EXPECT_EQ(2u, ctx.GLThread->CurrentVAO->IndexBuffer);
+
+   CALL_DrawArrays(disp, (GL_TRIANGLES, 0, 3));
+   CALL_DrawElements(disp, (GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, NULL));
+   CALL_Finish(disp, ());
+   EXPECT_EQ(0u, draws_on_app_thread);
+   EXPECT_EQ(2u, draws_on_driver_thread);
+
+   /* Indices in application memory. */
+   CALL_DeleteBuffers(disp, (1, &buffer));
+   EXPECT_EQ(0u, ctx.GLThread->CurrentVAO->IndexBuffer);
+   CALL_DrawElements(disp, (GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, NULL));
+   EXPECT_EQ(1u, draws_on_app_thread);
+
+   /* Vertices in application memory. */
+   CALL_BindBuffer(disp, (GL_ARRAY_BUFFER, 0));
+   CALL_VertexPointer(disp, (3, GL_FLOAT, 0, verts));
+   CALL_DrawArrays(disp, (GL_TRIANGLES, 0, 3));
+   EXPECT_EQ(2u, draws_on_app_thread);
+   EXPECT_EQ(2u, draws_on_driver_thread);
+}
+
+static double
+draw_loop_ms(struct _glapi_table *disp, unsigned draws, unsigned app_ns)
+{
+   struct timespec start, end;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (unsigned i = 0; i < draws; i++) {
+      /* The application's own work for the draw. */
+      spin_ns(app_ns);
+      CALL_BlendColor(disp, (i & 1, 0.0f, 0.0f, 1.0f));
+      CALL_DrawArrays(disp, (GL_TRIANGLES, 0, 3));
+   }
+   CALL_Finish(disp, ());
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   return (end.tv_sec - start.tv_sec) * 1000.0 +
+          (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+TEST_F(GLThread_test, DISABLED_DrawCallBenchmark)
+{
+   static const unsigned costs[][2] = {
+      /* application ns, driver ns per draw */
+      { 0, 2000 },
+      { 2000, 2000 },
+      { 1000, 4000 },
+      { 4000, 1000 },
+   };
+   const unsigned draws = 100000;
+
+   CALL_BindBuffer(disp, (GL_ARRAY_BUFFER, 1));
+   CALL_VertexPointer(disp, (3, GL_FLOAT, 0, NULL));
+
+   for (unsigned i = 0; i < sizeof(costs) / sizeof(costs[0]); i++) {
+      double direct, threaded;
+
+      driver_draw_ns = costs[i][1];
+      _glapi_set_dispatch(ctx.CurrentDispatch);
+      direct = draw_loop_ms(ctx.CurrentDispatch, draws, costs[i][0]);
+      _glapi_set_dispatch(ctx.MarshalExec);
+      threaded = draw_loop_ms(ctx.MarshalExec, draws, costs[i][0]);
+
+      printf("app %4u ns, driver %4u ns per draw: direct %8.2f ms  "
+             "glthread %8.2f ms  (%.2fx)\n", costs[i][0], costs[i][1],
+             direct, threaded, direct / threaded);
+   }
+}
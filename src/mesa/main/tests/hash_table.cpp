@@ -0,0 +1,241 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name hash_table.cpp
+ *
+ * Check _mesa_HashTable with both generated and application-chosen names,
+ * lookups racing with inserts, and (with --gtest_also_run_disabled_tests)
+ * compare lookup throughput from several threads against locked lookups.
+ */
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "main/glheader.h"
+#include "c11/threads.h"
+
+extern "C" {
+#include "main/hash.h"
+}
+
+/* Objects are fake pointers from which the name can be recovered. */
+static void *
+object(GLuint key)
+{
+   return (void *) (((uintptr_t) key << 4) | 8);
+}
+
+static void
+count_entry(GLuint key, void *data, void *userData)
+{
+   unsigned *count = (unsigned *) userData;
+
+   EXPECT_EQ(object(key), data);
+   (*count)++;
+}
+
+TEST(HashTable, DenseAndSparseNames)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   static const GLuint sparse[] = { 100000, 5000000, 0xfffffffe };
+   unsigned count = 0;
+
+   for (GLuint key = 1; key <= 3000; key++)
+      _mesa_HashInsert(table, key, object(key));
+   for (unsigned i = 0; i < 3; i++)
+      _mesa_HashInsert(table, sparse[i], object(sparse[i]));
+   EXPECT_EQ(3003u, _mesa_HashNumEntries(table));
+
+   for (GLuint key = 1; key <= 3000; key++)
+      EXPECT_EQ(object(key), _mesa_HashLookup(table, key));
+   for (unsigned i = 0; i < 3; i++)
+      EXPECT_EQ(object(sparse[i]), _mesa_HashLookup(table, sparse[i]));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 3001));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 100001));
+
+   /* Replacing an object doesn't add an entry. */
+   _mesa_HashInsert(table, 10, object(10));
+   _mesa_HashInsert(table, 100000, object(100000));
+   EXPECT_EQ(3003u, _mesa_HashNumEntries(table));
+
+   _mesa_HashRemove(table, 1);
+   _mesa_HashRemove(table, 5000000);
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 1));
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 5000000));
+   EXPECT_EQ(3001u, _mesa_HashNumEntries(table));
+
+   _mesa_HashWalk(table, count_entry, &count);
+   EXPECT_EQ(3001u, count);
+
+   /* No room after the highest name, but the first one is free again. */
+   EXPECT_EQ(1u, _mesa_HashFindFreeKeyBlock(table, 1));
+
+   count = 0;
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   EXPECT_EQ(3001u, count);
+   EXPECT_EQ(0u, _mesa_HashNumEntries(table));
+   _mesa_DeleteHashTable(table);
+}
+
+TEST(HashTable, ChosenNameCoveredByGrowth)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   unsigned count = 0;
+
+   /* Too far out for the dense array of an empty table, but covered once
+    * enough names are generated.
+    */
+   _mesa_HashInsert(table, 5000, object(5000));
+   for (GLuint key = 1; key <= 4000; key++) {
+      _mesa_HashInsert(table, key, object(key));
+      ASSERT_EQ(object(5000), _mesa_HashLookup(table, 5000));
+   }
+
+   _mesa_HashWalk(table, count_entry, &count);
+   EXPECT_EQ(4001u, count);
+
+   _mesa_HashRemove(table, 5000);
+   EXPECT_EQ(NULL, _mesa_HashLookup(table, 5000));
+
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   _mesa_DeleteHashTable(table);
+}
+
+struct lookup_thread {
+   struct _mesa_HashTable *table;
+   GLuint num_keys;
+   unsigned iterations;
+   bool locked;
+   volatile bool *stop;
+   unsigned errors;
+};
+
+static int
+lookup_thread_func(void *data)
+{
+   struct lookup_thread *t = (struct lookup_thread *) data;
+
+   for (unsigned i = 0; i < t->iterations && !(t->stop && *t->stop); i++) {
+      GLuint key = 1 + i % t->num_keys;
+      void *obj;
+
+      if (t->locked) {
+         _mesa_HashLockMutex(t->table);
+         obj = _mesa_HashLookupLocked(t->table, key);
+         _mesa_HashUnlockMutex(t->table);
+      } else {
+         obj = _mesa_HashLookup(t->table, key);
+      }
+
+      if (obj != NULL && obj != object(key))
+         t->errors++;
+   }
+   return 0;
+}
+
+TEST(HashTable, LookupsRacingInserts)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   const GLuint num_keys = 100000;
+   struct lookup_thread t[3];
+   thrd_t threads[3];
+   volatile bool stop = false;
+   unsigned count = 0;
+
+   for (unsigned i = 0; i < 3; i++) {
+      t[i].table = table;
+      t[i].num_keys = num_keys;
+      t[i].iterations = ~0u;
+      t[i].locked = false;
+      t[i].stop = &stop;
+      t[i].errors = 0;
+      ASSERT_EQ(thrd_success,
+                thrd_create(&threads[i], lookup_thread_func, &t[i]));
+   }
+
+   /* Grow the dense array many times and remove what was inserted. */
+   for (GLuint key = 1; key <= num_keys; key++) {
+      _mesa_HashInsert(table, key, object(key));
+      if (key % 3 == 0)
+         _mesa_HashRemove(table, key - 1);
+   }
+
+   stop = true;
+   for (unsigned i = 0; i < 3; i++) {
+      thrd_join(threads[i], NULL);
+      EXPECT_EQ(0u, t[i].errors);
+   }
+
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   EXPECT_EQ(num_keys - num_keys / 3, count);
+   _mesa_DeleteHashTable(table);
+}
+
+static double
+lookup_ms(struct _mesa_HashTable *table, unsigned num_threads, bool locked)
+{
+   const unsigned iterations = 4000000;
+   struct lookup_thread t[8];
+   thrd_t threads[8];
+   struct timespec start, end;
+
+   clock_gettime(CLOCK_MONOTONIC, &start);
+   for (unsigned i = 0; i < num_threads; i++) {
+      t[i].table = table;
+      t[i].num_keys = 1000;
+      t[i].iterations = iterations;
+      t[i].locked = locked;
+      t[i].stop = NULL;
+      t[i].errors = 0;
+      thrd_create(&threads[i], lookup_thread_func, &t[i]);
+   }
+   for (unsigned i = 0; i < num_threads; i++)
+      thrd_join(threads[i], NULL);
+   clock_gettime(CLOCK_MONOTONIC, &end);
+
+   return (end.tv_sec - start.tv_sec) * 1000.0 +
+          (end.tv_nsec - start.tv_nsec) / 1000000.0;
+}
+
+TEST(HashTable, DISABLED_LookupContentionBenchmark)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   unsigned count = 0;
+
+   for (GLuint key = 1; key <= 1000; key++)
+      _mesa_HashInsert(table, key, object(key));
+
+   for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      double locked = lookup_ms(table, num_threads, true);
+      double lockless = lookup_ms(table, num_threads, false);
+
+      printf("%u threads x 4M lookups: locked %8.2f ms  "
+             "lock-free %8.2f ms  (%.2fx)\n", num_threads,
+             locked, lockless, locked / lockless);
+   }
+
+   _mesa_HashDeleteAll(table, count_entry, &count);
+   _mesa_DeleteHashTable(table);
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name immediate_mode.cpp
+ *
+ * Check that glBegin/End vertices are drawn together across calls that
+ * don't change how they are drawn, and from a persistently mapped buffer
+ * when the driver supports it.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+#include "vbo/vbo_context.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+/* The x coordinate of each vertex drawn. */
+static std::vector<float> vertices_drawn;
+
+static void
+fake_draw_prims(struct gl_context *ctx,
+                const struct _mesa_prim *prims, GLuint nr_prims,
+                const struct _mesa_index_buffer *ib,
+                GLboolean index_bounds_valid,
+                GLuint min_index, GLuint max_index,
+                struct gl_transform_feedback_object *tfb_vertcount,
+                unsigned stream,
+                struct gl_buffer_object *indirect)
+{
+   const struct gl_client_array *pos = ctx->Array._DrawArrays[VERT_ATTRIB_POS];
+   const GLubyte *data = (const GLubyte *) pos->Ptr;
+
+   if (_mesa_is_bufferobj(pos->BufferObj))
+      data = (const GLubyte *) pos->BufferObj->Data + (uintptr_t) pos->Ptr;
+
+   for (GLuint i = 0; i < nr_prims; i++) {
+      for (GLuint j = 0; j < prims[i].count; j++) {
+         const GLuint v = prims[i].start + j;
+         vertices_drawn.push_back(*(const float *) (data + v * pos->StrideB));
+      }
+   }
+}
+
+class ImmediateMode_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void triangle(float x);
+   void flush();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct vbo_exec_context *exec;
+};
+
+void
+ImmediateMode_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+
+   ctx.Version = 30;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   vbo_set_draw_func(&ctx, fake_draw_prims);
+
+   exec = &vbo_context(&ctx)->exec;
+   vertices_drawn.clear();
+
+   _glapi_set_context(&ctx);
+   _glapi_set_dispatch(ctx.CurrentDispatch);
+}
+
+void
+ImmediateMode_test::TearDown()
+{
+   _glapi_set_dispatch(NULL);
+   _glapi_set_context(NULL);
+
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx);
+}
+
+void
+ImmediateMode_test::triangle(float x)
+{
+   CALL_Begin(_glapi_get_dispatch(), (GL_TRIANGLES));
+   for (unsigned i = 0; i < 3; i++)
+      CALL_Vertex2f(_glapi_get_dispatch(), (x + i, 0.0f));
+   CALL_End(_glapi_get_dispatch(), ());
+}
+
+void
+ImmediateMode_test::flush()
+{
+   struct gl_context *context = &ctx;
+
+   FLUSH_VERTICES(context, 0);
+}
+
+TEST_F(ImmediateMode_test, DrawsAcrossSelectorChanges)
+{
+   struct _glapi_table *disp = ctx.CurrentDispatch;
+   static const GLfloat translate[16] = {
+      1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  5, 0, 0, 1
+   };
+
+   triangle(0);
+   CALL_MatrixMode(disp, (GL_TEXTURE));
+   CALL_ActiveTexture(disp, (GL_TEXTURE1));
+   CALL_ClientActiveTexture(disp, (GL_TEXTURE1));
+   CALL_VertexPointer(disp, (2, GL_FLOAT, 0, NULL));
+   CALL_MatrixMode(disp, (GL_MODELVIEW));
+   CALL_LoadIdentity(disp, ());
+   CALL_PushMatrix(disp, ());
+   triangle(3);
+   CALL_PopMatrix(disp, ());
+   EXPECT_EQ(0u, exec->stats.draws);
+
+   CALL_LoadMatrixf(disp, (translate));
+   EXPECT_EQ(1u, exec->stats.draws);
+   EXPECT_EQ(6u, exec->stats.vertices);
+   EXPECT_EQ(6u, vertices_drawn.size());
+
+   triangle(6);
+   CALL_LoadMatrixf(disp, (translate));
+   EXPECT_EQ(1u, exec->stats.draws);
+
+   vbo_report_frame_stats(&ctx);
+   EXPECT_EQ(0u, exec->stats.draws);
+}
+
+TEST_F(ImmediateMode_test, StateChangeDraws)
+{
+   triangle(0);
+   CALL_LineWidth(ctx.CurrentDispatch, (2.0f));
+   triangle(3);
+   CALL_LineWidth(ctx.CurrentDispatch, (2.0f));
+   triangle(6);
+   flush();
+
+   EXPECT_EQ(2u, exec->stats.draws);
+   EXPECT_EQ(9u, exec->stats.vertices);
+}
+
+TEST_F(ImmediateMode_test, PersistentMapping)
+{
+   vbo_use_buffer_objects(&ctx);
+   ctx.Extensions.ARB_buffer_storage = GL_TRUE;
+
+   for (unsigned i = 0; i < 1000; i++) {
+      triangle(3 * i);
+      CALL_LineWidth(ctx.CurrentDispatch, (2.0f + i % 2));
+      EXPECT_TRUE(_mesa_bufferobj_mapped(exec->vtx.bufferobj, MAP_INTERNAL));
+   }
+   flush();
+
+   /* The buffer filled up several times along the way. */
+   EXPECT_EQ(1000u, exec->stats.draws);
+   ASSERT_EQ(3000u, vertices_drawn.size());
+   for (unsigned i = 0; i < 3000; i++)
+      ASSERT_EQ((float) i, vertices_drawn[i]);
+}
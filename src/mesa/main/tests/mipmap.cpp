@@ -0,0 +1,235 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name mipmap.cpp
+ *
+ * Check _mesa_generate_mipmap_level() (SIMD rows, threaded bands and
+ * slices, sRGB filtering) against a plain 2x2 box filter, and (with
+ * --gtest_also_run_disabled_tests) print its throughput.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "main/imports.h"
+#include "main/mipmap.h"
+
+template<typename T>
+static std::vector<T>
+random_image(int width, int height, int comps)
+{
+   std::vector<T> img(width * height * comps);
+
+   for (size_t i = 0; i < img.size(); i++)
+      img[i] = (T) (rand() & 0xff);
+   return img;
+}
+
+/* The 2D box filter, one component at a time, as do_row() defines it. */
+static void
+reference_ubyte(int comps, int srcWidth, int srcHeight,
+                const std::vector<GLubyte> &src,
+                int dstWidth, int dstHeight, std::vector<GLubyte> &dst)
+{
+   const int colStep = srcWidth == dstWidth ? 1 : 2;
+   const int rowStep = (srcHeight > 1 && srcHeight > dstHeight) ? 2 : 1;
+
+   for (int y = 0; y < dstHeight; y++) {
+      const GLubyte *rowA = &src[y * rowStep * srcWidth * comps];
+      const GLubyte *rowB = rowA + (rowStep - 1) * srcWidth * comps;
+
+      for (int x = 0; x < dstWidth; x++) {
+         const int j = x * colStep, k = j + colStep - 1;
+
+         for (int c = 0; c < comps; c++) {
+            dst[(y * dstWidth + x) * comps + c] =
+               (rowA[j * comps + c] + rowA[k * comps + c] +
+                rowB[j * comps + c] + rowB[k * comps + c]) / 4;
+         }
+      }
+   }
+}
+
+static void
+generate_2d(GLenum target, GLenum datatype, int comps, int bpp,
+            int srcWidth, int srcHeight, const void *src,
+            int dstWidth, int dstHeight, void *dst)
+{
+   const GLubyte *srcSlices[1] = { (const GLubyte *) src };
+   GLubyte *dstSlices[1] = { (GLubyte *) dst };
+
+   _mesa_generate_mipmap_level(target, datatype, comps, 0,
+                               srcWidth, srcHeight, 1,
+                               srcSlices, srcWidth * bpp,
+                               dstWidth, dstHeight, 1,
+                               dstSlices, dstWidth * bpp);
+}
+
+TEST(MipmapTest, Ubyte4MatchesBoxFilter)
+{
+   static const int sizes[][4] = {
+      /* src w, h -> dst w, h */
+      { 64, 64, 32, 32 },
+      { 37, 21, 18, 10 },
+      { 18, 1, 9, 1 },
+      { 1, 18, 1, 9 },
+      { 3, 3, 1, 1 },
+      { 2048, 1024, 1024, 512 },   /* big enough to be split up */
+   };
+
+   for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      const int sw = sizes[i][0], sh = sizes[i][1];
+      const int dw = sizes[i][2], dh = sizes[i][3];
+      std::vector<GLubyte> src = random_image<GLubyte>(sw, sh, 4);
+      std::vector<GLubyte> expected(dw * dh * 4), dst(dw * dh * 4);
+
+      SCOPED_TRACE(i);
+      reference_ubyte(4, sw, sh, src, dw, dh, expected);
+      generate_2d(GL_TEXTURE_2D, GL_UNSIGNED_BYTE, 4, 4,
+                  sw, sh, &src[0], dw, dh, &dst[0]);
+      ASSERT_TRUE(expected == dst);
+   }
+}
+
+TEST(MipmapTest, FloatAndHalfMatchBoxFilter)
+{
+   const int sw = 67, sh = 34, dw = 33, dh = 17;
+   std::vector<GLfloat> src(sw * sh * 4), dst(dw * dh * 4);
+   std::vector<GLhalfARB> hsrc(src.size()), hdst(dst.size());
+
+   for (size_t i = 0; i < src.size(); i++) {
+      src[i] = (rand() & 0xffff) / 4096.0f - 8.0f;
+      hsrc[i] = _mesa_float_to_half(src[i]);
+   }
+
+   generate_2d(GL_TEXTURE_2D, GL_FLOAT, 4, 16, sw, sh, &src[0],
+               dw, dh, &dst[0]);
+   generate_2d(GL_TEXTURE_2D, GL_HALF_FLOAT_ARB, 4, 8, sw, sh, &hsrc[0],
+               dw, dh, &hdst[0]);
+
+   for (int y = 0; y < dh; y++) {
+      for (int x = 0; x < dw; x++) {
+         for (int c = 0; c < 4; c++) {
+            const int a = ((2 * y) * sw + 2 * x) * 4 + c;
+            const int b = ((2 * y + 1) * sw + 2 * x) * 4 + c;
+            const float f = (src[a] + src[a + 4] + src[b] + src[b + 4]) * 0.25f;
+            const float h = (_mesa_half_to_float(hsrc[a]) +
+                             _mesa_half_to_float(hsrc[a + 4]) +
+                             _mesa_half_to_float(hsrc[b]) +
+                             _mesa_half_to_float(hsrc[b + 4])) * 0.25f;
+
+            ASSERT_EQ(f, dst[(y * dw + x) * 4 + c]);
+            ASSERT_EQ(_mesa_float_to_half(h), hdst[(y * dw + x) * 4 + c]);
+         }
+      }
+   }
+}
+
+TEST(MipmapTest, ArraySlicesMatchSingleSlices)
+{
+   const int sw = 512, sh = 256, dw = 256, dh = 128, layers = 6;
+   std::vector<GLubyte> src = random_image<GLubyte>(sw, sh * layers, 4);
+   std::vector<GLubyte> dst(dw * dh * layers * 4);
+   std::vector<GLubyte> expected(dw * dh * 4);
+   const GLubyte *srcSlices[layers];
+   GLubyte *dstSlices[layers];
+
+   for (int l = 0; l < layers; l++) {
+      srcSlices[l] = &src[l * sw * sh * 4];
+      dstSlices[l] = &dst[l * dw * dh * 4];
+   }
+
+   _mesa_generate_mipmap_level(GL_TEXTURE_2D_ARRAY_EXT, GL_UNSIGNED_BYTE, 4, 0,
+                               sw, sh, layers, srcSlices, sw * 4,
+                               dw, dh, layers, dstSlices, dw * 4);
+
+   for (int l = 0; l < layers; l++) {
+      std::vector<GLubyte> slice(srcSlices[l], srcSlices[l] + sw * sh * 4);
+
+      SCOPED_TRACE(l);
+      reference_ubyte(4, sw, sh, slice, dw, dh, expected);
+      ASSERT_EQ(0, memcmp(&expected[0], dstSlices[l], expected.size()));
+   }
+}
+
+TEST(MipmapTest, SrgbIsFilteredInLinearSpace)
+{
+   /* a black/white checkerboard with alpha 0/255 */
+   const GLubyte src[2 * 2 * 4] = {
+      0, 0, 0, 0,          255, 255, 255, 255,
+      255, 255, 255, 255,  0, 0, 0, 0,
+   };
+   GLubyte dst[4];
+
+   generate_2d(GL_TEXTURE_2D, MESA_MIPMAP_SRGB8_ALPHA(3), 4, 4,
+               2, 2, src, 1, 1, dst);
+
+   /* linear 0.5 is ~188 once encoded; alpha stays a plain average */
+   for (int c = 0; c < 3; c++) {
+      EXPECT_LE(187, dst[c]);
+      EXPECT_GE(188, dst[c]);
+   }
+   EXPECT_EQ(127, dst[3]);
+
+   /* with no alpha channel every component is sRGB */
+   generate_2d(GL_TEXTURE_2D, MESA_MIPMAP_SRGB8, 4, 4, 2, 2, src, 1, 1, dst);
+   EXPECT_LE(187, dst[3]);
+}
+
+TEST(MipmapTest, DISABLED_Benchmark)
+{
+   static const struct {
+      const char *name;
+      GLenum datatype;
+      int bpp;
+   } formats[] = {
+      { "rgba8", GL_UNSIGNED_BYTE, 4 },
+      { "srgba8", MESA_MIPMAP_SRGB8_ALPHA(3), 4 },
+      { "rgba16f", GL_HALF_FLOAT_ARB, 8 },
+      { "rgba32f", GL_FLOAT, 16 },
+   };
+   const int size = 4096;
+
+   for (unsigned f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+      std::vector<GLubyte> src =
+         random_image<GLubyte>(size, size, formats[f].bpp);
+      std::vector<GLubyte> dst(size * size * formats[f].bpp / 4);
+      struct timespec start, end;
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      generate_2d(GL_TEXTURE_2D, formats[f].datatype, 4, formats[f].bpp,
+                  size, size, &src[0], size / 2, size / 2, &dst[0]);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      printf("%-8s %dx%d -> %dx%d: %8.2f ms\n", formats[f].name,
+             size, size, size / 2, size / 2,
+             (end.tv_sec - start.tv_sec) * 1000.0 +
+             (end.tv_nsec - start.tv_nsec) / 1000000.0);
+   }
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name multi_draw.cpp
+ *
+ * Check that glMultiDrawArrays reports the same errors as glDrawArrays
+ * whatever its counts, and hands the non-empty ranges to the driver as a
+ * single list of prims.
+ */
+
+#include <gtest/gtest.h>
+
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+#include "vbo/vbo.h"
+
+extern "C" {
+#include "main/framebuffer.h"
+}
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+
+static unsigned draws;
+static unsigned prims_drawn;
+
+static void
+fake_update_state(struct gl_context *ctx, GLbitfield new_state)
+{
+}
+
+static void
+fake_draw_prims(struct gl_context *ctx,
+                const struct _mesa_prim *prims, GLuint nr_prims,
+                const struct _mesa_index_buffer *ib,
+                GLboolean index_bounds_valid,
+                GLuint min_index, GLuint max_index,
+                struct gl_transform_feedback_object *tfb_vertcount,
+                unsigned stream,
+                struct gl_buffer_object *indirect)
+{
+   draws++;
+   prims_drawn += nr_prims;
+}
+
+class MultiDrawArrays_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct gl_framebuffer *fb;
+   struct _glapi_table *disp;
+   GLfloat vertices[16][2];
+};
+
+void
+MultiDrawArrays_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   _mesa_init_driver_functions(&driver_functions);
+   driver_functions.UpdateState = fake_update_state;
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+
+   ctx.Version = 30;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+   vbo_set_draw_func(&ctx, fake_draw_prims);
+
+   draws = 0;
+   prims_drawn = 0;
+
+   fb = _mesa_create_framebuffer(&visual);
+   _mesa_make_current(&ctx, fb, fb);
+   disp = ctx.CurrentDispatch;
+
+   memset(vertices, 0, sizeof(vertices));
+   CALL_VertexPointer(disp, (2, GL_FLOAT, 0, vertices));
+   CALL_EnableClientState(disp, (GL_VERTEX_ARRAY));
+}
+
+void
+MultiDrawArrays_test::TearDown()
+{
+   _mesa_make_current(NULL, NULL, NULL);
+   _mesa_reference_framebuffer(&fb, NULL);
+
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx);
+}
+
+TEST_F(MultiDrawArrays_test, EmptyRangesStillValidated)
+{
+   static const GLint first[3] = { 0, 3, 6 };
+   static const GLsizei count[3] = { 0, 0, 0 };
+
+   CALL_MultiDrawArrays(disp, (GL_TRIANGLES + 100, first, count, 3));
+   EXPECT_EQ(GL_INVALID_ENUM, CALL_GetError(disp, ()));
+
+   CALL_MultiDrawArrays(disp, (GL_TRIANGLES, first, count, 3));
+   EXPECT_EQ(GL_NO_ERROR, CALL_GetError(disp, ()));
+   EXPECT_EQ(0u, draws);
+}
+
+TEST_F(MultiDrawArrays_test, NegativeCount)
+{
+   static const GLint first[3] = { 0, 3, 6 };
+   static const GLsizei count[3] = { 3, -1, 3 };
+
+   CALL_MultiDrawArrays(disp, (GL_TRIANGLES, first, count, 3));
+   EXPECT_EQ(GL_INVALID_VALUE, CALL_GetError(disp, ()));
+   EXPECT_EQ(0u, draws);
+}
+
+TEST_F(MultiDrawArrays_test, SkipsEmptyRanges)
+{
+   static const GLint first[4] = { 0, 3, 6, 9 };
+   static const GLsizei count[4] = { 3, 0, 6, 0 };
+
+   CALL_MultiDrawArrays(disp, (GL_TRIANGLES, first, count, 4));
+   EXPECT_EQ(GL_NO_ERROR, CALL_GetError(disp, ()));
+   EXPECT_EQ(1u, draws);
+   EXPECT_EQ(2u, prims_drawn);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name streaming_memcpy.cpp
+ *
+ * Check the cache-bypassing pixel transfer copies against memcpy(), and
+ * (with --gtest_also_run_disabled_tests) measure how much of a hot working
+ * set survives a large transfer done with each of them.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "main/streaming-memcpy.h"
+
+static void
+check_copy(mesa_memcpy_func copy, size_t dst_offset, size_t src_offset,
+           size_t len)
+{
+   std::vector<uint8_t> src(len + src_offset + 64);
+   std::vector<uint8_t> dst(len + dst_offset + 64, 0xcd);
+
+   for (size_t i = 0; i < src.size(); i++)
+      src[i] = (uint8_t) (i * 7 + 3);
+
+   copy(&dst[dst_offset], &src[src_offset], len);
+
+   for (size_t i = 0; i < dst_offset; i++)
+      ASSERT_EQ(0xcd, dst[i]);
+   ASSERT_EQ(0, memcmp(&dst[dst_offset], &src[src_offset], len));
+   for (size_t i = dst_offset + len; i < dst.size(); i++)
+      ASSERT_EQ(0xcd, dst[i]);
+}
+
+TEST(StreamingMemcpyTest, StoreMatchesMemcpy)
+{
+   static const size_t lengths[] = { 0, 1, 15, 16, 17, 63, 64, 65, 200, 4099 };
+
+   for (unsigned l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+      for (size_t dst_offset = 0; dst_offset < 16; dst_offset += 3) {
+         for (size_t src_offset = 0; src_offset < 16; src_offset += 5) {
+            SCOPED_TRACE(lengths[l]);
+            check_copy(_mesa_streaming_store_memcpy,
+                       dst_offset, src_offset, lengths[l]);
+         }
+      }
+   }
+}
+
+TEST(StreamingMemcpyTest, TransferMemcpyDispatch)
+{
+   EXPECT_TRUE(_mesa_get_transfer_memcpy(0) == (mesa_memcpy_func) memcpy);
+   EXPECT_TRUE(_mesa_get_transfer_memcpy(MESA_STREAMING_MEMCPY_THRESHOLD - 1) ==
+               (mesa_memcpy_func) memcpy);
+
+   mesa_memcpy_func big =
+      _mesa_get_transfer_memcpy(MESA_STREAMING_MEMCPY_THRESHOLD);
+   check_copy(big, 0, 0, 4096);
+   check_copy(big, 5, 0, 4096);
+   check_copy(big, 0, 9, 4096);
+   check_copy(big, 3, 3, 12345);
+}
+
+/* Time a re-read of a cache-sized working set after a large transfer. */
+static double
+hot_set_reread_ms(mesa_memcpy_func copy, std::vector<uint8_t> &hot,
+                  std::vector<uint8_t> &dst, const std::vector<uint8_t> &src)
+{
+   const size_t row = 16384;
+   volatile unsigned sum = 0;
+   clock_t start;
+
+   for (size_t i = 0; i < hot.size(); i += 64)
+      sum += hot[i];
+
+   /* Copy row by row, like the readpixels/getteximage paths do. */
+   for (size_t offset = 0; offset < src.size(); offset += row)
+      copy(&dst[offset], &src[offset], row);
+
+   start = clock();
+   for (int pass = 0; pass < 16; pass++)
+      for (size_t i = 0; i < hot.size(); i += 64)
+         sum += hot[i];
+
+   return 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+}
+
+TEST(StreamingMemcpyTest, DISABLED_CachePollutionBenchmark)
+{
+   std::vector<uint8_t> hot(1024 * 1024, 1);
+   std::vector<uint8_t> src(256 * 1024 * 1024, 2);
+   std::vector<uint8_t> dst(src.size(), 0);
+   mesa_memcpy_func streaming =
+      _mesa_get_transfer_memcpy(MESA_STREAMING_MEMCPY_THRESHOLD);
+   double ms_memcpy = 0, ms_streaming = 0;
+   clock_t start;
+
+   for (int i = 0; i < 4; i++) {
+      ms_memcpy += hot_set_reread_ms((mesa_memcpy_func) memcpy, hot, dst, src);
+      ms_streaming += hot_set_reread_ms(streaming, hot, dst, src);
+   }
+
+   start = clock();
+   for (size_t offset = 0; offset < src.size(); offset += 16384)
+      memcpy(&dst[offset], &src[offset], 16384);
+   double copy_memcpy = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+
+   start = clock();
+   for (size_t offset = 0; offset < src.size(); offset += 16384)
+      streaming(&dst[offset], &src[offset], 16384);
+   double copy_streaming = 1000.0 * (clock() - start) / CLOCKS_PER_SEC;
+
+   printf("256 MiB transfer:        memcpy %8.2f ms  streaming %8.2f ms\n",
+          copy_memcpy, copy_streaming);
+   printf("1 MiB hot set re-read:   memcpy %8.2f ms  streaming %8.2f ms\n",
+          ms_memcpy / 4, ms_streaming / 4);
+}
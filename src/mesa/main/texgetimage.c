@@ -48,6 +48,7 @@
 #include "texstore.h"
 #include "format_utils.h"
 #include "pixeltransfer.h"
+#include "streaming-memcpy.h"
 
 /**
  * Can the given type represent negative values?
@@ -675,13 +676,16 @@ get_tex_memcpy(struct gl_context *ctx,
                                   GL_MAP_READ_BIT, &src, &srcRowStride);
 
       if (src) {
+         mesa_memcpy_func copy =
+            _mesa_get_transfer_memcpy((size_t) bytesPerRow * height);
+
          if (bytesPerRow == dstRowStride && bytesPerRow == srcRowStride) {
-            memcpy(dst, src, bytesPerRow * texImage->Height);
+            copy(dst, src, bytesPerRow * texImage->Height);
          }
          else {
             GLuint row;
             for (row = 0; row < height; row++) {
-               memcpy(dst, src, bytesPerRow);
+               copy(dst, src, bytesPerRow);
                dst += dstRowStride;
                src += srcRowStride;
             }
@@ -788,6 +792,7 @@ _mesa_GetCompressedTexSubImage_sw(struct gl_context *ctx,
    struct compressed_pixelstore store;
    GLint slice;
    GLubyte *dest;
+   mesa_memcpy_func copy;
 
    _mesa_compute_compressed_pixelstore(dimensions, texImage->TexFormat,
                                        width, height, depth,
@@ -812,6 +817,10 @@ _mesa_GetCompressedTexSubImage_sw(struct gl_context *ctx,
 
    dest += store.SkipBytes;
 
+   copy = _mesa_get_transfer_memcpy((size_t) store.CopyBytesPerRow *
+                                    store.CopyRowsPerSlice *
+                                    store.CopySlices);
+
    for (slice = 0; slice < store.CopySlices; slice++) {
       GLint srcRowStride;
       GLubyte *src;
@@ -824,7 +833,7 @@ _mesa_GetCompressedTexSubImage_sw(struct gl_context *ctx,
       if (src) {
          GLint i;
          for (i = 0; i < store.CopyRowsPerSlice; i++) {
-            memcpy(dest, src, store.CopyBytesPerRow);
+            copy(dest, src, store.CopyBytesPerRow);
             dest += store.TotalBytesPerRow;
             src += srcRowStride;
          }
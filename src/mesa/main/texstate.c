@@ -306,7 +306,10 @@ _mesa_ActiveTexture(GLenum texture)
       return;
    }
 
-   FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   /* Selecting a unit doesn't change how anything is drawn, so there's no
+    * need to flush vertices.
+    */
+   ctx->NewState |= _NEW_TEXTURE;
 
    ctx->Texture.CurrentUnit = texUnit;
    if (ctx->Transform.MatrixMode == GL_TEXTURE) {
@@ -335,7 +338,7 @@ _mesa_ClientActiveTexture(GLenum texture)
       return;
    }
 
-   FLUSH_VERTICES(ctx, _NEW_ARRAY);
+   ctx->NewState |= _NEW_ARRAY;
    ctx->Array.ActiveTexture = texUnit;
 }
 
@@ -29,8 +29,12 @@
 #include <stdio.h>
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/macros.h"
 
 #include "pipe/p_defines.h"
+#include "os/os_time.h"
+#include "util/u_debug.h"
+#include "util/u_math.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
@@ -84,42 +88,114 @@ static const struct st_tracked_state *atoms[] =
 };
 
 
+/**
+ * Update counts and times of each atom, enabled with ST_ATOM_STATS=true
+ * and printed when the context is destroyed.
+ */
+struct st_atom_stats {
+   uint64_t validations;
+   uint64_t count[ARRAY_SIZE(atoms)];
+   uint64_t ns[ARRAY_SIZE(atoms)];
+};
+
+
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i, bit;
+
+   STATIC_ASSERT(ARRAY_SIZE(atoms) <= 64);
+
+   memset(st->mesa_bit_atoms, 0, sizeof(st->mesa_bit_atoms));
+   memset(st->st_bit_atoms, 0, sizeof(st->st_bit_atoms));
+
+   for (i = 0; i < ARRAY_SIZE(atoms); i++) {
+      const struct st_tracked_state *atom = atoms[i];
+
+      assert(atom->update);
+      assert(atom->dirty.mesa || atom->dirty.st);
+
+      for (bit = 0; bit < 32; bit++) {
+         if (atom->dirty.mesa & (1u << bit))
+            st->mesa_bit_atoms[bit] |= BITFIELD64_BIT(i);
+      }
+      for (bit = 0; bit < 64; bit++) {
+         if (atom->dirty.st & BITFIELD64_BIT(bit))
+            st->st_bit_atoms[bit] |= BITFIELD64_BIT(i);
+      }
+   }
+
+   if (debug_get_bool_option("ST_ATOM_STATS", FALSE))
+      st->atom_stats = CALLOC_STRUCT(st_atom_stats);
+}
+
+
+static void
+print_atom_stats(const struct st_atom_stats *stats)
+{
+   GLuint i;
+
+   debug_printf("st: %" PRIu64 " state validations\n", stats->validations);
+   debug_printf("st: %-28s %12s %12s %10s\n",
+                "atom", "updates", "total us", "ns/update");
+
+   for (i = 0; i < ARRAY_SIZE(atoms); i++) {
+      if (!stats->count[i])
+         continue;
+      debug_printf("st: %-28s %12" PRIu64 " %12" PRIu64 " %10" PRIu64 "\n",
+                   atoms[i]->name, stats->count[i], stats->ns[i] / 1000,
+                   stats->ns[i] / stats->count[i]);
+   }
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   if (st->atom_stats) {
+      print_atom_stats(st->atom_stats);
+      free(st->atom_stats);
+      st->atom_stats = NULL;
+   }
 }
 
 
 /***********************************************************************
  */
 
-static GLboolean check_state( const struct st_state_flags *a,
-			      const struct st_state_flags *b )
+/**
+ * The atoms affected by any of the given flags.  Only the set bits are
+ * visited, so this is cheap for the usual handful of dirty flags.
+ */
+static uint64_t
+atoms_for_state( const struct st_context *st,
+                 const struct st_state_flags *flags )
 {
-   return ((a->mesa & b->mesa) ||
-	   (a->st & b->st));
-}
+   uint64_t result = 0;
+   unsigned mesa = flags->mesa;
+   uint64_t st_bits = flags->st;
 
-static void accumulate_state( struct st_state_flags *a,
-			      const struct st_state_flags *b )
-{
-   a->mesa |= b->mesa;
-   a->st |= b->st;
+   while (mesa)
+      result |= st->mesa_bit_atoms[u_bit_scan(&mesa)];
+   while (st_bits)
+      result |= st->st_bit_atoms[u_bit_scan64(&st_bits)];
+
+   return result;
 }
 
 
-static void xor_states( struct st_state_flags *result,
-			     const struct st_state_flags *a,
-			      const struct st_state_flags *b )
+static void
+update_atom( struct st_context *st, GLuint i )
 {
-   result->mesa = a->mesa ^ b->mesa;
-   result->st = a->st ^ b->st;
+   struct st_atom_stats *stats = st->atom_stats;
+
+   if (likely(!stats)) {
+      atoms[i]->update( st );
+   }
+   else {
+      int64_t start = os_time_get_nano();
+      atoms[i]->update( st );
+      stats->ns[i] += os_time_get_nano() - start;
+      stats->count[i]++;
+   }
 }
 
 
@@ -173,7 +249,7 @@ static void check_attrib_edgeflag(struct st_context *st)
 void st_validate_state( struct st_context *st )
 {
    struct st_state_flags *state = &st->dirty;
-   GLuint i;
+   uint64_t pending;
 
    /* Get Mesa driver state. */
    st->dirty.st |= st->ctx->NewDriverState;
@@ -191,55 +267,32 @@ void st_validate_state( struct st_context *st )
    if (state->st == 0)
       return;
 
-   /*printf("%s %x/%x\n", __func__, state->mesa, state->st);*/
-
-#ifdef DEBUG
-   if (1) {
-#else
-   if (0) {
-#endif
-      /* Debug version which enforces various sanity checks on the
-       * state flags which are generated and checked to help ensure
-       * state atoms are ordered correctly in the list.
-       */
-      struct st_state_flags examined, prev;      
-      memset(&examined, 0, sizeof(examined));
-      prev = *state;
-
-      for (i = 0; i < ARRAY_SIZE(atoms); i++) {	 
-	 const struct st_tracked_state *atom = atoms[i];
-	 struct st_state_flags generated;
-	 
-	 /*printf("atom %s %x/%x\n", atom->name, atom->dirty.mesa, atom->dirty.st);*/
-
-	 if (!(atom->dirty.mesa || atom->dirty.st) ||
-	     !atom->update) {
-	    printf("malformed atom %s\n", atom->name);
-	    assert(0);
-	 }
-
-	 if (check_state(state, &atom->dirty)) {
-	    atoms[i]->update( st );
-	    /*printf("after: %x\n", atom->dirty.mesa);*/
-	 }
-
-	 accumulate_state(&examined, &atom->dirty);
-
-	 /* generated = (prev ^ state)
-	  * if (examined & generated)
-	  *     fail;
-	  */
-	 xor_states(&generated, &prev, state);
-	 assert(!check_state(&examined, &generated));
-	 prev = *state;
-      }
-      /*printf("\n");*/
+   if (st->atom_stats)
+      st->atom_stats->validations++;
 
-   }
-   else {
-      for (i = 0; i < ARRAY_SIZE(atoms); i++) {	 
-	 if (check_state(state, &atoms[i]->dirty))
-	    atoms[i]->update( st );
+   /* Atoms run in list order.  An atom may dirty more state for the atoms
+    * after it, but never for those before it.
+    */
+   pending = atoms_for_state(st, state);
+   while (pending) {
+      const GLuint i = u_bit_scan64(&pending);
+      const struct st_state_flags prev = *state;
+
+      update_atom(st, i);
+
+      if (state->mesa != prev.mesa || state->st != prev.st) {
+         struct st_state_flags generated;
+         uint64_t triggered;
+
+         generated.mesa = state->mesa & ~prev.mesa;
+         generated.st = state->st & ~prev.st;
+         triggered = atoms_for_state(st, &generated);
+
+         /* An atom dirtying state for itself or an earlier atom means the
+          * atom list is in the wrong order.
+          */
+         assert(!(triggered & BITFIELD64_MASK(i + 1)));
+         pending |= triggered & ~BITFIELD64_MASK(i + 1);
       }
    }
 
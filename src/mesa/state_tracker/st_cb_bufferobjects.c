@@ -37,6 +37,7 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "vbo/vbo.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
@@ -45,6 +46,7 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
+#include "cso_cache/cso_context.h"
 
 
 /**
@@ -68,6 +70,21 @@ st_bufferobj_alloc(struct gl_context *ctx, GLuint name)
 
 
 
+/**
+ * Called before the buffer's contents change other than through a
+ * persistent mapping, so vertex translations kept by u_vbuf are dropped.
+ */
+static void
+st_bufferobj_written(struct gl_context *ctx, struct st_buffer_object *st_obj)
+{
+   struct st_context *st = st_context(ctx);
+
+   /* DeleteBuffer can be called while the context is torn down. */
+   if (st_obj->buffer && st->cso_context)
+      cso_invalidate_buffer(st->cso_context, st_obj->buffer);
+}
+
+
 /**
  * Deallocate/free a vertex/pixel buffer object.
  * Called via glDeleteBuffersARB().
@@ -79,6 +96,9 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
 
    assert(obj->RefCount == 0);
    _mesa_buffer_unmap_all_mappings(ctx, obj);
+   vbo_delete_minmax_cache(obj);
+   mtx_destroy(&obj->MinMaxCacheMutex);
+   st_bufferobj_written(ctx, st_obj);
 
    if (st_obj->buffer)
       pipe_resource_reference(&st_obj->buffer, NULL);
@@ -130,6 +150,7 @@ st_bufferobj_subdata(struct gl_context *ctx,
     * just queue the upload as dma rather than mapping the underlying
     * buffer directly.
     */
+   st_bufferobj_written(ctx, st_obj);
    pipe_buffer_write(st_context(ctx)->pipe,
 		     st_obj->buffer,
 		     offset, size, data);
@@ -186,6 +207,8 @@ st_bufferobj_data(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    unsigned bind, pipe_usage, pipe_flags = 0;
 
+   st_bufferobj_written(ctx, st_obj);
+
    if (target != GL_EXTERNAL_VIRTUAL_MEMORY_BUFFER_AMD &&
        size && data && st_obj->buffer &&
        st_obj->Base.Size == size &&
@@ -340,8 +363,10 @@ st_bufferobj_map_range(struct gl_context *ctx,
    struct st_buffer_object *st_obj = st_buffer_object(obj);
    enum pipe_transfer_usage flags = 0x0;
 
-   if (access & GL_MAP_WRITE_BIT)
+   if (access & GL_MAP_WRITE_BIT) {
       flags |= PIPE_TRANSFER_WRITE;
+      st_bufferobj_written(ctx, st_obj);
+   }
 
    if (access & GL_MAP_READ_BIT)
       flags |= PIPE_TRANSFER_READ;
@@ -466,6 +491,7 @@ st_copy_buffer_subdata(struct gl_context *ctx,
 
    u_box_1d(readOffset, size, &box);
 
+   st_bufferobj_written(ctx, dstObj);
    pipe->resource_copy_region(pipe, dstObj->buffer, 0, writeOffset, 0, 0,
                               srcObj->buffer, 0, &box);
 }
@@ -493,6 +519,7 @@ st_clear_buffer_subdata(struct gl_context *ctx,
    if (!clearValue)
       clearValue = zeros;
 
+   st_bufferobj_written(ctx, buf);
    pipe->clear_buffer(pipe, buf->buffer, offset, size,
                       clearValue, clearValueSize);
 }
@@ -30,6 +30,7 @@
 #include "main/imports.h"
 #include "main/readpix.h"
 #include "main/enums.h"
+#include "main/errors.h"
 #include "main/framebuffer.h"
 #include "util/u_inlines.h"
 #include "util/u_format.h"
@@ -249,6 +250,11 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    pipe_transfer_unmap(pipe, tex_xfer);
    _mesa_unmap_pbo_dest(ctx, pack);
    pipe_resource_reference(&dst, NULL);
+
+   _mesa_perf_debug(ctx, MESA_DEBUG_SEVERITY_LOW,
+                    "glReadPixels(%dx%d %s/%s) converted by blitting to %s\n",
+                    width, height, _mesa_enum_to_string(format),
+                    _mesa_enum_to_string(type), util_format_name(dst_format));
    return;
 
 fallback:
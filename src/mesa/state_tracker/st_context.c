@@ -29,6 +29,7 @@
 #include "main/accum.h"
 #include "main/api_exec.h"
 #include "main/context.h"
+#include "main/glthread.h"
 #include "main/samplerobj.h"
 #include "main/shaderobj.h"
 #include "main/version.h"
@@ -187,6 +188,8 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    }
 
    st->cso_context = cso_create_context(pipe);
+   cso_enable_static_vertex_translations(st->cso_context, TRUE);
+   st->static_vertex_translations = TRUE;
 
    st_init_atoms( st );
    st_init_bitmap(st);
@@ -373,6 +376,8 @@ void st_destroy_context( struct st_context *st )
    struct gl_context *ctx = st->ctx;
    GLuint i;
 
+   _mesa_glthread_destroy(ctx);
+
    _mesa_HashWalk(ctx->Shared->TexObjects, destroy_tex_sampler_cb, st);
 
    st_reference_fragprog(st, &st->fp, NULL);
@@ -44,6 +44,7 @@ struct dd_function_table;
 struct draw_context;
 struct draw_stage;
 struct gen_mipmap_state;
+struct st_atom_stats;
 struct st_context;
 struct st_fragment_program;
 struct u_upload_mgr;
@@ -110,6 +111,9 @@ struct st_context
 
    boolean vertex_array_out_of_memory;
 
+   /** u_vbuf may keep translations of static vertex buffers */
+   boolean static_vertex_translations;
+
    /* Some state is contained in constant objects.
     * Other state is just parameter values.
     */
@@ -141,6 +145,16 @@ struct st_context
 
    struct st_state_flags dirty;
 
+   /**
+    * The atoms each bit of dirty.mesa and dirty.st triggers, as bitmasks
+    * indexed like the atom list in st_atom.c.
+    */
+   uint64_t mesa_bit_atoms[32];
+   uint64_t st_bit_atoms[64];
+
+   /** Per-atom update counts and times, NULL unless ST_ATOM_STATS is set */
+   struct st_atom_stats *atom_stats;
+
    GLboolean vertdata_edgeflags;
    GLboolean edgeflag_culls_prims;
 
@@ -65,6 +65,10 @@
 #include "cso_cache/cso_context.h"
 
 
+/** Max number of prims passed to the driver in one multi_draw call */
+#define ST_MAX_MULTI_DRAWS 32
+
+
 /**
  * This is very similar to vbo_all_varyings_in_vbos() but we are
  * only interested in per-vertex data.  See bug 38626.
@@ -191,8 +195,9 @@ st_draw_vbo(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    struct pipe_index_buffer ibuffer = {0};
    struct pipe_draw_info info;
+   struct pipe_draw_info draws[ST_MAX_MULTI_DRAWS];
    const struct gl_client_array **arrays = ctx->Array._DrawArrays;
-   unsigned i;
+   unsigned i, num_draws = 0;
 
    /* Mesa core state should have been validated already */
    assert(ctx->NewState == 0x0);
@@ -214,6 +219,15 @@ st_draw_vbo(struct gl_context *ctx,
       return;
    }
 
+   /* Writes through another context sharing our buffers wouldn't
+    * invalidate the vertex translations kept for this one.
+    */
+   if (unlikely(st->static_vertex_translations) &&
+       ctx->Shared->RefCount > 1) {
+      cso_enable_static_vertex_translations(st->cso_context, FALSE);
+      st->static_vertex_translations = FALSE;
+   }
+
    util_draw_init_info(&info);
 
    if (ib) {
@@ -257,7 +271,9 @@ st_draw_vbo(struct gl_context *ctx,
       info.restart_index = ctx->Array.RestartIndex;
    }
 
-   /* do actual drawing */
+   /* do actual drawing, passing the consecutive prims of the same mode to
+    * the driver together
+    */
    for (i = 0; i < nr_prims; i++) {
       info.mode = translate_prim(ctx, prims[i].mode);
       info.start = prims[i].start;
@@ -281,17 +297,32 @@ st_draw_vbo(struct gl_context *ctx,
       }
 
       if (info.count_from_stream_output || info.indirect) {
+         if (num_draws) {
+            cso_multi_draw(st->cso_context, draws, num_draws);
+            num_draws = 0;
+         }
          cso_draw_vbo(st->cso_context, &info);
+         continue;
       }
-      else if (info.primitive_restart) {
-         /* don't trim, restarts might be inside index list */
-         cso_draw_vbo(st->cso_context, &info);
-      }
-      else if (u_trim_pipe_prim(prims[i].mode, &info.count)) {
-         cso_draw_vbo(st->cso_context, &info);
+
+      /* don't trim with primitive restart, restarts might be inside index
+       * list
+       */
+      if (!info.primitive_restart &&
+          !u_trim_pipe_prim(prims[i].mode, &info.count))
+         continue;
+
+      if (num_draws == ARRAY_SIZE(draws) ||
+          (num_draws && draws[0].mode != info.mode)) {
+         cso_multi_draw(st->cso_context, draws, num_draws);
+         num_draws = 0;
       }
+      draws[num_draws++] = info;
    }
 
+   if (num_draws)
+      cso_multi_draw(st->cso_context, draws, num_draws);
+
    if (ib && st->indexbuf_uploader && !_mesa_is_bufferobj(ib->obj)) {
       pipe_resource_reference(&ibuffer.buffer, NULL);
    }
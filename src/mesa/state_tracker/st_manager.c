@@ -33,9 +33,11 @@
 #include "main/texstate.h"
 #include "main/errors.h"
 #include "main/framebuffer.h"
+#include "main/glthread.h"
 #include "main/fbobject.h"
 #include "main/renderbuffer.h"
 #include "main/version.h"
+#include "vbo/vbo.h"
 #include "st_texture.h"
 
 #include "st_context.h"
@@ -497,15 +499,27 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
    struct st_context *st = (struct st_context *) stctxi;
    unsigned pipe_flags = 0;
 
+   _mesa_glthread_finish(st->ctx);
+
    if (flags & ST_FLUSH_END_OF_FRAME) {
       pipe_flags |= PIPE_FLUSH_END_OF_FRAME;
    }
 
    st_flush(st, fence, pipe_flags);
+   if (flags & ST_FLUSH_END_OF_FRAME)
+      vbo_report_frame_stats(st->ctx);
    if (flags & ST_FLUSH_FRONT)
       st_manager_flush_frontbuffer(st);
 }
 
+static void
+st_context_thread_finish(struct st_context_iface *stctxi)
+{
+   struct st_context *st = (struct st_context *) stctxi;
+
+   _mesa_glthread_finish(st->ctx);
+}
+
 static boolean
 st_context_teximage(struct st_context_iface *stctxi,
                     enum st_texture_type tex_type,
@@ -522,6 +536,8 @@ st_context_teximage(struct st_context_iface *stctxi,
    GLuint width, height, depth;
    GLenum target;
 
+   _mesa_glthread_finish(ctx);
+
    switch (tex_type) {
    case ST_TEXTURE_1D:
       target = GL_TEXTURE_1D;
@@ -603,6 +619,8 @@ st_context_copy(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    _mesa_copy_context(src->ctx, st->ctx, mask);
 }
 
@@ -702,6 +720,7 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
 
    st->iface.destroy = st_context_destroy;
    st->iface.flush = st_context_flush;
+   st->iface.thread_finish = st_context_thread_finish;
    st->iface.teximage = st_context_teximage;
    st->iface.copy = st_context_copy;
    st->iface.share = st_context_share;
@@ -777,6 +796,18 @@ st_api_make_current(struct st_api *stapi, struct st_context_iface *stctxi,
 
          ret = _mesa_make_current(st->ctx, &stdraw->Base, &stread->Base);
 
+         /* Once the context is bound to a window, queue the application's
+          * calls to a driver thread if asked to.  Only st/mesa does this,
+          * as the flush and swap paths have to finish the thread first
+          * (see st_context_iface::thread_finish).
+          */
+         if (ret && !st->ctx->GLThread &&
+             _mesa_glthread_requested(st->ctx)) {
+            _mesa_glthread_init(st->ctx);
+            if (st->ctx->MarshalExec)
+               _glapi_set_dispatch(st->ctx->MarshalExec);
+         }
+
          st->draw_stamp = stdraw->stamp - 1;
          st->read_stamp = stread->stamp - 1;
          st_context_validate(st, stdraw, stread);
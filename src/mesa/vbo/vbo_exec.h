@@ -35,6 +35,7 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #define __VBO_EXEC_H__
 
 #include "main/mtypes.h"
+#include "main/bufferobj.h"
 #include "vbo.h"
 #include "vbo_attrib.h"
 
@@ -134,6 +135,13 @@ struct vbo_exec_context
    /* Which flags to set in vbo_exec_BeginVertices() */
    GLbitfield begin_vertices_flags;
 
+   /** glBegin/End drawing since vbo_report_frame_stats() */
+   struct {
+      GLuint draws;
+      GLuint prims;
+      GLuint vertices;
+   } stats;
+
 #ifdef DEBUG
    GLint flush_call_depth;
 #endif
@@ -141,6 +149,18 @@ struct vbo_exec_context
 
 
 
+/**
+ * Whether the vertex buffer stays mapped while we draw from it, rather
+ * than being unmapped before each draw and mapped again after.
+ */
+static inline GLboolean
+vbo_exec_persistent_mapping(const struct vbo_exec_context *exec)
+{
+   return _mesa_is_bufferobj(exec->vtx.bufferobj) &&
+          exec->ctx->Extensions.ARB_buffer_storage;
+}
+
+
 /* External API:
  */
 void vbo_exec_init( struct gl_context *ctx );
@@ -1154,13 +1154,20 @@ void vbo_exec_vtx_destroy( struct vbo_exec_context *exec )
 void vbo_exec_BeginVertices( struct gl_context *ctx )
 {
    struct vbo_exec_context *exec = &vbo_context(ctx)->exec;
+   GLbitfield flags = exec->begin_vertices_flags;
 
    vbo_exec_vtx_map( exec );
 
    assert((ctx->Driver.NeedFlush & FLUSH_UPDATE_CURRENT) == 0);
    assert(exec->begin_vertices_flags);
 
-   ctx->Driver.NeedFlush |= exec->begin_vertices_flags;
+   /* State changes needn't flush to unmap a persistently mapped buffer,
+    * only once vertices are stored.
+    */
+   if (vbo_exec_persistent_mapping(exec))
+      flags &= ~FLUSH_STORED_VERTICES;
+
+   ctx->Driver.NeedFlush |= flags;
 }
 
 
@@ -223,7 +223,7 @@ vbo_exec_bind_arrays( struct gl_context *ctx )
             assert(exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Pointer);
             assert(offset >= 0);
             arrays[attr].Ptr = (GLubyte *)
-               exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset + offset;
+               (GLintptr) exec->vtx.buffer_used + offset;
          }
          else {
             /* Ptr into ordinary app memory */
@@ -260,7 +260,7 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
    if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
       struct gl_context *ctx = exec->ctx;
       
-      if (ctx->Driver.FlushMappedBufferRange) {
+      if (ctx->Driver.FlushMappedBufferRange && !vbo_exec_persistent_mapping(exec)) {
          GLintptr offset = exec->vtx.buffer_used -
                            exec->vtx.bufferobj->Mappings[MAP_INTERNAL].Offset;
          GLsizeiptr length = (exec->vtx.buffer_ptr - exec->vtx.buffer_map) *
@@ -293,22 +293,46 @@ void
 vbo_exec_vtx_map( struct vbo_exec_context *exec )
 {
    struct gl_context *ctx = exec->ctx;
-   const GLenum accessRange = GL_MAP_WRITE_BIT |  /* for MapBufferRange */
-                              GL_MAP_INVALIDATE_RANGE_BIT |
-                              GL_MAP_UNSYNCHRONIZED_BIT |
-                              GL_MAP_FLUSH_EXPLICIT_BIT |
-                              MESA_MAP_NOWAIT_BIT;
+   const GLboolean persistent = vbo_exec_persistent_mapping(exec);
+   GLenum accessRange = GL_MAP_WRITE_BIT |  /* for MapBufferRange */
+                        GL_MAP_UNSYNCHRONIZED_BIT;
+   GLbitfield storageFlags = GL_MAP_WRITE_BIT |
+                             GL_DYNAMIC_STORAGE_BIT |
+                             GL_CLIENT_STORAGE_BIT;
    const GLenum usage = GL_STREAM_DRAW_ARB;
    
    if (!_mesa_is_bufferobj(exec->vtx.bufferobj))
       return;
 
+   if (persistent) {
+      /* Stays mapped across draws and is read back by vbo_copy_vertices,
+       * which the non-persistent flags below don't allow.
+       */
+      accessRange |= GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                     GL_MAP_READ_BIT;
+      storageFlags |= GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                      GL_MAP_READ_BIT;
+
+      /* Still mapped since the last flush. */
+      if (exec->vtx.buffer_map)
+         return;
+   }
+   else {
+      accessRange |= GL_MAP_INVALIDATE_RANGE_BIT |
+                     GL_MAP_FLUSH_EXPLICIT_BIT |
+                     MESA_MAP_NOWAIT_BIT;
+   }
+
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
    if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
-      /* The VBO exists and there's room for more */
-      if (exec->vtx.bufferobj->Size > 0) {
+      /* The VBO exists and there's room for more, unless it was created
+       * before it could be mapped persistently.
+       */
+      if (exec->vtx.bufferobj->Size > 0 &&
+          (exec->vtx.bufferobj->StorageFlags & storageFlags) ==
+          storageFlags) {
          exec->vtx.buffer_map =
             (fi_type *)ctx->Driver.MapBufferRange(ctx,
                                                   exec->vtx.buffer_used,
@@ -330,10 +354,7 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
 
       if (ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
                                  VBO_VERT_BUFFER_SIZE,
-                                 NULL, usage,
-                                 GL_MAP_WRITE_BIT |
-                                 GL_DYNAMIC_STORAGE_BIT |
-                                 GL_CLIENT_STORAGE_BIT,
+                                 NULL, usage, storageFlags,
                                  exec->vtx.bufferobj)) {
          /* buffer allocation worked, now map the buffer */
          exec->vtx.buffer_map =
@@ -378,9 +399,15 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
 void
 vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
 {
+   const GLboolean persistent = vbo_exec_persistent_mapping(exec);
+
    if (0)
       vbo_exec_debug_verts( exec );
 
+   /* Nothing needs the buffer unmapped if it's mapped persistently. */
+   if (persistent)
+      keepUnmapped = GL_FALSE;
+
    if (exec->vtx.prim_count && 
        exec->vtx.vert_count) {
 
@@ -397,7 +424,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
          if (ctx->NewState)
             _mesa_update_state( ctx );
 
-         if (_mesa_is_bufferobj(exec->vtx.bufferobj)) {
+         if (_mesa_is_bufferobj(exec->vtx.bufferobj) && !persistent) {
             vbo_exec_vtx_unmap( exec );
          }
 
@@ -405,6 +432,10 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
             printf("%s %d %d\n", __func__, exec->vtx.prim_count,
 		   exec->vtx.vert_count);
 
+         exec->stats.draws++;
+         exec->stats.prims += exec->vtx.prim_count;
+         exec->stats.vertices += exec->vtx.vert_count;
+
 	 vbo_context(ctx)->draw_prims( ctx, 
 				       exec->vtx.prim,
 				       exec->vtx.prim_count,
@@ -416,12 +447,26 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
 
 	 /* If using a real VBO, get new storage -- unless asked not to.
           */
-         if (_mesa_is_bufferobj(exec->vtx.bufferobj) && !keepUnmapped) {
+         if (_mesa_is_bufferobj(exec->vtx.bufferobj) && !keepUnmapped &&
+             !persistent) {
             vbo_exec_vtx_map( exec );
          }
       }
    }
 
+   if (persistent && exec->vtx.buffer_map) {
+      /* Keep filling the buffer after what was drawn. */
+      exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
+                                exec->vtx.buffer_map) * sizeof(float);
+      exec->vtx.buffer_map = exec->vtx.buffer_ptr;
+
+      if (VBO_VERT_BUFFER_SIZE <= exec->vtx.buffer_used + 1024) {
+         /* Full: unmap, and allocate new storage. */
+         vbo_exec_vtx_unmap( exec );
+         vbo_exec_vtx_map( exec );
+      }
+   }
+
    /* May have to unmap explicitly if we didn't draw:
     */
    if (keepUnmapped &&
@@ -440,3 +485,22 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
    exec->vtx.prim_count = 0;
    exec->vtx.vert_count = 0;
 }
+
+
+/**
+ * Called at the end of each frame.  With MESA_VERBOSE=draw, prints how
+ * many draws glBegin/End drawing took during the frame.
+ */
+void
+vbo_report_frame_stats(struct gl_context *ctx)
+{
+   struct vbo_exec_context *exec = &vbo_context(ctx)->exec;
+
+   if (MESA_VERBOSE & VERBOSE_DRAW) {
+      _mesa_debug(ctx, "glBegin/End: %u draws, %u primitives, "
+                  "%u vertices\n", exec->stats.draws, exec->stats.prims,
+                  exec->stats.vertices);
+   }
+
+   memset(&exec->stats, 0, sizeof(exec->stats));
+}
@@ -0,0 +1,319 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright 2003 VMware, Inc.
+ * Copyright 2009 VMware, Inc.
+ * All Rights Reserved.
+ * Copyright (C) 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/varray.h"
+#include "main/macros.h"
+#include "main/sse_minmax.h"
+#include "x86/common_x86_asm.h"
+#include "util/hash_table.h"
+#include "util/index_minmax.h"
+
+#include "vbo.h"
+
+
+/**
+ * Upper bound on the number of ranges remembered per buffer object.  The
+ * whole cache is dropped when it is reached, which keeps applications that
+ * draw from an ever changing set of sub-ranges from growing it without
+ * bound.
+ */
+#define MINMAX_CACHE_MAX_ENTRIES 64
+
+
+struct minmax_cache_key {
+   GLintptr offset;
+   GLuint count;
+   GLuint index_size;
+   GLuint restart;
+   GLuint restart_index;
+};
+
+
+struct minmax_cache_entry {
+   struct minmax_cache_key key;
+   GLuint min;
+   GLuint max;
+};
+
+
+static uint32_t
+vbo_minmax_cache_hash(const void *key)
+{
+   return _mesa_hash_data(key, sizeof(struct minmax_cache_key));
+}
+
+
+static bool
+vbo_minmax_cache_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, sizeof(struct minmax_cache_key)) == 0;
+}
+
+
+static void
+vbo_minmax_cache_delete_entry(struct hash_entry *entry)
+{
+   free(entry->data);
+}
+
+
+/**
+ * Whether anything other than the CPU can write the buffer behind our
+ * back, in which case there is nothing that would invalidate the cache.
+ */
+static bool
+vbo_use_minmax_cache(const struct gl_buffer_object *bufferObj)
+{
+   const GLbitfield persistent_write = GL_MAP_PERSISTENT_BIT |
+                                       GL_MAP_WRITE_BIT;
+
+   if (bufferObj->UsageHistory & (USAGE_TEXTURE_BUFFER |
+                                  USAGE_ATOMIC_COUNTER_BUFFER |
+                                  USAGE_SHADER_STORAGE_BUFFER |
+                                  USAGE_TRANSFORM_FEEDBACK_BUFFER |
+                                  USAGE_PIXEL_PACK_BUFFER |
+                                  USAGE_DISABLE_MINMAX_CACHE))
+      return false;
+
+   if ((bufferObj->Mappings[MAP_USER].AccessFlags & persistent_write) ==
+       persistent_write)
+      return false;
+
+   return true;
+}
+
+
+/**
+ * Free the min/max cache of a buffer object.
+ * Called when the buffer object is deleted.
+ */
+void
+vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
+{
+   _mesa_hash_table_destroy(bufferObj->MinMaxCache,
+                            vbo_minmax_cache_delete_entry);
+   bufferObj->MinMaxCache = NULL;
+}
+
+
+static bool
+vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
+                      const struct minmax_cache_key *key,
+                      GLuint *min_index, GLuint *max_index)
+{
+   struct hash_entry *result;
+   bool found = false;
+
+   if (!vbo_use_minmax_cache(bufferObj))
+      return false;
+
+   mtx_lock(&bufferObj->MinMaxCacheMutex);
+
+   if (bufferObj->MinMaxCacheDirty) {
+      /* Stop caching for good once the buffer has been rewritten more than
+       * it has been drawn from: that's a streaming buffer and every lookup
+       * would miss.  Allow a buffer's worth of misses first so that
+       * applications filling a static buffer piece by piece while they
+       * start drawing still get to use the cache.
+       */
+      const unsigned optimism = bufferObj->Size;
+
+      if (bufferObj->MinMaxCacheMissIndices > optimism &&
+          bufferObj->MinMaxCacheHitIndices <
+          bufferObj->MinMaxCacheMissIndices - optimism) {
+         bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
+      }
+
+      if (bufferObj->MinMaxCache)
+         vbo_delete_minmax_cache(bufferObj);
+      bufferObj->MinMaxCacheDirty = false;
+      goto out;
+   }
+
+   if (!bufferObj->MinMaxCache)
+      goto out;
+
+   result = _mesa_hash_table_search(bufferObj->MinMaxCache, key);
+   if (result) {
+      const struct minmax_cache_entry *entry = result->data;
+
+      *min_index = entry->min;
+      *max_index = entry->max;
+      found = true;
+   }
+
+out:
+   if (found)
+      bufferObj->MinMaxCacheHitIndices += key->count;
+   else
+      bufferObj->MinMaxCacheMissIndices += key->count;
+
+   mtx_unlock(&bufferObj->MinMaxCacheMutex);
+   return found;
+}
+
+
+static void
+vbo_minmax_cache_store(struct gl_buffer_object *bufferObj,
+                       const struct minmax_cache_key *key,
+                       GLuint min_index, GLuint max_index)
+{
+   struct minmax_cache_entry *entry;
+
+   if (!vbo_use_minmax_cache(bufferObj))
+      return;
+
+   mtx_lock(&bufferObj->MinMaxCacheMutex);
+
+   /* The buffer was written while we were scanning it. */
+   if (bufferObj->MinMaxCacheDirty)
+      goto out;
+
+   if (bufferObj->MinMaxCache &&
+       bufferObj->MinMaxCache->entries >= MINMAX_CACHE_MAX_ENTRIES)
+      vbo_delete_minmax_cache(bufferObj);
+
+   if (!bufferObj->MinMaxCache) {
+      bufferObj->MinMaxCache =
+         _mesa_hash_table_create(NULL, vbo_minmax_cache_hash,
+                                 vbo_minmax_cache_key_equal);
+      if (!bufferObj->MinMaxCache)
+         goto out;
+   }
+
+   /* Another context sharing the buffer may have got there first. */
+   if (_mesa_hash_table_search(bufferObj->MinMaxCache, key))
+      goto out;
+
+   entry = MALLOC_STRUCT(minmax_cache_entry);
+   if (!entry)
+      goto out;
+
+   entry->key = *key;
+   entry->min = min_index;
+   entry->max = max_index;
+
+   if (!_mesa_hash_table_insert(bufferObj->MinMaxCache, &entry->key, entry))
+      free(entry);
+
+out:
+   mtx_unlock(&bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Compute min and max elements by scanning the index buffer for
+ * glDraw[Range]Elements() calls.
+ * If primitive restart is enabled, we need to ignore restart
+ * indexes when computing min/max.
+ *
+ * Scans of buffer objects are remembered per buffer object until the
+ * buffer is written again, so static index buffers are only read once.
+ */
+static void
+vbo_get_minmax_index(struct gl_context *ctx,
+		     const struct _mesa_prim *prim,
+		     const struct _mesa_index_buffer *ib,
+		     GLuint *min_index, GLuint *max_index,
+		     const GLuint count)
+{
+   const GLboolean restart = ctx->Array._PrimitiveRestart;
+   const GLuint restartIndex = _mesa_primitive_restart_index(ctx, ib->type);
+   const int index_size = vbo_sizeof_ib_type(ib->type);
+   struct minmax_cache_key key;
+   const char *indices;
+
+   indices = (char *) ib->ptr + prim->start * index_size;
+   if (_mesa_is_bufferobj(ib->obj)) {
+      GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
+
+      key.offset = (GLintptr) indices;
+      key.count = count;
+      key.index_size = index_size;
+      key.restart = restart;
+      key.restart_index = restart ? restartIndex : 0;
+
+      if (vbo_get_minmax_cached(ib->obj, &key, min_index, max_index))
+         return;
+
+      indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
+                                           GL_MAP_READ_BIT, ib->obj,
+                                           MAP_INTERNAL);
+   }
+
+#if defined(USE_SSE41)
+   if (ib->type == GL_UNSIGNED_INT && !restart && cpu_has_sse4_1) {
+      _mesa_uint_array_min_max((const GLuint *) indices,
+                               min_index, max_index, count);
+   }
+   else
+#endif
+      util_index_minmax(index_size, indices, count, restart, restartIndex,
+                        min_index, max_index);
+
+   if (_mesa_is_bufferobj(ib->obj)) {
+      vbo_minmax_cache_store(ib->obj, &key, *min_index, *max_index);
+      ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
+   }
+}
+
+/**
+ * Compute min and max elements for nr_prims
+ */
+void
+vbo_get_minmax_indices(struct gl_context *ctx,
+                       const struct _mesa_prim *prims,
+                       const struct _mesa_index_buffer *ib,
+                       GLuint *min_index,
+                       GLuint *max_index,
+                       GLuint nr_prims)
+{
+   GLuint tmp_min, tmp_max;
+   GLuint i;
+   GLuint count;
+
+   *min_index = ~0;
+   *max_index = 0;
+
+   for (i = 0; i < nr_prims; i++) {
+      const struct _mesa_prim *start_prim;
+
+      start_prim = &prims[i];
+      count = start_prim->count;
+      /* Do combination if possible to reduce map/unmap count */
+      while ((i + 1 < nr_prims) &&
+             (prims[i].start + prims[i].count == prims[i+1].start)) {
+         count += prims[i+1].count;
+         i++;
+      }
+      vbo_get_minmax_index(ctx, start_prim, ib, &tmp_min, &tmp_max, count);
+      *min_index = MIN2(*min_index, tmp_min);
+      *max_index = MAX2(*max_index, tmp_max);
+   }
+}
@@ -95,6 +95,9 @@ void vbo_save_destroy( struct gl_context *ctx )
       }
    }
 
+   vbo_save_release_index_store(ctx, save->index_store);
+   save->index_store = NULL;
+
    for (i = 0; i < VBO_ATTRIB_MAX; i++) {
       _mesa_reference_buffer_object(ctx, &save->arrays[i].BufferObj, NULL);
    }
@@ -83,6 +83,16 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* The primitives as merged point, line and triangle lists indexing
+    * the vertices, or index_prim_count == 0.  See vbo_save_index.c.
+    */
+   struct _mesa_prim *index_prim;
+   GLuint index_prim_count;
+   GLuint index_count;
+   GLuint index_offset;         /**< in bytes, into index_store->bufferobj */
+   GLbitfield index_flags;
+   struct vbo_save_index_store *index_store;
 };
 
 /* These buffers should be a reasonable size to support upload to
@@ -97,6 +107,7 @@ struct vbo_save_vertex_list {
  */
 #define VBO_SAVE_BUFFER_SIZE (8*1024) /* dwords */
 #define VBO_SAVE_PRIM_SIZE   128
+#define VBO_SAVE_INDEX_BUFFER_SIZE (32*1024) /* GLushorts */
 #define VBO_SAVE_PRIM_MODE_MASK         0x3f
 #define VBO_SAVE_PRIM_WEAK              0x40
 #define VBO_SAVE_PRIM_NO_CURRENT_UPDATE 0x80
@@ -118,6 +129,12 @@ struct vbo_save_primitive_store {
    GLuint refcount;
 };
 
+struct vbo_save_index_store {
+   struct gl_buffer_object *bufferobj;
+   GLuint used;                 /**< in GLushorts */
+   GLuint refcount;
+};
+
 
 struct vbo_save_context {
    struct gl_context *ctx;
@@ -143,6 +160,7 @@ struct vbo_save_context {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+   struct vbo_save_index_store *index_store;  /**< allocated on demand */
 
    fi_type *buffer_ptr;		   /* cursor, points into buffer */
    fi_type vertex[VBO_ATTRIB_MAX*4];	   /* current values */
@@ -187,4 +205,23 @@ void
 vbo_save_unmap_vertex_store(struct gl_context *ctx,
                             struct vbo_save_vertex_store *vertex_store);
 
+/* vbo_save_index.c:
+ */
+void
+vbo_save_build_index_list(struct gl_context *ctx,
+                          struct vbo_save_vertex_list *node,
+                          const fi_type *vertices);
+
+void
+vbo_save_destroy_index_list(struct gl_context *ctx,
+                            struct vbo_save_vertex_list *node);
+
+void
+vbo_save_release_index_store(struct gl_context *ctx,
+                             struct vbo_save_index_store *index_store);
+
+GLboolean
+vbo_save_draw_index_list(struct gl_context *ctx,
+                         const struct vbo_save_vertex_list *node);
+
 #endif /* VBO_SAVE_H */
@@ -444,6 +444,11 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(ctx, node->prim, &node->prim_count);
 
+   vbo_save_build_index_list(ctx, node,
+                             (const fi_type *) ((const char *) save->
+                                                vertex_store->buffer +
+                                                node->buffer_offset));
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1210,6 +1215,20 @@ _save_OBE_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
 }
 
 
+static void GLAPIENTRY
+_save_OBE_MultiDrawArrays(GLenum mode, const GLint *first,
+                          const GLsizei *count, GLsizei primcount)
+{
+   GLsizei i;
+
+   for (i = 0; i < primcount; i++) {
+      if (count[i] > 0) {
+	 CALL_DrawArrays(GET_DISPATCH(), (mode, first[i], count[i]));
+      }
+   }
+}
+
+
 static void GLAPIENTRY
 _save_OBE_MultiDrawElements(GLenum mode, const GLsizei *count, GLenum type,
                             const GLvoid * const *indices, GLsizei primcount)
@@ -1411,6 +1430,7 @@ vbo_initialize_save_dispatch(const struct gl_context *ctx,
    SET_DrawArrays(exec, _save_OBE_DrawArrays);
    SET_DrawElements(exec, _save_OBE_DrawElements);
    SET_DrawRangeElements(exec, _save_OBE_DrawRangeElements);
+   SET_MultiDrawArrays(exec, _save_OBE_MultiDrawArrays);
    SET_MultiDrawElementsEXT(exec, _save_OBE_MultiDrawElements);
    SET_MultiDrawElementsBaseVertex(exec, _save_OBE_MultiDrawElementsBaseVertex);
    SET_Rectf(exec, _save_OBE_Rectf);
@@ -1529,6 +1549,8 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   vbo_save_destroy_index_list(ctx, node);
+
    free(node->current_data);
    node->current_data = NULL;
 }
@@ -0,0 +1,492 @@
+/**************************************************************************
+ *
+ * Copyright 2015 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file vbo_save_index.c
+ *
+ * Index lists for compiled vertex lists.
+ *
+ * Display lists built by CAD applications are made of many short strips,
+ * fans and quads, and each primitive of a vertex list becomes a separate
+ * draw when the list is replayed.  When a vertex list is compiled, its
+ * primitives are also expressed as lists of points, lines and triangles
+ * indexing the vertices, consecutive primitives of the same kind are
+ * merged, and identical vertices are given the same index so that they
+ * can be reused from post-transform vertex caches.
+ *
+ * Strips, loops and polygons are split the same way the draw module splits
+ * them with the last vertex convention, but these lists are only
+ * equivalent to the original primitives under some state, which is
+ * checked when the list is replayed.
+ */
+
+
+#include "main/glheader.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "main/transformfeedback.h"
+
+#include "vbo_context.h"
+
+
+/* An interesting VBO number/name to help with debugging */
+#define VBO_BUF_ID  12346
+
+/** vbo_save_vertex_list::index_flags */
+#define INDEX_POLYGONS_SPLIT   0x1  /**< quads or polygons made triangles */
+#define INDEX_LINES_SPLIT      0x2  /**< line strips or loops made lines */
+#define INDEX_VERTICES_MERGED  0x4  /**< identical vertices share an index */
+
+
+static struct vbo_save_index_store *
+alloc_index_store(struct gl_context *ctx)
+{
+   struct vbo_save_index_store *index_store =
+      CALLOC_STRUCT(vbo_save_index_store);
+
+   if (!index_store)
+      return NULL;
+
+   index_store->bufferobj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID);
+   if (!index_store->bufferobj ||
+       !ctx->Driver.BufferData(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                               VBO_SAVE_INDEX_BUFFER_SIZE * sizeof(GLushort),
+                               NULL, GL_STATIC_DRAW_ARB,
+                               GL_DYNAMIC_STORAGE_BIT,
+                               index_store->bufferobj)) {
+      _mesa_reference_buffer_object(ctx, &index_store->bufferobj, NULL);
+      free(index_store);
+      return NULL;
+   }
+
+   index_store->refcount = 1;
+   return index_store;
+}
+
+
+void
+vbo_save_release_index_store(struct gl_context *ctx,
+                             struct vbo_save_index_store *index_store)
+{
+   if (index_store && --index_store->refcount == 0) {
+      _mesa_reference_buffer_object(ctx, &index_store->bufferobj, NULL);
+      free(index_store);
+   }
+}
+
+
+/**
+ * The kind of list a primitive can be turned into, or GL_NONE.
+ */
+static GLenum
+list_mode(const struct _mesa_prim *prim, GLbitfield *flags)
+{
+   switch (prim->mode) {
+   case GL_POINTS:
+      return GL_POINTS;
+   case GL_LINE_LOOP:
+      /* Only a whole loop can be closed. */
+      if (!prim->begin || !prim->end)
+         return GL_NONE;
+      /* fall through */
+   case GL_LINE_STRIP:
+      *flags |= INDEX_LINES_SPLIT;
+      /* fall through */
+   case GL_LINES:
+      return GL_LINES;
+   case GL_QUADS:
+   case GL_QUAD_STRIP:
+   case GL_POLYGON:
+      *flags |= INDEX_POLYGONS_SPLIT;
+      /* fall through */
+   case GL_TRIANGLES:
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+      return GL_TRIANGLES;
+   default:
+      return GL_NONE;
+   }
+}
+
+
+/**
+ * The number of indices emit_indices() writes for a primitive.
+ */
+static GLuint
+count_indices(const struct _mesa_prim *prim)
+{
+   const GLuint n = prim->count;
+
+   switch (prim->mode) {
+   case GL_POINTS:
+      return n;
+   case GL_LINES:
+      return n & ~1;
+   case GL_LINE_STRIP:
+      return n >= 2 ? 2 * (n - 1) : 0;
+   case GL_LINE_LOOP:
+      return n >= 2 ? 2 * n : 0;
+   case GL_TRIANGLES:
+      return n - n % 3;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+      return n >= 3 ? 3 * (n - 2) : 0;
+   case GL_QUADS:
+      return n / 4 * 6;
+   case GL_QUAD_STRIP:
+      return n >= 4 ? (n - 2) / 2 * 6 : 0;
+   default:
+      return 0;
+   }
+}
+
+
+/**
+ * Write the indices of a primitive as a list, keeping the provoking vertex
+ * of the last vertex convention last.  \p remap maps the list's vertices
+ * to the index used for them.
+ */
+static GLushort *
+emit_indices(const struct _mesa_prim *prim, const GLushort *remap,
+             GLushort *out)
+{
+   const GLushort *v = remap + prim->start;
+   const GLuint n = prim->count;
+   GLuint i;
+
+#define TRI(a, b, c) \
+   do { *out++ = v[a]; *out++ = v[b]; *out++ = v[c]; } while (0)
+
+   switch (prim->mode) {
+   case GL_POINTS:
+   case GL_LINES:
+   case GL_TRIANGLES:
+      for (i = 0; i < count_indices(prim); i++)
+         *out++ = v[i];
+      break;
+   case GL_LINE_LOOP:
+   case GL_LINE_STRIP:
+      for (i = 0; i + 1 < n; i++) {
+         *out++ = v[i];
+         *out++ = v[i + 1];
+      }
+      if (prim->mode == GL_LINE_LOOP && n >= 2) {
+         *out++ = v[n - 1];
+         *out++ = v[0];
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 2 < n; i++) {
+         if (i & 1)
+            TRI(i + 1, i, i + 2);
+         else
+            TRI(i, i + 1, i + 2);
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 0; i + 2 < n; i++)
+         TRI(0, i + 1, i + 2);
+      break;
+   case GL_POLYGON:
+      /* The first vertex is the provoking one. */
+      for (i = 0; i + 2 < n; i++)
+         TRI(i + 1, i + 2, 0);
+      break;
+   case GL_QUADS:
+      for (i = 0; i + 3 < n; i += 4) {
+         TRI(i, i + 1, i + 3);
+         TRI(i + 1, i + 2, i + 3);
+      }
+      break;
+   case GL_QUAD_STRIP:
+      for (i = 0; i + 3 < n; i += 2) {
+         TRI(i + 2, i, i + 3);
+         TRI(i, i + 1, i + 3);
+      }
+      break;
+   }
+
+#undef TRI
+
+   return out;
+}
+
+
+static uint32_t
+hash_vertex(const GLuint *vertex, GLuint size)
+{
+   uint32_t hash = 2166136261u;
+   GLuint i;
+
+   for (i = 0; i < size; i++)
+      hash = (hash ^ vertex[i]) * 16777619u;
+   return hash;
+}
+
+
+/**
+ * Map each vertex to the first vertex identical to it.  Returns the
+ * number of distinct vertices.
+ */
+static GLuint
+merge_vertices(const fi_type *vertices, GLuint count, GLuint vertex_size,
+               GLushort *remap)
+{
+   const GLuint table_size = _mesa_next_pow_two_32(count * 2);
+   GLushort *table = malloc(table_size * sizeof(GLushort));
+   GLuint distinct = 0;
+   GLuint i;
+
+   if (!table) {
+      for (i = 0; i < count; i++)
+         remap[i] = i;
+      return count;
+   }
+
+   /* Slots hold a vertex number plus one, 0 is empty. */
+   memset(table, 0, table_size * sizeof(GLushort));
+
+   for (i = 0; i < count; i++) {
+      const GLuint *vertex = (const GLuint *) (vertices + i * vertex_size);
+      GLuint slot = hash_vertex(vertex, vertex_size) & (table_size - 1);
+
+      for (;;) {
+         const GLuint j = table[slot];
+
+         if (j == 0) {
+            table[slot] = i + 1;
+            remap[i] = i;
+            distinct++;
+            break;
+         }
+         if (memcmp(vertices + (j - 1) * vertex_size, vertex,
+                    vertex_size * sizeof(fi_type)) == 0) {
+            remap[i] = j - 1;
+            break;
+         }
+         slot = (slot + 1) & (table_size - 1);
+      }
+   }
+
+   free(table);
+   return distinct;
+}
+
+
+/**
+ * Build the index list of a vertex list being compiled, if it merges
+ * primitives or vertices.  \p vertices are the list's vertices.
+ */
+void
+vbo_save_build_index_list(struct gl_context *ctx,
+                          struct vbo_save_vertex_list *node,
+                          const fi_type *vertices)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   struct _mesa_prim *prims;
+   GLushort *remap, *indices, *out;
+   GLuint num_indices = 0, num_prims = 0, distinct;
+   GLbitfield flags = 0;
+   GLenum mode = GL_NONE;
+   GLuint i;
+
+   node->index_prim = NULL;
+   node->index_prim_count = 0;
+   node->index_store = NULL;
+
+   if (node->count == 0 || node->prim_count == 0)
+      return;
+
+   /* Count the lists needed. */
+   for (i = 0; i < node->prim_count; i++) {
+      const GLenum prim_mode = list_mode(&node->prim[i], &flags);
+
+      if (prim_mode == GL_NONE)
+         return;
+      if (prim_mode != mode)
+         num_prims++;
+      mode = prim_mode;
+      num_indices += count_indices(&node->prim[i]);
+   }
+
+   if (num_indices == 0 || num_indices > VBO_SAVE_INDEX_BUFFER_SIZE)
+      return;
+
+   remap = malloc(node->count * sizeof(GLushort));
+   if (!remap)
+      return;
+
+   distinct = merge_vertices(vertices, node->count, node->vertex_size, remap);
+   if (distinct < node->count)
+      flags |= INDEX_VERTICES_MERGED;
+
+   /* Not worth an indexed draw if little changes. */
+   if (num_prims == node->prim_count && distinct * 4 > node->count * 3) {
+      free(remap);
+      return;
+   }
+
+   indices = malloc(num_indices * sizeof(GLushort));
+   prims = calloc(num_prims, sizeof(struct _mesa_prim));
+   if (!indices || !prims)
+      goto done;
+
+   if (!save->index_store ||
+       save->index_store->used + num_indices > VBO_SAVE_INDEX_BUFFER_SIZE) {
+      vbo_save_release_index_store(ctx, save->index_store);
+      save->index_store = alloc_index_store(ctx);
+      if (!save->index_store)
+         goto done;
+   }
+
+   out = indices;
+   mode = GL_NONE;
+   num_prims = 0;
+   for (i = 0; i < node->prim_count; i++) {
+      const GLenum prim_mode = list_mode(&node->prim[i], &flags);
+
+      if (prim_mode != mode) {
+         struct _mesa_prim *prim = &prims[num_prims++];
+
+         prim->mode = prim_mode;
+         prim->indexed = 1;
+         prim->begin = 1;
+         prim->end = 1;
+         prim->start = out - indices;
+         prim->num_instances = 1;
+         mode = prim_mode;
+      }
+      out = emit_indices(&node->prim[i], remap, out);
+      prims[num_prims - 1].count = (out - indices) - prims[num_prims - 1].start;
+   }
+   assert(out - indices == num_indices);
+
+   node->index_offset = save->index_store->used * sizeof(GLushort);
+   ctx->Driver.BufferSubData(ctx, node->index_offset,
+                             num_indices * sizeof(GLushort), indices,
+                             save->index_store->bufferobj);
+   save->index_store->used += num_indices;
+   save->index_store->refcount++;
+
+   node->index_store = save->index_store;
+   node->index_prim = prims;
+   node->index_prim_count = num_prims;
+   node->index_count = num_indices;
+   node->index_flags = flags;
+   prims = NULL;
+
+done:
+   free(prims);
+   free(indices);
+   free(remap);
+}
+
+
+void
+vbo_save_destroy_index_list(struct gl_context *ctx,
+                            struct vbo_save_vertex_list *node)
+{
+   vbo_save_release_index_store(ctx, node->index_store);
+   node->index_store = NULL;
+   free(node->index_prim);
+   node->index_prim = NULL;
+   node->index_prim_count = 0;
+}
+
+
+/**
+ * Whether the index list draws the same as the list's primitives with the
+ * current state.
+ */
+static GLboolean
+can_draw_index_list(const struct gl_context *ctx,
+                    const struct vbo_save_vertex_list *node)
+{
+   const struct gl_vertex_program *vp = ctx->VertexProgram._Current;
+   const struct gl_fragment_program *fp = ctx->FragmentProgram._Current;
+
+   if (node->index_prim_count == 0)
+      return GL_FALSE;
+
+   /* The splits keep the provoking vertex of this convention only. */
+   if (ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT)
+      return GL_FALSE;
+
+   /* Stipple restarts at every line of a list. */
+   if ((node->index_flags & INDEX_LINES_SPLIT) && ctx->Line.StippleFlag)
+      return GL_FALSE;
+
+   /* Edges of the triangles would show. */
+   if ((node->index_flags & INDEX_POLYGONS_SPLIT) &&
+       (ctx->Polygon.FrontMode != GL_FILL || ctx->Polygon.BackMode != GL_FILL))
+      return GL_FALSE;
+
+   if (ctx->RenderMode != GL_RENDER ||
+       ctx->Array._PrimitiveRestart ||
+       _mesa_is_xfb_active_and_unpaused(ctx) ||
+       ctx->GeometryProgram._Current)
+      return GL_FALSE;
+
+   /* Merged primitives and vertices renumber these. */
+   if (vp && (vp->Base.SystemValuesRead &
+              ((1 << SYSTEM_VALUE_VERTEX_ID) |
+               (1 << SYSTEM_VALUE_VERTEX_ID_ZERO_BASE))))
+      return GL_FALSE;
+   if (fp && (fp->Base.InputsRead & VARYING_BIT_PRIMITIVE_ID))
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Draw the index list of a vertex list whose vertices are bound, if it
+ * draws the same as the list's primitives.
+ */
+GLboolean
+vbo_save_draw_index_list(struct gl_context *ctx,
+                         const struct vbo_save_vertex_list *node)
+{
+   struct _mesa_index_buffer ib;
+
+   if (!can_draw_index_list(ctx, node))
+      return GL_FALSE;
+
+   ib.count = node->index_count;
+   ib.type = GL_UNSIGNED_SHORT;
+   ib.obj = node->index_store->bufferobj;
+   ib.ptr = (const GLubyte *) NULL + node->index_offset;
+
+   vbo_context(ctx)->draw_prims(ctx, node->index_prim, node->index_prim_count,
+                                &ib, GL_TRUE, 0, node->count - 1,
+                                NULL, 0, NULL);
+   return GL_TRUE;
+}
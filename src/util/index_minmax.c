@@ -0,0 +1,223 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * The vector loops replace restart indices by the identity of each
+ * reduction (all ones for the minimum, zero for the maximum), so a block
+ * made only of restart indices leaves the accumulators alone.  If the
+ * reduced minimum ends up above the reduced maximum no real index was seen.
+ *
+ * SSE2 has no unsigned 16/32-bit min/max, so those flip the sign bit and
+ * use the signed operations instead.
+ */
+
+#include "index_minmax.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
+#define MIN2(a, b) ((a) < (b) ? (a) : (b))
+#define MAX2(a, b) ((a) > (b) ? (a) : (b))
+
+#define SCALAR_MINMAX(indices, i, count, restart, restart_index, lo, hi) \
+   for (; i < count; i++) {                                              \
+      const unsigned idx = indices[i];                                   \
+      if (restart && idx == restart_index)                               \
+         continue;                                                       \
+      lo = MIN2(lo, idx);                                                \
+      hi = MAX2(hi, idx);                                                \
+   }
+
+void
+util_index_minmax_ubyte(const uint8_t *indices, unsigned count,
+                        bool primitive_restart, unsigned restart_index,
+                        unsigned *min_index, unsigned *max_index)
+{
+   /* A restart index above 0xff never matches an 8-bit index. */
+   const bool restart = primitive_restart && restart_index <= 0xff;
+   unsigned lo = ~0u, hi = 0, i = 0;
+
+#ifdef __SSE2__
+   if (count >= 16) {
+      const __m128i r = _mm_set1_epi8((char) restart_index);
+      __m128i vmin = _mm_set1_epi8(-1), vmax = _mm_setzero_si128();
+      uint8_t mins[16], maxs[16];
+      unsigned k, vlo = 0xff, vhi = 0;
+
+      for (; i + 16 <= count; i += 16) {
+         __m128i v = _mm_loadu_si128((const __m128i *) (indices + i));
+         if (restart) {
+            const __m128i m = _mm_cmpeq_epi8(v, r);
+            vmin = _mm_min_epu8(vmin, _mm_or_si128(v, m));
+            vmax = _mm_max_epu8(vmax, _mm_andnot_si128(m, v));
+         } else {
+            vmin = _mm_min_epu8(vmin, v);
+            vmax = _mm_max_epu8(vmax, v);
+         }
+      }
+
+      _mm_storeu_si128((__m128i *) mins, vmin);
+      _mm_storeu_si128((__m128i *) maxs, vmax);
+      for (k = 0; k < 16; k++) {
+         vlo = MIN2(vlo, mins[k]);
+         vhi = MAX2(vhi, maxs[k]);
+      }
+      if (vlo <= vhi) {
+         lo = vlo;
+         hi = vhi;
+      }
+   }
+#endif
+
+   SCALAR_MINMAX(indices, i, count, restart, restart_index, lo, hi);
+
+   *min_index = lo;
+   *max_index = hi;
+}
+
+void
+util_index_minmax_ushort(const uint16_t *indices, unsigned count,
+                         bool primitive_restart, unsigned restart_index,
+                         unsigned *min_index, unsigned *max_index)
+{
+   const bool restart = primitive_restart && restart_index <= 0xffff;
+   unsigned lo = ~0u, hi = 0, i = 0;
+
+#ifdef __SSE2__
+   if (count >= 8) {
+      const __m128i r = _mm_set1_epi16((short) restart_index);
+      const __m128i sign = _mm_set1_epi16((short) 0x8000);
+      /* accumulators live in the sign-flipped domain */
+      __m128i vmin = _mm_set1_epi16(0x7fff);
+      __m128i vmax = _mm_set1_epi16((short) 0x8000);
+      uint16_t mins[8], maxs[8];
+      unsigned k, vlo = 0xffff, vhi = 0;
+
+      for (; i + 8 <= count; i += 8) {
+         __m128i v = _mm_loadu_si128((const __m128i *) (indices + i));
+         __m128i vl = v, vh = v;
+         if (restart) {
+            const __m128i m = _mm_cmpeq_epi16(v, r);
+            vl = _mm_or_si128(v, m);
+            vh = _mm_andnot_si128(m, v);
+         }
+         vmin = _mm_min_epi16(vmin, _mm_xor_si128(vl, sign));
+         vmax = _mm_max_epi16(vmax, _mm_xor_si128(vh, sign));
+      }
+
+      _mm_storeu_si128((__m128i *) mins, _mm_xor_si128(vmin, sign));
+      _mm_storeu_si128((__m128i *) maxs, _mm_xor_si128(vmax, sign));
+      for (k = 0; k < 8; k++) {
+         vlo = MIN2(vlo, mins[k]);
+         vhi = MAX2(vhi, maxs[k]);
+      }
+      if (vlo <= vhi) {
+         lo = vlo;
+         hi = vhi;
+      }
+   }
+#endif
+
+   SCALAR_MINMAX(indices, i, count, restart, restart_index, lo, hi);
+
+   *min_index = lo;
+   *max_index = hi;
+}
+
+#ifdef __SSE2__
+static inline __m128i
+min_epu32(__m128i a, __m128i b)
+{
+#ifdef __SSE4_1__
+   return _mm_min_epu32(a, b);
+#else
+   const __m128i sign = _mm_set1_epi32((int) 0x80000000);
+   const __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, sign),
+                                      _mm_xor_si128(b, sign));
+   return _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+#endif
+}
+
+static inline __m128i
+max_epu32(__m128i a, __m128i b)
+{
+#ifdef __SSE4_1__
+   return _mm_max_epu32(a, b);
+#else
+   const __m128i sign = _mm_set1_epi32((int) 0x80000000);
+   const __m128i gt = _mm_cmpgt_epi32(_mm_xor_si128(a, sign),
+                                      _mm_xor_si128(b, sign));
+   return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+#endif
+}
+#endif
+
+void
+util_index_minmax_uint(const uint32_t *indices, unsigned count,
+                       bool primitive_restart, unsigned restart_index,
+                       unsigned *min_index, unsigned *max_index)
+{
+   const bool restart = primitive_restart;
+   unsigned lo = ~0u, hi = 0, i = 0;
+
+#ifdef __SSE2__
+   if (count >= 4) {
+      const __m128i r = _mm_set1_epi32((int) restart_index);
+      __m128i vmin = _mm_set1_epi32(-1), vmax = _mm_setzero_si128();
+      uint32_t mins[4], maxs[4];
+      unsigned k, vlo = ~0u, vhi = 0;
+
+      for (; i + 4 <= count; i += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i *) (indices + i));
+         if (restart) {
+            const __m128i m = _mm_cmpeq_epi32(v, r);
+            vmin = min_epu32(vmin, _mm_or_si128(v, m));
+            vmax = max_epu32(vmax, _mm_andnot_si128(m, v));
+         } else {
+            vmin = min_epu32(vmin, v);
+            vmax = max_epu32(vmax, v);
+         }
+      }
+
+      _mm_storeu_si128((__m128i *) mins, vmin);
+      _mm_storeu_si128((__m128i *) maxs, vmax);
+      for (k = 0; k < 4; k++) {
+         vlo = MIN2(vlo, mins[k]);
+         vhi = MAX2(vhi, maxs[k]);
+      }
+      if (vlo <= vhi) {
+         lo = vlo;
+         hi = vhi;
+      }
+   }
+#endif
+
+   SCALAR_MINMAX(indices, i, count, restart, restart_index, lo, hi);
+
+   *min_index = lo;
+   *max_index = hi;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Minimum/maximum scans over 8, 16 and 32-bit index arrays, shared by the
+ * vbo module and gallium's u_vbuf.
+ *
+ * Indices equal to the restart index are skipped when primitive restart is
+ * enabled.  If no index is left, *min_index is ~0 and *max_index is 0.
+ */
+
+#ifndef INDEX_MINMAX_H
+#define INDEX_MINMAX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void
+util_index_minmax_ubyte(const uint8_t *indices, unsigned count,
+                        bool primitive_restart, unsigned restart_index,
+                        unsigned *min_index, unsigned *max_index);
+
+void
+util_index_minmax_ushort(const uint16_t *indices, unsigned count,
+                         bool primitive_restart, unsigned restart_index,
+                         unsigned *min_index, unsigned *max_index);
+
+void
+util_index_minmax_uint(const uint32_t *indices, unsigned count,
+                       bool primitive_restart, unsigned restart_index,
+                       unsigned *min_index, unsigned *max_index);
+
+/**
+ * Dispatch on the index size in bytes (1, 2 or 4).
+ */
+static inline void
+util_index_minmax(unsigned index_size, const void *indices, unsigned count,
+                  bool primitive_restart, unsigned restart_index,
+                  unsigned *min_index, unsigned *max_index)
+{
+   switch (index_size) {
+   case 1:
+      util_index_minmax_ubyte((const uint8_t *) indices, count,
+                              primitive_restart, restart_index,
+                              min_index, max_index);
+      break;
+   case 2:
+      util_index_minmax_ushort((const uint16_t *) indices, count,
+                               primitive_restart, restart_index,
+                               min_index, max_index);
+      break;
+   default:
+      util_index_minmax_uint((const uint32_t *) indices, count,
+                             primitive_restart, restart_index,
+                             min_index, max_index);
+      break;
+   }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INDEX_MINMAX_H */
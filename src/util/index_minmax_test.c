@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks the index min/max kernels against a plain loop for every index
+ * size, with and without primitive restart, then prints their throughput.
+ */
+
+/* Force assertions, even on debug builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "index_minmax.h"
+
+#define MAX_COUNT 1000
+#define BENCH_COUNT (4 * 1024 * 1024)
+
+static void
+reference(unsigned index_size, const void *indices, unsigned count,
+          bool restart, unsigned restart_index,
+          unsigned *min_index, unsigned *max_index)
+{
+   unsigned i;
+
+   *min_index = ~0u;
+   *max_index = 0;
+   for (i = 0; i < count; i++) {
+      unsigned idx = index_size == 1 ? ((const uint8_t *) indices)[i] :
+                     index_size == 2 ? ((const uint16_t *) indices)[i] :
+                                       ((const uint32_t *) indices)[i];
+      if (restart && idx == restart_index)
+         continue;
+      if (idx < *min_index)
+         *min_index = idx;
+      if (idx > *max_index)
+         *max_index = idx;
+   }
+}
+
+static void
+fill(unsigned index_size, void *indices, unsigned count, unsigned restart_index,
+     unsigned restart_ratio)
+{
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      unsigned idx = (unsigned) rand() * 2654435761u;
+
+      if (restart_ratio && rand() % restart_ratio == 0)
+         idx = restart_index;
+
+      if (index_size == 1)
+         ((uint8_t *) indices)[i] = idx;
+      else if (index_size == 2)
+         ((uint16_t *) indices)[i] = idx;
+      else
+         ((uint32_t *) indices)[i] = idx;
+   }
+}
+
+static void
+check(unsigned index_size, const void *indices, unsigned count,
+      bool restart, unsigned restart_index)
+{
+   unsigned min_ref, max_ref, min_index, max_index;
+
+   reference(index_size, indices, count, restart, restart_index,
+             &min_ref, &max_ref);
+   util_index_minmax(index_size, indices, count, restart, restart_index,
+                     &min_index, &max_index);
+   assert(min_index == min_ref);
+   assert(max_index == max_ref);
+}
+
+static void
+bench(unsigned index_size, void *indices, bool restart)
+{
+   const unsigned iterations = 64;
+   unsigned min_index, max_index, i;
+   clock_t start, ticks;
+
+   fill(index_size, indices, BENCH_COUNT, ~0u, 0);
+
+   start = clock();
+   for (i = 0; i < iterations; i++)
+      util_index_minmax(index_size, indices, BENCH_COUNT, restart, ~0u,
+                        &min_index, &max_index);
+   ticks = clock() - start;
+
+   printf("%2u-bit indices, restart %-3s %8.1f Mindices/s\n",
+          index_size * 8, restart ? "on" : "off",
+          (double) BENCH_COUNT * iterations / 1e6 /
+          ((double) (ticks + 1) / CLOCKS_PER_SEC));
+}
+
+int
+main(int argc, char **argv)
+{
+   static const unsigned sizes[] = { 1, 2, 4 };
+   static const unsigned restart_ratios[] = { 0, 1, 2, 40 };
+   uint32_t *storage = malloc(BENCH_COUNT * sizeof(uint32_t) + 4);
+   unsigned s, count, offset, r;
+
+   assert(storage);
+   srand(0x1234);
+
+   for (s = 0; s < 3; s++) {
+      const unsigned index_size = sizes[s];
+      const unsigned all_ones = index_size == 4 ? ~0u :
+                                (1u << (index_size * 8)) - 1;
+
+      for (count = 0; count < MAX_COUNT; count = count * 2 + 1) {
+         for (offset = 0; offset < 4; offset++) {
+            char *indices = (char *) storage + offset * index_size;
+
+            for (r = 0; r < 4; r++) {
+               const unsigned restart_index =
+                  r & 1 ? all_ones : (unsigned) rand() & all_ones;
+
+               fill(index_size, indices, count, restart_index,
+                    restart_ratios[r]);
+               check(index_size, indices, count, false, restart_index);
+               check(index_size, indices, count, true, restart_index);
+               /* for 8 and 16-bit indices, a restart index they can't hold */
+               check(index_size, indices, count, true, all_ones + 1);
+            }
+         }
+      }
+   }
+
+   for (s = 0; s < 3; s++) {
+      bench(sizes[s], storage, false);
+      bench(sizes[s], storage, true);
+   }
+
+   free(storage);
+
+   return 0;
+}
@@ -0,0 +1,113 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright 2012 Intel Corporation
+ * Copyright 2013 Google
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Authors:
+ *    Chad Versace <chad.versace@linux.intel.com>
+ *    Frank Henigman <fjhenigman@google.com>
+ */
+
+/**
+ * Driver-independent copies between linear memory and the common X/Y
+ * tiled surface layouts.
+ *
+ * The tile walker only knows about byte offsets; any per-texel work
+ * (e.g. swapping the R and B channels of an 8888 format) is done by the
+ * mem_copy_fn handed to it, see tiled_memcpy_get_copy_fn().
+ */
+
+#ifndef TILED_MEMCPY_H
+#define TILED_MEMCPY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *(*mem_copy_fn)(void *dest, const void *src, size_t n);
+
+/**
+ * Tile layouts understood by the tiled memcpy engine.
+ */
+enum tiled_memcpy_tiling {
+   /** 512 bytes x 8 rows, each tile row is contiguous */
+   TILED_MEMCPY_TILING_X,
+   /** 128 bytes x 32 rows, stored as 16-byte wide columns */
+   TILED_MEMCPY_TILING_Y,
+};
+
+/**
+ * Tells tiled_memcpy_get_copy_fn() whether the copy is
+ *
+ *  - an upload with an aligned (tiled) destination and a potentially
+ *    unaligned (linear) source; or
+ *  - a download with an aligned (tiled) source and a potentially
+ *    unaligned (linear) destination.
+ */
+enum tiled_memcpy_direction {
+   TILED_MEMCPY_UPLOAD,
+   TILED_MEMCPY_DOWNLOAD,
+};
+
+/**
+ * Per-texel transformation applied while copying.
+ */
+enum tiled_memcpy_swizzle {
+   /** Straight copy */
+   TILED_MEMCPY_SWIZZLE_NONE,
+   /** Swap bytes 0 and 2 of every 32-bit texel (RGBA8 <-> BGRA8) */
+   TILED_MEMCPY_SWIZZLE_RGBA8_BGRA8,
+};
+
+mem_copy_fn
+tiled_memcpy_get_copy_fn(enum tiled_memcpy_swizzle swizzle,
+                         enum tiled_memcpy_direction direction);
+
+void
+tiled_memcpy_linear_to_tiled(uint32_t xt1, uint32_t xt2,
+                             uint32_t yt1, uint32_t yt2,
+                             char *dst, const char *src,
+                             uint32_t dst_pitch, int32_t src_pitch,
+                             bool has_swizzling,
+                             enum tiled_memcpy_tiling tiling,
+                             mem_copy_fn mem_copy);
+
+void
+tiled_memcpy_tiled_to_linear(uint32_t xt1, uint32_t xt2,
+                             uint32_t yt1, uint32_t yt2,
+                             char *dst, const char *src,
+                             int32_t dst_pitch, uint32_t src_pitch,
+                             bool has_swizzling,
+                             enum tiled_memcpy_tiling tiling,
+                             mem_copy_fn mem_copy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TILED_MEMCPY_H */
@@ -0,0 +1,222 @@
+/*
+ * Copyright © 2015 Intel Corporation
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Checks tiled_memcpy against a straightforward per-byte address
+ * computation for every tiling/swizzle combination, then prints
+ * the throughput of whole-surface copies.
+ */
+
+/* Force assertions, even on debug builds. */
+#undef NDEBUG
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tiled_memcpy.h"
+
+#define TILE_SIZE 4096
+
+#define SURFACE_PITCH  4096   /* bytes, a whole number of X and Y tiles */
+#define SURFACE_HEIGHT 256    /* rows, a whole number of X and Y tiles */
+#define SURFACE_SIZE   (SURFACE_PITCH * SURFACE_HEIGHT)
+
+#define BENCH_ITERATIONS 64
+
+static char *
+alloc_tiled(void **storage)
+{
+   uintptr_t p;
+
+   *storage = malloc(SURFACE_SIZE + TILE_SIZE);
+   assert(*storage);
+   p = ((uintptr_t) *storage + TILE_SIZE - 1) & ~(uintptr_t)(TILE_SIZE - 1);
+   return (char *) p;
+}
+
+/**
+ * Byte offset of linear position (x, y) inside the tiled surface.
+ */
+static uint32_t
+tiled_offset(enum tiled_memcpy_tiling tiling, bool has_swizzling,
+             uint32_t x, uint32_t y)
+{
+   uint32_t tile, in_tile;
+
+   if (tiling == TILED_MEMCPY_TILING_X) {
+      tile = (y / 8) * 8 * SURFACE_PITCH + (x / 512) * TILE_SIZE;
+      in_tile = (y % 8) * 512 + x % 512;
+      if (has_swizzling)
+         in_tile ^= (((in_tile >> 9) ^ (in_tile >> 10)) & 1) << 6;
+   } else {
+      tile = (y / 32) * 32 * SURFACE_PITCH + (x / 128) * TILE_SIZE;
+      in_tile = ((x % 128) / 16) * 512 + (y % 32) * 16 + x % 16;
+      if (has_swizzling)
+         in_tile ^= ((in_tile >> 9) & 1) << 6;
+   }
+
+   return tile + in_tile;
+}
+
+/* Where byte 'x' of a linear row comes from once swizzled. */
+static uint32_t
+swizzled_x(enum tiled_memcpy_swizzle swizzle, uint32_t x)
+{
+   static const uint8_t rgba8_permutation[4] = { 2, 1, 0, 3 };
+
+   if (swizzle == TILED_MEMCPY_SWIZZLE_RGBA8_BGRA8)
+      return (x & ~3u) + rgba8_permutation[x & 3];
+   return x;
+}
+
+static void
+test_rect(enum tiled_memcpy_tiling tiling, enum tiled_memcpy_swizzle swizzle,
+          bool has_swizzling,
+          uint32_t x1, uint32_t x2, uint32_t y1, uint32_t y2,
+          char *tiled, char *linear, char *readback)
+{
+   mem_copy_fn upload =
+      tiled_memcpy_get_copy_fn(swizzle, TILED_MEMCPY_UPLOAD);
+   mem_copy_fn download =
+      tiled_memcpy_get_copy_fn(swizzle, TILED_MEMCPY_DOWNLOAD);
+   uint32_t x, y;
+
+   memset(tiled, 0, SURFACE_SIZE);
+   memset(readback, 0, SURFACE_SIZE);
+
+   tiled_memcpy_linear_to_tiled(x1, x2, y1, y2, tiled, linear,
+                                SURFACE_PITCH, SURFACE_PITCH, has_swizzling,
+                                tiling, upload);
+
+   for (y = y1; y < y2; y++) {
+      for (x = x1; x < x2; x++) {
+         uint32_t offset = tiled_offset(tiling, has_swizzling, x, y);
+         assert(tiled[offset] ==
+                linear[y * SURFACE_PITCH + swizzled_x(swizzle, x)]);
+      }
+   }
+
+   tiled_memcpy_tiled_to_linear(x1, x2, y1, y2, readback, tiled,
+                                SURFACE_PITCH, SURFACE_PITCH, has_swizzling,
+                                tiling, download);
+
+   for (y = 0; y < SURFACE_HEIGHT; y++) {
+      for (x = 0; x < SURFACE_PITCH; x++) {
+         char expected = 0;
+
+         if (x >= x1 && x < x2 && y >= y1 && y < y2)
+            expected = linear[y * SURFACE_PITCH + x];
+         assert(readback[y * SURFACE_PITCH + x] == expected);
+      }
+   }
+}
+
+static void
+bench(enum tiled_memcpy_tiling tiling, enum tiled_memcpy_swizzle swizzle,
+      char *tiled, char *linear)
+{
+   mem_copy_fn upload =
+      tiled_memcpy_get_copy_fn(swizzle, TILED_MEMCPY_UPLOAD);
+   mem_copy_fn download =
+      tiled_memcpy_get_copy_fn(swizzle, TILED_MEMCPY_DOWNLOAD);
+   double mb = (double) SURFACE_SIZE * BENCH_ITERATIONS / (1024.0 * 1024.0);
+   clock_t start, upload_ticks, download_ticks;
+   unsigned i;
+
+   start = clock();
+   for (i = 0; i < BENCH_ITERATIONS; i++)
+      tiled_memcpy_linear_to_tiled(0, SURFACE_PITCH, 0, SURFACE_HEIGHT,
+                                   tiled, linear,
+                                   SURFACE_PITCH, SURFACE_PITCH, true,
+                                   tiling, upload);
+   upload_ticks = clock() - start;
+
+   start = clock();
+   for (i = 0; i < BENCH_ITERATIONS; i++)
+      tiled_memcpy_tiled_to_linear(0, SURFACE_PITCH, 0, SURFACE_HEIGHT,
+                                   linear, tiled,
+                                   SURFACE_PITCH, SURFACE_PITCH, true,
+                                   tiling, download);
+   download_ticks = clock() - start;
+
+   printf("%s-tiled %-13s upload %8.1f MB/s  download %8.1f MB/s\n",
+          tiling == TILED_MEMCPY_TILING_X ? "X" : "Y",
+          swizzle == TILED_MEMCPY_SWIZZLE_NONE ? "memcpy" : "rgba8<->bgra8",
+          mb / ((double) (upload_ticks + 1) / CLOCKS_PER_SEC),
+          mb / ((double) (download_ticks + 1) / CLOCKS_PER_SEC));
+}
+
+int
+main(int argc, char **argv)
+{
+   static const uint32_t rects[][4] = {
+      /* x1, x2, y1, y2 */
+      { 0, SURFACE_PITCH, 0, SURFACE_HEIGHT },
+      { 0, 512, 0, 8 },
+      { 0, 128, 0, 32 },
+      { 4, 60, 3, 5 },
+      { 12, 1036, 1, 67 },
+      { 500, 3000, 31, 200 },
+      { 1020, 1028, 255, 256 },
+   };
+   void *tiled_storage;
+   char *tiled = alloc_tiled(&tiled_storage);
+   char *linear = malloc(SURFACE_SIZE);
+   char *readback = malloc(SURFACE_SIZE);
+   unsigned i, t, s, has_swizzling;
+
+   assert(linear && readback);
+
+   srand(0x1234);
+   for (i = 0; i < SURFACE_SIZE; i++)
+      linear[i] = rand();
+
+   for (t = TILED_MEMCPY_TILING_X; t <= TILED_MEMCPY_TILING_Y; t++) {
+      for (s = TILED_MEMCPY_SWIZZLE_NONE;
+           s <= TILED_MEMCPY_SWIZZLE_RGBA8_BGRA8; s++) {
+         for (has_swizzling = 0; has_swizzling < 2; has_swizzling++) {
+            for (i = 0; i < sizeof(rects) / sizeof(rects[0]); i++) {
+               test_rect(t, s, has_swizzling,
+                         rects[i][0], rects[i][1], rects[i][2], rects[i][3],
+                         tiled, linear, readback);
+            }
+         }
+      }
+   }
+
+   for (t = TILED_MEMCPY_TILING_X; t <= TILED_MEMCPY_TILING_Y; t++) {
+      for (s = TILED_MEMCPY_SWIZZLE_NONE;
+           s <= TILED_MEMCPY_SWIZZLE_RGBA8_BGRA8; s++) {
+         bench(t, s, tiled, readback);
+      }
+   }
+
+   free(readback);
+   free(linear);
+   free(tiled_storage);
+
+   return 0;
+}